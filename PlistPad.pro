@@ -6,7 +6,7 @@
 
 QT       += core gui
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
 TARGET = PlistPad
 TEMPLATE = app
@@ -15,26 +15,25 @@ TEMPLATE = app
 SOURCES += src/main.cpp\
     src/dialogs/AboutDialog.cpp \
     src/dialogs/FindReplaceDialog.cpp \
+    src/dialogs/CompareDialog.cpp \
     src/ComboBoxDelegate.cpp \
     src/MainWindow.cpp \
-    src/model/PlistTreeWriter.cpp \
-    src/model/PlistTreeItem.cpp \
-    src/model/PlistTreeModel.cpp \
-    src/model/PlistTreeReader.cpp
+    src/PlistCommandLine.cpp
 
 HEADERS  += \
     src/dialogs/AboutDialog.h \
     src/dialogs/FindReplaceDialog.h \
+    src/dialogs/CompareDialog.h \
     src/ComboBoxDelegate.h \
     src/MainWindow.h \
-    src/model/PlistTreeModel.h \
-    src/model/PlistTreeItem.h \
-    src/model/PlistTreeReader.h \
-    src/model/PlistTreeWriter.h
+    src/PlistCommandLine.h
+
+include(src/model/model.pri)
 
 FORMS    += \
     src/dialogs/AboutDialog.ui \
     src/dialogs/FindReplaceDialog.ui \
+    src/dialogs/CompareDialog.ui \
     src/MainWindow.ui
 
 OTHER_FILES +=
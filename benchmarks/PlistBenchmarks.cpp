@@ -0,0 +1,896 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+
+#include "PlistCorpusGenerator.h"
+#include "PlistTreeArena.h"
+#include "PlistTreeModel.h"
+#include "PlistTreeReader.h"
+#include "PlistTreeWriter.h"
+#include "PlistBinaryTreeReader.h"
+#include "PlistBinaryTreeWriter.h"
+#include "PlistXmlEmitter.h"
+#include "PlistTreeDiff.h"
+#include "PlistTreeMerge.h"
+#include "PlistTreeQuery.h"
+#include "PlistSearchIndex.h"
+#include "PlistTreeSearchCursor.h"
+#include "PlistTreeReplacer.h"
+#include "PlistTreeFilterModel.h"
+#include "PlistTreeSortModel.h"
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+
+namespace {
+    // Peak resident set size of this process, in bytes (0 if we don't know how to find out).
+    qint64 PeakResidentSetSize()
+    {
+#if defined(Q_OS_WIN)
+        PROCESS_MEMORY_COUNTERS counters;
+
+        if ( GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ) {
+            return static_cast<qint64>(counters.PeakWorkingSetSize);
+        }
+
+        return 0;
+#elif defined(Q_OS_UNIX)
+        struct rusage usage;
+
+        if ( getrusage(RUSAGE_SELF, &usage) != 0 ) {
+            return 0;
+        }
+
+#if defined(Q_OS_MAC)
+        return static_cast<qint64>(usage.ru_maxrss);            // Bytes on OS X
+#else
+        return static_cast<qint64>(usage.ru_maxrss) * 1024;     // Kilobytes elsewhere
+#endif
+#else
+        return 0;
+#endif
+    }
+
+
+    // Visit every cell the way a view would, returning the number of items seen.
+    qint64 TraverseModel(QAbstractItemModel &model, const QModelIndex &parent)
+    {
+        qint64 count = 0;
+        int rows = model.rowCount(parent);
+
+        for( int row = 0; row < rows; ++row )
+        {
+            QModelIndex index = model.index(row, 0, parent);
+
+            for( int column = 0; column < model.columnCount(parent); ++column ) {
+                model.data(index.sibling(row, column), Qt::DisplayRole);
+            }
+
+            count += 1 + TraverseModel(model, index);
+        }
+
+        return count;
+    }
+}
+
+
+/**
+ * @brief Throughput benchmarks for reading, writing, searching and traversing Plist trees.
+ *
+ * Every benchmark runs once per corpus shape. Alongside the usual QTest timings, each one
+ * prints MB/s (of the file being read or written), items/s and the peak RSS so far.
+ */
+class PlistBenchmarks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void readXml_data();
+    void readXml();
+    void readBinary_data();
+    void readBinary();
+    void writeXml_data();
+    void writeXml();
+    void writeBinary_data();
+    void writeBinary();
+    void saveLargeDocument();
+    void formatNumbers_data();
+    void formatNumbers();
+    void findReplace_data();
+    void findReplace();
+    void findReplaceRegex_data();
+    void findReplaceRegex();
+    void countReplacements_data();
+    void countReplacements();
+    void traverseModel_data();
+    void traverseModel();
+    void hashTree_data();
+    void hashTree();
+    void diffTrees_data();
+    void diffTrees();
+    void mergeTrees_data();
+    void mergeTrees();
+    void queryTree_data();
+    void queryTree();
+    void itemFootprint_data();
+    void itemFootprint();
+    void searchIndex_data();
+    void searchIndex();
+    void searchCursor_data();
+    void searchCursor();
+    void filterTree_data();
+    void filterTree();
+    void sortKeys_data();
+    void sortKeys();
+
+private:
+    void shapeData();
+    void report(const QString &what, qint64 bytes, qint64 items, qint64 nsecs, int iterations);
+
+    QTemporaryDir _dir;
+    QVector<PlistTreeItem*> _trees;
+    QVector<QString> _xmlFiles;
+    QVector<QString> _binaryFiles;
+    QVector<qint64> _itemCounts;
+};
+
+
+void PlistBenchmarks::initTestCase()
+{
+    QVERIFY(_dir.isValid());
+
+    int scale = qMax(qgetenv("PLISTPAD_BENCHMARK_SCALE").toInt(), 1);
+    PlistCorpusGenerator generator;
+
+    for( int shape = 0; shape < PlistCorpusGenerator::SHAPE_COUNT; ++shape )
+    {
+        QString name = PlistCorpusGenerator::ShapeName(static_cast<PlistCorpusGenerator::Shape>(shape));
+        PlistTreeItem *tree = generator.generate(static_cast<PlistCorpusGenerator::Shape>(shape), scale);
+
+        QString xmlFile = _dir.filePath(name + ".plist");
+        QString binaryFile = _dir.filePath(name + ".bplist");
+
+        PlistTreeWriter xmlWriter = PlistTreeWriter();
+        QVERIFY(xmlWriter.writeTreeToFile(tree, xmlFile));
+
+        PlistBinaryTreeWriter binaryWriter = PlistBinaryTreeWriter();
+        QVERIFY(binaryWriter.writeTreeToFile(tree, binaryFile));
+
+        _trees.append(tree);
+        _xmlFiles.append(xmlFile);
+        _binaryFiles.append(binaryFile);
+        _itemCounts.append(PlistCorpusGenerator::CountItems(tree));
+
+        qDebug("Corpus %s: %lld items, %.1f MB XML, %.1f MB binary", qPrintable(name), _itemCounts.last(),
+               QFileInfo(xmlFile).size() / 1048576.0, QFileInfo(binaryFile).size() / 1048576.0);
+    }
+}
+
+
+void PlistBenchmarks::cleanupTestCase()
+{
+    qDeleteAll(_trees);
+    _trees.clear();
+
+    qDebug("Peak RSS: %.1f MB", PeakResidentSetSize() / 1048576.0);
+}
+
+
+void PlistBenchmarks::readXml_data()
+{
+    shapeData();
+}
+
+
+void PlistBenchmarks::readXml()
+{
+    QFETCH(int, shape);
+    QString fileName = _xmlFiles.at(shape);
+
+    QElapsedTimer timer;
+    int iterations = 0;
+    timer.start();
+
+    QBENCHMARK {
+        PlistTreeArena arena;
+        PlistTreeReader itemReader = PlistTreeReader();
+        itemReader.setArena(&arena);
+        QVERIFY(itemReader.readTreeFromFile(fileName) != nullptr);
+        iterations++;
+    }
+
+    report("read XML", QFileInfo(fileName).size(), _itemCounts.at(shape), timer.nsecsElapsed(), iterations);
+}
+
+
+void PlistBenchmarks::readBinary_data()
+{
+    shapeData();
+}
+
+
+void PlistBenchmarks::readBinary()
+{
+    QFETCH(int, shape);
+    QString fileName = _binaryFiles.at(shape);
+
+    QElapsedTimer timer;
+    int iterations = 0;
+    timer.start();
+
+    QBENCHMARK {
+        PlistTreeArena arena;
+        PlistBinaryTreeReader itemReader = PlistBinaryTreeReader();
+        itemReader.setArena(&arena);
+        QVERIFY(itemReader.readTreeFromFile(fileName) != nullptr);
+        iterations++;
+    }
+
+    report("read binary", QFileInfo(fileName).size(), _itemCounts.at(shape), timer.nsecsElapsed(), iterations);
+}
+
+
+void PlistBenchmarks::writeXml_data()
+{
+    shapeData();
+}
+
+
+void PlistBenchmarks::writeXml()
+{
+    QFETCH(int, shape);
+    QString fileName = _dir.filePath("write.plist");
+
+    QElapsedTimer timer;
+    int iterations = 0;
+    timer.start();
+
+    QBENCHMARK {
+        PlistTreeWriter itemWriter = PlistTreeWriter();
+        QVERIFY(itemWriter.writeTreeToFile(_trees.at(shape), fileName));
+        iterations++;
+    }
+
+    report("write XML", QFileInfo(fileName).size(), _itemCounts.at(shape), timer.nsecsElapsed(), iterations);
+}
+
+
+void PlistBenchmarks::writeBinary_data()
+{
+    shapeData();
+}
+
+
+void PlistBenchmarks::writeBinary()
+{
+    QFETCH(int, shape);
+    QString fileName = _dir.filePath("write.bplist");
+
+    QElapsedTimer timer;
+    int iterations = 0;
+    timer.start();
+
+    QBENCHMARK {
+        PlistBinaryTreeWriter itemWriter = PlistBinaryTreeWriter();
+        QVERIFY(itemWriter.writeTreeToFile(_trees.at(shape), fileName));
+        iterations++;
+    }
+
+    report("write binary", QFileInfo(fileName).size(), _itemCounts.at(shape), timer.nsecsElapsed(), iterations);
+}
+
+
+void PlistBenchmarks::saveLargeDocument()
+{
+    // A few hundred MB of XML without a few GB of tree: the blobs all share one buffer.
+    // (Binary output would collapse them into a single object, so this is XML only.)
+    const int scale = qMax(qgetenv("PLISTPAD_BENCHMARK_SCALE").toInt(), 1);
+    const int blobCount = 192 * scale;
+
+    QByteArray blob(1024 * 1024, Qt::Uninitialized);
+
+    for( int i = 0; i < blob.size(); ++i ) {
+        blob[i] = static_cast<char>(i * 131 + (i >> 9));
+    }
+
+    PlistTreeItem *root = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistDictionary);
+    root->aendChild(PlistTreeItem::Clone(nullptr, *_trees.at(PlistCorpusGenerator::NumericArray)));
+
+    for( int i = 0; i < blobCount; ++i ) {
+        PlistTreeItem *item = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistData, QString("blob-%1").arg(i));
+        item->setValueRetainType(blob);
+        root->aendChild(item);
+    }
+
+    QString fileName = _dir.filePath("large.plist");
+    qint64 items = PlistCorpusGenerator::CountItems(root);
+
+    QElapsedTimer timer;
+    int iterations = 0;
+    timer.start();
+
+    QBENCHMARK {
+        PlistTreeWriter itemWriter = PlistTreeWriter();
+        QVERIFY(itemWriter.writeTreeToFile(root, fileName));
+        iterations++;
+    }
+
+    report("save large document", QFileInfo(fileName).size(), items, timer.nsecsElapsed(), iterations);
+    QFile::remove(fileName);
+    delete root;
+}
+
+
+void PlistBenchmarks::formatNumbers_data()
+{
+    QTest::addColumn<bool>("viaVariant");
+
+    QTest::newRow("variant") << true;
+    QTest::newRow("emitter") << false;
+}
+
+
+void PlistBenchmarks::formatNumbers()
+{
+    // Formatting the numeric corpus's values the way the writer used to (a QVariant and
+    // QString per value) against the emitter's direct formatting into a reused buffer.
+    QFETCH(bool, viaVariant);
+    PlistTreeItem *root = _trees.at(PlistCorpusGenerator::NumericArray);
+    QByteArray buffer;
+    PlistXmlEmitter emitter(&buffer);
+    qint64 bytes = 0;
+
+    QElapsedTimer timer;
+    int iterations = 0;
+    timer.start();
+
+    QBENCHMARK {
+        buffer.resize(0);
+
+        for( int i = 0; i < root->childCount(); ++i )
+        {
+            PlistTreeItem *item = root->child(i);
+
+            if ( viaVariant ) {
+                buffer.append(item->getValue().toString().toUtf8());
+            } else if ( item->plistType() == PlistTreeItem::PlistInteger ) {
+                emitter.writeIntegerElement(item->value().integer(), 0);
+            } else {
+                emitter.writeRealElement(item->value().real(), 0);
+            }
+        }
+
+        bytes = buffer.size();
+        iterations++;
+    }
+
+    report("format numbers", bytes, root->childCount(), timer.nsecsElapsed(), iterations);
+}
+
+
+void PlistBenchmarks::findReplace_data()
+{
+    shapeData();
+}
+
+
+void PlistBenchmarks::findReplace()
+{
+    QFETCH(int, shape);
+
+    // Replacing a word with itself matches everywhere the word appears without changing
+    // the tree, so every iteration does the same amount of work.
+    PlistTreeModel model(PlistTreeItem::Clone(nullptr, *_trees.at(shape)));
+    QString find = PlistCorpusGenerator::CommonWord();
+    QString replace = find;
+
+    QElapsedTimer timer;
+    int iterations = 0;
+    timer.start();
+
+    QBENCHMARK {
+        model.findReplace(find, replace, ReplaceAll, ReplaceModeNormal);
+        iterations++;
+    }
+
+    report("find/replace", QFileInfo(_xmlFiles.at(shape)).size(), _itemCounts.at(shape), timer.nsecsElapsed(), iterations);
+}
+
+
+void PlistBenchmarks::findReplaceRegex_data()
+{
+    shapeData();
+}
+
+
+void PlistBenchmarks::findReplaceRegex()
+{
+    QFETCH(int, shape);
+
+    // As above, but through a capture so that the regular expression engine does all the work.
+    PlistTreeModel model(PlistTreeItem::Clone(nullptr, *_trees.at(shape)));
+    QString find = QString("(%1)").arg(PlistCorpusGenerator::CommonWord());
+    QString replace = "\\1";
+
+    QElapsedTimer timer;
+    int iterations = 0;
+    timer.start();
+
+    QBENCHMARK {
+        QVERIFY(model.findReplace(find, replace, ReplaceAll, ReplaceModeRegularExpression, Qt::CaseInsensitive) >= 0);
+        iterations++;
+    }
+
+    report("regex find/replace", QFileInfo(_xmlFiles.at(shape)).size(), _itemCounts.at(shape), timer.nsecsElapsed(), iterations);
+}
+
+
+void PlistBenchmarks::countReplacements_data()
+{
+    shapeData();
+}
+
+
+void PlistBenchmarks::countReplacements()
+{
+    QFETCH(int, shape);
+
+    // Just the parallel search, which a dry run never follows with any changes.
+    PlistTreeModel model(PlistTreeItem::Clone(nullptr, *_trees.at(shape)));
+    QString find = PlistCorpusGenerator::CommonWord();
+    QString replace = find.toUpper();
+    const quint64 hash = model.visibleRoot()->subtreeHash();
+
+    QElapsedTimer timer;
+    int iterations = 0;
+    timer.start();
+
+    QBENCHMARK {
+        QVERIFY(model.findReplace(find, replace, ReplaceAll, ReplaceModeNormal, Qt::CaseSensitive, true) >= 0);
+        iterations++;
+    }
+
+    report("count replacements", QFileInfo(_xmlFiles.at(shape)).size(), _itemCounts.at(shape), timer.nsecsElapsed(), iterations);
+    QCOMPARE(model.visibleRoot()->subtreeHash(), hash);
+}
+
+
+void PlistBenchmarks::traverseModel_data()
+{
+    shapeData();
+}
+
+
+void PlistBenchmarks::traverseModel()
+{
+    QFETCH(int, shape);
+    PlistTreeModel model(PlistTreeItem::Clone(nullptr, *_trees.at(shape)));
+
+    QElapsedTimer timer;
+    int iterations = 0;
+    timer.start();
+
+    QBENCHMARK {
+        QCOMPARE(TraverseModel(model, QModelIndex()), _itemCounts.at(shape));
+        iterations++;
+    }
+
+    report("traverse", QFileInfo(_xmlFiles.at(shape)).size(), _itemCounts.at(shape), timer.nsecsElapsed(), iterations);
+}
+
+
+void PlistBenchmarks::hashTree_data()
+{
+    shapeData();
+}
+
+
+void PlistBenchmarks::hashTree()
+{
+    QFETCH(int, shape);
+
+    // Hashes are cached, so only the first pass over a fresh copy does any work.
+    PlistTreeItem *root = PlistTreeItem::Clone(nullptr, *_trees.at(shape));
+    QElapsedTimer timer;
+    timer.start();
+
+    QBENCHMARK_ONCE {
+        PlistTreeItem::ComputeHashesInParallel(root);
+    }
+
+    report("hash", QFileInfo(_xmlFiles.at(shape)).size(), _itemCounts.at(shape), timer.nsecsElapsed(), 1);
+
+    // A copy has the same content, so it must have the same hash.
+    quint64 hash = root->subtreeHash();
+    delete root;
+    QCOMPARE(hash, _trees.at(shape)->subtreeHash());
+}
+
+
+void PlistBenchmarks::diffTrees_data()
+{
+    shapeData();
+}
+
+
+void PlistBenchmarks::diffTrees()
+{
+    QFETCH(int, shape);
+
+    // Change the last leaf of a copy, so the diff has to find its way down to it.
+    PlistTreeItem *changed = PlistTreeItem::Clone(nullptr, *_trees.at(shape));
+    PlistTreeItem *leaf = changed;
+
+    while( leaf->childCount() > 0 ) {
+        leaf = leaf->child(leaf->childCount() - 1);
+    }
+
+    leaf->setValueAndType(QVariant(QString("changed by diffTrees")));
+    PlistTreeItem::ComputeHashesInParallel(changed);
+    PlistTreeItem::ComputeHashesInParallel(_trees.at(shape));
+
+    PlistTreeDiff diff;
+    QElapsedTimer timer;
+    int iterations = 0;
+    timer.start();
+
+    QBENCHMARK {
+        diff.compare(_trees.at(shape), changed);
+        iterations++;
+    }
+
+    report("diff", QFileInfo(_xmlFiles.at(shape)).size(), _itemCounts.at(shape), timer.nsecsElapsed(), iterations);
+
+    int editCount = diff.edits().count();
+    delete changed;
+    QCOMPARE(editCount, 1);
+}
+
+
+void PlistBenchmarks::mergeTrees_data()
+{
+    shapeData();
+}
+
+
+void PlistBenchmarks::mergeTrees()
+{
+    QFETCH(int, shape);
+
+    // Each side changes a different leaf, so the merge is clean but has to reach both.
+    PlistTreeItem *ours = PlistTreeItem::Clone(nullptr, *_trees.at(shape));
+    PlistTreeItem *theirs = PlistTreeItem::Clone(nullptr, *_trees.at(shape));
+    PlistTreeItem *oursLeaf = ours;
+    PlistTreeItem *theirsLeaf = theirs;
+
+    while( oursLeaf->childCount() > 0 ) {
+        oursLeaf = oursLeaf->child(oursLeaf->childCount() - 1);
+    }
+
+    while( theirsLeaf->childCount() > 0 ) {
+        theirsLeaf = theirsLeaf->child(0);
+    }
+
+    oursLeaf->setValueAndType(QVariant(QString("changed by ours")));
+    theirsLeaf->setValueAndType(QVariant(QString("changed by theirs")));
+
+    PlistTreeMerge merger;
+    QElapsedTimer timer;
+    int iterations = 0;
+    int conflicts = 0;
+    timer.start();
+
+    QBENCHMARK {
+        PlistTreeArena arena;
+        merger.setArena(&arena);
+        merger.merge(_trees.at(shape), ours, theirs);
+        conflicts = merger.conflictCount();
+        iterations++;
+    }
+
+    report("merge", QFileInfo(_xmlFiles.at(shape)).size(), _itemCounts.at(shape), timer.nsecsElapsed(), iterations);
+
+    delete ours;
+    delete theirs;
+    QCOMPARE(conflicts, 0);
+}
+
+
+void PlistBenchmarks::queryTree_data()
+{
+    shapeData();
+}
+
+
+void PlistBenchmarks::queryTree()
+{
+    QFETCH(int, shape);
+
+    // A wildcard over every descendant, which is the worst case for a path.
+    PlistTreeQuery everything;
+    QVERIFY(everything.compile("Root..*"));
+
+    QElapsedTimer timer;
+    int iterations = 0;
+    int matches = 0;
+    timer.start();
+
+    QBENCHMARK {
+        matches = everything.evaluate(_trees.at(shape)).count();
+        iterations++;
+    }
+
+    report("query", QFileInfo(_xmlFiles.at(shape)).size(), _itemCounts.at(shape), timer.nsecsElapsed(), iterations);
+    QCOMPARE(qint64(matches), _itemCounts.at(shape) - 1);
+
+    // The path of the last leaf should lead straight back to it.
+    PlistTreeItem *leaf = _trees.at(shape);
+
+    while( leaf->childCount() > 0 ) {
+        leaf = leaf->child(leaf->childCount() - 1);
+    }
+
+    PlistTreeQuery path;
+    QVERIFY(path.compile(PlistTreeQuery::PathForItem(leaf)));
+
+    QList<PlistTreeItem*> found = path.evaluate(_trees.at(shape));
+    QCOMPARE(found.count(), 1);
+    QVERIFY(found.first() == leaf);
+}
+
+
+void PlistBenchmarks::itemFootprint_data()
+{
+    shapeData();
+}
+
+
+void PlistBenchmarks::itemFootprint()
+{
+    QFETCH(int, shape);
+
+    // Not timed: read the corpus into an arena and see how much of it each item takes up.
+    PlistTreeArena arena;
+    PlistTreeReader itemReader = PlistTreeReader();
+    itemReader.setArena(&arena);
+    QVERIFY(itemReader.readTreeFromFile(_xmlFiles.at(shape)) != nullptr);
+
+    qint64 items = _itemCounts.at(shape);
+
+    qDebug("item footprint %s: %d bytes per item, %.1f arena bytes per item, %.1f MB for %lld items", QTest::currentDataTag(),
+           int(sizeof(PlistTreeItem)), double(arena.reservedBytes()) / items, arena.reservedBytes() / 1048576.0, items);
+}
+
+
+void PlistBenchmarks::searchIndex_data()
+{
+    shapeData();
+}
+
+
+void PlistBenchmarks::searchIndex()
+{
+    QFETCH(int, shape);
+
+    // Building happens on a worker thread, so time it through to the ready signal.
+    PlistSearchIndex index;
+    QSignalSpy ready(&index, SIGNAL(ready()));
+
+    QElapsedTimer buildTimer;
+    buildTimer.start();
+    index.build(_trees.at(shape));
+    QVERIFY(ready.wait(600000));
+    report("index build", QFileInfo(_xmlFiles.at(shape)).size(), _itemCounts.at(shape), buildTimer.nsecsElapsed(), 1);
+
+    QString find = PlistCorpusGenerator::CommonWord();
+    QElapsedTimer timer;
+    int iterations = 0;
+    int matches = 0;
+    timer.start();
+
+    QBENCHMARK {
+        matches = index.find(find, ReplaceAll).count();
+        iterations++;
+    }
+
+    report("indexed find", QFileInfo(_xmlFiles.at(shape)).size(), _itemCounts.at(shape), timer.nsecsElapsed(), iterations);
+
+    // The index only narrows things down, so it has to agree with a plain walk of the tree.
+    int walked = 0;
+    QVector<PlistTreeItem*> stack;
+    stack.append(_trees.at(shape));
+
+    while( !stack.isEmpty() )
+    {
+        PlistTreeItem *item = stack.takeLast();
+        const PlistTreeItem *parent = item->parent();
+
+        if ( (parent != nullptr && parent->shouldChildrenHaveKey() && item->key().contains(find))
+             || (item->plistType() == PlistTreeItem::PlistString && item->value().string().contains(find)) ) {
+            walked++;
+        }
+
+        for( int i = 0; i < item->childCount(); ++i ) {
+            stack.append(item->child(i));
+        }
+    }
+
+    QCOMPARE(matches, walked);
+}
+
+
+void PlistBenchmarks::searchCursor_data()
+{
+    shapeData();
+}
+
+
+void PlistBenchmarks::searchCursor()
+{
+    QFETCH(int, shape);
+
+    // Find Next pressed over and over, all the way round the document.
+    PlistTextMatcher matcher(PlistCorpusGenerator::CommonWord());
+    PlistTreeSearchCursor cursor(_trees.at(shape));
+
+    QElapsedTimer timer;
+    int iterations = 0;
+    int matches = 0;
+    timer.start();
+
+    QBENCHMARK {
+        cursor.setPosition(nullptr);
+        PlistTreeItem *first = cursor.findNext(matcher, ReplaceAll);
+        matches = 0;
+
+        // Searches wrap, so the first match coming round again means we've seen them all.
+        for( PlistTreeItem *item = first; item != nullptr; )
+        {
+            matches++;
+            item = cursor.findNext(matcher, ReplaceAll);
+
+            if ( item == first ) {
+                break;
+            }
+        }
+
+        iterations++;
+    }
+
+    report("find next", QFileInfo(_xmlFiles.at(shape)).size(), _itemCounts.at(shape), timer.nsecsElapsed(), iterations);
+
+    // Every match once, the same as a full search.
+    PlistTreeReplacer replacer = PlistTreeReplacer(matcher, QString(), ReplaceAll);
+    QCOMPARE(matches, replacer.countMatches(_trees.at(shape)));
+}
+
+
+void PlistBenchmarks::filterTree_data()
+{
+    shapeData();
+}
+
+
+void PlistBenchmarks::filterTree()
+{
+    QFETCH(int, shape);
+
+    // Typing a word into the filter box: a full pass for the first letters, then narrowing passes.
+    PlistTreeModel model(PlistTreeItem::Clone(nullptr, *_trees.at(shape)));
+    PlistTreeFilterModel filter(&model);
+    QString word = PlistCorpusGenerator::CommonWord();
+
+    QElapsedTimer timer;
+    int iterations = 0;
+    timer.start();
+
+    QBENCHMARK {
+        filter.setFilterText(QString());
+
+        for( int length = 1; length <= word.length(); ++length ) {
+            filter.setFilterText(word.left(length));
+        }
+
+        iterations++;
+    }
+
+    report("filter", QFileInfo(_xmlFiles.at(shape)).size(), _itemCounts.at(shape), timer.nsecsElapsed(), iterations * word.length());
+
+    // Narrowing has to end up where filtering from scratch would.
+    PlistTreeReplacer replacer = PlistTreeReplacer(PlistTextMatcher(word, ReplaceModeNormal, Qt::CaseInsensitive), QString(), ReplaceAll);
+    QCOMPARE(filter.matchCount(), replacer.countMatches(model.visibleRoot()));
+}
+
+
+void PlistBenchmarks::sortKeys_data()
+{
+    shapeData();
+}
+
+
+void PlistBenchmarks::sortKeys()
+{
+    QFETCH(int, shape);
+
+    // Everything expanded, as a view would have it, so that every dictionary gets sorted.
+    PlistTreeModel model(PlistTreeItem::Clone(nullptr, *_trees.at(shape)));
+    PlistTreeFilterModel filter(&model);
+    PlistTreeSortModel sort(&filter);
+    TraverseModel(sort, QModelIndex());
+
+    // The first time works out the collation keys...
+    QElapsedTimer timer;
+    timer.start();
+    sort.setSortByKey(true);
+    report("sort", QFileInfo(_xmlFiles.at(shape)).size(), _itemCounts.at(shape), timer.nsecsElapsed(), 1);
+
+    // ...after which turning it off and on again only sorts.
+    int iterations = 0;
+    timer.restart();
+
+    QBENCHMARK {
+        sort.setSortByKey(false);
+        sort.setSortByKey(true);
+        iterations++;
+    }
+
+    report("sort toggle", QFileInfo(_xmlFiles.at(shape)).size(), _itemCounts.at(shape), timer.nsecsElapsed(), iterations);
+
+    // Nothing lost, and the top level really is in order.
+    QCOMPARE(TraverseModel(sort, QModelIndex()), _itemCounts.at(shape));
+
+    QModelIndex rootIndex = sort.index(0, 0);
+    QCollator collator;
+    collator.setNumericMode(true);
+    collator.setCaseSensitivity(Qt::CaseInsensitive);
+
+    if ( model.visibleRoot()->shouldChildrenHaveKey() )
+    {
+        for( int row = 1; row < sort.rowCount(rootIndex); ++row ) {
+            QVERIFY(collator.compare(sort.index(row - 1, 0, rootIndex).data().toString(), sort.index(row, 0, rootIndex).data().toString()) <= 0);
+        }
+    }
+}
+
+
+//
+// Private Methods
+//
+
+
+void PlistBenchmarks::shapeData()
+{
+    QTest::addColumn<int>("shape");
+
+    for( int shape = 0; shape < PlistCorpusGenerator::SHAPE_COUNT; ++shape ) {
+        QTest::newRow(qPrintable(PlistCorpusGenerator::ShapeName(static_cast<PlistCorpusGenerator::Shape>(shape)))) << shape;
+    }
+}
+
+
+void PlistBenchmarks::report(const QString &what, qint64 bytes, qint64 items, qint64 nsecs, int iterations)
+{
+    if ( iterations == 0 || nsecs <= 0 ) {
+        return;
+    }
+
+    // Timer covers QTest's own bookkeeping too, so treat these as slightly pessimistic.
+    double seconds = (nsecs / 1e9) / iterations;
+
+    qDebug("%s %s: %.1f MB/s, %.0f items/s, peak RSS %.1f MB", qPrintable(what), QTest::currentDataTag(),
+           (bytes / 1048576.0) / seconds, items / seconds, PeakResidentSetSize() / 1048576.0);
+}
+
+
+QTEST_GUILESS_MAIN(PlistBenchmarks)
+
+#include "PlistBenchmarks.moc"
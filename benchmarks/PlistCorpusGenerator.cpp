@@ -0,0 +1,250 @@
+#include "PlistCorpusGenerator.h"
+
+#include <QDateTime>
+
+
+namespace {
+    const char * const WORDS[] = {
+        "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel",
+        "india", "juliet", "kilo", "lima", "mike", "november", "oscar", "papa",
+    };
+
+    const int WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+
+    // Keep chains well inside the binary reader's nesting limit.
+    const int NESTING_DEPTH = 400;
+}
+
+
+PlistCorpusGenerator::PlistCorpusGenerator(quint32 seed)
+{
+    _state = (seed != 0) ? seed : 1;
+}
+
+
+PlistTreeItem * PlistCorpusGenerator::generate(Shape shape, int scale)
+{
+    scale = qMax(scale, 1);
+
+    switch( shape )
+    {
+    case WideDictionary: return wideDictionary(scale);
+    case DeepNesting: return deepNesting(scale);
+    case HugeArray: return hugeArray(scale);
+    case LargeBlobs: return largeBlobs(scale);
+    case NumericArray: return numericArray(scale);
+    }
+
+    return nullptr;
+}
+
+
+QString PlistCorpusGenerator::CommonWord()
+{
+    return QString(WORDS[1]);
+}
+
+
+QString PlistCorpusGenerator::ShapeName(Shape shape)
+{
+    switch( shape )
+    {
+    case WideDictionary: return QString("wide-dict");
+    case DeepNesting: return QString("deep-nesting");
+    case HugeArray: return QString("huge-array");
+    case LargeBlobs: return QString("large-blobs");
+    case NumericArray: return QString("numeric-array");
+    }
+
+    return QString();
+}
+
+
+qint64 PlistCorpusGenerator::CountItems(const PlistTreeItem *root)
+{
+    if ( root == nullptr ) {
+        return 0;
+    }
+
+    qint64 count = 1;
+
+    for( int i = 0; i < root->childCount(); ++i ) {
+        count += CountItems(root->child(i));
+    }
+
+    return count;
+}
+
+
+//
+// Protected Methods
+//
+
+
+quint32 PlistCorpusGenerator::nextRandom()
+{
+    // xorshift32; deterministic on every platform, unlike qrand().
+    _state ^= _state << 13;
+    _state ^= _state >> 17;
+    _state ^= _state << 5;
+    return _state;
+}
+
+
+QString PlistCorpusGenerator::randomWords(int count)
+{
+    QString result;
+
+    for( int i = 0; i < count; ++i )
+    {
+        if ( i > 0 ) {
+            result.append(QLatin1Char(' '));
+        }
+
+        result.append(QLatin1String(WORDS[nextRandom() % WORD_COUNT]));
+    }
+
+    return result;
+}
+
+
+PlistTreeItem * PlistCorpusGenerator::randomScalar(const QString &key)
+{
+    switch( nextRandom() % 5 )
+    {
+    case 0:
+        {
+            PlistTreeItem *item = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistInteger, key);
+            item->setValueRetainType(static_cast<qint64>(nextRandom()) - 0x7FFFFFFF);
+            return item;
+        }
+
+    case 1:
+        {
+            PlistTreeItem *item = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistReal, key);
+            item->setValueRetainType(static_cast<double>(nextRandom()) / 1000.0);
+            return item;
+        }
+
+    case 2:
+        {
+            PlistTreeItem *item = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistBoolean, key);
+            item->setValueRetainType((nextRandom() & 1) != 0);
+            return item;
+        }
+
+    case 3:
+        {
+            PlistTreeItem *item = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistDate, key);
+            item->setValueRetainType(QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(nextRandom()) * 1000, Qt::UTC));
+            return item;
+        }
+
+    default:
+        {
+            PlistTreeItem *item = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistString, key);
+            item->setValueRetainType(randomWords(1 + nextRandom() % 6));
+            return item;
+        }
+    }
+}
+
+
+PlistTreeItem * PlistCorpusGenerator::wideDictionary(int scale)
+{
+    PlistTreeItem *root = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistDictionary);
+    const int count = 50000 * scale;
+
+    for( int i = 0; i < count; ++i ) {
+        root->aendChild(randomScalar(QString("%1-%2").arg(randomWords(1)).arg(i)));
+    }
+
+    return root;
+}
+
+
+PlistTreeItem * PlistCorpusGenerator::deepNesting(int scale)
+{
+    PlistTreeItem *root = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistArray);
+    const int chains = 8 * scale;
+
+    for( int chain = 0; chain < chains; ++chain )
+    {
+        PlistTreeItem *container = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistDictionary);
+        root->aendChild(container);
+
+        for( int depth = 0; depth < NESTING_DEPTH; ++depth )
+        {
+            const bool isDictionary = (container->plistType() == PlistTreeItem::PlistDictionary);
+
+            for( int i = 0; i < 3; ++i ) {
+                container->aendChild(randomScalar(isDictionary ? QString("%1-%2").arg(randomWords(1)).arg(i) : QString()));
+            }
+
+            PlistTreeItem *next = PlistTreeItem::Create(nullptr, isDictionary ? PlistTreeItem::PlistArray : PlistTreeItem::PlistDictionary, isDictionary ? QString("child") : QString());
+            container->aendChild(next);
+            container = next;
+        }
+    }
+
+    return root;
+}
+
+
+PlistTreeItem * PlistCorpusGenerator::hugeArray(int scale)
+{
+    PlistTreeItem *root = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistArray);
+    const int count = 250000 * scale;
+
+    for( int i = 0; i < count; ++i ) {
+        root->aendChild(randomScalar());
+    }
+
+    return root;
+}
+
+
+PlistTreeItem * PlistCorpusGenerator::largeBlobs(int scale)
+{
+    PlistTreeItem *root = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistDictionary);
+    const int count = 16 * scale;
+    const int size = 1024 * 1024;
+
+    for( int i = 0; i < count; ++i )
+    {
+        QByteArray blob(size, Qt::Uninitialized);
+        quint32 *words = reinterpret_cast<quint32*>(blob.data());
+
+        for( int j = 0; j < size / 4; ++j ) {
+            words[j] = nextRandom();
+        }
+
+        PlistTreeItem *item = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistData, QString("blob-%1").arg(i));
+        item->setValueRetainType(blob);
+        root->aendChild(item);
+    }
+
+    return root;
+}
+
+
+PlistTreeItem * PlistCorpusGenerator::numericArray(int scale)
+{
+    PlistTreeItem *root = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistArray);
+    const int count = 500000 * scale;
+
+    for( int i = 0; i < count; ++i )
+    {
+        if ( (nextRandom() & 1) != 0 ) {
+            PlistTreeItem *item = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistInteger);
+            item->setValueRetainType((static_cast<qint64>(nextRandom()) << 16) - 0x7FFFFFFFFFFFLL);
+            root->aendChild(item);
+        } else {
+            PlistTreeItem *item = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistReal);
+            item->setValueRetainType(static_cast<double>(nextRandom()) / static_cast<double>(1 + nextRandom() % 9973));
+            root->aendChild(item);
+        }
+    }
+
+    return root;
+}
@@ -0,0 +1,77 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTCORPUSGENERATOR_H
+#define PLISTCORPUSGENERATOR_H
+
+#include "PlistTreeItem.h"
+
+
+/**
+ * @brief Builds synthetic Plist trees for benchmarking.
+ *
+ * The output depends only on the seed, the shape and the scale, so runs on different
+ * machines (or before and after a change) work on exactly the same data.
+ */
+class PlistCorpusGenerator
+{
+public:
+    enum Shape {
+        WideDictionary,                 // One dictionary with a very large number of keys
+        DeepNesting,                    // Long chains of alternating dictionaries and arrays
+        HugeArray,                      // One array with a very large number of scalars
+        LargeBlobs,                     // A few large data items
+        NumericArray,                   // One array of integers and reals only
+    };
+
+    static const int SHAPE_COUNT = 5;
+
+    explicit PlistCorpusGenerator(quint32 seed = 0x5EED);
+
+    /** Build a tree of the given shape on the heap. Scale 1 gives a file of a few MB. */
+    PlistTreeItem * generate(Shape shape, int scale = 1);
+
+    /** One of the words used for keys and strings, to give find/replace something to match. */
+    static QString CommonWord();
+
+    /** Short name of a shape, for benchmark row names. */
+    static QString ShapeName(Shape shape);
+
+    /** Number of items in the tree, including the root. */
+    static qint64 CountItems(const PlistTreeItem *root);
+
+
+protected:
+    quint32 nextRandom();
+    QString randomWords(int count);
+    PlistTreeItem * randomScalar(const QString &key = QString());
+
+    PlistTreeItem * wideDictionary(int scale);
+    PlistTreeItem * deepNesting(int scale);
+    PlistTreeItem * hugeArray(int scale);
+    PlistTreeItem * largeBlobs(int scale);
+    PlistTreeItem * numericArray(int scale);
+
+
+private:
+    quint32 _state;
+};
+
+#endif // PLISTCORPUSGENERATOR_H
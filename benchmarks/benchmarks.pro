@@ -0,0 +1,31 @@
+#-------------------------------------------------
+#
+# Plist Pad benchmarks. These run headless:
+#
+#   qmake benchmarks.pro && make && ./PlistBenchmarks
+#
+# Set PLISTPAD_BENCHMARK_SCALE to grow the generated corpus.
+#
+#-------------------------------------------------
+
+QT       += core gui testlib
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
+
+TARGET = PlistBenchmarks
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= app_bundle
+
+
+SOURCES += \
+    PlistBenchmarks.cpp \
+    PlistCorpusGenerator.cpp
+
+HEADERS += \
+    PlistCorpusGenerator.h
+
+include(../src/model/model.pri)
+
+win32: LIBS += -lpsapi
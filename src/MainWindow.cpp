@@ -1,15 +1,33 @@
 #include "MainWindow.h"
 #include "ui_MainWindow.h"
 
+#include <QAction>
 #include <QTreeView>
+#include <QFileInfo>
 #include <QStandardItemModel>
 #include <QStandardItem>
+#include <QEventLoop>
 
 
 const QString kATitle = QString("PlistPad");
 const QString kAVersion = QString("0.1.0");
 
 
+namespace {
+    // Most matches 'Go to path' will select, so a broad path can't stall the view.
+    const int MAX_PATH_MATCHES = 1000;
+
+    // Filtering waits for a pause in typing this long, in milliseconds.
+    const int FILTER_DELAY = 150;
+
+    // As does following the path box, where the path is only half typed until then.
+    const int PATH_DELAY = 300;
+
+    // A filter that leaves at most this many rows expands them all.
+    const int MAX_EXPANDED_MATCHES = 10000;
+}
+
+
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
@@ -20,13 +38,64 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
 
     _findReplaceDialog = nullptr;
     _treeModel = nullptr;
+    _filterModel = nullptr;
+    _sortModel = nullptr;
+    _loadProgressDialog = nullptr;
+
+    _loader = new PlistTreeLoader(this);
+    connect(_loader, SIGNAL(loaded(QString,PlistTreeItem*,PlistTreeArena*,PlistLazyTreeReader*,PlistTreeSource*,bool)), this, SLOT(fileLoaded(QString,PlistTreeItem*,PlistTreeArena*,PlistLazyTreeReader*,PlistTreeSource*,bool)));
+    connect(_loader, SIGNAL(failed(QString)), this, SLOT(fileLoadFailed(QString)));
+    connect(_loader, SIGNAL(canceled(QString)), this, SLOT(fileLoadCanceled(QString)));
+
+    // The path box follows along after a pause in typing, but only through what has been
+    // read already; return goes to the path, reading whatever it passes through.
+    _pathEdit = new QLineEdit(this);
+    _pathEdit->setPlaceholderText(tr("Go to path, e.g. Root.Items[0].Name"));
+    _pathEdit->setClearButtonEnabled(true);
+    _pathEdit->setMaximumWidth(320);
+    ui->mainToolBar->addSeparator();
+    ui->mainToolBar->addWidget(_pathEdit);
+
+    _pathTimer = new QTimer(this);
+    _pathTimer->setSingleShot(true);
+    _pathTimer->setInterval(PATH_DELAY);
+    connect(_pathEdit, SIGNAL(textEdited(QString)), _pathTimer, SLOT(start()));
+    connect(_pathEdit, SIGNAL(returnPressed()), this, SLOT(goToPath()));
+    connect(_pathTimer, SIGNAL(timeout()), this, SLOT(previewPath()));
+
+    // The filter box waits for a pause in typing, as every change re-filters the tree.
+    _filterEdit = new QLineEdit(this);
+    _filterEdit->setPlaceholderText(tr("Filter"));
+    _filterEdit->setClearButtonEnabled(true);
+    _filterEdit->setMaximumWidth(200);
+    ui->mainToolBar->addWidget(_filterEdit);
+
+    _filterTimer = new QTimer(this);
+    _filterTimer->setSingleShot(true);
+    _filterTimer->setInterval(FILTER_DELAY);
+    connect(_filterEdit, SIGNAL(textChanged(QString)), _filterTimer, SLOT(start()));
+    connect(_filterEdit, SIGNAL(returnPressed()), this, SLOT(filterTree()));
+    connect(_filterTimer, SIGNAL(timeout()), this, SLOT(filterTree()));
+
+    // Sorting is a view of the document, so it stays as it is from one document to the next.
+    _sortAction = ui->mainToolBar->addAction(tr("Sort Keys"));
+    _sortAction->setCheckable(true);
+    _sortAction->setToolTip(tr("Show dictionary keys in alphabetical order"));
+    connect(_sortAction, SIGNAL(toggled(bool)), this, SLOT(sortTree(bool)));
+
     newFile();
 }
 
 
 MainWindow::~MainWindow()
 {
+    // Stop the loader first, as a fetch reads into the model.
+    delete _loader;
+    _loader = nullptr;
+
     if ( _treeModel != nullptr ) {
+        delete _sortModel;
+        delete _filterModel;
         delete _treeModel;
     }
 
@@ -111,22 +180,118 @@ void MainWindow::treeViewRemoveSelectedRow()
 
 void MainWindow::newFile()
 {
+    if ( _loader->isRunning() ) {
+        return;
+    }
+
     _openFileName = QString();
+    _openFileIsBinary = false;
     setModel(new PlistTreeModel());
 }
 
 
 void MainWindow::openFile()
 {
+    if ( _loader->isRunning() ) {
+        return;
+    }
+
     QString filename = QFileDialog::getOpenFileName(this, tr("Open Plist File"), QString(), "Plist Files (*.plist)");
 
-    if ( !filename.isEmpty() )
+    if ( !filename.isEmpty() && _loader->load(filename) )
     {
-        PlistTreeReader itemReader = PlistTreeReader();
-        PlistTreeItem *item = itemReader.readTreeFromFile(filename);
-        setModel(new PlistTreeModel(item));
-        on_action_CollapseAll_triggered();
-        _openFileName = filename;
+        // Parsing happens on a worker thread; the window stays responsive and the
+        // tree is swapped in by fileLoaded() once it's complete.
+        _loadProgressDialog = new QProgressDialog(tr("Opening %1...").arg(QFileInfo(filename).fileName()), tr("Cancel"), 0, 100, this);
+        _loadProgressDialog->setWindowModality(Qt::WindowModal);
+        _loadProgressDialog->setMinimumDuration(250);
+        _loadProgressDialog->setValue(0);
+
+        connect(_loader, SIGNAL(progressChanged(int)), _loadProgressDialog, SLOT(setValue(int)));
+        connect(_loadProgressDialog, SIGNAL(canceled()), _loader, SLOT(cancel()));
+    }
+}
+
+
+void MainWindow::fileLoaded(const QString &fileName, PlistTreeItem *root, PlistTreeArena *arena, PlistLazyTreeReader *lazyReader, PlistTreeSource *source, bool isBinary)
+{
+    finishLoading();
+
+    setModel(new PlistTreeModel(root, arena, lazyReader, source));
+    on_action_CollapseAll_triggered();
+    _openFileName = fileName;
+    _openFileIsBinary = isBinary;
+}
+
+
+void MainWindow::fileLoadFailed(const QString &fileName)
+{
+    finishLoading();
+    QMessageBox::warning(this, tr("Open Plist File"), tr("Unable to read %1. It might not be a valid XML or binary Plist file.").arg(fileName));
+}
+
+
+void MainWindow::fileLoadCanceled(const QString &)
+{
+    finishLoading();
+}
+
+
+void MainWindow::goToPath()
+{
+    _pathTimer->stop();
+    selectPath(true);
+}
+
+
+void MainWindow::previewPath()
+{
+    selectPath(false);
+}
+
+
+void MainWindow::filterTree()
+{
+    _filterTimer->stop();
+
+    if ( _filterModel == nullptr || _filterModel->filterText() == _filterEdit->text() ) {
+        return;
+    }
+
+    // Filtering looks at everything, which is best read with a chance to cancel.
+    if ( !_filterEdit->text().isEmpty() && !fetchWholeDocument() ) {
+        return;
+    }
+
+    _filterModel->setFilterText(_filterEdit->text());
+
+    if ( _filterModel->filterText().isEmpty() ) {
+        ui->treeView->expand(_sortModel->index(0, 0));
+        ui->statusBar->clearMessage();
+        return;
+    }
+
+    // Few enough rows are left to show them all, otherwise just the top level.
+    if ( _filterModel->matchCount() <= MAX_EXPANDED_MATCHES ) {
+        ui->treeView->expandAll();
+    } else {
+        ui->treeView->expand(_sortModel->index(0, 0));
+    }
+
+    ui->statusBar->showMessage(tr("%1 match(es)").arg(_filterModel->matchCount()));
+}
+
+
+void MainWindow::treeViewFetchFailed()
+{
+    ui->statusBar->showMessage(tr("Part of the file couldn't be read, so it has been left as it is"));
+}
+
+
+void MainWindow::sortTree(bool sortByKey)
+{
+    if ( _sortModel != nullptr ) {
+        _sortModel->setSortByKey(sortByKey);
     }
 }
 
@@ -138,20 +303,27 @@ void MainWindow::saveFile()
         return;
     }
 
-    PlistTreeWriter itemWriter = PlistTreeWriter();
-    itemWriter.writeTreeToFile(_treeModel->visibleRoot(), _openFileName);
+    // Save in the same format the file was opened in.
+    writeFile(_openFileName, _openFileIsBinary);
 }
 
 
 void MainWindow::saveFileAs()
 {
-    QString filename = QFileDialog::getSaveFileName(this, tr("Save Plist File"), QString(), "Plist Files (*.plist)");
+    QString xmlFilter = tr("XML Plist Files (*.plist)");
+    QString binaryFilter = tr("Binary Plist Files (*.plist)");
+    QString selectedFilter = _openFileIsBinary ? binaryFilter : xmlFilter;
+
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save Plist File"), QString(), QString("%1;;%2").arg(xmlFilter, binaryFilter), &selectedFilter);
 
     if ( !filename.isEmpty() )
     {
-        PlistTreeWriter itemWriter = PlistTreeWriter();
-        itemWriter.writeTreeToFile(_treeModel->visibleRoot(), filename);
-        _openFileName = filename;
+        bool binary = (selectedFilter == binaryFilter);
+
+        if ( writeFile(filename, binary) ) {
+            _openFileName = filename;
+            _openFileIsBinary = binary;
+        }
     }
 }
 
@@ -164,11 +336,15 @@ void MainWindow::treeViewRowCopy()
         return;
     }
 
+    selectedIndex = sourceIndex(selectedIndex);
     PlistTreeItem *item = _treeModel->itemAtIndex(selectedIndex);
 
     if ( item != nullptr ) {
         QString xml;
 
+        // The writer walks the items directly, so anything not yet read has to be read first.
+        _treeModel->fetchAll(selectedIndex.sibling(selectedIndex.row(), 0));
+
         PlistTreeWriter itemWriter = PlistTreeWriter();
         itemWriter.writeTreeToString(item, &xml);
 
@@ -193,7 +369,7 @@ void MainWindow::treeViewRowPaste()
     }
 
     QModelIndex index = sel.at(0);
-    PlistTreeItem *selectedItem = _treeModel->itemAtIndex(index);
+    PlistTreeItem *selectedItem = _treeModel->itemAtIndex(sourceIndex(index));
 
     if ( selectedItem == nullptr ) {
         return;
@@ -202,6 +378,7 @@ void MainWindow::treeViewRowPaste()
     QString xml = QApplication::clipboard()->text();
 
     PlistTreeReader itemReader = PlistTreeReader();
+    itemReader.setArena(_treeModel->arena());
     PlistTreeItem *insertItem = itemReader.readTreeFromString(xml);
 
     if ( insertItem == nullptr ) {
@@ -212,11 +389,14 @@ void MainWindow::treeViewRowPaste()
     int insertRow = 0;
     bool result = false;
 
+    // Rows are counted in the document, which the filter may be hiding some of.
+    QModelIndex selectedSourceIndex = sourceIndex(index.sibling(index.row(), 0));
+
     if ( PlistTreeItem::IsContainerType(selectedItem->plistType()) && ui->treeView->isExpanded(index) ) {
-        containerIndex = index;
+        containerIndex = selectedSourceIndex;
     } else {
-        containerIndex = index.parent();
-        insertRow = index.row() + 1;
+        containerIndex = selectedSourceIndex.parent();
+        insertRow = selectedSourceIndex.row() + 1;
     }
 
     result = _treeModel->insertItem(insertItem, insertRow, containerIndex);
@@ -225,14 +405,59 @@ void MainWindow::treeViewRowPaste()
         delete insertItem;
     } else {
         ui->treeView->selectionModel()->clearSelection();
-        ui->treeView->selectionModel()->select(containerIndex.child(insertRow,0), QItemSelectionModel::Select);
+        ui->treeView->selectionModel()->select(viewIndex(_treeModel->index(insertRow, 0, containerIndex)), QItemSelectionModel::Select);
     }
 }
 
 
-void MainWindow::treeViewFindReplace(QString &find, QString &replace, ReplaceTarget target, ReplaceMode mode)
+void MainWindow::treeViewFindReplace(QString &find, QString &replace, ReplaceTarget target, ReplaceMode mode, Qt::CaseSensitivity cs, bool dryRun)
 {
-    _treeModel->findReplace(find, replace, target, mode);
+    if ( !fetchWholeDocument() ) {
+        return;
+    }
+
+    int count = _treeModel->findReplace(find, replace, target, mode, cs, dryRun);
+
+    if ( count < 0 ) {
+        ui->statusBar->showMessage(tr("%1 isn't a valid regular expression").arg(find));
+    } else if ( dryRun ) {
+        ui->statusBar->showMessage(tr("Would change %1 item(s)").arg(count));
+    } else {
+        ui->statusBar->showMessage(tr("Changed %1 item(s)").arg(count));
+    }
+}
+
+
+void MainWindow::treeViewFindNext(const QString &find, ReplaceTarget target, ReplaceMode mode, Qt::CaseSensitivity cs, bool backwards)
+{
+    if ( find.isEmpty() ) {
+        return;
+    }
+
+    QModelIndex current = sourceIndex(ui->treeView->selectionModel()->currentIndex());
+    QModelIndex match = _treeModel->findNext(current.sibling(current.row(), 0), find, target, mode, cs, backwards);
+
+    if ( !match.isValid() ) {
+        ui->statusBar->showMessage(tr("Nothing matches %1").arg(find));
+        return;
+    }
+
+    match = viewIndex(match);
+
+    for( QModelIndex parent = match.parent(); parent.isValid() && !ui->treeView->isExpanded(parent); parent = parent.parent() ) {
+        ui->treeView->expand(parent);
+    }
+
+    ui->treeView->selectionModel()->setCurrentIndex(match, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
+    ui->treeView->scrollTo(match);
+    ui->statusBar->clearMessage();
+}
+
+
+void MainWindow::treeViewCountMatches(const QString &find, ReplaceTarget target, ReplaceMode mode, Qt::CaseSensitivity cs)
+{
+    // Only what has been read is counted, rather than reading the whole file as the user types.
+    _findReplaceDialog->setMatchCount(_treeModel->countMatches(find, target, mode, cs), _treeModel->hasUnfetchedItems());
 }
 
 
@@ -263,7 +488,7 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
     if ( event->key() == Qt::Key_Enter || event->key() == Qt::Key_Return )
     {
         QModelIndex selectedIndex = getSelectedIndex();
-        PlistTreeItem * selectedItem = _treeModel->itemAtIndex(selectedIndex);
+        PlistTreeItem * selectedItem = _treeModel->itemAtIndex(sourceIndex(selectedIndex));
 
         if ( selectedItem != nullptr )
         {
@@ -290,7 +515,7 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
             treeViewRemoveSelectedRow();
         }
         else if ( selectedIndex.column() == PlistTreeItem::COLUMN_VALUE ) {
-            _treeModel->setData(selectedIndex, QVariant(), Qt::EditRole);
+            ui->treeView->model()->setData(selectedIndex, QVariant(), Qt::EditRole);
         }
     }
 
@@ -334,17 +559,183 @@ void MainWindow::setModel(PlistTreeModel *model)
 {
     if (_treeModel != nullptr) {
         ui->treeView->setModel(nullptr);
+        delete _sortModel;
+        delete _filterModel;
         delete _treeModel;
+        _sortModel = nullptr;
+        _filterModel = nullptr;
         _treeModel = nullptr;
     }
 
     _treeModel = model;
+    connect(_treeModel, SIGNAL(fetchFailed(QModelIndex)), this, SLOT(treeViewFetchFailed()));
+    _filterModel = new PlistTreeFilterModel(_treeModel);
+    _sortModel = new PlistTreeSortModel(_filterModel);
+    _sortModel->setSortByKey(_sortAction->isChecked());
 
     //register the model
-    ui->treeView->setModel(_treeModel);
-    ui->treeView->expandAll();
+    ui->treeView->setModel(_sortModel);
+    ui->treeView->expand(_sortModel->index(0, 0));
     ui->treeView->setItemDelegateForColumn(1, new ComboBoxDelegate(PlistTreeItem::ComboBoxTypeStrings()));
     ui->treeView->setContextMenuPolicy(Qt::CustomContextMenu);
+
+    // The filter carries over to the new document.
+    if ( !_filterEdit->text().isEmpty() ) {
+        filterTree();
+    }
+
+    // A new document needs its own index if the find dialog is still open.
+    if ( _findReplaceDialog != nullptr && _findReplaceDialog->isVisible() ) {
+        connect(_treeModel, SIGNAL(searchIndexReady()), _findReplaceDialog, SLOT(refreshMatchCount()), Qt::UniqueConnection);
+        _treeModel->buildSearchIndex();
+        _findReplaceDialog->refreshMatchCount();
+    }
+}
+
+
+void MainWindow::finishLoading()
+{
+    if ( _loadProgressDialog != nullptr ) {
+        disconnect(_loader, SIGNAL(progressChanged(int)), _loadProgressDialog, SLOT(setValue(int)));
+        _loadProgressDialog->deleteLater();
+        _loadProgressDialog = nullptr;
+    }
+}
+
+
+bool MainWindow::fetchWholeDocument()
+{
+    if ( !_treeModel->hasUnfetchedItems() ) {
+        return true;
+    }
+
+    // Either there turned out to be nothing left to read, or the loader is busy.
+    if ( !_loader->fetchAll(_treeModel) ) {
+        return !_treeModel->hasUnfetchedItems();
+    }
+
+    // Reading the rest of a big file can take a while, so it's done on the loader's worker like
+    // opening it, with the window waiting here (but still painting) until it's done or cancelled.
+    QProgressDialog progressDialog(tr("Reading the rest of the file..."), tr("Cancel"), 0, 100, this);
+    progressDialog.setWindowModality(Qt::WindowModal);
+    progressDialog.setMinimumDuration(250);
+    progressDialog.setValue(0);
+
+    QEventLoop loop;
+    connect(_loader, SIGNAL(progressChanged(int)), &progressDialog, SLOT(setValue(int)));
+    connect(&progressDialog, SIGNAL(canceled()), _loader, SLOT(cancel()));
+    connect(_loader, SIGNAL(fetched()), &loop, SLOT(quit()));
+    connect(_loader, SIGNAL(fetchCanceled()), &loop, SLOT(quit()));
+    loop.exec();
+
+    disconnect(_loader, SIGNAL(progressChanged(int)), &progressDialog, SLOT(setValue(int)));
+    disconnect(_loader, SIGNAL(fetched()), &loop, SLOT(quit()));
+    disconnect(_loader, SIGNAL(fetchCanceled()), &loop, SLOT(quit()));
+
+    return !_treeModel->hasUnfetchedItems();
+}
+
+
+void MainWindow::selectPath(bool fetch)
+{
+    QString path = _pathEdit->text();
+
+    if ( path.trimmed().isEmpty() ) {
+        ui->statusBar->clearMessage();
+        return;
+    }
+
+    PlistTreeQuery query;
+
+    if ( !query.compile(path) ) {
+        ui->statusBar->showMessage(tr("%1 at column %2").arg(query.errorString()).arg(query.errorPosition() + 1));
+        return;
+    }
+
+    QModelIndexList matches = _treeModel->query(query, MAX_PATH_MATCHES, fetch);
+
+    if ( matches.isEmpty() && !fetch && _treeModel->hasUnfetchedItems() ) {
+        ui->statusBar->showMessage(tr("Nothing matches %1 yet; press Return to read further").arg(path));
+        return;
+    } else if ( matches.isEmpty() ) {
+        ui->statusBar->showMessage(tr("Nothing matches %1").arg(path));
+        return;
+    }
+
+    QItemSelection selection;
+
+    // A match hidden by the filter brings everything back, so that it can be shown.
+    for( int i = 0; i < matches.count(); ++i )
+    {
+        if ( !_filterModel->mapFromSource(matches.at(i)).isValid() ) {
+            viewIndex(matches.at(i));
+            break;
+        }
+    }
+
+    for( int i = 0; i < matches.count(); ++i ) {
+        matches[i] = viewIndex(matches.at(i));
+    }
+
+    for( int i = 0; i < matches.count(); ++i )
+    {
+        const QModelIndex &match = matches.at(i);
+        selection.select(match, match.sibling(match.row(), PlistTreeItem::COLUMN_VALUE));
+
+        for( QModelIndex parent = match.parent(); parent.isValid() && !ui->treeView->isExpanded(parent); parent = parent.parent() ) {
+            ui->treeView->expand(parent);
+        }
+    }
+
+    ui->treeView->selectionModel()->setCurrentIndex(matches.first(), QItemSelectionModel::NoUpdate);
+    ui->treeView->selectionModel()->select(selection, QItemSelectionModel::ClearAndSelect);
+    ui->treeView->scrollTo(matches.first());
+
+    if ( matches.count() == MAX_PATH_MATCHES ) {
+        ui->statusBar->showMessage(tr("Showing the first %1 matches").arg(MAX_PATH_MATCHES));
+    } else {
+        ui->statusBar->showMessage(tr("%1 match(es)").arg(matches.count()));
+    }
+}
+
+
+bool MainWindow::writeFile(QString &fileName, bool binary)
+{
+    if ( binary ) {
+        // Binary files are written from the items alone, so anything that couldn't be read would be lost.
+        if ( !fetchWholeDocument() || _treeModel->hasUnreadableItems() ) {
+            return false;
+        }
+
+        PlistBinaryTreeWriter itemWriter = PlistBinaryTreeWriter();
+        return itemWriter.writeTreeToFile(_treeModel->visibleRoot(), fileName);
+    }
+
+    // Anything left unchanged (including whatever hasn't been read yet) is copied from the source file.
+    PlistTreeWriter itemWriter = PlistTreeWriter();
+    itemWriter.setSource(_treeModel->source());
+    return itemWriter.writeTreeToFile(_treeModel->visibleRoot(), fileName);
+}
+
+
+QModelIndex MainWindow::sourceIndex(const QModelIndex &viewIndex) const
+{
+    return _filterModel->mapToSource(_sortModel->mapToSource(viewIndex));
+}
+
+
+QModelIndex MainWindow::viewIndex(const QModelIndex &sourceIndex)
+{
+    QModelIndex index = _filterModel->mapFromSource(sourceIndex);
+
+    // Rows the filter hides can only be shown by clearing it.
+    if ( !index.isValid() && sourceIndex.isValid() && !_filterModel->filterText().isEmpty() ) {
+        _filterEdit->clear();
+        filterTree();
+        index = _filterModel->mapFromSource(sourceIndex);
+    }
+
+    return _sortModel->mapFromSource(index);
 }
 
 
@@ -363,7 +754,9 @@ QModelIndex MainWindow::getSelectedIndex()
 
 void MainWindow::on_action_ExpandAll_triggered()
 {
-    ui->treeView->expandAll();
+    if ( fetchWholeDocument() ) {
+        ui->treeView->expandAll();
+    }
 }
 
 void MainWindow::on_action_CollapseAll_triggered()
@@ -402,10 +795,53 @@ void MainWindow::on_actionFind_Replace_triggered()
     if  ( _findReplaceDialog == nullptr ) {
         _findReplaceDialog = new FindReplaceDialog(this);
         _findReplaceDialog->setModal(false);
-        connect(_findReplaceDialog, SIGNAL(doFindReplace(QString&,QString&,ReplaceTarget,ReplaceMode)), this, SLOT(treeViewFindReplace(QString&,QString&,ReplaceTarget,ReplaceMode)));
+        connect(_findReplaceDialog, SIGNAL(doFindReplace(QString&,QString&,ReplaceTarget,ReplaceMode,Qt::CaseSensitivity,bool)), this, SLOT(treeViewFindReplace(QString&,QString&,ReplaceTarget,ReplaceMode,Qt::CaseSensitivity,bool)));
+        connect(_findReplaceDialog, SIGNAL(doFindNext(QString,ReplaceTarget,ReplaceMode,Qt::CaseSensitivity,bool)), this, SLOT(treeViewFindNext(QString,ReplaceTarget,ReplaceMode,Qt::CaseSensitivity,bool)));
+        connect(_findReplaceDialog, SIGNAL(findTextChanged(QString,ReplaceTarget,ReplaceMode,Qt::CaseSensitivity)), this, SLOT(treeViewCountMatches(QString,ReplaceTarget,ReplaceMode,Qt::CaseSensitivity)));
     }
 
+    // The index answers the dialog's match count as the user types.
+    connect(_treeModel, SIGNAL(searchIndexReady()), _findReplaceDialog, SLOT(refreshMatchCount()), Qt::UniqueConnection);
+    _treeModel->buildSearchIndex();
+    _findReplaceDialog->refreshMatchCount();
+
     _findReplaceDialog->show();
     _findReplaceDialog->raise();
     _findReplaceDialog->activateWindow();
 }
+
+
+void MainWindow::on_actionCompare_triggered()
+{
+    if ( _loader->isRunning() ) {
+        return;
+    }
+
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Compare With Plist File"), QString(), "Plist Files (*.plist)");
+
+    // The dialog gets a copy of the whole of this document.
+    if ( fileName.isEmpty() || !fetchWholeDocument() ) {
+        return;
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+
+    PlistTreeArena *otherArena = new PlistTreeArena();
+    PlistTreeItem *otherRoot = PlistTreeLoader::ReadTreeFromFile(fileName, otherArena);
+
+    if ( otherRoot == nullptr ) {
+        delete otherArena;
+        QApplication::restoreOverrideCursor();
+        QMessageBox::warning(this, tr("Compare With Plist File"), tr("Unable to read %1. It might not be a valid XML or binary Plist file.").arg(fileName));
+        return;
+    }
+
+    // It's a copy so that it can't be affected by edits made here.
+    PlistTreeArena *thisArena = new PlistTreeArena();
+    PlistTreeItem *thisRoot = PlistTreeItem::Clone(thisArena, *_treeModel->visibleRoot());
+    QString thisTitle = _openFileName.isEmpty() ? tr("Untitled") : QFileInfo(_openFileName).fileName();
+
+    CompareDialog dialog(thisRoot, thisArena, thisTitle, otherRoot, otherArena, QFileInfo(fileName).fileName(), this);
+    QApplication::restoreOverrideCursor();
+    dialog.exec();
+}
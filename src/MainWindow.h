@@ -23,13 +23,23 @@
 
 #include <QMainWindow>
 #include <QFileDialog>
+#include <QLineEdit>
 #include <QMessageBox>
+#include <QProgressDialog>
+#include <QTimer>
 
 #include "dialogs/AboutDialog.h"
 #include "dialogs/FindReplaceDialog.h"
+#include "dialogs/CompareDialog.h"
 #include "model/PlistTreeModel.h"
+#include "model/PlistTreeArena.h"
 #include "model/PlistTreeWriter.h"
+#include "model/PlistBinaryTreeWriter.h"
 #include "model/PlistTreeReader.h"
+#include "model/PlistTreeLoader.h"
+#include "model/PlistTreeQuery.h"
+#include "model/PlistTreeFilterModel.h"
+#include "model/PlistTreeSortModel.h"
 #include "ComboBoxDelegate.h"
 
 
@@ -65,7 +75,17 @@ public slots:
     void treeViewRowCopy();
     void treeViewRowCut();
     void treeViewRowPaste();
-    void treeViewFindReplace(QString &find, QString &replace, ReplaceTarget target, ReplaceMode mode);
+    void treeViewFindReplace(QString &find, QString &replace, ReplaceTarget target, ReplaceMode mode, Qt::CaseSensitivity cs, bool dryRun);
+    void treeViewFindNext(const QString &find, ReplaceTarget target, ReplaceMode mode, Qt::CaseSensitivity cs, bool backwards);
+    void treeViewCountMatches(const QString &find, ReplaceTarget target, ReplaceMode mode, Qt::CaseSensitivity cs);
+    void fileLoaded(const QString &fileName, PlistTreeItem *root, PlistTreeArena *arena, PlistLazyTreeReader *lazyReader, PlistTreeSource *source, bool isBinary);
+    void fileLoadFailed(const QString &fileName);
+    void fileLoadCanceled(const QString &fileName);
+    void goToPath();
+    void previewPath();
+    void filterTree();
+    void sortTree(bool sortByKey);
+    void treeViewFetchFailed();
 
 private slots:
     void on_actionSave_As_triggered();
@@ -90,15 +110,33 @@ private slots:
 
     void on_actionFind_Replace_triggered();
 
+    void on_actionCompare_triggered();
+
 private:
     Ui::MainWindow *ui;
 
     FindReplaceDialog *_findReplaceDialog;
+    PlistTreeLoader *_loader;
+    QProgressDialog *_loadProgressDialog;
+    QLineEdit *_pathEdit;
+    QTimer *_pathTimer;
+    QLineEdit *_filterEdit;
+    QTimer *_filterTimer;
+    QAction *_sortAction;
 
     QString _openFileName;
+    bool _openFileIsBinary;
     PlistTreeModel *_treeModel;
+    PlistTreeFilterModel *_filterModel;     // On top of _treeModel
+    PlistTreeSortModel *_sortModel;         // What the tree view shows, on top of _filterModel
 
     void setModel(PlistTreeModel *model);
+    QModelIndex sourceIndex(const QModelIndex &viewIndex) const;
+    QModelIndex viewIndex(const QModelIndex &sourceIndex);
+    void selectPath(bool fetch);
+    bool writeFile(QString &fileName, bool binary);
+    void finishLoading();
+    bool fetchWholeDocument();
     QModelIndex getSelectedIndex();
 };
 
@@ -0,0 +1,424 @@
+#include "PlistCommandLine.h"
+#include "model/PlistTreeArena.h"
+#include "model/PlistTreeLoader.h"
+#include "model/PlistTreeMerge.h"
+#include "model/PlistTreeWriter.h"
+#include "model/PlistBinaryTreeWriter.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QFuture>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QXmlStreamReader>
+#include <QtConcurrent/QtConcurrentRun>
+#include <cstdio>
+
+
+PlistCommandLine::PlistCommandLine()
+{
+    _command = CommandNone;
+    _outputFormat = OutputXml;
+    _jobs = 0;
+    _quiet = false;
+}
+
+
+bool PlistCommandLine::IsCommand(int argc, char *argv[])
+{
+    if ( argc < 2 ) {
+        return false;
+    }
+
+    QString name = QString::fromLocal8Bit(argv[1]);
+    return CommandForName(name) != CommandNone || name == "help" || name == "--help";
+}
+
+
+int PlistCommandLine::run(const QStringList &args)
+{
+    if ( !args.isEmpty() && (args.first() == "help" || args.first() == "--help") ) {
+        printUsage();
+        return 0;
+    }
+
+    if ( !parseArguments(args) ) {
+        printUsage();
+        return 2;
+    }
+
+    if ( _command == CommandMerge ) {
+        return runMerge();
+    }
+
+    return runFiles();
+}
+
+
+//
+// Protected Methods
+//
+
+
+bool PlistCommandLine::parseArguments(const QStringList &args)
+{
+    _command = args.isEmpty() ? CommandNone : CommandForName(args.first());
+
+    if ( _command == CommandNone ) {
+        return false;
+    }
+
+    // Merge just takes its files, in order.
+    if ( _command == CommandMerge ) {
+        _files = args.mid(1);
+        return _files.count() >= 3 && _files.count() <= 4;
+    }
+
+    if ( _command == CommandMinify ) {
+        _outputFormat = OutputCompactXml;
+    }
+
+    bool hasFormat = (_command != CommandConvert);
+
+    for( int i = 1; i < args.count(); ++i )
+    {
+        const QString &arg = args.at(i);
+        const bool hasValue = (i + 1 < args.count());
+
+        if ( arg == "--to" && hasValue && _command == CommandConvert )
+        {
+            QString format = args.at(++i);
+
+            if ( format == "xml" ) {
+                _outputFormat = OutputXml;
+            } else if ( format == "binary" ) {
+                _outputFormat = OutputBinary;
+            } else {
+                fprintf(stderr, "Unknown format '%s'\n", qPrintable(format));
+                return false;
+            }
+
+            hasFormat = true;
+        }
+        else if ( (arg == "-o" || arg == "--output") && hasValue )
+        {
+            _outputDir = args.at(++i);
+
+            if ( !QFileInfo(_outputDir).isDir() ) {
+                fprintf(stderr, "'%s' is not a directory\n", qPrintable(_outputDir));
+                return false;
+            }
+        }
+        else if ( (arg == "-j" || arg == "--jobs") && hasValue )
+        {
+            bool isNumber = false;
+            _jobs = args.at(++i).toInt(&isNumber);
+
+            if ( !isNumber || _jobs < 1 ) {
+                fprintf(stderr, "'%s' is not a number of jobs\n", qPrintable(args.at(i)));
+                return false;
+            }
+        }
+        else if ( arg == "-q" || arg == "--quiet" )
+        {
+            _quiet = true;
+        }
+        else if ( arg.startsWith("-") )
+        {
+            fprintf(stderr, "Unknown option '%s'\n", qPrintable(arg));
+            return false;
+        }
+        else if ( _command == CommandQuery && !_query.isValid() )
+        {
+            // Compiled once, up front, then evaluated against every file.
+            if ( !_query.compile(arg) ) {
+                fprintf(stderr, "Invalid path '%s': %s at column %d\n", qPrintable(arg), qPrintable(_query.errorString()), _query.errorPosition() + 1);
+                return false;
+            }
+        }
+        else
+        {
+            _files.append(arg);
+        }
+    }
+
+    if ( !hasFormat || _files.isEmpty() || (_command == CommandQuery && !_query.isValid()) ) {
+        return false;
+    }
+
+    // Two files writing to the same place would leave one of them with the other's content.
+    if ( _command != CommandValidate && _command != CommandQuery )
+    {
+        QSet<QString> outputs;
+
+        for( int i = 0; i < _files.count(); ++i )
+        {
+            QString output = QFileInfo(outputFileName(_files.at(i))).absoluteFilePath();
+
+            if ( outputs.contains(output) ) {
+                fprintf(stderr, "More than one file would be written to '%s'\n", qPrintable(output));
+                return false;
+            }
+
+            outputs.insert(output);
+        }
+    }
+
+    return true;
+}
+
+
+int PlistCommandLine::runFiles()
+{
+    // A pool of our own, so the global one stays free for the readers' and writers' own threads.
+    QThreadPool pool;
+    pool.setMaxThreadCount(_jobs > 0 ? _jobs : QThread::idealThreadCount());
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QList<QFuture<FileResult> > results;
+
+    for( int i = 0; i < _files.count(); ++i ) {
+        results.append(QtConcurrent::run(&pool, this, &PlistCommandLine::processFile, _files.at(i)));
+    }
+
+    // Report in the order given, as each file finishes. Queries print their matches instead of timings.
+    const bool isQuery = (_command == CommandQuery);
+    int failures = 0;
+    int matches = 0;
+
+    for( int i = 0; i < results.count(); ++i )
+    {
+        FileResult result = results.at(i).result();
+
+        for( int j = 0; j < result.matches.count(); ++j )
+        {
+            if ( _files.count() > 1 ) {
+                printf("%s: %s\n", qPrintable(result.fileName), qPrintable(result.matches.at(j)));
+            } else {
+                printf("%s\n", qPrintable(result.matches.at(j)));
+            }
+        }
+
+        matches += result.matches.count();
+
+        if ( !result.error.isEmpty() ) {
+            ++failures;
+            fflush(stdout);
+            fprintf(stderr, "FAIL %10.1f ms  %s: %s\n", result.milliseconds, qPrintable(result.fileName), qPrintable(result.error));
+        } else if ( !_quiet && !isQuery ) {
+            printf("ok   %10.1f ms  %s\n", result.milliseconds, qPrintable(result.fileName));
+        }
+    }
+
+    if ( isQuery ) {
+        return (failures > 0 || matches == 0) ? 1 : 0;
+    }
+
+    if ( !_quiet || failures > 0 ) {
+        printf("%d file(s), %d failed, %.1f ms\n", results.count(), failures, timer.nsecsElapsed() / 1000000.0);
+    }
+
+    return (failures > 0) ? 1 : 0;
+}
+
+
+int PlistCommandLine::runMerge()
+{
+    // The result is written to OUTPUT, or over OURS if there isn't one, in the same format
+    // as OURS. That makes it usable as a git merge driver ('PlistPad merge %O %A %B').
+    PlistTreeArena arena;
+    bool isBinary = false;
+
+    // A missing base just means there's no common ancestor (git passes an empty file then),
+    // but one which is there and can't be read would quietly turn every edit into a conflict.
+    const QFileInfo baseInfo(_files.at(0));
+    const bool hasBase = !_files.at(0).isEmpty() && baseInfo.exists() && baseInfo.size() > 0;
+    PlistTreeItem *base = hasBase ? PlistTreeLoader::ReadTreeFromFile(_files.at(0), &arena) : nullptr;
+
+    if ( hasBase && base == nullptr ) {
+        fprintf(stderr, "Unable to read %s\n", qPrintable(_files.at(0)));
+        return 2;
+    }
+
+    PlistTreeItem *ours = PlistTreeLoader::ReadTreeFromFile(_files.at(1), &arena, &isBinary);
+    PlistTreeItem *theirs = PlistTreeLoader::ReadTreeFromFile(_files.at(2), &arena);
+
+    // The other two always have to be there.
+    if ( ours == nullptr || theirs == nullptr ) {
+        fprintf(stderr, "Unable to read %s\n", qPrintable(ours == nullptr ? _files.at(1) : _files.at(2)));
+        return 2;
+    }
+
+    PlistTreeMerge merger;
+    merger.setArena(&arena);
+    PlistTreeItem *merged = merger.merge(base, ours, theirs);
+
+    QString output = (_files.count() == 4) ? _files.at(3) : _files.at(1);
+    bool didWrite = false;
+
+    if ( isBinary ) {
+        PlistBinaryTreeWriter itemWriter = PlistBinaryTreeWriter();
+        didWrite = itemWriter.writeTreeToFile(merged, output);
+    } else {
+        PlistTreeWriter itemWriter = PlistTreeWriter();
+        didWrite = itemWriter.writeTreeToFile(merged, output);
+    }
+
+    if ( !didWrite ) {
+        fprintf(stderr, "Unable to write %s\n", qPrintable(output));
+        return 2;
+    }
+
+    if ( merger.conflictCount() > 0 ) {
+        fprintf(stderr, "%d conflict(s) left in %s\n", merger.conflictCount(), qPrintable(output));
+        return 1;
+    }
+
+    return 0;
+}
+
+
+void PlistCommandLine::printUsage() const
+{
+    fprintf(stderr,
+            "Usage: PlistPad convert --to xml|binary [options] FILE...\n"
+            "       PlistPad format [options] FILE...\n"
+            "       PlistPad minify [options] FILE...\n"
+            "       PlistPad validate [options] FILE...\n"
+            "       PlistPad query [options] PATH FILE...\n"
+            "       PlistPad merge BASE OURS THEIRS [OUTPUT]\n"
+            "\n"
+            "Files are rewritten in place unless an output directory is given.\n"
+            "\n"
+            "Options:\n"
+            "  -o, --output DIR   Write the results into DIR\n"
+            "  -j, --jobs N       Process N files at once (default: one per core)\n"
+            "  -q, --quiet        Only report files which fail\n"
+            "\n"
+            "Exits with 0 if every file succeeded, 1 if any failed and 2 for a bad command line.\n"
+            "query prints every item matching PATH (such as Root.Items[*].Name) and exits\n"
+            "with 1 if nothing matched. merge exits with 1 if conflicts were left in the result\n"
+            "and 2 if a file can't be read. BASE may be empty or missing.\n");
+}
+
+
+PlistCommandLine::FileResult PlistCommandLine::processFile(const QString &fileName) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    FileResult result;
+    result.fileName = fileName;
+
+    // Every file gets its own arena, so nothing is shared between threads.
+    PlistTreeArena arena;
+    bool isBinary = false;
+    PlistTreeItem *rootNode = PlistTreeLoader::ReadTreeFromFile(fileName, &arena, &isBinary);
+
+    if ( rootNode == nullptr )
+    {
+        if ( !QFileInfo(fileName).isReadable() ) {
+            result.error = "Unable to open file";
+        } else {
+            QString xmlError = isBinary ? QString() : XmlErrorForFile(fileName);
+            result.error = xmlError.isEmpty() ? QString("Not a valid property list") : xmlError;
+        }
+    }
+    else if ( _command == CommandQuery )
+    {
+        QList<PlistTreeItem*> items = _query.evaluate(rootNode);
+
+        for( int i = 0; i < items.count(); ++i ) {
+            result.matches.append(QString("%1 = %2").arg(PlistTreeQuery::PathForItem(items.at(i)), ValueText(items.at(i))));
+        }
+    }
+    else if ( _command != CommandValidate )
+    {
+        QString output = outputFileName(fileName);
+        bool didWrite = false;
+
+        if ( _outputFormat == OutputBinary ) {
+            PlistBinaryTreeWriter itemWriter = PlistBinaryTreeWriter();
+            didWrite = itemWriter.writeTreeToFile(rootNode, output);
+        } else {
+            PlistTreeWriter itemWriter = PlistTreeWriter();
+            itemWriter.setCompact(_outputFormat == OutputCompactXml);
+            didWrite = itemWriter.writeTreeToFile(rootNode, output);
+        }
+
+        if ( !didWrite ) {
+            result.error = QString("Unable to write %1").arg(output);
+        }
+    }
+
+    result.milliseconds = timer.nsecsElapsed() / 1000000.0;
+    return result;
+}
+
+
+QString PlistCommandLine::outputFileName(const QString &fileName) const
+{
+    if ( _outputDir.isEmpty() ) {
+        return fileName;
+    }
+
+    return QDir(_outputDir).filePath(QFileInfo(fileName).fileName());
+}
+
+
+PlistCommandLine::Command PlistCommandLine::CommandForName(const QString &name)
+{
+    if ( name == "convert" ) { return CommandConvert; }
+    if ( name == "format" ) { return CommandFormat; }
+    if ( name == "minify" ) { return CommandMinify; }
+    if ( name == "validate" ) { return CommandValidate; }
+    if ( name == "query" ) { return CommandQuery; }
+    if ( name == "merge" || name == "--merge" ) { return CommandMerge; }
+
+    return CommandNone;
+}
+
+
+QString PlistCommandLine::XmlErrorForFile(const QString &fileName)
+{
+    // The readers only say whether they managed; a plain XML pass says where a broken file goes wrong.
+    QFile file(fileName);
+
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        return QString();
+    }
+
+    QXmlStreamReader xmlReader(&file);
+
+    while( !xmlReader.atEnd() ) {
+        xmlReader.readNext();
+    }
+
+    if ( !xmlReader.hasError() ) {
+        return QString();
+    }
+
+    return QString("Line %1, column %2: %3").arg(xmlReader.lineNumber()).arg(xmlReader.columnNumber()).arg(xmlReader.errorString());
+}
+
+
+QString PlistCommandLine::ValueText(const PlistTreeItem *item)
+{
+    switch( item->plistType() )
+    {
+    case PlistTreeItem::PlistArray:
+    case PlistTreeItem::PlistDictionary:
+        return QString("%1 (%2)").arg(item->typeDescription(), item->data(PlistTreeItem::COLUMN_VALUE).toString());
+
+    case PlistTreeItem::PlistDate:
+        return item->data(PlistTreeItem::COLUMN_VALUE).toDateTime().toString(Qt::ISODate);
+
+    default:
+        return item->data(PlistTreeItem::COLUMN_VALUE).toString();
+    }
+}
@@ -0,0 +1,109 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTCOMMANDLINE_H
+#define PLISTCOMMANDLINE_H
+
+#include "model/PlistTreeQuery.h"
+
+#include <QString>
+#include <QStringList>
+
+
+/**
+ * @brief Runs Plist Pad without a window, for scripts and build machines.
+ *
+ *     PlistPad convert --to xml|binary [options] FILE...
+ *     PlistPad format [options] FILE...
+ *     PlistPad minify [options] FILE...
+ *     PlistPad validate [options] FILE...
+ *     PlistPad query [options] PATH FILE...
+ *     PlistPad merge BASE OURS THEIRS [OUTPUT]
+ *
+ * Files are rewritten in place unless an output directory is given with -o. format and
+ * minify always write XML, indented or with no whitespace at all. Files are processed
+ * concurrently on a thread pool of their own (-j sets its size), and each one is reported
+ * with how long it took, in the order given. The exit code is 0 if every file succeeded,
+ * 1 if any failed and 2 if the command line itself was wrong.
+ *
+ * query prints the path and value of every item matching a PlistTreeQuery path instead
+ * of timings, and also exits with 1 if nothing in any of the files matched.
+ */
+class PlistCommandLine
+{
+public:
+    PlistCommandLine();
+
+    /** Whether the given arguments ask for a command rather than the editor. */
+    static bool IsCommand(int argc, char *argv[]);
+
+    /** Run the command in the given arguments (not including the program name) and return the exit code. */
+    int run(const QStringList &args);
+
+
+protected:
+    enum Command {
+        CommandNone,
+        CommandConvert,
+        CommandFormat,
+        CommandMinify,
+        CommandValidate,
+        CommandQuery,
+        CommandMerge
+    };
+
+    enum OutputFormat {
+        OutputXml,
+        OutputCompactXml,
+        OutputBinary
+    };
+
+    struct FileResult {
+        QString fileName;
+        QString error;          // Empty if the file was processed successfully
+        QStringList matches;    // Lines to print for a query
+        double milliseconds;
+    };
+
+    bool parseArguments(const QStringList &args);
+    int runFiles();
+    int runMerge();
+    void printUsage() const;
+
+    /** Read, and unless validating, write the given file. Safe to run on any thread. */
+    FileResult processFile(const QString &fileName) const;
+    QString outputFileName(const QString &fileName) const;
+
+    static Command CommandForName(const QString &name);
+    static QString XmlErrorForFile(const QString &fileName);
+    static QString ValueText(const PlistTreeItem *item);
+
+
+private:
+    Command _command;
+    OutputFormat _outputFormat;
+    QString _outputDir;
+    QStringList _files;
+    PlistTreeQuery _query;
+    int _jobs;                  // Files processed at once, or 0 for one per core
+    bool _quiet;                // Only report failures
+};
+
+#endif // PLISTCOMMANDLINE_H
@@ -0,0 +1,141 @@
+#include "CompareDialog.h"
+#include "ui_CompareDialog.h"
+
+#include <QHash>
+#include <QColor>
+
+
+namespace {
+    const QColor ADDED_COLOR = QColor(212, 247, 212);
+    const QColor REMOVED_COLOR = QColor(247, 212, 212);
+    const QColor CHANGED_COLOR = QColor(247, 240, 192);
+    const QColor CONTAINS_CHANGES_COLOR = QColor(236, 236, 236);
+
+    // Expanding thousands of branches makes the view crawl; past this, the user can expand the rest.
+    const int MAX_EXPANDED_EDITS = 500;
+}
+
+
+/**
+ * Read-only PlistTreeModel which paints a background colour behind chosen items.
+ */
+class CompareTreeModel : public PlistTreeModel
+{
+public:
+    CompareTreeModel(PlistTreeItem *root, PlistTreeArena *arena, QObject *parent) : PlistTreeModel(root, arena, nullptr, nullptr, parent)
+    {
+    }
+
+    void setColor(const PlistTreeItem *item, const QColor &color)
+    {
+        _colors.insert(item, color);
+    }
+
+    bool hasColor(const PlistTreeItem *item) const
+    {
+        return _colors.contains(item);
+    }
+
+    QVariant data(const QModelIndex &index, int role) const
+    {
+        if ( role == Qt::BackgroundRole ) {
+            QHash<const PlistTreeItem*, QColor>::const_iterator it = _colors.constFind(itemAtIndex(index));
+            return (it != _colors.constEnd()) ? QVariant(it.value()) : QVariant();
+        }
+
+        return PlistTreeModel::data(index, role);
+    }
+
+    Qt::ItemFlags flags(const QModelIndex &index) const
+    {
+        return PlistTreeModel::flags(index) & ~Qt::ItemIsEditable;
+    }
+
+private:
+    QHash<const PlistTreeItem*, QColor> _colors;
+};
+
+
+CompareDialog::CompareDialog(PlistTreeItem *oldRoot, PlistTreeArena *oldArena, const QString &oldTitle,
+                             PlistTreeItem *newRoot, PlistTreeArena *newArena, const QString &newTitle, QWidget *parent) :
+    QDialog(parent), ui(new Ui::CompareDialog)
+{
+    ui->setupUi(this);
+    ui->labelOld->setText(oldTitle);
+    ui->labelNew->setText(newTitle);
+
+    _expandedCount = 0;
+    _oldModel = new CompareTreeModel(oldRoot, oldArena, this);
+    _newModel = new CompareTreeModel(newRoot, newArena, this);
+    ui->treeViewOld->setModel(_oldModel);
+    ui->treeViewNew->setModel(_newModel);
+
+    // Identical subtrees are skipped by hash, so hash both sides up front.
+    PlistTreeItem::ComputeHashesInParallel(oldRoot);
+    PlistTreeItem::ComputeHashesInParallel(newRoot);
+
+    if ( !_diff.compare(oldRoot, newRoot) ) {
+        ui->labelSummary->setText(tr("The documents are identical."));
+        return;
+    }
+
+    const QVector<PlistTreeDiff::Edit> &edits = _diff.edits();
+
+    for( int i = 0; i < edits.count(); ++i )
+    {
+        const PlistTreeDiff::Edit &edit = edits.at(i);
+
+        switch( edit.type )
+        {
+        case PlistTreeDiff::EditAdded:
+            highlightItem(_newModel, ui->treeViewNew, edit.newItem, ADDED_COLOR);
+            break;
+
+        case PlistTreeDiff::EditRemoved:
+            highlightItem(_oldModel, ui->treeViewOld, edit.oldItem, REMOVED_COLOR);
+            break;
+
+        case PlistTreeDiff::EditChanged:
+            highlightItem(_oldModel, ui->treeViewOld, edit.oldItem, CHANGED_COLOR);
+            highlightItem(_newModel, ui->treeViewNew, edit.newItem, CHANGED_COLOR);
+            break;
+        }
+
+        _expandedCount++;
+    }
+
+    ui->labelSummary->setText(tr("%1 added, %2 removed, %3 changed.")
+                              .arg(_diff.countEdits(PlistTreeDiff::EditAdded))
+                              .arg(_diff.countEdits(PlistTreeDiff::EditRemoved))
+                              .arg(_diff.countEdits(PlistTreeDiff::EditChanged)));
+}
+
+
+CompareDialog::~CompareDialog()
+{
+    delete ui;
+}
+
+
+void CompareDialog::highlightItem(CompareTreeModel *model, QTreeView *view, const PlistTreeItem *item, const QColor &color)
+{
+    model->setColor(item, color);
+
+    // Tint and open up every ancestor, stopping at one an earlier edit has already dealt with.
+    const bool shouldExpand = (_expandedCount < MAX_EXPANDED_EDITS);
+
+    for( PlistTreeItem *ancestor = item->parent(); ancestor != nullptr && !model->hasColor(ancestor); ancestor = ancestor->parent() )
+    {
+        QModelIndex index = model->indexForItem(ancestor);
+
+        if ( !index.isValid() ) {
+            break;
+        }
+
+        model->setColor(ancestor, CONTAINS_CHANGES_COLOR);
+
+        if ( shouldExpand ) {
+            view->expand(index);
+        }
+    }
+}
@@ -0,0 +1,63 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef COMPAREDIALOG_H
+#define COMPAREDIALOG_H
+
+#include <QDialog>
+#include <QTreeView>
+#include "../model/PlistTreeModel.h"
+#include "../model/PlistTreeDiff.h"
+
+
+namespace Ui {
+    class CompareDialog;
+}
+
+class CompareTreeModel;
+
+
+/**
+ * Shows two documents side by side, with the rows a PlistTreeDiff found highlighted:
+ * removed rows on the left, added rows on the right and changed rows on both. Rows
+ * which only contain changes are tinted too, and expanded so the changes are visible.
+ * Both trees are read-only.
+ */
+class CompareDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    /** Compare the old and new trees, taking ownership of both roots and their arenas, as PlistTreeModel does. */
+    CompareDialog(PlistTreeItem *oldRoot, PlistTreeArena *oldArena, const QString &oldTitle,
+                  PlistTreeItem *newRoot, PlistTreeArena *newArena, const QString &newTitle, QWidget *parent = 0);
+    ~CompareDialog();
+
+private:
+    void highlightItem(CompareTreeModel *model, QTreeView *view, const PlistTreeItem *item, const QColor &color);
+
+    Ui::CompareDialog *ui;
+    CompareTreeModel *_oldModel;
+    CompareTreeModel *_newModel;
+    PlistTreeDiff _diff;
+    int _expandedCount;
+};
+
+#endif // COMPAREDIALOG_H
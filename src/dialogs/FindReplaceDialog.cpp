@@ -1,15 +1,23 @@
 #include "FindReplaceDialog.h"
 #include "ui_FindReplaceDialog.h"
+#include "../model/PlistTextMatcher.h"
 
 FindReplaceDialog::FindReplaceDialog(QWidget *parent) : QDialog(parent), ui(new Ui::FindReplaceDialog)
 {
     ui->setupUi(this);
 
     ui->comboBoxMode->addItem("Normal");
+    ui->comboBoxMode->addItem("Whole Word");
+    ui->comboBoxMode->addItem("Regular Expression");
 
     ui->comboBoxTarget->addItem("Keys and Values");
     ui->comboBoxTarget->addItem("Values Only");
     ui->comboBoxTarget->addItem("Keys Only");
+
+    connect(ui->lineEditFind, SIGNAL(textChanged(QString)), this, SLOT(refreshMatchCount()));
+    connect(ui->comboBoxTarget, SIGNAL(currentIndexChanged(int)), this, SLOT(refreshMatchCount()));
+    connect(ui->comboBoxMode, SIGNAL(currentIndexChanged(int)), this, SLOT(refreshMatchCount()));
+    connect(ui->checkBoxMatchCase, SIGNAL(toggled(bool)), this, SLOT(refreshMatchCount()));
 }
 
 FindReplaceDialog::~FindReplaceDialog()
@@ -17,17 +25,79 @@ FindReplaceDialog::~FindReplaceDialog()
     delete ui;
 }
 
+void FindReplaceDialog::setMatchCount(int count, bool isPartial)
+{
+    if ( ui->lineEditFind->text().isEmpty() ) {
+        ui->labelMatches->clear();
+    } else if ( count < 0 ) {
+        ui->labelMatches->setText("Indexing...");
+    } else if ( isPartial ) {
+        ui->labelMatches->setText(QString("%1 %2 so far").arg(count).arg(count == 1 ? "match" : "matches"));
+    } else {
+        ui->labelMatches->setText(QString("%1 %2").arg(count).arg(count == 1 ? "match" : "matches"));
+    }
+}
+
+void FindReplaceDialog::refreshMatchCount()
+{
+    QString find = ui->lineEditFind->text();
+    PlistTextMatcher matcher(find, currentMode(), currentCaseSensitivity());
+
+    // A half typed expression is worth pointing out rather than counting.
+    if ( !find.isEmpty() && !matcher.isValid() ) {
+        ui->labelMatches->setText(matcher.errorString());
+        return;
+    }
+
+    emit findTextChanged(find, currentTarget(), currentMode(), currentCaseSensitivity());
+}
+
 void FindReplaceDialog::on_pushButton_clicked()
 {
-    ReplaceTarget target = ReplaceAll;
-    ReplaceMode mode = ReplaceModeNormal;
+    ReplaceTarget target = currentTarget();
+    ReplaceMode mode = currentMode();
+
+    emit doFindReplace(ui->lineEditFind->text(), ui->lineEditReplace->text(), target, mode, currentCaseSensitivity());
+}
+
+void FindReplaceDialog::on_pushButtonNext_clicked()
+{
+    emit doFindNext(ui->lineEditFind->text(), currentTarget(), currentMode(), currentCaseSensitivity(), false);
+}
+
+void FindReplaceDialog::on_pushButtonPrevious_clicked()
+{
+    emit doFindNext(ui->lineEditFind->text(), currentTarget(), currentMode(), currentCaseSensitivity(), true);
+}
+
+void FindReplaceDialog::on_pushButtonCount_clicked()
+{
+    emit doFindReplace(ui->lineEditFind->text(), ui->lineEditReplace->text(), currentTarget(), currentMode(), currentCaseSensitivity(), true);
+}
 
+ReplaceTarget FindReplaceDialog::currentTarget() const
+{
     switch( ui->comboBoxTarget->currentIndex() )
     {
-    case 0: target = ReplaceAll; break;
-    case 1: target = ReplaceValue; break;
-    case 2: target = ReplaceKey; break;
+    case 1: return ReplaceValue;
+    case 2: return ReplaceKey;
+    }
+
+    return ReplaceAll;
+}
+
+ReplaceMode FindReplaceDialog::currentMode() const
+{
+    switch( ui->comboBoxMode->currentIndex() )
+    {
+    case 1: return ReplaceModeWholeWord;
+    case 2: return ReplaceModeRegularExpression;
     }
 
-    emit doFindReplace(ui->lineEditFind->text(), ui->lineEditReplace->text(), target, mode);
+    return ReplaceModeNormal;
+}
+
+Qt::CaseSensitivity FindReplaceDialog::currentCaseSensitivity() const
+{
+    return ui->checkBoxMatchCase->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive;
 }
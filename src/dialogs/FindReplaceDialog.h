@@ -34,7 +34,7 @@ namespace Ui {
  * A simple find replace dialog which presents text fields for the find/replace text
  * parameters and combo boxes for the target/mode of the find replace operation.
  * Emits a doFindReplace signal whenever the user clicks on the 'Find / Replace All'
- * button.
+ * or 'Count Replacements' buttons, doFindNext for 'Find Next' and 'Find Previous', and findTextChanged as the user types so the number of matches can be shown.
  */
 class FindReplaceDialog : public QDialog
 {
@@ -45,13 +45,36 @@ public:
     ~FindReplaceDialog();
 
 signals:
-    void doFindReplace(QString &find, QString &replace, ReplaceTarget target = ReplaceAll, ReplaceMode mode = ReplaceModeNormal);
+    /** Replace everything that matches, or with dryRun, just count what would be replaced. */
+    void doFindReplace(QString &find, QString &replace, ReplaceTarget target = ReplaceAll, ReplaceMode mode = ReplaceModeNormal, Qt::CaseSensitivity cs = Qt::CaseSensitive, bool dryRun = false);
 
+    /** Select the next (or previous) match after the current selection. */
+    void doFindNext(const QString &find, ReplaceTarget target, ReplaceMode mode, Qt::CaseSensitivity cs, bool backwards);
+
+    /** The find text or options changed, so the match count wants updating. */
+    void findTextChanged(const QString &find, ReplaceTarget target, ReplaceMode mode, Qt::CaseSensitivity cs);
+
+public slots:
+    /**
+     * Show how many items match the find text, or that the document is still being indexed if count is -1.
+     * A partial count only covers the part of the document which has been read from the file so far.
+     */
+    void setMatchCount(int count, bool isPartial = false);
+
+    /** Ask for the match count again, such as when the search index becomes ready. */
+    void refreshMatchCount();
     
 private slots:
     void on_pushButton_clicked();
+    void on_pushButtonCount_clicked();
+    void on_pushButtonNext_clicked();
+    void on_pushButtonPrevious_clicked();
 
 private:
+    ReplaceTarget currentTarget() const;
+    ReplaceMode currentMode() const;
+    Qt::CaseSensitivity currentCaseSensitivity() const;
+
     Ui::FindReplaceDialog *ui;
 };
 
@@ -1,8 +1,19 @@
 #include "MainWindow.h"
+#include "PlistCommandLine.h"
+
 #include <QApplication>
+#include <QCoreApplication>
+
 
 int main(int argc, char *argv[])
 {
+    // Command line modes don't need (or want) a display.
+    if ( PlistCommandLine::IsCommand(argc, argv) ) {
+        QCoreApplication app(argc, argv);
+        PlistCommandLine commandLine;
+        return commandLine.run(app.arguments().mid(1));
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
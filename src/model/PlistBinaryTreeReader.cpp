@@ -0,0 +1,485 @@
+#include "PlistBinaryTreeReader.h"
+#include "PlistTreeArena.h"
+
+#include <QtEndian>
+#include <climits>
+#include <cstring>
+
+
+namespace {
+    const char BINARY_PLIST_MAGIC[] = "bplist0";
+    const int BINARY_PLIST_MAGIC_SIZE = 7;
+    const int BINARY_PLIST_HEADER_SIZE = 8;
+    const int BINARY_PLIST_TRAILER_SIZE = 32;
+
+    // Object markers are a type in the high nibble and size information in the low nibble.
+    const quint8 MARKER_NULL = 0x00;
+    const quint8 MARKER_FALSE = 0x08;
+    const quint8 MARKER_TRUE = 0x09;
+    const quint8 TYPE_SIMPLE = 0x0;
+    const quint8 TYPE_INTEGER = 0x1;
+    const quint8 TYPE_REAL = 0x2;
+    const quint8 TYPE_DATE = 0x3;
+    const quint8 TYPE_DATA = 0x4;
+    const quint8 TYPE_ASCII_STRING = 0x5;
+    const quint8 TYPE_UNICODE_STRING = 0x6;
+    const quint8 TYPE_UID = 0x8;
+    const quint8 TYPE_ARRAY = 0xA;
+    const quint8 TYPE_SET = 0xC;
+    const quint8 TYPE_DICTIONARY = 0xD;
+
+    // Binary plist dates are seconds relative to 2001-01-01T00:00:00Z.
+    const qint64 BINARY_PLIST_EPOCH_SECS = 978307200;
+
+    // Well beyond anything real, but keeps a hostile file from blowing the stack.
+    const int MAX_DEPTH = 512;
+
+    // How many objects to read between progress reports.
+    const int PROGRESS_INTERVAL = 4096;
+
+    // Items allowed per object reference the file has room for. Without shared containers there can't be
+    // more than one, but a file whose containers are referenced from many places could grow exponentially.
+    const quint64 MAX_ITEMS_PER_REF = 4;
+}
+
+
+PlistBinaryTreeReader::PlistBinaryTreeReader()
+{
+    _arena = nullptr;
+    _itemsUntilProgress = PROGRESS_INTERVAL;
+    _cancelled = false;
+    _data = nullptr;
+    _size = 0;
+    _offsetIntSize = 0;
+    _objectRefSize = 0;
+    _numObjects = 0;
+    _topObject = 0;
+    _offsetTableOffset = 0;
+    _itemsLeft = 0;
+}
+
+
+void PlistBinaryTreeReader::setArena(PlistTreeArena *arena)
+{
+    _arena = arena;
+}
+
+
+void PlistBinaryTreeReader::setProgressCallback(const std::function<bool(qint64, qint64)> &callback)
+{
+    _progressCallback = callback;
+}
+
+
+PlistTreeItem * PlistBinaryTreeReader::readTreeFromFile(QString &fileName)
+{
+    if ( fileName.isEmpty() ) {
+        return nullptr;
+    }
+
+    QFile file(fileName);
+
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        return nullptr;
+    }
+
+    // Parse straight out of the page cache rather than reading the file into a buffer.
+    qint64 size = file.size();
+    uchar *data = file.map(0, size);
+
+    if ( data == nullptr ) {
+        return nullptr;
+    }
+
+    PlistTreeItem *result = readTreeFromData(data, size);
+
+    file.unmap(data);
+    file.close();
+
+    return result;
+}
+
+
+PlistTreeItem * PlistBinaryTreeReader::readTreeFromData(const uchar *data, qint64 size)
+{
+    _data = data;
+    _size = size;
+
+    if ( !IsBinaryPlist(data, size) || !readTrailer() ) {
+        return nullptr;
+    }
+
+    _stringCache = QVector<QString>();
+    _stringCache.resize(static_cast<int>(qMin<quint64>(_numObjects, INT_MAX)));
+    _ancestors.clear();
+    _itemsLeft = (quint64(_size) / _objectRefSize + 1) * MAX_ITEMS_PER_REF;
+    _itemsUntilProgress = PROGRESS_INTERVAL;
+    _cancelled = false;
+
+    PlistTreeItem *result = itemForObject(_topObject, QString(), 0);
+
+    _stringCache = QVector<QString>();
+    _data = nullptr;
+    _size = 0;
+
+    return result;
+}
+
+
+bool PlistBinaryTreeReader::IsBinaryPlist(const uchar *data, qint64 size)
+{
+    return ( data != nullptr && size >= BINARY_PLIST_HEADER_SIZE && memcmp(data, BINARY_PLIST_MAGIC, BINARY_PLIST_MAGIC_SIZE) == 0 );
+}
+
+
+bool PlistBinaryTreeReader::IsBinaryPlistFile(QString &fileName)
+{
+    QFile file(fileName);
+
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        return false;
+    }
+
+    QByteArray header = file.read(BINARY_PLIST_HEADER_SIZE);
+    return IsBinaryPlist(reinterpret_cast<const uchar*>(header.constData()), header.size());
+}
+
+
+//
+// Protected Methods
+//
+
+
+bool PlistBinaryTreeReader::readTrailer()
+{
+    if ( _size < BINARY_PLIST_HEADER_SIZE + BINARY_PLIST_TRAILER_SIZE ) {
+        return false;
+    }
+
+    const quint64 trailer = _size - BINARY_PLIST_TRAILER_SIZE;
+    _offsetIntSize = _data[trailer + 6];
+    _objectRefSize = _data[trailer + 7];
+    _numObjects = qFromBigEndian<quint64>(_data + trailer + 8);
+    _topObject = qFromBigEndian<quint64>(_data + trailer + 16);
+    _offsetTableOffset = qFromBigEndian<quint64>(_data + trailer + 24);
+
+    if ( _offsetIntSize < 1 || _offsetIntSize > 8 || _objectRefSize < 1 || _objectRefSize > 8 ) {
+        return false;
+    }
+
+    if ( _numObjects == 0 || _topObject >= _numObjects || _offsetTableOffset < BINARY_PLIST_HEADER_SIZE ) {
+        return false;
+    }
+
+    // The offset table has to sit between the objects and the trailer.
+    if ( _offsetTableOffset > trailer || _numObjects > (trailer - _offsetTableOffset) / _offsetIntSize ) {
+        return false;
+    }
+
+    return true;
+}
+
+
+PlistTreeItem * PlistBinaryTreeReader::itemForObject(quint64 objectRef, const QString &key, int depth)
+{
+    quint64 offset = 0;
+
+    if ( _cancelled || depth > MAX_DEPTH || _itemsLeft == 0 || !objectOffset(objectRef, offset) ) {
+        return nullptr;
+    }
+
+    _itemsLeft--;
+
+    // Objects are usually laid out in the order they're read, so the offset of the
+    // current one is a reasonable measure of how far through the file we are.
+    if ( _progressCallback && --_itemsUntilProgress == 0 )
+    {
+        _itemsUntilProgress = PROGRESS_INTERVAL;
+
+        if ( !_progressCallback(static_cast<qint64>(offset), _size) ) {
+            _cancelled = true;
+            return nullptr;
+        }
+    }
+
+    const quint8 marker = _data[offset];
+    const quint8 type = marker >> 4;
+    const quint8 info = marker & 0x0f;
+    PlistValue value;
+
+    switch( type )
+    {
+    case TYPE_SIMPLE:
+        if ( marker == MARKER_FALSE || marker == MARKER_TRUE ) {
+            value.setType(PlistTreeItem::PlistBoolean);
+            value.setBoolean(marker == MARKER_TRUE);
+        } else if ( marker == MARKER_NULL ) {
+            // No XML equivalent; the closest thing we can show is an empty string.
+            value.setType(PlistTreeItem::PlistString);
+            value.setString(QString());
+        } else {
+            return nullptr;
+        }
+        break;
+
+    case TYPE_INTEGER:
+        {
+            // 1, 2 and 4 byte integers are unsigned, 8 bytes are signed and 16 bytes are
+            // 128-bit, of which we keep the low 64 bits.
+            const int size = 1 << info;
+
+            if ( info > 4 || offset + 1 + size > quint64(_size) ) {
+                return nullptr;
+            }
+
+            value.setType(PlistTreeItem::PlistInteger);
+            value.setInteger(static_cast<qint64>(readSizedInt(offset + 1 + (size == 16 ? 8 : 0), qMin(size, 8))));
+            break;
+        }
+
+    case TYPE_REAL:
+    case TYPE_DATE:
+        {
+            const int size = 1 << info;
+
+            if ( (size != 4 && size != 8) || offset + 1 + size > quint64(_size) ) {
+                return nullptr;
+            }
+
+            double real = 0.0;
+
+            if ( size == 4 ) {
+                quint32 bits = qFromBigEndian<quint32>(_data + offset + 1);
+                float f;
+                memcpy(&f, &bits, sizeof(f));
+                real = f;
+            } else {
+                quint64 bits = qFromBigEndian<quint64>(_data + offset + 1);
+                memcpy(&real, &bits, sizeof(real));
+            }
+
+            if ( type == TYPE_REAL ) {
+                value.setType(PlistTreeItem::PlistReal);
+                value.setReal(real);
+            } else {
+                value.setType(PlistTreeItem::PlistDate);
+                value.setDate(static_cast<qint64>((real + BINARY_PLIST_EPOCH_SECS) * 1000.0));
+            }
+            break;
+        }
+
+    case TYPE_DATA:
+        {
+            quint64 count = 0;
+            quint64 dataOffset = offset;
+
+            if ( !readCount(dataOffset, marker, count) || count > quint64(_size) - dataOffset || count > quint64(INT_MAX) ) {
+                return nullptr;
+            }
+
+            value.setType(PlistTreeItem::PlistData);
+            value.setData(QByteArray(reinterpret_cast<const char*>(_data + dataOffset), static_cast<int>(count)));
+            break;
+        }
+
+    case TYPE_ASCII_STRING:
+    case TYPE_UNICODE_STRING:
+        value.setType(PlistTreeItem::PlistString);
+        value.setString(stringForObject(objectRef));
+        break;
+
+    case TYPE_UID:
+        {
+            // Keyed archives use these; XML plists represent them as { CF$UID = n }.
+            const int size = info + 1;
+
+            if ( offset + 1 + size > quint64(_size) || size > 8 ) {
+                return nullptr;
+            }
+
+            PlistTreeItem *item = PlistTreeItem::Create(_arena, PlistTreeItem::PlistDictionary, key);
+            PlistTreeItem *uid = PlistTreeItem::Create(_arena, PlistTreeItem::PlistInteger, QString("CF$UID"));
+            PlistValue uidValue(PlistTreeItem::PlistInteger);
+            uidValue.setInteger(static_cast<qint64>(readSizedInt(offset + 1, size)));
+            uid->setValue(uidValue);
+            item->aendChild(uid);
+            return item;
+        }
+
+    case TYPE_ARRAY:
+    case TYPE_SET:
+    case TYPE_DICTIONARY:
+        {
+            quint64 count = 0;
+            quint64 refsOffset = offset;
+            const bool isDict = (type == TYPE_DICTIONARY);
+            const quint64 refCount = isDict ? 2 : 1;
+
+            if ( !readCount(refsOffset, marker, count) ) {
+                return nullptr;
+            }
+
+            if ( count > (quint64(_size) - refsOffset) / (_objectRefSize * refCount) ) {
+                return nullptr;
+            }
+
+            if ( _ancestors.contains(objectRef) ) {
+                return nullptr;
+            }
+
+            PlistTreeItem *item = PlistTreeItem::Create(_arena, isDict ? PlistTreeItem::PlistDictionary : PlistTreeItem::PlistArray, key);
+            _ancestors.append(objectRef);
+
+            for( quint64 i = 0; i < count; ++i )
+            {
+                quint64 childRef = 0;
+                QString childKey;
+
+                if ( isDict ) {
+                    quint64 keyRef = 0;
+
+                    if ( !readObjectRef(refsOffset + i * _objectRefSize, keyRef) ) {
+                        break;
+                    }
+
+                    childKey = stringForObject(keyRef);
+
+                    if ( !readObjectRef(refsOffset + (count + i) * _objectRefSize, childRef) ) {
+                        break;
+                    }
+                } else if ( !readObjectRef(refsOffset + i * _objectRefSize, childRef) ) {
+                    break;
+                }
+
+                PlistTreeItem *child = itemForObject(childRef, childKey, depth + 1);
+
+                if ( child == nullptr ) {
+                    _ancestors.removeLast();
+                    delete item;
+                    return nullptr;
+                }
+
+                item->aendChild(child);
+            }
+
+            _ancestors.removeLast();
+            return item;
+        }
+
+    default:
+        return nullptr;
+    }
+
+    PlistTreeItem *item = PlistTreeItem::Create(_arena, static_cast<PlistTreeItem::PlistType>(value.type()), key);
+    item->setValue(value);
+    return item;
+}
+
+
+QString PlistBinaryTreeReader::stringForObject(quint64 objectRef)
+{
+    quint64 offset = 0;
+
+    if ( !objectOffset(objectRef, offset) ) {
+        return QString();
+    }
+
+    if ( objectRef < quint64(_stringCache.size()) && !_stringCache.at(static_cast<int>(objectRef)).isNull() ) {
+        return _stringCache.at(static_cast<int>(objectRef));
+    }
+
+    const quint8 marker = _data[offset];
+    const quint8 type = marker >> 4;
+    quint64 count = 0;
+    QString result;
+
+    if ( !readCount(offset, marker, count) || count > quint64(INT_MAX) ) {
+        return QString();
+    }
+
+    if ( type == TYPE_ASCII_STRING && count <= quint64(_size) - offset )
+    {
+        result = QString::fromLatin1(reinterpret_cast<const char*>(_data + offset), static_cast<int>(count));
+    }
+    else if ( type == TYPE_UNICODE_STRING && count <= (quint64(_size) - offset) / 2 )
+    {
+        // UTF-16 big endian; swap into a QString in one pass.
+        result.resize(static_cast<int>(count));
+        QChar *out = result.data();
+
+        for( quint64 i = 0; i < count; ++i ) {
+            out[i] = QChar(qFromBigEndian<quint16>(_data + offset + i * 2));
+        }
+    }
+
+    // Mark empty strings as seen too, so they aren't decoded again.
+    if ( result.isNull() ) {
+        result = QString("");
+    }
+
+    if ( objectRef < quint64(_stringCache.size()) ) {
+        _stringCache[static_cast<int>(objectRef)] = result;
+    }
+
+    return result;
+}
+
+
+bool PlistBinaryTreeReader::objectOffset(quint64 objectRef, quint64 &offset) const
+{
+    if ( objectRef >= _numObjects ) {
+        return false;
+    }
+
+    offset = readSizedInt(_offsetTableOffset + objectRef * _offsetIntSize, _offsetIntSize);
+    return ( offset >= BINARY_PLIST_HEADER_SIZE && offset < _offsetTableOffset );
+}
+
+
+bool PlistBinaryTreeReader::readCount(quint64 &offset, quint8 marker, quint64 &count) const
+{
+    // Counts under 15 live in the marker; otherwise an integer object follows it.
+    count = marker & 0x0f;
+    offset += 1;
+
+    if ( count != 0x0f ) {
+        return true;
+    }
+
+    if ( offset >= quint64(_size) || (_data[offset] >> 4) != TYPE_INTEGER ) {
+        return false;
+    }
+
+    const int size = 1 << (_data[offset] & 0x0f);
+
+    if ( size > 8 || offset + 1 + size > quint64(_size) ) {
+        return false;
+    }
+
+    count = readSizedInt(offset + 1, size);
+    offset += 1 + size;
+    return true;
+}
+
+
+bool PlistBinaryTreeReader::readObjectRef(quint64 offset, quint64 &objectRef) const
+{
+    if ( offset + _objectRefSize > quint64(_size) ) {
+        return false;
+    }
+
+    objectRef = readSizedInt(offset, _objectRefSize);
+    return true;
+}
+
+
+quint64 PlistBinaryTreeReader::readSizedInt(quint64 offset, int size) const
+{
+    quint64 result = 0;
+
+    for( int i = 0; i < size; ++i ) {
+        result = (result << 8) | _data[offset + i];
+    }
+
+    return result;
+}
@@ -0,0 +1,92 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTBINARYTREEREADER_H
+#define PLISTBINARYTREEREADER_H
+
+#include "PlistTreeItem.h"
+
+#include <QFile>
+#include <QVector>
+
+#include <functional>
+
+
+/**
+ * @brief Class for reading a Plist tree from a binary (bplist00) file or buffer.
+ *
+ * Files are memory mapped and the object table is walked in place via the offset
+ * table in the trailer, so the only copies made are the decoded strings and data
+ * blobs stored in the resulting items. Strings referenced from several places (keys
+ * in an array of dictionaries, typically) are decoded once and shared.
+ */
+class PlistBinaryTreeReader
+{
+public:
+    PlistBinaryTreeReader();
+
+    /** Allocate all items read from now on in the given arena (or on the heap, if nullptr). */
+    void setArena(PlistTreeArena *arena);
+
+    /** Called periodically with the bytes read so far and the total; return false to cancel the read. */
+    void setProgressCallback(const std::function<bool(qint64, qint64)> &callback);
+
+    PlistTreeItem * readTreeFromFile(QString &fileName);
+    PlistTreeItem * readTreeFromData(const uchar *data, qint64 size);
+
+    /** Does the given buffer start with the binary plist magic bytes? */
+    static bool IsBinaryPlist(const uchar *data, qint64 size);
+
+    /** Does the given file start with the binary plist magic bytes? */
+    static bool IsBinaryPlistFile(QString &fileName);
+
+
+protected:
+    bool readTrailer();
+    PlistTreeItem * itemForObject(quint64 objectRef, const QString &key, int depth);
+    QString stringForObject(quint64 objectRef);
+
+    bool objectOffset(quint64 objectRef, quint64 &offset) const;
+    bool readCount(quint64 &offset, quint8 marker, quint64 &count) const;
+    bool readObjectRef(quint64 offset, quint64 &objectRef) const;
+    quint64 readSizedInt(quint64 offset, int size) const;
+
+
+private:
+    PlistTreeArena *_arena;
+    std::function<bool(qint64, qint64)> _progressCallback;
+    int _itemsUntilProgress;
+    bool _cancelled;
+
+    const uchar *_data;                 // Start of the (mapped) file
+    qint64 _size;
+
+    int _offsetIntSize;                 // Trailer fields
+    int _objectRefSize;
+    quint64 _numObjects;
+    quint64 _topObject;
+    quint64 _offsetTableOffset;
+
+    QVector<QString> _stringCache;      // Decoded strings by object ref
+    QVector<quint64> _ancestors;        // Containers being read, to reject reference cycles
+    quint64 _itemsLeft;                 // How many more items the file is allowed to expand into
+};
+
+#endif // PLISTBINARYTREEREADER_H
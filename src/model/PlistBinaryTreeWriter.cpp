@@ -0,0 +1,424 @@
+#include "PlistBinaryTreeWriter.h"
+
+#include <QtEndian>
+#include <cstring>
+
+
+namespace {
+    const char BINARY_PLIST_HEADER[] = "bplist00";
+    const int BINARY_PLIST_HEADER_SIZE = 8;
+    const int FLUSH_THRESHOLD = 1 << 20;
+
+    const quint8 MARKER_FALSE = 0x08;
+    const quint8 MARKER_TRUE = 0x09;
+    const quint8 TYPE_INTEGER = 0x1;
+    const quint8 TYPE_REAL = 0x2;
+    const quint8 TYPE_DATE = 0x3;
+    const quint8 TYPE_DATA = 0x4;
+    const quint8 TYPE_ASCII_STRING = 0x5;
+    const quint8 TYPE_UNICODE_STRING = 0x6;
+    const quint8 TYPE_ARRAY = 0xA;
+    const quint8 TYPE_DICTIONARY = 0xD;
+
+    const qint64 BINARY_PLIST_EPOCH_SECS = 978307200;
+
+    // Smallest number of bytes which can hold the given unsigned value.
+    int bytesNeeded(quint64 value) {
+        if ( value <= 0xff ) { return 1; }
+        if ( value <= 0xffff ) { return 2; }
+        if ( value <= 0xffffffffULL ) { return 4; }
+        return 8;
+    }
+
+    bool isAscii(const QString &string) {
+        const QChar *data = string.constData();
+
+        for( int i = 0; i < string.size(); ++i ) {
+            if ( data[i].unicode() > 0x7f ) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+
+PlistBinaryTreeWriter::PlistBinaryTreeWriter()
+{
+    _booleans[0] = -1;
+    _booleans[1] = -1;
+    _objectRefSize = 1;
+}
+
+
+bool PlistBinaryTreeWriter::writeTreeToFile(PlistTreeItem *rootNode, QString &fileName)
+{
+    if ( rootNode == nullptr || fileName.isEmpty() ) {
+        return false;
+    }
+
+    // The original file is only replaced once everything has been written.
+    QSaveFile file(fileName);
+
+    if ( !file.open(QIODevice::WriteOnly) ) {
+        return false;
+    }
+
+    if ( !writeTree(rootNode, &file) ) {
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
+
+
+bool PlistBinaryTreeWriter::writeTreeToIODevice(PlistTreeItem *rootNode, QIODevice *device)
+{
+    if ( rootNode == nullptr || device == nullptr ) {
+        return false;
+    }
+
+    if ( !device->isOpen() && !device->open(QIODevice::WriteOnly) ) {
+        return false;
+    }
+
+    bool result = writeTree(rootNode, device);
+
+    device->close();
+    return result;
+}
+
+
+//
+// Protected Methods
+//
+
+
+bool PlistBinaryTreeWriter::writeTree(PlistTreeItem *rootNode, QIODevice *device)
+{
+    flattenNode(rootNode);
+    bool result = writeObjects(device);
+
+    _objects.clear();
+    _refs.clear();
+    _strings.clear();
+    _integers.clear();
+    _reals.clear();
+    _dates.clear();
+    _datas.clear();
+    _booleans[0] = -1;
+    _booleans[1] = -1;
+
+    return result;
+}
+
+
+bool PlistBinaryTreeWriter::writeObjects(QIODevice *device)
+{
+    _objectRefSize = bytesNeeded(_objects.count() - 1);
+    _buffer.reserve(FLUSH_THRESHOLD * 2);
+    _buffer.append(BINARY_PLIST_HEADER, BINARY_PLIST_HEADER_SIZE);
+
+    // Stream the objects out, noting where each one starts.
+    QVector<quint64> offsets;
+    offsets.reserve(_objects.count());
+    quint64 written = 0;
+
+    for( int i = 0; i < _objects.count(); ++i )
+    {
+        offsets.append(written + _buffer.size());
+        encodeObject(_objects.at(i));
+
+        if ( _buffer.size() >= FLUSH_THRESHOLD ) {
+            written += _buffer.size();
+
+            if ( !flush(device) ) {
+                return false;
+            }
+        }
+    }
+
+    // Offset table, using the smallest size which can hold the last offset.
+    const quint64 offsetTableOffset = written + _buffer.size();
+    const int offsetIntSize = bytesNeeded(offsets.isEmpty() ? 0 : offsets.last());
+
+    for( int i = 0; i < offsets.count(); ++i )
+    {
+        encodeSizedInt(offsets.at(i), offsetIntSize);
+
+        if ( _buffer.size() >= FLUSH_THRESHOLD && !flush(device) ) {
+            return false;
+        }
+    }
+
+    // Trailer: 6 unused bytes, the two sizes, then object count, top object and table offset.
+    _buffer.append(QByteArray(6, '\0'));
+    _buffer.append(static_cast<char>(offsetIntSize));
+    _buffer.append(static_cast<char>(_objectRefSize));
+    encodeSizedInt(_objects.count(), 8);
+    encodeSizedInt(0, 8);
+    encodeSizedInt(offsetTableOffset, 8);
+
+    return flush(device);
+}
+
+
+quint64 PlistBinaryTreeWriter::flattenNode(const PlistTreeItem *node)
+{
+    if ( !PlistTreeItem::IsContainerType(node->plistType()) ) {
+        return uniqueScalar(node);
+    }
+
+    // Containers are never uniqued. The object is added before its children so the
+    // root ends up as object 0, and child references are gathered locally because
+    // nested containers add their own references while we recurse.
+    const bool isDict = (node->plistType() == PlistTreeItem::PlistDictionary);
+    const quint64 id = addObject(isDict ? ObjectDictionary : ObjectArray, node);
+    const int count = node->childCount();
+
+    QVector<quint64> refs(isDict ? count * 2 : count);
+
+    for( int i = 0; i < count; ++i )
+    {
+        const PlistTreeItem *child = node->child(i);
+
+        if ( isDict ) {
+            refs[i] = uniqueString(child->key());
+            refs[count + i] = flattenNode(child);
+        } else {
+            refs[i] = flattenNode(child);
+        }
+    }
+
+    Object &object = _objects[static_cast<int>(id)];
+    object.refsStart = _refs.count();
+    object.refsCount = count;
+    _refs += refs;
+
+    return id;
+}
+
+
+quint64 PlistBinaryTreeWriter::uniqueString(const QString &string)
+{
+    QHash<QString, quint64>::const_iterator it = _strings.constFind(string);
+
+    if ( it != _strings.constEnd() ) {
+        return it.value();
+    }
+
+    quint64 id = addObject(ObjectString, nullptr, string);
+    _strings.insert(string, id);
+    return id;
+}
+
+
+quint64 PlistBinaryTreeWriter::uniqueScalar(const PlistTreeItem *node)
+{
+    const PlistValue &value = node->value();
+
+    switch( node->plistType() )
+    {
+    case PlistTreeItem::PlistString:
+        return uniqueString(value.string());
+
+    case PlistTreeItem::PlistBoolean:
+        {
+            const int index = value.boolean() ? 1 : 0;
+
+            if ( _booleans[index] < 0 ) {
+                _booleans[index] = addObject(ObjectBoolean, node);
+            }
+
+            return _booleans[index];
+        }
+
+    case PlistTreeItem::PlistInteger:
+        {
+            QHash<qint64, quint64>::const_iterator it = _integers.constFind(value.integer());
+
+            if ( it != _integers.constEnd() ) {
+                return it.value();
+            }
+
+            quint64 id = addObject(ObjectInteger, node);
+            _integers.insert(value.integer(), id);
+            return id;
+        }
+
+    case PlistTreeItem::PlistReal:
+        {
+            const double real = value.real();
+            quint64 bits = 0;
+            memcpy(&bits, &real, sizeof(bits));
+
+            QHash<quint64, quint64>::const_iterator it = _reals.constFind(bits);
+
+            if ( it != _reals.constEnd() ) {
+                return it.value();
+            }
+
+            quint64 id = addObject(ObjectReal, node);
+            _reals.insert(bits, id);
+            return id;
+        }
+
+    case PlistTreeItem::PlistDate:
+        {
+            QHash<qint64, quint64>::const_iterator it = _dates.constFind(value.date());
+
+            if ( it != _dates.constEnd() ) {
+                return it.value();
+            }
+
+            quint64 id = addObject(ObjectDate, node);
+            _dates.insert(value.date(), id);
+            return id;
+        }
+
+    case PlistTreeItem::PlistData:
+        {
+            const QByteArray data = value.data();
+            QHash<QByteArray, quint64>::const_iterator it = _datas.constFind(data);
+
+            if ( it != _datas.constEnd() ) {
+                return it.value();
+            }
+
+            quint64 id = addObject(ObjectData, node);
+            _datas.insert(data, id);
+            return id;
+        }
+
+    default:
+        // Shouldn't happen for a valid tree; an empty string keeps the file readable.
+        return uniqueString(QString(""));
+    }
+}
+
+
+quint64 PlistBinaryTreeWriter::addObject(ObjectKind kind, const PlistTreeItem *node, const QString &string)
+{
+    Object object;
+    object.kind = kind;
+    object.node = node;
+    object.string = string;
+    object.refsStart = 0;
+    object.refsCount = 0;
+
+    _objects.append(object);
+    return _objects.count() - 1;
+}
+
+
+void PlistBinaryTreeWriter::encodeObject(const Object &object)
+{
+    switch( object.kind )
+    {
+    case ObjectBoolean:
+        _buffer.append(static_cast<char>(object.node->value().boolean() ? MARKER_TRUE : MARKER_FALSE));
+        break;
+
+    case ObjectInteger:
+        encodeInteger(object.node->value().integer());
+        break;
+
+    case ObjectReal:
+    case ObjectDate:
+        {
+            double real = object.node->value().real();
+
+            if ( object.kind == ObjectDate ) {
+                real = object.node->value().date() / 1000.0 - BINARY_PLIST_EPOCH_SECS;
+            }
+
+            quint64 bits = 0;
+            memcpy(&bits, &real, sizeof(bits));
+            _buffer.append(static_cast<char>(((object.kind == ObjectDate ? TYPE_DATE : TYPE_REAL) << 4) | 3));
+            encodeSizedInt(bits, 8);
+            break;
+        }
+
+    case ObjectData:
+        {
+            const QByteArray data = object.node->value().data();
+            encodeMarker(TYPE_DATA, data.size());
+            _buffer.append(data);
+            break;
+        }
+
+    case ObjectString:
+        if ( isAscii(object.string) )
+        {
+            encodeMarker(TYPE_ASCII_STRING, object.string.size());
+            _buffer.append(object.string.toLatin1());
+        }
+        else
+        {
+            encodeMarker(TYPE_UNICODE_STRING, object.string.size());
+            const QChar *data = object.string.constData();
+
+            for( int i = 0; i < object.string.size(); ++i ) {
+                encodeSizedInt(data[i].unicode(), 2);
+            }
+        }
+        break;
+
+    case ObjectArray:
+    case ObjectDictionary:
+        {
+            const bool isDict = (object.kind == ObjectDictionary);
+            encodeMarker(isDict ? TYPE_DICTIONARY : TYPE_ARRAY, object.refsCount);
+
+            const int refs = isDict ? object.refsCount * 2 : object.refsCount;
+
+            for( int i = 0; i < refs; ++i ) {
+                encodeSizedInt(_refs.at(object.refsStart + i), _objectRefSize);
+            }
+            break;
+        }
+    }
+}
+
+
+void PlistBinaryTreeWriter::encodeMarker(quint8 type, quint64 count)
+{
+    // Counts of 15 and over don't fit in the marker and follow it as an integer object.
+    if ( count < 0x0f ) {
+        _buffer.append(static_cast<char>((type << 4) | count));
+    } else {
+        _buffer.append(static_cast<char>((type << 4) | 0x0f));
+        encodeInteger(static_cast<qint64>(count));
+    }
+}
+
+
+void PlistBinaryTreeWriter::encodeInteger(qint64 value)
+{
+    // 1, 2 and 4 byte integers are unsigned, so negative values always take 8 bytes.
+    const int size = (value < 0) ? 8 : bytesNeeded(static_cast<quint64>(value));
+    const quint8 sizeLog2 = (size == 1) ? 0 : (size == 2) ? 1 : (size == 4) ? 2 : 3;
+
+    _buffer.append(static_cast<char>((TYPE_INTEGER << 4) | sizeLog2));
+    encodeSizedInt(static_cast<quint64>(value), size);
+}
+
+
+void PlistBinaryTreeWriter::encodeSizedInt(quint64 value, int size)
+{
+    for( int i = size - 1; i >= 0; --i ) {
+        _buffer.append(static_cast<char>((value >> (i * 8)) & 0xff));
+    }
+}
+
+
+bool PlistBinaryTreeWriter::flush(QIODevice *device)
+{
+    bool result = ( device->write(_buffer) == _buffer.size() );
+
+    // Keep the allocation around for the next batch of objects.
+    _buffer.resize(0);
+    return result;
+}
@@ -0,0 +1,99 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTBINARYTREEWRITER_H
+#define PLISTBINARYTREEWRITER_H
+
+#include "PlistTreeItem.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QHash>
+#include <QVector>
+
+
+/**
+ * @brief Class for writing a Plist Tree to a binary (bplist00) File / IODevice or buffer.
+ *
+ * The tree is first flattened into an object list, with strings (including keys),
+ * numbers, dates and data blobs uniqued so that each distinct value is stored once.
+ * Once the object count is known the smallest possible object reference size is
+ * chosen, and the objects are streamed out through a fixed size buffer followed by
+ * an offset table using the smallest offset size that fits.
+ */
+class PlistBinaryTreeWriter
+{
+public:
+    PlistBinaryTreeWriter();
+
+    bool writeTreeToFile(PlistTreeItem *rootNode, QString &fileName);
+    bool writeTreeToIODevice(PlistTreeItem *rootNode, QIODevice *device);
+
+
+protected:
+    enum ObjectKind {
+        ObjectBoolean,
+        ObjectInteger,
+        ObjectReal,
+        ObjectDate,
+        ObjectData,
+        ObjectString,
+        ObjectArray,
+        ObjectDictionary,
+    };
+
+    struct Object {
+        ObjectKind kind;
+        const PlistTreeItem *node;      // Item holding the value, or the container
+        QString string;                 // For strings, which may come from a key
+        int refsStart;                  // For containers, first entry in _refs
+        int refsCount;
+    };
+
+    bool writeTree(PlistTreeItem *rootNode, QIODevice *device);
+    bool writeObjects(QIODevice *device);
+    quint64 flattenNode(const PlistTreeItem *node);
+    quint64 uniqueString(const QString &string);
+    quint64 uniqueScalar(const PlistTreeItem *node);
+    quint64 addObject(ObjectKind kind, const PlistTreeItem *node, const QString &string = QString());
+
+    void encodeObject(const Object &object);
+    void encodeMarker(quint8 type, quint64 count);
+    void encodeInteger(qint64 value);
+    void encodeSizedInt(quint64 value, int size);
+    bool flush(QIODevice *device);
+
+
+private:
+    QVector<Object> _objects;
+    QVector<quint64> _refs;             // Child (and key) references of all containers
+
+    QHash<QString, quint64> _strings;   // Uniqued values by content
+    QHash<qint64, quint64> _integers;
+    QHash<quint64, quint64> _reals;     // Keyed by the bit pattern, so -0.0 and NaN behave
+    QHash<qint64, quint64> _dates;
+    QHash<QByteArray, quint64> _datas;
+    qint64 _booleans[2];
+
+    int _objectRefSize;
+    QByteArray _buffer;
+};
+
+#endif // PLISTBINARYTREEWRITER_H
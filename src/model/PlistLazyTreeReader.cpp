@@ -0,0 +1,354 @@
+#include "PlistLazyTreeReader.h"
+#include "PlistTreeArena.h"
+#include "PlistTreeReader.h"
+
+
+PlistLazyTreeReader::PlistLazyTreeReader()
+{
+    _source = nullptr;
+    _ownSource = nullptr;
+    _data = nullptr;
+    _size = 0;
+    _arena = nullptr;
+    _unsupported = false;
+}
+
+
+PlistLazyTreeReader::~PlistLazyTreeReader()
+{
+    delete _ownSource;
+    _ownSource = nullptr;
+}
+
+
+void PlistLazyTreeReader::setArena(PlistTreeArena *arena)
+{
+    _arena = arena;
+}
+
+
+void PlistLazyTreeReader::setSource(PlistTreeSource *source)
+{
+    _source = source;
+}
+
+
+bool PlistLazyTreeReader::isUnsupported() const
+{
+    return _unsupported;
+}
+
+
+void PlistLazyTreeReader::setProgressCallback(const std::function<bool(qint64, qint64)> &callback)
+{
+    _progressCallback = callback;
+}
+
+
+PlistTreeItem * PlistLazyTreeReader::readTreeFromFile(QString &fileName)
+{
+    if ( fileName.isEmpty() || _data != nullptr ) {
+        return nullptr;
+    }
+
+    if ( _source == nullptr ) {
+        _ownSource = new PlistTreeSource();
+        _source = _ownSource;
+    }
+
+    if ( !_source->open(fileName) ) {
+        return nullptr;
+    }
+
+    _data = _source->data();
+    _size = _source->size();
+
+    // Skip the prolog up to and including <plist>, then read the root item.
+    PlistXmlTokenizer tokenizer(_data, _size);
+    PlistXmlTokenizer::Token token;
+    tokenizer.setProgressCallback(_progressCallback);
+
+    do {
+        token = tokenizer.readNext();
+    } while( token == PlistXmlTokenizer::TokenText && tokenizer.isWhitespace() );
+
+    if ( token != PlistXmlTokenizer::TokenStartElement || tokenizer.elementName() != PlistXmlTokenizer::ElementPlist ) {
+        _unsupported = tokenizer.isUnsupported();
+        return nullptr;
+    }
+
+    do {
+        token = tokenizer.readNext();
+    } while( token == PlistXmlTokenizer::TokenText && tokenizer.isWhitespace() );
+
+    PlistTreeItem *root = nullptr;
+    PlistTreeItem::PlistType rootType = PlistTreeReader::PlistTypeForElementName(tokenizer.elementName());
+
+    if ( token == PlistXmlTokenizer::TokenStartElement && PlistTreeItem::IsContainerType(rootType) )
+    {
+        // The root's children are wanted straight away, for the initial view, so they're read
+        // in the same pass that finds the end of the root, rather than skipping it first.
+        const qint64 elementBegin = tokenizer.tokenBegin();
+        QList<PlistTreeItem*> children;
+
+        if ( !readItems(tokenizer, rootType == PlistTreeItem::PlistDictionary, children, _arena, false) || tokenizer.token() != PlistXmlTokenizer::TokenEndElement ) {
+            qDeleteAll(children);
+        } else {
+            // The span goes on first, so that a renamed duplicate key can mark it out of date.
+            root = PlistTreeItem::Create(_arena, rootType);
+            root->setSourceSpan(_source->addSpan(elementBegin, tokenizer.tokenEnd()));
+
+            for( int i = 0; i < children.count(); ++i ) {
+                root->aendChild(children.at(i));
+            }
+        }
+    }
+    else if ( token == PlistXmlTokenizer::TokenStartElement || token == PlistXmlTokenizer::TokenEmptyElement )
+    {
+        root = readItem(tokenizer, QString(), _arena, false);
+    }
+
+    if ( root == nullptr ) {
+        _unsupported = tokenizer.isUnsupported();
+        return nullptr;
+    }
+
+    return root;
+}
+
+
+bool PlistLazyTreeReader::readChildren(PlistTreeItem *item, QList<PlistTreeItem*> &children)
+{
+    children.clear();
+    qint64 token = (item != nullptr) ? item->fetchToken() : -1;
+
+    if ( token < 0 || token >= _ranges.count() || _data == nullptr ) {
+        return false;
+    }
+
+    const Range &range = _ranges.at(static_cast<int>(token));
+    PlistXmlTokenizer tokenizer(_data, _size, range.begin, range.end);
+
+    if ( !readItems(tokenizer, item->plistType() == PlistTreeItem::PlistDictionary, children, _arena, false) || tokenizer.token() != PlistXmlTokenizer::TokenEndOfDocument
+         || children.count() != item->unfetchedChildCount() )
+    {
+        _unsupported = _unsupported || tokenizer.isUnsupported();
+        qDeleteAll(children);
+        children.clear();
+        return false;
+    }
+
+    return true;
+}
+
+
+bool PlistLazyTreeReader::readSubtrees(QVector<Subtree> &subtrees, PlistTreeArena *arena, const std::function<bool(qint64, qint64)> &progressCallback)
+{
+    qint64 totalBytes = 0;
+    qint64 bytesRead = 0;
+
+    for( int i = 0; i < subtrees.count(); ++i )
+    {
+        const qint64 token = subtrees.at(i).token;
+
+        if ( token >= 0 && token < _ranges.count() ) {
+            totalBytes += _ranges.at(static_cast<int>(token)).end - _ranges.at(static_cast<int>(token)).begin;
+        }
+    }
+
+    for( int i = 0; i < subtrees.count(); ++i )
+    {
+        Subtree &subtree = subtrees[i];
+        subtree.isRead = false;
+        subtree.children.clear();
+
+        if ( subtree.token < 0 || subtree.token >= _ranges.count() || _data == nullptr ) {
+            continue;
+        }
+
+        // Each container's bytes are read once, with its descendants read as they're reached rather than skipped.
+        const Range &range = _ranges.at(static_cast<int>(subtree.token));
+        PlistXmlTokenizer tokenizer(_data, _size, range.begin, range.end);
+
+        if ( progressCallback ) {
+            const qint64 rangeBegin = range.begin;
+            const qint64 bytesBefore = bytesRead;
+
+            tokenizer.setProgressCallback([&progressCallback, rangeBegin, bytesBefore, totalBytes](qint64 pos, qint64) {
+                return progressCallback(bytesBefore + pos - rangeBegin, totalBytes);
+            });
+        }
+
+        subtree.isRead = readItems(tokenizer, subtree.isDictionary, subtree.children, arena, true) && tokenizer.token() == PlistXmlTokenizer::TokenEndOfDocument
+                         && subtree.children.count() == subtree.count;
+
+        if ( !subtree.isRead ) {
+            qDeleteAll(subtree.children);
+            subtree.children.clear();
+        }
+
+        bytesRead += range.end - range.begin;
+
+        if ( progressCallback && !progressCallback(bytesRead, totalBytes) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+PlistLazyTreeReader::Subtree PlistLazyTreeReader::SubtreeForItem(const PlistTreeItem *item)
+{
+    Subtree subtree;
+    subtree.token = item->fetchToken();
+    subtree.count = item->unfetchedChildCount();
+    subtree.isDictionary = (item->plistType() == PlistTreeItem::PlistDictionary);
+    subtree.isRead = false;
+    return subtree;
+}
+
+
+//
+// Protected Methods
+//
+
+
+bool PlistLazyTreeReader::readItems(PlistXmlTokenizer &tokenizer, bool isInDict, QList<PlistTreeItem*> &items, PlistTreeArena *arena, bool readAll)
+{
+    QString key;
+
+    while( true )
+    {
+        switch( tokenizer.readNext() )
+        {
+        case PlistXmlTokenizer::TokenText:
+            if ( !tokenizer.isWhitespace() ) {
+                return false;
+            }
+            break;
+
+        case PlistXmlTokenizer::TokenStartElement:
+        case PlistXmlTokenizer::TokenEmptyElement:
+            if ( isInDict && tokenizer.elementName() == PlistXmlTokenizer::ElementKey )
+            {
+                if ( tokenizer.token() == PlistXmlTokenizer::TokenEmptyElement ) {
+                    key = QString();
+                } else {
+                    key = tokenizer.readElementText();
+
+                    if ( tokenizer.token() != PlistXmlTokenizer::TokenEndElement ) {
+                        return false;
+                    }
+                }
+            }
+            else
+            {
+                PlistTreeItem *item = readItem(tokenizer, isInDict ? key : QString(), arena, readAll);
+
+                if ( item == nullptr ) {
+                    return false;
+                }
+
+                items.append(item);
+            }
+            break;
+
+        case PlistXmlTokenizer::TokenEndOfDocument:
+            // The range stops just short of the container's own end tag...
+            return true;
+
+        case PlistXmlTokenizer::TokenEndElement:
+            // ...unless it's the root, which is read without a range.
+            return true;
+
+        default:
+            return false;
+        }
+    }
+}
+
+
+PlistTreeItem * PlistLazyTreeReader::readItem(PlistXmlTokenizer &tokenizer, const QString &key, PlistTreeArena *arena, bool readAll)
+{
+    PlistXmlTokenizer::ElementName elementName = tokenizer.elementName();
+    PlistTreeItem::PlistType plistType = PlistTreeReader::PlistTypeForElementName(elementName);
+    const bool isEmptyElement = (tokenizer.token() == PlistXmlTokenizer::TokenEmptyElement);
+
+    if ( plistType == PlistTreeItem::PlistError ) {
+        return nullptr;
+    }
+
+    PlistTreeItem *item = PlistTreeItem::Create(arena, plistType, key);
+
+    if ( PlistTreeItem::IsContainerType(plistType) )
+    {
+        if ( !isEmptyElement && readAll )
+        {
+            // Read the children now, in the same pass that finds the end of the container.
+            qint64 elementBegin = tokenizer.tokenBegin();
+            QList<PlistTreeItem*> children;
+
+            if ( !readItems(tokenizer, plistType == PlistTreeItem::PlistDictionary, children, arena, true) || tokenizer.token() != PlistXmlTokenizer::TokenEndElement ) {
+                qDeleteAll(children);
+                delete item;
+                return nullptr;
+            }
+
+            // As for the root, the span goes on before the children.
+            item->setSourceSpan(_source->addSpan(elementBegin, tokenizer.tokenEnd()));
+
+            for( int i = 0; i < children.count(); ++i ) {
+                item->aendChild(children.at(i));
+            }
+        }
+        else if ( !isEmptyElement )
+        {
+            // Just note where the content is and how many children there are.
+            qint64 elementBegin = tokenizer.tokenBegin();
+            qint64 begin = tokenizer.tokenEnd();
+            int childCount = 0;
+
+            if ( !tokenizer.skipCurrentElement(&childCount) ) {
+                delete item;
+                return nullptr;
+            }
+
+            if ( childCount > 0 ) {
+                Range range = { begin, tokenizer.tokenBegin() };
+                _ranges.append(range);
+                item->setUnfetchedChildren(_ranges.count() - 1, childCount);
+            }
+
+            item->setSourceSpan(_source->addSpan(elementBegin, tokenizer.tokenEnd()));
+        }
+    }
+    else if ( elementName == PlistXmlTokenizer::ElementTrue || elementName == PlistXmlTokenizer::ElementFalse )
+    {
+        item->setValueRetainType(elementName == PlistXmlTokenizer::ElementTrue);
+
+        if ( !isEmptyElement && !tokenizer.skipCurrentElement() ) {
+            delete item;
+            return nullptr;
+        }
+    }
+    else
+    {
+        QString text;
+
+        if ( !isEmptyElement )
+        {
+            text = tokenizer.readElementText();
+
+            if ( tokenizer.token() != PlistXmlTokenizer::TokenEndElement ) {
+                delete item;
+                return nullptr;
+            }
+        }
+
+        item->setValueRetainType(text);
+    }
+
+    return item;
+}
+
@@ -0,0 +1,120 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTLAZYTREEREADER_H
+#define PLISTLAZYTREEREADER_H
+
+#include "PlistTreeItem.h"
+#include "PlistXmlTokenizer.h"
+#include "PlistTreeSource.h"
+
+#include <QList>
+#include <QVector>
+#include <functional>
+
+
+/**
+ * @brief Reads an XML Plist file on demand, one container at a time.
+ *
+ * The file is held in a PlistTreeSource and scanned once up front, which only materializes the
+ * root item and its direct children. Every other container remembers where its content
+ * lives in the file and how many children it has, and is only read when readChildren()
+ * is called for it (typically from PlistTreeModel::fetchMore as the user expands the tree).
+ *
+ * Every non-empty container also gets its span recorded in the source, so that it can
+ * be copied verbatim when saving if it isn't changed.
+ *
+ * When everything is wanted at once, readSubtrees() reads each unfetched container with
+ * all of its descendants in a single pass over its bytes, and can do so on a worker thread.
+ *
+ * The reader (and its source) must outlive every item it returned which still has unfetched children.
+ */
+class PlistLazyTreeReader
+{
+public:
+    /** An unfetched container to be read in full by readSubtrees(), without touching the item itself. */
+    struct Subtree {
+        qint64 token;                       // The container's fetchToken()
+        int count;                          // How many children it should have
+        bool isDictionary;
+        bool isRead;                        // Were its children read successfully?
+        QList<PlistTreeItem*> children;     // Its children, with everything below them already attached
+    };
+
+    PlistLazyTreeReader();
+    ~PlistLazyTreeReader();
+
+    /** Allocate all items read from now on in the given arena (or on the heap, if nullptr). */
+    void setArena(PlistTreeArena *arena);
+
+    /** Read the file into the given source, which must outlive the reader. Without one, the reader keeps its own. */
+    void setSource(PlistTreeSource *source);
+
+    /** Report progress through readTreeFromFile (bytes scanned, total bytes). Returning false from it cancels the read. */
+    void setProgressCallback(const std::function<bool(qint64, qint64)> &callback);
+
+    /** Read the root item and its direct children. Returns nullptr on failure. */
+    PlistTreeItem * readTreeFromFile(QString &fileName);
+
+    /** Did the file use XML features we don't handle? If so, read it with PlistTreeReader instead. */
+    bool isUnsupported() const;
+
+    /**
+     * Read the unfetched children of the given container. They are not attached to it; that's up to the caller.
+     * Returns false (with no children) if that part of the file can't be read.
+     */
+    bool readChildren(PlistTreeItem *item, QList<PlistTreeItem*> &children);
+
+    /**
+     * Read the children of each of the given containers, and everything below them, allocating them in the
+     * given arena. Nothing else of the reader's changes, so this may run on a worker thread while readChildren()
+     * goes on being used elsewhere. Progress goes to the callback (bytes read, total bytes), and returning false
+     * from it stops the read and makes this return false.
+     */
+    bool readSubtrees(QVector<Subtree> &subtrees, PlistTreeArena *arena, const std::function<bool(qint64, qint64)> &progressCallback = std::function<bool(qint64, qint64)>());
+
+    /** Describe an unfetched container for readSubtrees(). */
+    static Subtree SubtreeForItem(const PlistTreeItem *item);
+
+
+protected:
+    bool readItems(PlistXmlTokenizer &tokenizer, bool isInDict, QList<PlistTreeItem*> &items, PlistTreeArena *arena, bool readAll);
+    PlistTreeItem * readItem(PlistXmlTokenizer &tokenizer, const QString &key, PlistTreeArena *arena, bool readAll);
+
+
+private:
+    struct Range {
+        qint64 begin;                   // Just after the container's start tag
+        qint64 end;                     // The '<' of its end tag
+    };
+
+    PlistTreeSource *_source;
+    PlistTreeSource *_ownSource;        // Used when no source was given
+    const char *_data;
+    qint64 _size;
+    QVector<Range> _ranges;             // Content of each unfetched container, indexed by fetch token
+
+    PlistTreeArena *_arena;
+    bool _unsupported;
+
+    std::function<bool(qint64, qint64)> _progressCallback;
+};
+
+#endif // PLISTLAZYTREEREADER_H
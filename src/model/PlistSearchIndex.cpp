@@ -0,0 +1,390 @@
+#include "PlistSearchIndex.h"
+
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+
+
+PlistSearchIndex::PlistSearchIndex(QObject *parent) : QObject(parent)
+{
+    _root = nullptr;
+    _tombstones = 0;
+    _ready = false;
+    _building = false;
+
+    connect(&_watcher, SIGNAL(finished()), this, SLOT(buildFinished()));
+}
+
+
+PlistSearchIndex::~PlistSearchIndex()
+{
+    // The worker only reads its own snapshot, so it just has to be allowed to finish.
+    if ( _watcher.isRunning() ) {
+        disconnect(&_watcher, SIGNAL(finished()), this, SLOT(buildFinished()));
+        _watcher.waitForFinished();
+    }
+}
+
+
+void PlistSearchIndex::build(PlistTreeItem *root)
+{
+    if ( root == nullptr || isBuilding() ) {
+        return;
+    }
+
+    _root = root;
+    _building = true;
+    _pendingUpdates.clear();
+    _pendingRemovals.clear();
+
+    // Copying the text is cheap (it's shared), and means the worker never touches the tree.
+    Snapshot snapshot;
+    CollectItems(root, snapshot.items);
+    snapshot.keys.resize(snapshot.items.count());
+    snapshot.values.resize(snapshot.items.count());
+
+    for( int i = 0; i < snapshot.items.count(); ++i )
+    {
+        const PlistTreeItem *item = snapshot.items.at(i);
+        snapshot.keys[i] = item->key();
+
+        if ( item->plistType() == PlistTreeItem::PlistString ) {
+            snapshot.values[i] = item->value().string();
+        }
+    }
+
+    _watcher.setFuture(QtConcurrent::run(&PlistSearchIndex::BuildIndex, snapshot));
+}
+
+
+bool PlistSearchIndex::isReady() const
+{
+    return _ready;
+}
+
+
+bool PlistSearchIndex::isBuilding() const
+{
+    // Not the watcher's state: edits made after the worker finishes but before its
+    // index is taken still have to be kept for applyPendingEdits().
+    return _building;
+}
+
+
+void PlistSearchIndex::addSubtree(PlistTreeItem *item)
+{
+    if ( item == nullptr || (!_ready && !isBuilding()) ) {
+        return;
+    }
+
+    QVector<PlistTreeItem*> items;
+    CollectItems(item, items);
+
+    for( int i = 0; i < items.count(); ++i )
+    {
+        if ( _ready ) {
+            addItem(items.at(i));
+        }
+
+        if ( isBuilding() ) {
+            _pendingUpdates.insert(items.at(i));
+        }
+    }
+}
+
+
+void PlistSearchIndex::removeSubtree(PlistTreeItem *item)
+{
+    if ( item == nullptr || (!_ready && !isBuilding()) ) {
+        return;
+    }
+
+    QVector<PlistTreeItem*> items;
+    CollectItems(item, items);
+
+    for( int i = 0; i < items.count(); ++i )
+    {
+        if ( _ready ) {
+            removeItem(items.at(i));
+        }
+
+        if ( isBuilding() ) {
+            _pendingUpdates.remove(items.at(i));
+            _pendingRemovals.insert(items.at(i));
+        }
+    }
+
+    compactIfNeeded();
+}
+
+
+void PlistSearchIndex::updateItem(PlistTreeItem *item)
+{
+    if ( item == nullptr || (!_ready && !isBuilding()) ) {
+        return;
+    }
+
+    if ( _ready ) {
+        removeItem(item);
+        addItem(item);
+    }
+
+    if ( isBuilding() ) {
+        _pendingUpdates.insert(item);
+    }
+
+    compactIfNeeded();
+}
+
+
+QList<PlistTreeItem*> PlistSearchIndex::find(const QString &text, ReplaceTarget target, Qt::CaseSensitivity cs, int limit) const
+{
+    QList<PlistTreeItem*> results;
+
+    if ( !_ready || text.isEmpty() || limit == 0 ) {
+        return results;
+    }
+
+    QVector<quint64> trigrams;
+    AppendTrigrams(text, trigrams);
+
+    if ( trigrams.isEmpty() )
+    {
+        // Too short to have any trigrams, so every item is a candidate.
+        for( int id = 0; id < _index.items.count(); ++id )
+        {
+            const PlistTreeItem *item = _index.items.at(id);
+
+            if ( item != nullptr && matches(item, text, target, cs) )
+            {
+                results.append(_index.items.at(id));
+
+                if ( results.count() == limit ) {
+                    break;
+                }
+            }
+        }
+
+        return results;
+    }
+
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    // Any trigram that appears nowhere means nothing can match.
+    QVector<const QVector<int>*> lists;
+
+    for( int i = 0; i < trigrams.count(); ++i )
+    {
+        Postings::const_iterator it = _index.postings.constFind(trigrams.at(i));
+
+        if ( it == _index.postings.constEnd() ) {
+            return results;
+        }
+
+        lists.append(&it.value());
+    }
+
+    // Intersect smallest first, so the candidate list only ever shrinks from the smallest.
+    std::sort(lists.begin(), lists.end(), [](const QVector<int> *a, const QVector<int> *b) { return a->count() < b->count(); });
+
+    QVector<int> candidates = *lists.first();
+    QVector<int> intersection;
+
+    for( int i = 1; i < lists.count() && !candidates.isEmpty(); ++i )
+    {
+        intersection.resize(qMin(candidates.count(), lists.at(i)->count()));
+        QVector<int>::iterator end = std::set_intersection(candidates.begin(), candidates.end(), lists.at(i)->begin(), lists.at(i)->end(), intersection.begin());
+        intersection.resize(static_cast<int>(end - intersection.begin()));
+        candidates.swap(intersection);
+    }
+
+    // Trigrams only narrow things down; the text itself decides.
+    for( int i = 0; i < candidates.count(); ++i )
+    {
+        PlistTreeItem *item = _index.items.at(candidates.at(i));
+
+        if ( item != nullptr && matches(item, text, target, cs) )
+        {
+            results.append(item);
+
+            if ( results.count() == limit ) {
+                break;
+            }
+        }
+    }
+
+    return results;
+}
+
+
+//
+// Private Slots
+//
+
+
+void PlistSearchIndex::buildFinished()
+{
+    _index = _watcher.result();
+    _tombstones = 0;
+    _ready = true;
+    _building = false;
+
+    applyPendingEdits();
+    emit ready();
+}
+
+
+//
+// Protected Methods
+//
+
+
+void PlistSearchIndex::addItem(PlistTreeItem *item)
+{
+    if ( _index.ids.contains(item) ) {
+        return;
+    }
+
+    const int id = _index.items.count();
+    _index.items.append(item);
+    _index.ids.insert(item, id);
+
+    QVector<quint64> trigrams;
+    AppendTrigrams(item->key(), trigrams);
+
+    if ( item->plistType() == PlistTreeItem::PlistString ) {
+        AppendTrigrams(item->value().string(), trigrams);
+    }
+
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    // The new id is the highest there is, so the lists stay sorted.
+    for( int i = 0; i < trigrams.count(); ++i ) {
+        _index.postings[trigrams.at(i)].append(id);
+    }
+}
+
+
+void PlistSearchIndex::removeItem(PlistTreeItem *item)
+{
+    QHash<const PlistTreeItem*, int>::iterator it = _index.ids.find(item);
+
+    if ( it == _index.ids.end() ) {
+        return;
+    }
+
+    // Leave the id in the posting lists; find() skips tombstones.
+    _index.items[it.value()] = nullptr;
+    _index.ids.erase(it);
+    _tombstones++;
+}
+
+
+void PlistSearchIndex::applyPendingEdits()
+{
+    // Removals first: an item removed during the build may share its address with one added after it.
+    foreach( PlistTreeItem *item, _pendingRemovals ) {
+        removeItem(item);
+    }
+
+    foreach( PlistTreeItem *item, _pendingUpdates ) {
+        removeItem(item);
+        addItem(item);
+    }
+
+    _pendingRemovals.clear();
+    _pendingUpdates.clear();
+
+    compactIfNeeded();
+}
+
+
+void PlistSearchIndex::compactIfNeeded()
+{
+    if ( !_ready || isBuilding() || _root == nullptr ) {
+        return;
+    }
+
+    // The current index keeps answering (and being updated) until the new one is ready.
+    if ( _tombstones > COMPACT_THRESHOLD && _tombstones > _index.items.count() / 2 ) {
+        build(_root);
+    }
+}
+
+
+bool PlistSearchIndex::matches(const PlistTreeItem *item, const QString &text, ReplaceTarget target, Qt::CaseSensitivity cs) const
+{
+    // The same items findReplace would change: keys in dictionaries and string values.
+    if ( target == ReplaceKey || target == ReplaceAll )
+    {
+        const PlistTreeItem *parent = item->parent();
+
+        if ( parent != nullptr && parent->shouldChildrenHaveKey() && item->key().contains(text, cs) ) {
+            return true;
+        }
+    }
+
+    if ( target == ReplaceValue || target == ReplaceAll )
+    {
+        if ( item->plistType() == PlistTreeItem::PlistString && item->value().string().contains(text, cs) ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+PlistSearchIndex::Index PlistSearchIndex::BuildIndex(const Snapshot &snapshot)
+{
+    Index index;
+    index.items = snapshot.items;
+    index.ids.reserve(snapshot.items.count());
+
+    QVector<quint64> trigrams;
+
+    for( int id = 0; id < snapshot.items.count(); ++id )
+    {
+        index.ids.insert(snapshot.items.at(id), id);
+
+        trigrams.resize(0);
+        AppendTrigrams(snapshot.keys.at(id), trigrams);
+        AppendTrigrams(snapshot.values.at(id), trigrams);
+
+        std::sort(trigrams.begin(), trigrams.end());
+        trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+        for( int i = 0; i < trigrams.count(); ++i ) {
+            index.postings[trigrams.at(i)].append(id);
+        }
+    }
+
+    return index;
+}
+
+
+void PlistSearchIndex::AppendTrigrams(const QString &text, QVector<quint64> &trigrams)
+{
+    if ( text.size() < 3 ) {
+        return;
+    }
+
+    // Case folded, so one index serves case sensitive and insensitive searches alike.
+    const QString folded = text.toCaseFolded();
+    const ushort *data = folded.utf16();
+
+    for( int i = 0; i + 2 < folded.size(); ++i ) {
+        trigrams.append((quint64(data[i]) << 32) | (quint64(data[i + 1]) << 16) | quint64(data[i + 2]));
+    }
+}
+
+
+void PlistSearchIndex::CollectItems(PlistTreeItem *item, QVector<PlistTreeItem*> &items)
+{
+    items.append(item);
+
+    for( int i = 0; i < item->childCount(); ++i ) {
+        CollectItems(item->child(i), items);
+    }
+}
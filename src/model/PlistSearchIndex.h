@@ -0,0 +1,133 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTSEARCHINDEX_H
+#define PLISTSEARCHINDEX_H
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+#include "PlistTreeItem.h"
+#include "PlistTreeModel.h"
+
+
+/**
+ * @brief Trigram index over the keys and string values of a Plist tree, for finding text without a full walk.
+ *
+ * Every indexed item gets an id, and every three character sequence (case folded) in its
+ * key or string value maps to the sorted list of ids it appears in. Searching for text
+ * of three characters or more intersects the lists for the text's trigrams, smallest
+ * first, and only checks the few candidates left against the real key and value; shorter
+ * text checks every indexed item, which is still much cheaper than walking the model.
+ *
+ * The index is built on a worker thread from a snapshot of the tree's text, taken on
+ * the calling thread. After that it is kept up to date by the model: an edited item is
+ * given a new id and its old one becomes a tombstone, so nothing ever has to be removed
+ * from the middle of a list, and once tombstones make up most of the ids the index is
+ * quietly rebuilt in the background. Edits made while a build is running are applied
+ * when it finishes. Everything but the build itself happens on the thread which owns
+ * the index.
+ */
+class PlistSearchIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PlistSearchIndex(QObject *parent = 0);
+    ~PlistSearchIndex();
+
+    /** Start indexing the tree below the given root in the background, replacing the current index once it's done. */
+    void build(PlistTreeItem *root);
+
+    /** Can the index be searched yet? */
+    bool isReady() const;
+
+    /** Is a build running? */
+    bool isBuilding() const;
+
+    /** Index the given item and everything below it, after it has been added to the tree. */
+    void addSubtree(PlistTreeItem *item);
+
+    /** Forget the given item and everything below it, before it is removed from the tree. */
+    void removeSubtree(PlistTreeItem *item);
+
+    /** Re-index the given item after its key or value has changed. */
+    void updateItem(PlistTreeItem *item);
+
+    /** Items with a key or string value (as the target says) containing the given text, stopping after limit of them if it isn't negative. */
+    QList<PlistTreeItem*> find(const QString &text, ReplaceTarget target, Qt::CaseSensitivity cs = Qt::CaseSensitive, int limit = -1) const;
+
+signals:
+    /** A build has finished and the index can be searched. */
+    void ready();
+
+private slots:
+    void buildFinished();
+
+
+protected:
+    typedef QHash<quint64, QVector<int> > Postings;
+
+    struct Snapshot {
+        QVector<PlistTreeItem*> items;
+        QVector<QString> keys;
+        QVector<QString> values;
+    };
+
+    struct Index {
+        QVector<PlistTreeItem*> items;          // By id; nullptr for a tombstone
+        QHash<const PlistTreeItem*, int> ids;   // Ids of the live items
+        Postings postings;
+    };
+
+    void addItem(PlistTreeItem *item);
+    void removeItem(PlistTreeItem *item);
+    void applyPendingEdits();
+    void compactIfNeeded();
+    bool matches(const PlistTreeItem *item, const QString &text, ReplaceTarget target, Qt::CaseSensitivity cs) const;
+
+    /** Build the posting lists for a snapshot. Runs on a worker thread. */
+    static Index BuildIndex(const Snapshot &snapshot);
+
+    /** Add the trigrams of the given text to a list, case folded and packed into 48 bits each. */
+    static void AppendTrigrams(const QString &text, QVector<quint64> &trigrams);
+
+    static void CollectItems(PlistTreeItem *item, QVector<PlistTreeItem*> &items);
+
+
+private:
+    // Below this many ids, tombstones aren't worth a rebuild.
+    static const int COMPACT_THRESHOLD = 65536;
+
+    QFutureWatcher<Index> _watcher;
+    PlistTreeItem *_root;
+    Index _index;
+    int _tombstones;
+    bool _ready;
+    bool _building;                         // Until buildFinished(), which can be well after the worker is done
+
+    QSet<PlistTreeItem*> _pendingUpdates;   // Added or changed while a build was running
+    QSet<PlistTreeItem*> _pendingRemovals;  // Removed while a build was running
+};
+
+#endif // PLISTSEARCHINDEX_H
@@ -0,0 +1,90 @@
+#include "PlistTextMatcher.h"
+
+
+PlistTextMatcher::PlistTextMatcher(const QString &find, ReplaceMode mode, Qt::CaseSensitivity cs)
+{
+    _find = find;
+    _mode = mode;
+    _cs = cs;
+
+    if ( mode == ReplaceModeNormal || find.isEmpty() ) {
+        return;
+    }
+
+    QRegularExpression::PatternOptions options = QRegularExpression::UseUnicodePropertiesOption;
+
+    if ( cs == Qt::CaseInsensitive ) {
+        options |= QRegularExpression::CaseInsensitiveOption;
+    }
+
+    if ( mode == ReplaceModeWholeWord ) {
+        // Lookarounds rather than \b, so text that starts or ends with punctuation still works.
+        _regex.setPattern("(?<!\\w)" + QRegularExpression::escape(find) + "(?!\\w)");
+    } else {
+        _regex.setPattern(find);
+    }
+
+    _regex.setPatternOptions(options);
+
+    if ( _regex.isValid() ) {
+        _regex.optimize();
+    }
+}
+
+
+bool PlistTextMatcher::isValid() const
+{
+    if ( _find.isEmpty() ) {
+        return false;
+    }
+
+    return (_mode == ReplaceModeNormal) || _regex.isValid();
+}
+
+
+QString PlistTextMatcher::errorString() const
+{
+    if ( _find.isEmpty() ) {
+        return QString("Nothing to find");
+    }
+
+    if ( _mode != ReplaceModeNormal && !_regex.isValid() ) {
+        return QString("%1 at offset %2").arg(_regex.errorString()).arg(_regex.patternErrorOffset());
+    }
+
+    return QString();
+}
+
+
+bool PlistTextMatcher::matches(const QString &text) const
+{
+    if ( !isValid() ) {
+        return false;
+    }
+
+    if ( _mode == ReplaceModeNormal ) {
+        return text.contains(_find, _cs);
+    }
+
+    return _regex.match(text).hasMatch();
+}
+
+
+bool PlistTextMatcher::replace(QString &text, const QString &replacement) const
+{
+    // Checking first means text that doesn't match is never copied.
+    if ( !matches(text) ) {
+        return false;
+    }
+
+    const QString original = text;
+
+    if ( _mode == ReplaceModeNormal ) {
+        text.replace(_find, replacement, _cs);
+    } else {
+        // The whole word pattern has no capture groups, so its replacement goes in exactly as typed.
+        text.replace(_regex, replacement);
+    }
+
+    return text != original;
+}
@@ -0,0 +1,61 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTTEXTMATCHER_H
+#define PLISTTEXTMATCHER_H
+
+#include "PlistTreeModel.h"
+
+#include <QRegularExpression>
+#include <QString>
+
+
+/**
+ * @brief The find half of a find/replace, prepared once and then tested against many keys and values.
+ *
+ * Normal mode looks for the text as it is. Whole word mode looks for it with no letter, digit
+ * or underscore either side, and regular expression mode treats it as a Perl compatible
+ * pattern, in which case the replacement can refer to captures as \1, \2 and so on. Both of
+ * those are compiled (and JIT compiled, where Qt supports it) when the matcher is made.
+ */
+class PlistTextMatcher
+{
+public:
+    PlistTextMatcher(const QString &find, ReplaceMode mode = ReplaceModeNormal, Qt::CaseSensitivity cs = Qt::CaseSensitive);
+
+    /** False if the text is empty or isn't a valid regular expression. */
+    bool isValid() const;
+    QString errorString() const;
+
+    /** Does the text contain a match? */
+    bool matches(const QString &text) const;
+
+    /** Replace every match in text. Returns true if that changed it. */
+    bool replace(QString &text, const QString &replacement) const;
+
+
+private:
+    QString _find;
+    ReplaceMode _mode;
+    Qt::CaseSensitivity _cs;
+    QRegularExpression _regex;          // Whole word and regular expression modes
+};
+
+#endif // PLISTTEXTMATCHER_H
@@ -0,0 +1,232 @@
+#include "PlistTreeArena.h"
+#include "PlistTreeItem.h"
+
+#include <new>
+
+
+namespace {
+    // Header tag for slots sitting on the free list. Arena pointers are always
+    // aligned, so this can never be mistaken for one.
+    const quintptr FREE_SLOT_TAG = 1;
+
+    // Each slot is a header followed by the item, rounded up to keep items aligned.
+    const size_t SLOT_SIZE = ((PlistTreeArena::HEADER_SIZE + sizeof(PlistTreeItem) + 15) / 16) * 16;
+
+    inline quintptr &slotTag(void *slot) {
+        return *static_cast<quintptr*>(slot);
+    }
+
+    inline quint64 &slotHeaderWord(void *slot) {
+        return *reinterpret_cast<quint64*>(static_cast<char*>(slot) + sizeof(quintptr));
+    }
+
+    inline void *&slotNextFree(void *slot) {
+        return *reinterpret_cast<void**>(static_cast<char*>(slot) + PlistTreeArena::HEADER_SIZE);
+    }
+}
+
+
+PlistTreeArena::PlistTreeArena()
+{
+    _chunkUsed = SLOTS_PER_CHUNK;
+    _freeList = nullptr;
+    _releasing = false;
+}
+
+
+PlistTreeArena::~PlistTreeArena()
+{
+    release();
+}
+
+
+void * PlistTreeArena::allocate()
+{
+    void *slot = nullptr;
+
+    if ( _freeList != nullptr )
+    {
+        slot = _freeList;
+        _freeList = slotNextFree(slot);
+    }
+    else
+    {
+        if ( _chunkUsed == SLOTS_PER_CHUNK ) {
+            _chunks.append(static_cast<char*>(::operator new(SLOT_SIZE * SLOTS_PER_CHUNK)));
+            _chunkUsed = 0;
+        }
+
+        slot = _chunks.last() + SLOT_SIZE * _chunkUsed++;
+    }
+
+    slotTag(slot) = reinterpret_cast<quintptr>(this);
+    slotHeaderWord(slot) = 0;
+    return static_cast<char*>(slot) + HEADER_SIZE;
+}
+
+
+void PlistTreeArena::deallocate(void *ptr)
+{
+    // Everything is about to be freed in one go anyway.
+    if ( _releasing || ptr == nullptr ) {
+        return;
+    }
+
+    void *slot = static_cast<char*>(ptr) - HEADER_SIZE;
+    slotTag(slot) = FREE_SLOT_TAG;
+    slotNextFree(slot) = _freeList;
+    _freeList = slot;
+}
+
+
+void PlistTreeArena::release()
+{
+    _releasing = true;
+    const quintptr liveTag = reinterpret_cast<quintptr>(this);
+
+    // Items check isReleasing() in their destructor and leave children from this arena
+    // alone, so each item is destroyed exactly once here without any recursion.
+    for( int i = 0; i < _chunks.count(); ++i )
+    {
+        char *chunk = _chunks.at(i);
+        int used = (i == _chunks.count() - 1) ? _chunkUsed : SLOTS_PER_CHUNK;
+
+        for( int j = 0; j < used; ++j )
+        {
+            char *slot = chunk + SLOT_SIZE * j;
+
+            if ( slotTag(slot) == liveTag ) {
+                reinterpret_cast<PlistTreeItem*>(slot + HEADER_SIZE)->~PlistTreeItem();
+            }
+        }
+    }
+
+    for( int i = 0; i < _chunks.count(); ++i ) {
+        ::operator delete(_chunks.at(i));
+    }
+
+    _chunks.clear();
+    _chunkUsed = SLOTS_PER_CHUNK;
+    _freeList = nullptr;
+    _releasing = false;
+}
+
+
+bool PlistTreeArena::isReleasing() const
+{
+    return _releasing;
+}
+
+
+qint64 PlistTreeArena::reservedBytes() const
+{
+    return static_cast<qint64>(_chunks.count()) * SLOTS_PER_CHUNK * SLOT_SIZE;
+}
+
+
+void PlistTreeArena::adopt(PlistTreeArena *other)
+{
+    if ( other == nullptr || other == this || other->_chunks.isEmpty() ) {
+        return;
+    }
+
+    const quintptr otherTag = reinterpret_cast<quintptr>(other);
+    const quintptr liveTag = reinterpret_cast<quintptr>(this);
+
+    // The other arena's last chunk won't be last here, so its unused slots go on the free list.
+    char *lastChunk = other->_chunks.last();
+
+    for( int j = other->_chunkUsed; j < SLOTS_PER_CHUNK; ++j ) {
+        other->deallocate(lastChunk + SLOT_SIZE * j + HEADER_SIZE);
+    }
+
+    for( int i = 0; i < other->_chunks.count(); ++i )
+    {
+        char *chunk = other->_chunks.at(i);
+
+        for( int j = 0; j < SLOTS_PER_CHUNK; ++j )
+        {
+            char *slot = chunk + SLOT_SIZE * j;
+
+            if ( slotTag(slot) == otherTag ) {
+                slotTag(slot) = liveTag;
+            }
+        }
+    }
+
+    // Splice the free lists together.
+    if ( other->_freeList != nullptr )
+    {
+        void *tail = other->_freeList;
+
+        while( slotNextFree(tail) != nullptr ) {
+            tail = slotNextFree(tail);
+        }
+
+        slotNextFree(tail) = _freeList;
+        _freeList = other->_freeList;
+    }
+
+    // Our own last chunk stays last, so _chunkUsed still describes it.
+    const int insertAt = _chunks.isEmpty() ? 0 : _chunks.count() - 1;
+
+    for( int i = 0; i < other->_chunks.count(); ++i ) {
+        _chunks.insert(insertAt + i, other->_chunks.at(i));
+    }
+
+    other->_chunks.clear();
+    other->_chunkUsed = SLOTS_PER_CHUNK;
+    other->_freeList = nullptr;
+}
+
+
+//
+// Static helpers
+//
+
+
+void * PlistTreeArena::AllocateItem(size_t size, PlistTreeArena *arena)
+{
+    if ( arena != nullptr && size + HEADER_SIZE <= SLOT_SIZE ) {
+        return arena->allocate();
+    }
+
+    void *block = ::operator new(size + HEADER_SIZE);
+    slotTag(block) = 0;
+    slotHeaderWord(block) = 0;
+    return static_cast<char*>(block) + HEADER_SIZE;
+}
+
+
+void PlistTreeArena::DeallocateItem(void *ptr)
+{
+    if ( ptr == nullptr ) {
+        return;
+    }
+
+    PlistTreeArena *arena = ArenaForItem(ptr);
+
+    if ( arena != nullptr ) {
+        arena->deallocate(ptr);
+    } else {
+        ::operator delete(static_cast<char*>(ptr) - HEADER_SIZE);
+    }
+}
+
+
+PlistTreeArena * PlistTreeArena::ArenaForItem(const void *ptr)
+{
+    quintptr tag = *reinterpret_cast<const quintptr*>(static_cast<const char*>(ptr) - HEADER_SIZE);
+
+    if ( tag == 0 || tag == FREE_SLOT_TAG ) {
+        return nullptr;
+    }
+
+    return reinterpret_cast<PlistTreeArena*>(tag);
+}
+
+
+quint64 & PlistTreeArena::ItemHeaderWord(const void *ptr)
+{
+    return slotHeaderWord(const_cast<char*>(static_cast<const char*>(ptr)) - HEADER_SIZE);
+}
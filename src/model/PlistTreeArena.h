@@ -0,0 +1,98 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTTREEARENA_H
+#define PLISTTREEARENA_H
+
+#include <QVector>
+#include <cstddef>
+
+
+/**
+ * @brief Pool allocator which owns every PlistTreeItem of a single document.
+ *
+ * Items are carved out of large chunks with a bump pointer, and items deleted while
+ * editing go onto a free list to be reused. Each slot is preceded by a small header
+ * recording the owning arena, which lets a plain 'delete item' work no matter where
+ * the item was allocated (items created without an arena live on the normal heap).
+ * The rest of the header is a spare word which items use to cache their hash.
+ *
+ * Destroying the arena destroys all of its live items in a single linear sweep over
+ * the chunks rather than recursing through the tree, then frees the chunks at once.
+ */
+class PlistTreeArena
+{
+public:
+    static const size_t HEADER_SIZE = 16;       // Keeps the item itself 16-byte aligned
+    static const int SLOTS_PER_CHUNK = 4096;
+
+    PlistTreeArena();
+    ~PlistTreeArena();
+
+    /** Allocate storage for a single item from this arena. */
+    void *allocate();
+
+    /** Return an item's storage to the free list. */
+    void deallocate(void *ptr);
+
+    /** Destroy every live item in the arena and free all of its memory. */
+    void release();
+
+    /** Is the arena currently sweeping through its items in release()? */
+    bool isReleasing() const;
+
+    /**
+     * Take over every item of another arena, such as one filled on a worker thread, leaving it empty.
+     * The items stay where they are; only the ownership recorded in their headers changes.
+     */
+    void adopt(PlistTreeArena *other);
+
+
+    //
+    // Static helpers used by PlistTreeItem's operator new/delete
+    //
+
+    /** Allocate an item of the given size, from the arena if one is provided or from the heap otherwise. */
+    static void *AllocateItem(size_t size, PlistTreeArena *arena);
+
+    /** Free an item allocated with AllocateItem, wherever it came from. */
+    static void DeallocateItem(void *ptr);
+
+    /** Which arena does the given item belong to? Returns nullptr for heap allocated items. */
+    static PlistTreeArena *ArenaForItem(const void *ptr);
+
+    /** Spare word in the given item's header, zeroed on allocation, which the item may use as it likes. */
+    static quint64 &ItemHeaderWord(const void *ptr);
+
+    /** Bytes of chunk memory held by this arena, whether the slots are in use or not. */
+    qint64 reservedBytes() const;
+
+
+private:
+    PlistTreeArena(const PlistTreeArena &);
+    PlistTreeArena &operator=(const PlistTreeArena &);
+
+    QVector<char*> _chunks;             // Chunks of SLOTS_PER_CHUNK slots each
+    int _chunkUsed;                     // Slots handed out from the last chunk
+    void *_freeList;                    // Slots returned by deallocate
+    bool _releasing;                    // In the middle of release()
+};
+
+#endif // PLISTTREEARENA_H
@@ -0,0 +1,217 @@
+#include "PlistTreeDiff.h"
+
+
+PlistTreeDiff::PlistTreeDiff()
+{
+}
+
+
+bool PlistTreeDiff::compare(const PlistTreeItem *oldRoot, const PlistTreeItem *newRoot)
+{
+    _edits.clear();
+
+    if ( oldRoot == nullptr && newRoot == nullptr ) {
+        return false;
+    } else if ( oldRoot == nullptr ) {
+        addEdit(EditAdded, nullptr, newRoot);
+    } else if ( newRoot == nullptr ) {
+        addEdit(EditRemoved, oldRoot, nullptr);
+    } else {
+        compareItems(oldRoot, newRoot);
+    }
+
+    return !_edits.isEmpty();
+}
+
+
+const QVector<PlistTreeDiff::Edit> & PlistTreeDiff::edits() const
+{
+    return _edits;
+}
+
+
+int PlistTreeDiff::countEdits(EditType type) const
+{
+    int count = 0;
+
+    for( int i = 0; i < _edits.count(); ++i ) {
+        if ( _edits.at(i).type == type ) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+
+//
+// Protected Methods
+//
+
+
+void PlistTreeDiff::compareItems(const PlistTreeItem *oldItem, const PlistTreeItem *newItem)
+{
+    if ( oldItem->subtreeHash() == newItem->subtreeHash() ) {
+        return;
+    }
+
+    // Only two containers of the same kind, with everything inside them read, are worth looking inside.
+    if ( oldItem->plistType() != newItem->plistType() || !PlistTreeItem::IsContainerType(oldItem->plistType()) ||
+         oldItem->hasUnfetchedChildren() || newItem->hasUnfetchedChildren() ) {
+        addEdit(EditChanged, oldItem, newItem);
+    } else if ( oldItem->plistType() == PlistTreeItem::PlistDictionary ) {
+        compareDictionaries(oldItem, newItem);
+    } else {
+        compareArrays(oldItem, newItem);
+    }
+}
+
+
+void PlistTreeDiff::compareDictionaries(const PlistTreeItem *oldItem, const PlistTreeItem *newItem)
+{
+    for( int i = 0; i < oldItem->childCount(); ++i )
+    {
+        const PlistTreeItem *oldChild = oldItem->child(i);
+        const PlistTreeItem *newChild = newItem->childForKey(oldChild->key());
+
+        if ( newChild == nullptr ) {
+            addEdit(EditRemoved, oldChild, nullptr);
+        } else {
+            compareItems(oldChild, newChild);
+        }
+    }
+
+    for( int i = 0; i < newItem->childCount(); ++i )
+    {
+        const PlistTreeItem *newChild = newItem->child(i);
+
+        if ( oldItem->childForKey(newChild->key()) == nullptr ) {
+            addEdit(EditAdded, nullptr, newChild);
+        }
+    }
+}
+
+
+void PlistTreeDiff::compareArrays(const PlistTreeItem *oldItem, const PlistTreeItem *newItem)
+{
+    QVector<int> matches = MatchChildren(oldItem, newItem);
+    int oldNext = 0;
+    int newNext = 0;
+
+    // Whatever lies between two matches goes to pairRuns.
+    for( int i = 0; i < matches.count(); ++i )
+    {
+        if ( matches.at(i) >= 0 ) {
+            pairRuns(oldItem, oldNext, i, newItem, newNext, matches.at(i));
+            oldNext = i + 1;
+            newNext = matches.at(i) + 1;
+        }
+    }
+
+    pairRuns(oldItem, oldNext, oldItem->childCount(), newItem, newNext, newItem->childCount());
+}
+
+
+void PlistTreeDiff::pairRuns(const PlistTreeItem *oldItem, int oldBegin, int oldEnd, const PlistTreeItem *newItem, int newBegin, int newEnd)
+{
+    const int paired = qMin(oldEnd - oldBegin, newEnd - newBegin);
+
+    for( int k = 0; k < paired; ++k ) {
+        compareItems(oldItem->child(oldBegin + k), newItem->child(newBegin + k));
+    }
+
+    for( int k = oldBegin + paired; k < oldEnd; ++k ) {
+        addEdit(EditRemoved, oldItem->child(k), nullptr);
+    }
+
+    for( int k = newBegin + paired; k < newEnd; ++k ) {
+        addEdit(EditAdded, nullptr, newItem->child(k));
+    }
+}
+
+
+QVector<int> PlistTreeDiff::MatchChildren(const PlistTreeItem *oldItem, const PlistTreeItem *newItem)
+{
+    const int oldCount = oldItem->childCount();
+    const int newCount = newItem->childCount();
+    QVector<int> matches(oldCount, -1);
+    int prefix = 0;
+    int suffix = 0;
+
+    // Most edits leave the start and end of an array alone.
+    while( prefix < oldCount && prefix < newCount && oldItem->child(prefix)->subtreeHash() == newItem->child(prefix)->subtreeHash() ) {
+        matches[prefix] = prefix;
+        prefix++;
+    }
+
+    while( suffix < oldCount - prefix && suffix < newCount - prefix &&
+           oldItem->child(oldCount - 1 - suffix)->subtreeHash() == newItem->child(newCount - 1 - suffix)->subtreeHash() ) {
+        matches[oldCount - 1 - suffix] = newCount - 1 - suffix;
+        suffix++;
+    }
+
+    MatchRuns(oldItem, prefix, oldCount - suffix, newItem, prefix, newCount - suffix, matches);
+    return matches;
+}
+
+
+void PlistTreeDiff::MatchRuns(const PlistTreeItem *oldItem, int oldBegin, int oldEnd, const PlistTreeItem *newItem, int newBegin, int newEnd, QVector<int> &matches)
+{
+    const int rows = oldEnd - oldBegin;
+    const int columns = newEnd - newBegin;
+
+    // Too big to align (or nothing to align); everything in between stays unmatched.
+    if ( rows == 0 || columns == 0 || static_cast<qint64>(rows + 1) * (columns + 1) > MAX_LCS_CELLS ) {
+        return;
+    }
+
+    QVector<quint64> oldHashes(rows);
+    QVector<quint64> newHashes(columns);
+
+    for( int i = 0; i < rows; ++i ) {
+        oldHashes[i] = oldItem->child(oldBegin + i)->subtreeHash();
+    }
+
+    for( int j = 0; j < columns; ++j ) {
+        newHashes[j] = newItem->child(newBegin + j)->subtreeHash();
+    }
+
+    // lengths[i][j] is the length of the LCS of old[i..] and new[j..].
+    const int stride = columns + 1;
+    QVector<int> lengths((rows + 1) * stride, 0);
+
+    for( int i = rows - 1; i >= 0; --i )
+    {
+        for( int j = columns - 1; j >= 0; --j )
+        {
+            if ( oldHashes.at(i) == newHashes.at(j) ) {
+                lengths[i * stride + j] = lengths.at((i + 1) * stride + j + 1) + 1;
+            } else {
+                lengths[i * stride + j] = qMax(lengths.at((i + 1) * stride + j), lengths.at(i * stride + j + 1));
+            }
+        }
+    }
+
+    int i = 0;
+    int j = 0;
+
+    while( i < rows && j < columns )
+    {
+        if ( oldHashes.at(i) == newHashes.at(j) ) {
+            matches[oldBegin + i] = newBegin + j;
+            i++;
+            j++;
+        } else if ( lengths.at((i + 1) * stride + j) >= lengths.at(i * stride + j + 1) ) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+}
+
+
+void PlistTreeDiff::addEdit(EditType type, const PlistTreeItem *oldItem, const PlistTreeItem *newItem)
+{
+    Edit edit = { type, oldItem, newItem };
+    _edits.append(edit);
+}
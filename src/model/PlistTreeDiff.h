@@ -0,0 +1,93 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTTREEDIFF_H
+#define PLISTTREEDIFF_H
+
+#include "PlistTreeItem.h"
+
+#include <QVector>
+
+
+/**
+ * @brief Structural diff between two Plist trees, producing a flat edit script.
+ *
+ * Subtrees with the same subtreeHash() are skipped without being visited, so the cost
+ * depends on how much changed rather than on the size of the documents. Dictionary
+ * children are matched by key through the key index, which ignores their order. Only
+ * arrays need a sequence alignment: the common prefix and suffix are trimmed first,
+ * then the remainder is aligned with an LCS over the children's hashes. Unmatched
+ * children left between two matches are paired up by position and compared in turn,
+ * so an edit deep inside an array element is reported where it happened rather than
+ * as the whole element being removed and added again.
+ *
+ * Both trees should be fully read; unfetched children are not compared.
+ */
+class PlistTreeDiff
+{
+public:
+    enum EditType {
+        EditAdded,                      // Only in the new tree
+        EditRemoved,                    // Only in the old tree
+        EditChanged,                    // Value or type differs
+    };
+
+    struct Edit {
+        EditType type;
+        const PlistTreeItem *oldItem;   // nullptr for EditAdded
+        const PlistTreeItem *newItem;   // nullptr for EditRemoved
+    };
+
+    PlistTreeDiff();
+
+    /** Compare the two trees, replacing any previous edit script. Returns false if they are identical. */
+    bool compare(const PlistTreeItem *oldRoot, const PlistTreeItem *newRoot);
+
+    /** The edits found by the last compare(), in document order. */
+    const QVector<Edit> &edits() const;
+
+    /** How many edits of the given type were found? */
+    int countEdits(EditType type) const;
+
+    /**
+     * Align the children of two arrays by hash, as compare() does: for each old child, the
+     * index of the new child it matches, or -1. Matched indices always increase.
+     */
+    static QVector<int> MatchChildren(const PlistTreeItem *oldItem, const PlistTreeItem *newItem);
+
+
+protected:
+    void compareItems(const PlistTreeItem *oldItem, const PlistTreeItem *newItem);
+    void compareDictionaries(const PlistTreeItem *oldItem, const PlistTreeItem *newItem);
+    void compareArrays(const PlistTreeItem *oldItem, const PlistTreeItem *newItem);
+    void pairRuns(const PlistTreeItem *oldItem, int oldBegin, int oldEnd, const PlistTreeItem *newItem, int newBegin, int newEnd);
+    void addEdit(EditType type, const PlistTreeItem *oldItem, const PlistTreeItem *newItem);
+
+    static void MatchRuns(const PlistTreeItem *oldItem, int oldBegin, int oldEnd, const PlistTreeItem *newItem, int newBegin, int newEnd, QVector<int> &matches);
+
+
+private:
+    // Arrays whose unmatched middles would need a bigger LCS table than this are paired up by position instead.
+    static const qint64 MAX_LCS_CELLS = 4 * 1024 * 1024;
+
+    QVector<Edit> _edits;
+};
+
+#endif // PLISTTREEDIFF_H
@@ -0,0 +1,821 @@
+#include "PlistTreeFilterModel.h"
+#include "PlistTextMatcher.h"
+#include "PlistTreeReplacer.h"
+
+#include <algorithm>
+
+
+namespace {
+    // Above this many separate runs of rows coming and going, one reset is cheaper for the views.
+    const int MAX_ROW_CHANGES = 1000;
+
+    // Child lists are in source order, so a child's place in one can be found by its source row.
+    bool IsBeforeRow(const PlistTreeItem *item, int row)
+    {
+        return item->row() < row;
+    }
+}
+
+
+PlistTreeFilterModel::PlistTreeFilterModel(PlistTreeModel *source, QObject *parent) : QAbstractProxyModel(parent)
+{
+    _treeModel = source;
+    _matchCount = -1;
+    _isRemoving = false;
+    _isInserting = false;
+    _isResetting = false;
+    _isStale = false;
+
+    setSourceModel(source);
+
+    connect(source, SIGNAL(rowsAboutToBeInserted(QModelIndex,int,int)), this, SLOT(sourceRowsAboutToBeInserted(QModelIndex,int,int)));
+    connect(source, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(sourceRowsInserted(QModelIndex,int,int)));
+    connect(source, SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)), this, SLOT(sourceRowsAboutToBeRemoved(QModelIndex,int,int)));
+    connect(source, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(sourceRowsRemoved(QModelIndex,int,int)));
+    connect(source, SIGNAL(dataChanged(QModelIndex,QModelIndex)), this, SLOT(sourceDataChanged(QModelIndex,QModelIndex)));
+    connect(source, SIGNAL(modelAboutToBeReset()), this, SLOT(sourceAboutToBeReset()));
+    connect(source, SIGNAL(modelReset()), this, SLOT(sourceReset()));
+}
+
+
+void PlistTreeFilterModel::setFilterText(const QString &text)
+{
+    if ( text == _filterText ) {
+        return;
+    }
+
+    // Every row that contains the new text also contains the old text, so only those need checking
+    // again, unless rows the old text hid have changed since.
+    const bool narrowing = !_isStale && !_filterText.isEmpty() && text.contains(_filterText, Qt::CaseInsensitive);
+
+    // Everything has to be here to be searched, and reading it adds rows, so it's read before
+    // anything changes here. When narrowing, it already is.
+    if ( !text.isEmpty() && !narrowing ) {
+        _treeModel->fetchAll();
+    }
+
+    _filterText = text;
+    refilter(narrowing);
+}
+
+
+QString PlistTreeFilterModel::filterText() const
+{
+    return _filterText;
+}
+
+
+int PlistTreeFilterModel::matchCount() const
+{
+    return _matchCount;
+}
+
+
+PlistTreeModel *PlistTreeFilterModel::treeModel() const
+{
+    return _treeModel;
+}
+
+
+//
+// Proxy Methods
+//
+
+
+QModelIndex PlistTreeFilterModel::mapToSource(const QModelIndex &proxyIndex) const
+{
+    if ( !proxyIndex.isValid() ) {
+        return QModelIndex();
+    }
+
+    return _treeModel->indexForItem(static_cast<PlistTreeItem*>(proxyIndex.internalPointer()), proxyIndex.column());
+}
+
+
+QModelIndex PlistTreeFilterModel::mapFromSource(const QModelIndex &sourceIndex) const
+{
+    if ( !sourceIndex.isValid() ) {
+        return QModelIndex();
+    }
+
+    PlistTreeItem *item = _treeModel->itemAtIndex(sourceIndex);
+
+    if ( !isVisible(item) ) {
+        return QModelIndex();
+    }
+
+    return createIndex(proxyRow(item), sourceIndex.column(), item);
+}
+
+
+QModelIndex PlistTreeFilterModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if ( row < 0 || column < 0 || column >= columnCount(parent) ) {
+        return QModelIndex();
+    }
+
+    // The document root is always shown.
+    if ( !parent.isValid() ) {
+        QModelIndex sourceIndex = _treeModel->index(row, column);
+        return sourceIndex.isValid() ? createIndex(row, column, sourceIndex.internalPointer()) : QModelIndex();
+    }
+
+    PlistTreeItem *parentItem = static_cast<PlistTreeItem*>(parent.internalPointer());
+    ChildLists::const_iterator it = _children.constFind(parentItem);
+
+    if ( it != _children.constEnd() ) {
+        return (row < it.value().count()) ? createIndex(row, column, it.value().at(row)) : QModelIndex();
+    }
+
+    return (row < parentItem->childCount()) ? createIndex(row, column, parentItem->child(row)) : QModelIndex();
+}
+
+
+QModelIndex PlistTreeFilterModel::parent(const QModelIndex &child) const
+{
+    if ( !child.isValid() ) {
+        return QModelIndex();
+    }
+
+    PlistTreeItem *parentItem = static_cast<PlistTreeItem*>(child.internalPointer())->parent();
+
+    // The invisible root (which has no parent of its own) is the invalid index.
+    if ( parentItem == nullptr || parentItem->parent() == nullptr ) {
+        return QModelIndex();
+    }
+
+    return createIndex(proxyRow(parentItem), 0, parentItem);
+}
+
+
+int PlistTreeFilterModel::rowCount(const QModelIndex &parent) const
+{
+    if ( parent.column() > 0 ) {
+        return 0;
+    }
+
+    if ( !parent.isValid() ) {
+        return _treeModel->rowCount();
+    }
+
+    PlistTreeItem *item = static_cast<PlistTreeItem*>(parent.internalPointer());
+    ChildLists::const_iterator it = _children.constFind(item);
+    return (it != _children.constEnd()) ? it.value().count() : item->childCount();
+}
+
+
+int PlistTreeFilterModel::columnCount(const QModelIndex &) const
+{
+    return _treeModel->columnCount();
+}
+
+
+bool PlistTreeFilterModel::hasChildren(const QModelIndex &parent) const
+{
+    ChildLists::const_iterator it = _children.constFind(static_cast<PlistTreeItem*>(parent.internalPointer()));
+
+    if ( parent.isValid() && it != _children.constEnd() ) {
+        return !it.value().isEmpty();
+    }
+
+    return _treeModel->hasChildren(mapToSource(parent));
+}
+
+
+bool PlistTreeFilterModel::canFetchMore(const QModelIndex &parent) const
+{
+    // Filtering reads the whole document, so only rows shown as they are can have anything left to read.
+    if ( parent.isValid() && _children.contains(static_cast<PlistTreeItem*>(parent.internalPointer())) ) {
+        return false;
+    }
+
+    return _treeModel->canFetchMore(mapToSource(parent));
+}
+
+
+void PlistTreeFilterModel::fetchMore(const QModelIndex &parent)
+{
+    if ( canFetchMore(parent) ) {
+        _treeModel->fetchMore(mapToSource(parent));
+    }
+}
+
+
+QVariant PlistTreeFilterModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    return _treeModel->headerData(section, orientation, role);
+}
+
+
+bool PlistTreeFilterModel::insertRows(int row, int count, const QModelIndex &parent)
+{
+    PlistTreeItem *parentItem = static_cast<PlistTreeItem*>(parent.internalPointer());
+    ChildLists::const_iterator it = _children.constFind(parentItem);
+
+    if ( !parent.isValid() || it == _children.constEnd() ) {
+        return _treeModel->insertRows(row, count, mapToSource(parent));
+    }
+
+    // Just before the visible row that's there now, or just after the last one.
+    const QVector<PlistTreeItem*> &visible = it.value();
+    int sourceRow = parentItem->childCount();
+
+    if ( row < visible.count() ) {
+        sourceRow = visible.at(row)->row();
+    } else if ( !visible.isEmpty() ) {
+        sourceRow = visible.last()->row() + 1;
+    }
+
+    return _treeModel->insertRows(sourceRow, count, mapToSource(parent));
+}
+
+
+bool PlistTreeFilterModel::removeRows(int row, int count, const QModelIndex &parent)
+{
+    PlistTreeItem *parentItem = static_cast<PlistTreeItem*>(parent.internalPointer());
+    ChildLists::const_iterator it = _children.constFind(parentItem);
+
+    if ( !parent.isValid() || it == _children.constEnd() ) {
+        return _treeModel->removeRows(row, count, mapToSource(parent));
+    }
+
+    if ( row < 0 || count < 0 || row + count > it.value().count() ) {
+        return false;
+    }
+
+    // The visible rows needn't be next to each other in the source, so they go one at a time.
+    QVector<PlistTreeItem*> items = it.value().mid(row, count);
+    QModelIndex sourceParent = mapToSource(parent);
+    bool didRemove = true;
+
+    for( int i = items.count() - 1; i >= 0; --i ) {
+        didRemove = _treeModel->removeRows(items.at(i)->row(), 1, sourceParent) && didRemove;
+    }
+
+    return didRemove;
+}
+
+
+//
+// Protected Slots
+//
+
+
+void PlistTreeFilterModel::sourceRowsAboutToBeInserted(const QModelIndex &parent, int first, int last)
+{
+    PlistTreeItem *parentItem = _treeModel->itemAtIndex(parent);
+
+    // The reset works everything out afresh once it's over.
+    if ( _isResetting ) {
+        return;
+    }
+
+    // Rows added out of sight haven't been checked against the filter.
+    if ( parentItem != nullptr && !isVisible(parentItem) ) {
+        _isStale = true;
+        return;
+    }
+
+    // Filtered containers take their new rows in sourceRowsInserted, once they're there to look at.
+    if ( parentItem != nullptr && _children.contains(parentItem) ) {
+        return;
+    }
+
+    beginInsertRows(mapFromSource(parent), first, last);
+    _isInserting = true;
+}
+
+
+void PlistTreeFilterModel::sourceRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if ( _isInserting ) {
+        _isInserting = false;
+        endInsertRows();
+        return;
+    }
+
+    PlistTreeItem *parentItem = _treeModel->itemAtIndex(parent);
+    ChildLists::iterator it = _children.find(parentItem);
+
+    if ( _isResetting || parentItem == nullptr || it == _children.end() ) {
+        return;
+    }
+
+    // New rows are shown whatever the filter, so that it's clear where they went.
+    QVector<PlistTreeItem*> &visible = it.value();
+    const int proxyFirst = static_cast<int>(std::lower_bound(visible.begin(), visible.end(), first, IsBeforeRow) - visible.begin());
+
+    beginInsertRows(mapFromSource(parent), proxyFirst, proxyFirst + last - first);
+
+    for( int row = first; row <= last; ++row ) {
+        visible.insert(proxyFirst + row - first, parentItem->child(row));
+    }
+
+    renumberRows(visible, proxyFirst);
+    endInsertRows();
+}
+
+
+void PlistTreeFilterModel::sourceRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+    if ( _isResetting ) {
+        return;
+    }
+
+    PlistTreeItem *parentItem = _treeModel->itemAtIndex(parent);
+    ChildLists::iterator it = _children.find(parentItem);
+
+    if ( parentItem == nullptr || it == _children.end() )
+    {
+        if ( parentItem == nullptr || isVisible(parentItem) ) {
+            beginRemoveRows(mapFromSource(parent), first, last);
+            _isRemoving = true;
+        }
+
+        for( int row = first; row <= last; ++row ) {
+            forgetSubtree(_treeModel->itemAtIndex(_treeModel->index(row, 0, parent)));
+        }
+
+        return;
+    }
+
+    // The visible rows among those going are next to each other in the proxy.
+    QVector<PlistTreeItem*> &visible = it.value();
+    const int proxyFirst = static_cast<int>(std::lower_bound(visible.begin(), visible.end(), first, IsBeforeRow) - visible.begin());
+    int proxyLast = proxyFirst - 1;
+
+    while( proxyLast + 1 < visible.count() && visible.at(proxyLast + 1)->row() <= last ) {
+        proxyLast++;
+    }
+
+    if ( proxyLast < proxyFirst ) {
+        return;
+    }
+
+    beginRemoveRows(mapFromSource(parent), proxyFirst, proxyLast);
+    _isRemoving = true;
+
+    for( int row = proxyFirst; row <= proxyLast; ++row ) {
+        forgetSubtree(visible.at(row));
+        _rows.remove(visible.at(row));
+    }
+
+    visible.remove(proxyFirst, proxyLast - proxyFirst + 1);
+    renumberRows(visible, proxyFirst);
+}
+
+
+void PlistTreeFilterModel::sourceRowsRemoved(const QModelIndex &, int, int)
+{
+    if ( _isRemoving ) {
+        _isRemoving = false;
+        endRemoveRows();
+    }
+}
+
+
+void PlistTreeFilterModel::sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if ( !topLeft.isValid() || !bottomRight.isValid() || _isResetting ) {
+        return;
+    }
+
+    QModelIndex sourceParent = topLeft.parent();
+    const bool isTypeChange = (topLeft.column() <= PlistTreeItem::COLUMN_TYPE && bottomRight.column() >= PlistTreeItem::COLUMN_TYPE);
+
+    for( int row = topLeft.row(); row <= bottomRight.row(); ++row )
+    {
+        PlistTreeItem *item = _treeModel->itemAtIndex(_treeModel->index(row, 0, sourceParent));
+
+        if ( item == nullptr ) {
+            continue;
+        }
+
+        // A hidden row might match now, which a narrowing pass wouldn't notice.
+        if ( !isVisible(item) ) {
+            _isStale = true;
+            continue;
+        }
+
+        // A new type can mean new children, which the child lists know nothing about. Anything
+        // still unread is read first, so that reading it can't add rows in the middle of the update.
+        if ( isTypeChange && _children.contains(item) ) {
+            _treeModel->fetchAll();
+            refilter(false);
+            break;
+        }
+    }
+
+    int proxyFirst = -1;
+    int proxyLast = -1;
+
+    for( int row = topLeft.row(); row <= bottomRight.row(); ++row )
+    {
+        PlistTreeItem *item = _treeModel->itemAtIndex(_treeModel->index(row, 0, sourceParent));
+
+        if ( item == nullptr || !isVisible(item) ) {
+            continue;
+        }
+
+        const int proxy = proxyRow(item);
+        proxyFirst = (proxyFirst < 0) ? proxy : qMin(proxyFirst, proxy);
+        proxyLast = qMax(proxyLast, proxy);
+    }
+
+    if ( proxyFirst < 0 ) {
+        return;
+    }
+
+    QModelIndex proxyParent = mapFromSource(sourceParent);
+    emit dataChanged(index(proxyFirst, topLeft.column(), proxyParent), index(proxyLast, bottomRight.column(), proxyParent));
+}
+
+
+void PlistTreeFilterModel::sourceAboutToBeReset()
+{
+    beginResetModel();
+    _isResetting = true;
+}
+
+
+void PlistTreeFilterModel::sourceReset()
+{
+    _children.clear();
+    _rows.clear();
+    _matchCount = -1;
+
+    // Rows read in by the filter go unannounced, as the reset covers them.
+    if ( !_filterText.isEmpty() ) {
+        _treeModel->fetchAll();
+        applyFilter(false, _children, _rows, _matchCount);
+    }
+
+    _isStale = false;
+    _isResetting = false;
+    endResetModel();
+}
+
+
+//
+// Protected Methods
+//
+
+
+void PlistTreeFilterModel::refilter(bool narrowing)
+{
+    ChildLists children;
+    QHash<const PlistTreeItem*, int> rows;
+    int matchCount = -1;
+
+    if ( !_filterText.isEmpty() ) {
+        applyFilter(narrowing, children, rows, matchCount);
+    }
+
+    updateRows(children, rows);
+    _matchCount = matchCount;
+    _isStale = false;
+}
+
+
+void PlistTreeFilterModel::applyFilter(bool narrowing, ChildLists &children, QHash<const PlistTreeItem*, int> &rows, int &matchCount) const
+{
+    PlistTreeItem *root = _treeModel->visibleRoot();
+    children.clear();
+    rows.clear();
+    matchCount = 0;
+
+    if ( root == nullptr ) {
+        return;
+    }
+
+    PlistTextMatcher matcher(_filterText, ReplaceModeNormal, Qt::CaseInsensitive);
+
+    struct Frame {
+        PlistTreeItem *item;
+        const QVector<PlistTreeItem*> *candidates;  // Children to look at, or nullptr for all of them
+        int next;
+        QVector<PlistTreeItem*> visible;
+    };
+
+    QVector<Frame> stack;
+    Frame rootFrame = { root, nullptr, 0, QVector<PlistTreeItem*>() };
+    stack.append(rootFrame);
+
+    // Depth first, deciding on each item once all of its children have been decided on.
+    while( !stack.isEmpty() )
+    {
+        Frame &frame = stack.last();
+
+        if ( frame.next == 0 && narrowing ) {
+            ChildLists::const_iterator it = _children.constFind(frame.item);
+            frame.candidates = (it != _children.constEnd()) ? &it.value() : nullptr;
+        }
+
+        const int count = frame.candidates ? frame.candidates->count() : frame.item->childCount();
+
+        if ( frame.next < count )
+        {
+            PlistTreeItem *child = frame.candidates ? frame.candidates->at(frame.next) : frame.item->child(frame.next);
+            frame.next++;
+
+            Frame childFrame = { child, nullptr, 0, QVector<PlistTreeItem*>() };
+            stack.append(childFrame);
+            continue;
+        }
+
+        Frame done = stack.takeLast();
+        const bool matches = PlistTreeReplacer::ItemMatches(done.item, matcher, ReplaceAll);
+
+        if ( matches ) {
+            matchCount++;
+        }
+
+        if ( !matches && done.visible.isEmpty() && !stack.isEmpty() ) {
+            continue;
+        }
+
+        // A matching container still hides the children that don't match.
+        if ( done.item->childCount() > 0 )
+        {
+            for( int i = 0; i < done.visible.count(); ++i ) {
+                rows.insert(done.visible.at(i), i);
+            }
+
+            children.insert(done.item, done.visible);
+        }
+
+        if ( !stack.isEmpty() ) {
+            stack.last().visible.append(done.item);
+        }
+    }
+}
+
+
+void PlistTreeFilterModel::updateRows(ChildLists &children, QHash<const PlistTreeItem*, int> &rows)
+{
+    PlistTreeItem *root = _treeModel->visibleRoot();
+    QVector<PlistTreeItem*> changed;
+    int changes = 0;
+
+    // Only containers shown both before and after can have rows come and go; anything
+    // else comes or goes along with one of their rows.
+    QVector<PlistTreeItem*> stack;
+
+    if ( root != nullptr ) {
+        stack.append(root);
+    }
+
+    while( !stack.isEmpty() )
+    {
+        PlistTreeItem *item = stack.takeLast();
+        const QVector<PlistTreeItem*> before = shownChildren(item, _children);
+        const QVector<PlistTreeItem*> after = shownChildren(item, children);
+        int runs = 0;
+        int i = 0;
+        int j = 0;
+        bool inRun = false;
+
+        // Both lists are in source order, so they can be merged to find the runs that differ.
+        while( i < before.count() || j < after.count() )
+        {
+            if ( i < before.count() && j < after.count() && before.at(i) == after.at(j) )
+            {
+                if ( after.at(j)->childCount() > 0 ) {
+                    stack.append(after.at(j));
+                }
+
+                inRun = false;
+                i++;
+                j++;
+                continue;
+            }
+
+            if ( !inRun ) {
+                runs++;
+                inRun = true;
+            }
+
+            if ( j == after.count() || (i < before.count() && before.at(i)->row() < after.at(j)->row()) ) {
+                i++;
+            } else {
+                j++;
+            }
+        }
+
+        if ( runs > 0 ) {
+            changed.append(item);
+            changes += runs;
+        }
+    }
+
+    // Too much has changed to be worth telling the views about bit by bit.
+    if ( changes > MAX_ROW_CHANGES )
+    {
+        beginResetModel();
+        _children.swap(children);
+        _rows.swap(rows);
+        endResetModel();
+        return;
+    }
+
+    for( int i = 0; i < changed.count(); ++i ) {
+        updateChildren(changed.at(i), children, rows);
+    }
+
+    // What's left is the same rows, but without the child lists of containers shown as they are.
+    _children.swap(children);
+    _rows.swap(rows);
+}
+
+
+void PlistTreeFilterModel::updateChildren(PlistTreeItem *item, const ChildLists &children, const QHash<const PlistTreeItem*, int> &rows)
+{
+    const QModelIndex parent = mapFromSource(_treeModel->indexForItem(item));
+    const QVector<PlistTreeItem*> after = shownChildren(item, children);
+    QSet<const PlistTreeItem*> kept;
+
+    for( int i = 0; i < after.count(); ++i ) {
+        kept.insert(after.at(i));
+    }
+
+    // A container shown as it is gets a child list, so that its rows can be taken out one run at a time.
+    if ( !_children.contains(item) ) {
+        _children.insert(item, shownChildren(item, _children));
+        renumberRows(_children[item], 0);
+    }
+
+    // Rows going, from the back so that the rows of each run are still right when it goes.
+    for( int last = _children[item].count() - 1; last >= 0; )
+    {
+        const QVector<PlistTreeItem*> &visible = _children[item];
+
+        if ( kept.contains(visible.at(last)) ) {
+            last--;
+            continue;
+        }
+
+        int first = last;
+
+        while( first > 0 && !kept.contains(visible.at(first - 1)) ) {
+            first--;
+        }
+
+        beginRemoveRows(parent, first, last);
+
+        for( int row = first; row <= last; ++row ) {
+            forgetSubtree(_children[item].at(row));
+            _rows.remove(_children[item].at(row));
+        }
+
+        _children[item].remove(first, last - first + 1);
+        renumberRows(_children[item], first);
+        endRemoveRows();
+
+        last = first - 1;
+    }
+
+    // Rows coming, which are everything in the new list that isn't in what's left of the old one.
+    int row = 0;
+    int next = 0;
+
+    while( next < after.count() )
+    {
+        if ( row < _children[item].count() && _children[item].at(row) == after.at(next) ) {
+            row++;
+            next++;
+            continue;
+        }
+
+        int end = next;
+
+        while( end < after.count() && (row == _children[item].count() || _children[item].at(row) != after.at(end)) ) {
+            end++;
+        }
+
+        beginInsertRows(parent, row, row + end - next - 1);
+
+        for( int i = next; i < end; ++i ) {
+            _children[item].insert(row + i - next, after.at(i));
+            adoptSubtree(after.at(i), children, rows);
+        }
+
+        renumberRows(_children[item], row);
+        endInsertRows();
+
+        row += end - next;
+        next = end;
+    }
+}
+
+
+void PlistTreeFilterModel::adoptSubtree(const PlistTreeItem *item, const ChildLists &children, const QHash<const PlistTreeItem*, int> &rows)
+{
+    QVector<const PlistTreeItem*> stack;
+    stack.append(item);
+
+    while( !stack.isEmpty() )
+    {
+        ChildLists::const_iterator it = children.constFind(stack.takeLast());
+
+        if ( it == children.constEnd() ) {
+            continue;
+        }
+
+        _children.insert(it.key(), it.value());
+
+        for( int i = 0; i < it.value().count(); ++i ) {
+            _rows.insert(it.value().at(i), rows.value(it.value().at(i), i));
+            stack.append(it.value().at(i));
+        }
+    }
+}
+
+
+QVector<PlistTreeItem*> PlistTreeFilterModel::shownChildren(const PlistTreeItem *item, const ChildLists &children) const
+{
+    ChildLists::const_iterator it = children.constFind(item);
+
+    if ( it != children.constEnd() ) {
+        return it.value();
+    }
+
+    QVector<PlistTreeItem*> all;
+    all.reserve(item->childCount());
+
+    for( int row = 0; row < item->childCount(); ++row ) {
+        all.append(item->child(row));
+    }
+
+    return all;
+}
+
+
+bool PlistTreeFilterModel::isVisible(const PlistTreeItem *item) const
+{
+    if ( _children.isEmpty() ) {
+        return true;
+    }
+
+    // Climb through rows shown as they are until reaching a filtered container, which knows.
+    while( true )
+    {
+        const PlistTreeItem *parent = item->parent();
+
+        if ( parent == nullptr ) {
+            return true;
+        }
+
+        if ( _children.contains(parent) ) {
+            return _rows.contains(item);
+        }
+
+        item = parent;
+    }
+}
+
+
+int PlistTreeFilterModel::proxyRow(const PlistTreeItem *item) const
+{
+    const PlistTreeItem *parent = item->parent();
+
+    if ( parent != nullptr && _children.contains(parent) ) {
+        return _rows.value(item, -1);
+    }
+
+    return item->row();
+}
+
+
+void PlistTreeFilterModel::forgetSubtree(const PlistTreeItem *item)
+{
+    if ( _children.isEmpty() ) {
+        return;
+    }
+
+    QVector<const PlistTreeItem*> stack;
+    stack.append(item);
+
+    while( !stack.isEmpty() )
+    {
+        ChildLists::iterator it = _children.find(stack.takeLast());
+
+        if ( it == _children.end() ) {
+            continue;
+        }
+
+        for( int i = 0; i < it.value().count(); ++i ) {
+            _rows.remove(it.value().at(i));
+            stack.append(it.value().at(i));
+        }
+
+        _children.erase(it);
+    }
+}
+
+
+void PlistTreeFilterModel::renumberRows(const QVector<PlistTreeItem*> &children, int from)
+{
+    for( int row = from; row < children.count(); ++row ) {
+        _rows.insert(children.at(row), row);
+    }
+}
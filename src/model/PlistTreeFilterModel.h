@@ -0,0 +1,142 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTTREEFILTERMODEL_H
+#define PLISTTREEFILTERMODEL_H
+
+#include <QAbstractProxyModel>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+#include "PlistTreeModel.h"
+
+
+/**
+ * @brief A proxy for a PlistTreeModel which shows only the rows whose key or string value contains
+ * the filter text, along with their ancestors.
+ *
+ * Which rows are visible is worked out in a single bottom-up pass over the tree, rather than
+ * QSortFilterProxyModel's per-row callbacks, and stored as the list of visible children for each
+ * visible container. Adding characters to the filter text can only hide rows, so it re-checks
+ * only the rows that are still visible, unless a hidden row has changed since the last pass.
+ * With no filter text, or below a row added while filtering, rows map straight through to the
+ * source without any bookkeeping.
+ *
+ * Changing the filter removes and inserts just the rows which come and go, so that expansion,
+ * selection and anything cached by the proxies above survive typing; only very large changes
+ * reset the model instead.
+ *
+ * Edited rows stay visible until the filter next changes, so that they don't vanish mid-edit.
+ */
+class PlistTreeFilterModel : public QAbstractProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit PlistTreeFilterModel(PlistTreeModel *source, QObject *parent = 0);
+
+    /** Show only matching rows and their ancestors, ignoring case. Empty text shows everything. */
+    void setFilterText(const QString &text);
+    QString filterText() const;
+
+    /** How many rows matched the filter, or -1 if there isn't one. */
+    int matchCount() const;
+
+    PlistTreeModel *treeModel() const;
+
+    //
+    // Proxy Methods
+    //
+
+    QModelIndex mapToSource(const QModelIndex &proxyIndex) const;
+    QModelIndex mapFromSource(const QModelIndex &sourceIndex) const;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
+    QModelIndex parent(const QModelIndex &child) const;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const;
+    bool canFetchMore(const QModelIndex &parent) const;
+    void fetchMore(const QModelIndex &parent);
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+    /** Rows are added to and removed from the source, before or after the given visible rows. */
+    bool insertRows(int row, int count, const QModelIndex &parent = QModelIndex());
+    bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex());
+
+
+protected slots:
+    void sourceRowsAboutToBeInserted(const QModelIndex &parent, int first, int last);
+    void sourceRowsInserted(const QModelIndex &parent, int first, int last);
+    void sourceRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+    void sourceRowsRemoved(const QModelIndex &parent, int first, int last);
+    void sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void sourceAboutToBeReset();
+    void sourceReset();
+
+
+protected:
+    typedef QHash<const PlistTreeItem*, QVector<PlistTreeItem*> > ChildLists;
+
+    /** Work out which rows the filter text shows, and update the rows to match. */
+    void refilter(bool narrowing);
+
+    /** Work out the visible children of every visible container. If narrowing, only rows that are visible now are looked at. */
+    void applyFilter(bool narrowing, ChildLists &children, QHash<const PlistTreeItem*, int> &rows, int &matchCount) const;
+
+    /** Switch to the given child lists, removing and inserting the rows that differ (or resetting, if there are too many). */
+    void updateRows(ChildLists &children, QHash<const PlistTreeItem*, int> &rows);
+
+    /** Remove and insert the rows of one container that is shown both before and after. */
+    void updateChildren(PlistTreeItem *item, const ChildLists &children, const QHash<const PlistTreeItem*, int> &rows);
+
+    /** Take on the child lists of a newly shown item and everything below it. */
+    void adoptSubtree(const PlistTreeItem *item, const ChildLists &children, const QHash<const PlistTreeItem*, int> &rows);
+
+    /** The children of item that the given child lists show. */
+    QVector<PlistTreeItem*> shownChildren(const PlistTreeItem *item, const ChildLists &children) const;
+
+    /** Is the item shown? */
+    bool isVisible(const PlistTreeItem *item) const;
+
+    /** The row of a visible item in the proxy. */
+    int proxyRow(const PlistTreeItem *item) const;
+
+    /** Forget the child lists of item and everything below it, as they're about to go. */
+    void forgetSubtree(const PlistTreeItem *item);
+
+    /** Renumber the rows of a child list from the given row onwards. */
+    void renumberRows(const QVector<PlistTreeItem*> &children, int from);
+
+
+private:
+    PlistTreeModel *_treeModel;
+    QString _filterText;
+    int _matchCount;
+    ChildLists _children;               // Visible children of the visible containers that are filtered
+    QHash<const PlistTreeItem*, int> _rows;     // Proxy rows of the items in _children
+    bool _isRemoving;                   // Between sourceRowsAboutToBeRemoved and sourceRowsRemoved
+    bool _isInserting;                  // Between sourceRowsAboutToBeInserted and sourceRowsInserted
+    bool _isResetting;                  // Between sourceAboutToBeReset and sourceReset
+    bool _isStale;                      // Have hidden rows changed since the last pass?
+};
+
+#endif // PLISTTREEFILTERMODEL_H
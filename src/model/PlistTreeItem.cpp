@@ -1,4 +1,58 @@
 #include "PlistTreeItem.h"
+#include "PlistTreeArena.h"
+
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentMap>
+#include <cstring>
+
+
+// A large document is mostly PlistTreeItems, so keep an eye on their size. On 64-bit
+// platforms this is 56 bytes (an 80 byte arena slot, with the header).
+Q_STATIC_ASSERT(sizeof(void*) != 8 || sizeof(PlistTreeItem) <= 56);
+
+
+namespace {
+    const quint64 HASH_MULTIPLIER = 0x9e3779b97f4a7c15ULL;
+
+    // How many levels ComputeHashesInParallel will go down looking for enough subtrees.
+    const int MAX_HASH_SPLIT_DEPTH = 8;
+
+    // splitmix64's finalizer: every input bit affects every output bit.
+    quint64 MixHash(quint64 x)
+    {
+        x += HASH_MULTIPLIER;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    quint64 HashBytes(const char *data, qint64 size, quint64 seed)
+    {
+        quint64 hash = seed ^ (static_cast<quint64>(size) * HASH_MULTIPLIER);
+        qint64 i = 0;
+
+        for( ; i + 8 <= size; i += 8 ) {
+            quint64 word;
+            memcpy(&word, data + i, sizeof(word));
+            hash = MixHash(hash ^ word);
+        }
+
+        quint64 tail = 0;
+        memcpy(&tail, data + i, static_cast<size_t>(size - i));
+        return MixHash(hash ^ tail);
+    }
+
+    quint64 HashString(const QString &string, quint64 seed)
+    {
+        return HashBytes(reinterpret_cast<const char*>(string.constData()), string.size() * sizeof(QChar), seed);
+    }
+
+    void HashSubtree(PlistTreeItem *&item)
+    {
+        item->subtreeHash();
+    }
+}
 
 
 //
@@ -9,6 +63,8 @@
 PlistTreeItem::PlistTreeItem(const QVariant &value, const QString &key)
 {
     _parentItem = nullptr;
+    _row = 0;
+    _sourceSpan = -1;
     _key = key;
 
     setValueAndType(value);
@@ -18,22 +74,24 @@ PlistTreeItem::PlistTreeItem(const QVariant &value, const QString &key)
 PlistTreeItem::PlistTreeItem(const PlistType &type, const QString &key)
 {
     _parentItem = nullptr;
+    _row = 0;
+    _sourceSpan = -1;
     _key = key;
-    _type = type;
-    _value = QVariant();
+    _value = PlistValue(type);
 }
 
 
 PlistTreeItem::PlistTreeItem(const PlistTreeItem &item)
 {
     _parentItem = nullptr;
+    _row = 0;
+    _sourceSpan = -1;
     _key = item.key();
-    _type = item.plistType();
     _value = item._value;
 
     for( int i = 0; i < item.childCount(); i++ )
     {
-        PlistTreeItem *childItem = new PlistTreeItem(*item.child(i));
+        PlistTreeItem *childItem = Clone(arena(), *item.child(i));
         aendChild(childItem);
     }
 }
@@ -42,7 +100,58 @@ PlistTreeItem::PlistTreeItem(const PlistTreeItem &item)
 // Destructor
 PlistTreeItem::~PlistTreeItem()
 {
-    removeAllChildren();
+    // Children in an arena which is being released are destroyed by the arena's own
+    // sweep, so only delete the ones that would otherwise be leaked.
+    for( QList<PlistTreeItem *>::const_iterator it = _childItems.begin(); it != _childItems.end(); ++it )
+    {
+        PlistTreeArena *childArena = (*it)->arena();
+
+        if ( childArena == nullptr || !childArena->isReleasing() ) {
+            delete (*it);
+        }
+    }
+}
+
+
+PlistTreeItem * PlistTreeItem::Create(PlistTreeArena *arena, const QVariant &value, const QString &key)
+{
+    return new (arena) PlistTreeItem(value, key);
+}
+
+
+PlistTreeItem * PlistTreeItem::Create(PlistTreeArena *arena, PlistType type, const QString &key)
+{
+    return new (arena) PlistTreeItem(type, key);
+}
+
+
+PlistTreeItem * PlistTreeItem::Clone(PlistTreeArena *arena, const PlistTreeItem &item)
+{
+    return new (arena) PlistTreeItem(item);
+}
+
+
+void * PlistTreeItem::operator new(size_t size, PlistTreeArena *arena)
+{
+    return PlistTreeArena::AllocateItem(size, arena);
+}
+
+
+void PlistTreeItem::operator delete(void *ptr)
+{
+    PlistTreeArena::DeallocateItem(ptr);
+}
+
+
+void PlistTreeItem::operator delete(void *ptr, PlistTreeArena *)
+{
+    PlistTreeArena::DeallocateItem(ptr);
+}
+
+
+PlistTreeArena * PlistTreeItem::arena() const
+{
+    return PlistTreeArena::ArenaForItem(this);
 }
 
 
@@ -54,13 +163,13 @@ PlistTreeItem::~PlistTreeItem()
 bool PlistTreeItem::canAddChild() const
 {
     // The 'Invisible Root' only allows for one child item
-    if ( _type == PlistInvisibleRoot && _childItems.count() == 0 )
+    if ( plistType() == PlistInvisibleRoot && _childItems.count() == 0 )
     {
         return true;
     }
 
     // Otherwise, only arrays and dictionaries allow child items
-    if ( _type == PlistArray || _type == PlistDictionary )
+    if ( plistType() == PlistArray || plistType() == PlistDictionary )
     {
         return true;
     }
@@ -76,14 +185,15 @@ bool PlistTreeItem::aendChild(PlistTreeItem *child)
     }
 
     child->setParent(this);
+    child->_row = _childItems.count();
     _childItems.append(child);
+    adoptChildKey(child);
+    invalidateHash();
 
-    if ( shouldChildrenHaveKey() ) {
-        if ( !isChildKeyValid(child->key(), child) ) {
-            child->setKey(nextChildKey());
-        }
-    } else {
-        child->setKey(QString());
+    // A child read along with its own children is only dirty if one of their keys had to be renamed,
+    // and then the bytes we were read from are out of date too.
+    if ( child->childCount() > 0 && child->isDirty() ) {
+        markDirty();
     }
 
     return true;
@@ -98,15 +208,34 @@ bool PlistTreeItem::insertChild(int index, PlistTreeItem *child)
 
     child->setParent(this);
     _childItems.insert(index, child);
+    renumberChildren(index);
+    adoptChildKey(child);
+    invalidateHash();
 
-    if ( shouldChildrenHaveKey() ) {
-        if ( !isChildKeyValid(child->key(), child) ) {
-            child->setKey(nextChildKey());
-        }
-    } else {
-        child->setKey(QString());
+    return true;
+}
+
+
+bool PlistTreeItem::insertChildren(int index, const QList<PlistTreeItem*> &children)
+{
+    if ( !canAddChild() ) {
+        return false;
     }
 
+    // One splice, rather than shuffling the rows along once per child.
+    QList<PlistTreeItem*> childItems = _childItems.mid(0, index);
+    childItems.append(children);
+    childItems.append(_childItems.mid(index));
+    _childItems.swap(childItems);
+    renumberChildren(index);
+
+    for( int i = 0; i < children.count(); ++i ) {
+        children.at(i)->setParent(this);
+        adoptChildKey(children.at(i));
+    }
+
+    invalidateHash();
+
     return true;
 }
 
@@ -115,23 +244,65 @@ void PlistTreeItem::removeAllChildren()
 {
     qDeleteAll(_childItems);
     _childItems.clear();
+    _childKeyIndex.clear();
+    invalidateHash();
 }
 
 
 bool PlistTreeItem::removeChildAtIndex(int index)
 {
-    if ( index >= _childItems.count() ) {
+    if ( index < 0 || index >= _childItems.count() ) {
         return false;
     }
 
     PlistTreeItem *item = _childItems.at(index);
+    unindexChildKey(item);
     delete item;
     _childItems.removeAt(index);
+    renumberChildren(index);
+    invalidateHash();
+
+    return true;
+}
+
+
+bool PlistTreeItem::removeChildren(int index, int count)
+{
+    if ( index < 0 || count < 0 || index + count > _childItems.count() ) {
+        return false;
+    }
+
+    // One splice and one renumbering, rather than one of each per child.
+    for( int i = index; i < index + count; ++i ) {
+        unindexChildKey(_childItems.at(i));
+        delete _childItems.at(i);
+    }
+
+    _childItems.erase(_childItems.begin() + index, _childItems.begin() + index + count);
+    renumberChildren(index);
+    invalidateHash();
 
     return true;
 }
 
 
+PlistTreeItem * PlistTreeItem::takeChildAtIndex(int index)
+{
+    if ( index < 0 || index >= _childItems.count() ) {
+        return nullptr;
+    }
+
+    PlistTreeItem *item = _childItems.takeAt(index);
+    unindexChildKey(item);
+    renumberChildren(index);
+    invalidateHash();
+
+    item->setParent(nullptr);
+    item->_row = 0;
+    return item;
+}
+
+
 PlistTreeItem * PlistTreeItem::child(int row) const
 {
     return _childItems.value(row);
@@ -144,16 +315,174 @@ int PlistTreeItem::childCount() const
 }
 
 
+void PlistTreeItem::setUnfetchedChildren(qint64 fetchToken, int count)
+{
+    _value.setPending(static_cast<quint32>(fetchToken), static_cast<quint32>(count));
+    invalidateHash();
+}
+
+
+void PlistTreeItem::clearFetchToken()
+{
+    if ( _value.storageKind() == PlistValue::StoragePending ) {
+        _value.clear();
+        invalidateHash();
+    }
+}
+
+
+void PlistTreeItem::markUnreadable()
+{
+    _value.setUnreadable();
+}
+
+
+bool PlistTreeItem::isUnreadable() const
+{
+    return _value.storageKind() == PlistValue::StorageUnreadable;
+}
+
+
+qint64 PlistTreeItem::fetchToken() const
+{
+    return _value.pendingToken();
+}
+
+
+bool PlistTreeItem::hasUnfetchedChildren() const
+{
+    return _value.isPending();
+}
+
+
+int PlistTreeItem::unfetchedChildCount() const
+{
+    return _value.pendingCount();
+}
+
+
+void PlistTreeItem::setSourceSpan(int span)
+{
+    _sourceSpan = span;
+}
+
+
+int PlistTreeItem::sourceSpan() const
+{
+    return _sourceSpan;
+}
+
+
+bool PlistTreeItem::isDirty() const
+{
+    return _sourceSpan < 0;
+}
+
+
+void PlistTreeItem::markDirty()
+{
+    // Every ancestor's span includes this item, so they all need writing out again.
+    for( PlistTreeItem *item = this; item != nullptr; item = item->_parentItem ) {
+        item->_sourceSpan = -1;
+    }
+}
+
+
+quint64 PlistTreeItem::subtreeHash() const
+{
+    // The hash is cached in the spare word of our slot header, where 0 means not computed yet.
+    quint64 &cachedHash = PlistTreeArena::ItemHeaderWord(this);
+
+    if ( cachedHash != 0 ) {
+        return cachedHash;
+    }
+
+    quint64 hash = MixHash(static_cast<quint64>(plistType()) + 1);
+
+    switch( plistType() )
+    {
+    case PlistString: hash = HashString(_value.string(), hash); break;
+    case PlistInteger: hash = MixHash(hash ^ static_cast<quint64>(_value.integer())); break;
+    case PlistBoolean: hash = MixHash(hash ^ (_value.boolean() ? 1 : 0)); break;
+    case PlistDate: hash = MixHash(hash ^ static_cast<quint64>(_value.date())); break;
+
+    case PlistReal:
+        {
+            const double real = _value.real();
+            quint64 bits = 0;
+            memcpy(&bits, &real, sizeof(bits));
+            hash = MixHash(hash ^ bits);
+            break;
+        }
+
+    case PlistData:
+        {
+            const QByteArray data = _value.data();
+            hash = HashBytes(data.constData(), data.size(), hash);
+            break;
+        }
+
+    case PlistArray:
+    case PlistInvisibleRoot:
+        // Chaining the children makes their order count.
+        for( int i = 0; i < _childItems.count(); ++i ) {
+            hash = MixHash(hash + _childItems.at(i)->subtreeHash());
+        }
+        break;
+
+    case PlistDictionary:
+        {
+            // Summing the (key, value) pairs makes their order irrelevant, while
+            // (unlike xor) duplicate pairs still don't cancel each other out.
+            quint64 sum = 0;
+
+            for( int i = 0; i < _childItems.count(); ++i ) {
+                const PlistTreeItem *child = _childItems.at(i);
+                sum += HashString(child->_key, child->subtreeHash());
+            }
+
+            hash = MixHash(hash + sum);
+            break;
+        }
+
+    default:
+        break;
+    }
+
+    // Children which haven't been read could be anything, so rather than hash as if they
+    // weren't there, such a container hashes as itself and never matches another subtree.
+    if ( hasUnfetchedChildren() ) {
+        hash = MixHash(hash ^ static_cast<quint64>(unfetchedChildCount()));
+        hash = MixHash(hash + static_cast<quint64>(reinterpret_cast<quintptr>(this)));
+    }
+
+    hash = MixHash(hash + static_cast<quint64>(_childItems.count()));
+    cachedHash = (hash != 0) ? hash : 1;
+    return cachedHash;
+}
+
+
+void PlistTreeItem::invalidateHash()
+{
+    // An item without a valid hash never has an ancestor with one, so we can stop at the first.
+    for( PlistTreeItem *item = this; item != nullptr && PlistTreeArena::ItemHeaderWord(item) != 0; item = item->_parentItem ) {
+        PlistTreeArena::ItemHeaderWord(item) = 0;
+    }
+}
+
+
 QString PlistTreeItem::nextChildKey() const
 {
-    if ( _type != PlistDictionary ) {
+    if ( plistType() != PlistDictionary ) {
         return QString();
     }
 
-    int index = 1;
+    // Start past the number of children, which is usually free, rather than probing
+    // 'Key 1', 'Key 2'... every time.
+    int index = _childItems.count() + 1;
     QString key = QString("Key %1").arg(index++);
 
-    while( !isChildKeyValid(key) && index < 1000 ) {
+    while( _childKeyIndex.contains(key) ) {
         key = QString("Key %1").arg(index++);
     }
 
@@ -161,6 +490,57 @@ QString PlistTreeItem::nextChildKey() const
 }
 
 
+PlistTreeItem * PlistTreeItem::childForKey(const QString &key) const
+{
+    return _childKeyIndex.value(key, nullptr);
+}
+
+
+void PlistTreeItem::adoptChildKey(PlistTreeItem *child)
+{
+    if ( !shouldChildrenHaveKey() ) {
+        child->_key = QString();
+        return;
+    }
+
+    if ( isChildKeyValid(child->_key, child) ) {
+        _childKeyIndex.insert(child->_key, child);
+    } else {
+        // A duplicate or missing key read from a file is renamed, so the file's copy of us is out of date.
+        child->setKey(nextChildKey());
+        markDirty();
+    }
+}
+
+
+void PlistTreeItem::unindexChildKey(PlistTreeItem *child)
+{
+    QHash<QString, PlistTreeItem*>::iterator it = _childKeyIndex.find(child->_key);
+
+    if ( it != _childKeyIndex.end() && it.value() == child ) {
+        _childKeyIndex.erase(it);
+    }
+}
+
+
+void PlistTreeItem::renumberChildren(int fromIndex)
+{
+    for( int i = qMax(fromIndex, 0); i < _childItems.count(); ++i ) {
+        _childItems.at(i)->_row = i;
+    }
+}
+
+
+void PlistTreeItem::rebuildChildKeyIndex()
+{
+    _childKeyIndex.clear();
+
+    for( QList<PlistTreeItem *>::const_iterator it = _childItems.begin(); it != _childItems.end(); ++it ) {
+        adoptChildKey(*it);
+    }
+}
+
+
 //
 // Getters / Setters
 //
@@ -174,61 +554,60 @@ void PlistTreeItem::setValueAndType(const QVariant &value)
 
     // Whatever we do, this will kill all children as we're setting the value
     removeAllChildren();
+    invalidateHash();
 
     // Switch dependant on the variant type
     if ( value.type() == QVariant::Type::String )
     {
-        _type = PlistString;
-        _value = value;
+        _value.setType(PlistString);
+        _value.setString(value.toString());
     }
     else if ( value.type() == QVariant::Type::Int || value.type() == QVariant::Type::LongLong )
     {
-        _type = PlistInteger;
-        _value = value;
+        _value.setType(PlistInteger);
+        _value.setInteger(value.toLongLong());
     }
     else if ( value.type() == QVariant::Type::Double )
     {
-        _type = PlistReal;
-        _value = value;
+        _value.setType(PlistReal);
+        _value.setReal(value.toDouble());
     }
     else if ( value.type() == QVariant::Type::Bool )
     {
-        _type = PlistBoolean;
-        _value = value;
+        _value.setType(PlistBoolean);
+        _value.setBoolean(value.toBool());
     }
-    else if ( value.type() == QVariant::Type::Date )
+    else if ( value.type() == QVariant::Type::Date || value.type() == QVariant::Type::DateTime )
     {
-        _type = PlistDate;
-        _value = value;
+        _value.setType(PlistDate);
+        _value.setDate(value.toDateTime().toMSecsSinceEpoch());
     }
-    else if ( value.type() == QVariant::Type::BitArray )
+    else if ( value.type() == QVariant::Type::ByteArray )
     {
-        _type = PlistData;
-        _value = value;
+        _value.setType(PlistData);
+        _value.setData(value.toByteArray());
     }
     else if ( value.type() == QVariant::Type::List )
     {
-        _type = PlistArray;
-        _value = QVariant();
+        _value = PlistValue(PlistArray);
 
         QList<QVariant> list = value.toList();
 
         for ( QList<QVariant>::Iterator it = list.begin(); it != list.end(); ++it )
         {
-           PlistTreeItem *child = new PlistTreeItem((*it), QString());
+           PlistTreeItem *child = Create(arena(), (*it), QString());
            aendChild(child);
         }
     }
     else if ( value.type() == QVariant::Type::Map )
     {
-        _type = PlistDictionary;
-        _value = QVariant();
+        _value = PlistValue(PlistDictionary);
 
         QMap<QString,QVariant> map = value.toMap();
 
         for ( QMap<QString,QVariant>::Iterator it = map.begin(); it != map.end(); ++it)
         {
-            PlistTreeItem *child = new PlistTreeItem(it.value(), it.key());
+            PlistTreeItem *child = Create(arena(), it.value(), it.key());
             aendChild(child);
         }
     }
@@ -237,51 +616,70 @@ void PlistTreeItem::setValueAndType(const QVariant &value)
 
 void PlistTreeItem::setValueRetainType(const QVariant &value)
 {
-    if ( _type == PlistArray || _type == PlistDictionary || _type == PlistInvisibleRoot ) {
-        _value = QVariant();
-        return;
-    }
-
-    _value = QVariant();
+    PlistType type = plistType();
+    _value.clear();
+    invalidateHash();
 
-    if ( _type == PlistString )
-    {
-        _value = value.canConvert(QVariant::String) ? value.toString() : QString();
-    }
-    else if ( _type == PlistReal )
-    {
-        _value = value.canConvert(QVariant::Double) ? value.toDouble() : QVariant(0.0);
-    }
-    else if ( _type == PlistInteger )
+    switch( type )
     {
-        _value = value.canConvert(QVariant::Int) ? value.toInt() : QVariant(0);
-    }
-    else if ( _type == PlistBoolean )
-    {
-        _value = value.canConvert(QVariant::Bool) ? value.toBool() : QVariant(true);
-    }
-    else if ( _type == PlistDate )
-    {
-        _value = value.canConvert(QVariant::Date) ? QVariant(value.toDateTime()) : QVariant(QDateTime());
-    }
-    else if ( _type == PlistData )
-    {
-        _value = value.canConvert(QVariant::BitArray) ? QVariant(value.toBitArray()) : QVariant(QBitArray());
+    case PlistString:
+        _value.setString(value.toString());
+        break;
+
+    case PlistReal:
+        _value.setReal(value.toDouble());
+        break;
+
+    case PlistInteger:
+        _value.setInteger(value.toLongLong());
+        break;
+
+    case PlistBoolean:
+        _value.setBoolean(value.canConvert(QVariant::Bool) ? value.toBool() : true);
+        break;
+
+    case PlistDate:
+        {
+            // Dates arrive as ISO-8601 text when read from a file.
+            QDateTime date = (value.type() == QVariant::String) ? QDateTime::fromString(value.toString(), Qt::ISODate) : value.toDateTime();
+            _value.setDate(date.isValid() ? date.toMSecsSinceEpoch() : 0);
+            break;
+        }
+
+    case PlistData:
+        // Data arrives as base64 text when read from a file.
+        if ( value.type() == QVariant::String ) {
+            _value.setData(QByteArray::fromBase64(value.toString().toLatin1()));
+        } else {
+            _value.setData(value.toByteArray());
+        }
+        break;
+
+    default:
+        break;
     }
 }
 
 
+void PlistTreeItem::setValue(const PlistValue &value)
+{
+    removeAllChildren();
+    _value = value;
+    invalidateHash();
+}
+
+
 QVariant PlistTreeItem::getValue()
 {
     QVariant result;
 
-    switch( _type ) {
-    case PlistString: result = _value.toString(); break;
-    case PlistReal: result = _value.toDouble(); break;
-    case PlistInteger: result = _value.toInt(); break;
-    case PlistBoolean: result = _value.toBool(); break;
-    case PlistDate: result = _value.toDate(); break;
-    case PlistData: result = _value.toBitArray(); break;
+    switch( plistType() ) {
+    case PlistString: result = _value.string(); break;
+    case PlistReal: result = _value.real(); break;
+    case PlistInteger: result = _value.integer(); break;
+    case PlistBoolean: result = _value.boolean(); break;
+    case PlistDate: result = QDateTime::fromMSecsSinceEpoch(_value.date(), Qt::UTC); break;
+    case PlistData: result = _value.data(); break;
 
     case PlistArray:
         {
@@ -327,8 +725,9 @@ QString PlistTreeItem::key() const
 void PlistTreeItem::setType(PlistType type)
 {
     QVariant value = getValue();
-    _type = type;
+    _value.setType(type);
     setValueRetainType(value);
+    rebuildChildKeyIndex();
 }
 
 
@@ -340,7 +739,7 @@ void PlistTreeItem::setParent(PlistTreeItem *parent)
 
 bool PlistTreeItem::shouldChildrenHaveKey() const
 {
-    if ( _type == PlistDictionary ) {
+    if ( plistType() == PlistDictionary ) {
         return true;
     }
 
@@ -348,24 +747,18 @@ bool PlistTreeItem::shouldChildrenHaveKey() const
 }
 
 
-bool PlistTreeItem::isChildKeyValid(QString &aString, PlistTreeItem *ignoreItem) const
+bool PlistTreeItem::isChildKeyValid(const QString &aString, PlistTreeItem *ignoreItem) const
 {
     if ( aString.isNull() || aString.isEmpty() ) {
         return false;
     }
 
-    for( QList<PlistTreeItem *>::const_iterator it = _childItems.begin(); it != _childItems.end(); ++it )
-    {
-        if ( (*it) != ignoreItem && (*it)->key().compare(aString) == 0 ) {
-            return false;
-        }
-    }
-
-    return true;
+    PlistTreeItem *existing = _childKeyIndex.value(aString, nullptr);
+    return ( existing == nullptr || existing == ignoreItem );
 }
 
 
-bool PlistTreeItem::setKey(QString &aString)
+bool PlistTreeItem::setKey(const QString &aString)
 {
     if ( !_parentItem || !_parentItem->shouldChildrenHaveKey() ) {
         _key = QString();
@@ -376,7 +769,12 @@ bool PlistTreeItem::setKey(QString &aString)
         return false;
     }
 
+    _parentItem->unindexChildKey(this);
     _key = aString;
+    _parentItem->_childKeyIndex.insert(_key, this);
+
+    // Our key is part of the parent's content, not ours.
+    _parentItem->invalidateHash();
     return true;
 }
 
@@ -389,7 +787,7 @@ bool PlistTreeItem::setKey(QString &aString)
 int PlistTreeItem::row() const
 {
     if (_parentItem) {
-        return _parentItem->_childItems.indexOf(const_cast<PlistTreeItem*>(this));
+        return _row;
     }
 
     return 0;
@@ -415,11 +813,7 @@ QVariant PlistTreeItem::data(int column) const
     case COLUMN_KEY: return keyDescription();
     case COLUMN_TYPE: return typeDescription();
     case COLUMN_VALUE:
-        if ( IsContainerType(_type) ) {
-            return QString("%1 Items").arg(childCount());
-        } else {
-            return _value;
-        }
+        return valueData();
     }
 
     return QVariant();
@@ -428,7 +822,35 @@ QVariant PlistTreeItem::data(int column) const
 
 PlistTreeItem::PlistType PlistTreeItem::plistType() const
 {
-    return _type;
+    return static_cast<PlistType>(_value.type());
+}
+
+
+const PlistValue & PlistTreeItem::value() const
+{
+    return _value;
+}
+
+
+QVariant PlistTreeItem::valueData() const
+{
+    // Build the display value straight from the typed storage, without any conversions.
+    switch( plistType() )
+    {
+    case PlistString: return _value.string();
+    case PlistReal: return _value.real();
+    case PlistInteger: return _value.integer();
+    case PlistBoolean: return _value.boolean();
+    case PlistDate: return QDateTime::fromMSecsSinceEpoch(_value.date(), Qt::UTC);
+    case PlistData: return DataDescription(_value.data());
+
+    case PlistArray:
+    case PlistDictionary:
+        return QString("%1 Items").arg(hasUnfetchedChildren() ? unfetchedChildCount() : childCount());
+
+    default:
+        return QVariant();
+    }
 }
 
 
@@ -440,7 +862,7 @@ QString PlistTreeItem::keyDescription() const
 
     if (_parentItem->plistType() == PlistArray)
     {
-        return QString("%1").arg(row());
+        return QString::number(row());
     }
     else if ( _parentItem->plistType() == PlistDictionary)
     {
@@ -453,7 +875,7 @@ QString PlistTreeItem::keyDescription() const
 
 QString PlistTreeItem::typeDescription() const
 {
-    return PlistTreeItem::PlistTypeToString(_type);
+    return PlistTreeItem::PlistTypeToString(plistType());
 }
 
 
@@ -472,16 +894,16 @@ Qt::ItemFlags PlistTreeItem::flags(int column) const
     }
     else if ( column == COLUMN_VALUE )
     {
-        if ( _type == PlistBoolean ) {
+        if ( plistType() == PlistBoolean ) {
             return Qt::ItemIsEnabled | Qt::ItemIsUserCheckable | Qt::ItemIsEditable;
         }
 
-        if ( _type == PlistString || _type == PlistReal || _type == PlistInteger || _type == PlistDate )
+        if ( plistType() == PlistString || plistType() == PlistReal || plistType() == PlistInteger || plistType() == PlistDate )
         {
             return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsEditable;
         }
 
-        if ( _type == PlistDictionary || _type == PlistArray )
+        if ( plistType() == PlistDictionary || plistType() == PlistArray )
         {
             return 0;
         }
@@ -560,12 +982,86 @@ PlistTreeItem::PlistType PlistTreeItem::StringToPlistType(QString aValue)
 }
 
 
+QString PlistTreeItem::DataDescription(const QByteArray &data)
+{
+    // Same format as Xcode: hex digits in groups of four bytes, e.g. <cafebabe 00>
+    QString result(QLatin1Char('<'));
+    result.reserve(data.size() * 2 + data.size() / 4 + 2);
+
+    for( int i = 0; i < data.size(); ++i )
+    {
+        if ( i > 0 && i % 4 == 0 ) {
+            result.append(QLatin1Char(' '));
+        }
+
+        static const char hexDigits[] = "0123456789abcdef";
+        uchar byte = static_cast<uchar>(data.at(i));
+        result.append(QLatin1Char(hexDigits[byte >> 4]));
+        result.append(QLatin1Char(hexDigits[byte & 0xf]));
+    }
+
+    result.append(QLatin1Char('>'));
+    return result;
+}
+
+
 bool PlistTreeItem::IsContainerType(PlistType plistType)
 {
     return ( plistType == PlistDictionary || plistType == PlistArray );
 }
 
 
+quint64 PlistTreeItem::ComputeHashesInParallel(const PlistTreeItem *root)
+{
+    if ( root == nullptr ) {
+        return 0;
+    }
+
+    // Disjoint subtrees share nothing, so they can be hashed on separate threads. Going down a
+    // level at a time until there are enough of them keeps every thread busy even when the
+    // root has only a few (big) children, as PlistTreeReplacer::SplitTree does.
+    const int wantedSubtrees = qMax(QThread::idealThreadCount(), 1) * 4;
+
+    QVector<PlistTreeItem*> subtrees;
+    subtrees.append(const_cast<PlistTreeItem*>(root));
+
+    for( int depth = 0; depth < MAX_HASH_SPLIT_DEPTH && subtrees.count() < wantedSubtrees; ++depth )
+    {
+        QVector<PlistTreeItem*> split;
+        bool didSplit = false;
+
+        for( int i = 0; i < subtrees.count(); ++i )
+        {
+            PlistTreeItem *item = subtrees.at(i);
+
+            if ( item->_childItems.isEmpty() ) {
+                split.append(item);
+                continue;
+            }
+
+            for( int row = 0; row < item->_childItems.count(); ++row ) {
+                split.append(item->_childItems.at(row));
+            }
+
+            didSplit = true;
+        }
+
+        subtrees.swap(split);
+
+        if ( !didSplit ) {
+            break;
+        }
+    }
+
+    if ( subtrees.count() > 1 ) {
+        QtConcurrent::blockingMap(subtrees, HashSubtree);
+    }
+
+    // The levels above the subtrees are left, and only have to combine their cached hashes.
+    return root->subtreeHash();
+}
+
+
 QStringList PlistTreeItem::ComboBoxTypeStrings()
 {
     QStringList list;
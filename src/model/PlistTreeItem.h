@@ -22,10 +22,13 @@
 #define PLISTTREEITEM_H
 
 #include <QVariant>
-#include <QDate>
-#include <QBitArray>
+#include <QHash>
+#include <QDateTime>
 #include <QStringList>
 
+#include "PlistValue.h"
+
+class PlistTreeArena;
 
 /**
  * @brief Represents a single row in the Plist item tree.
@@ -35,6 +38,13 @@
  * it is a dictionary). This allows us to preserve the order of the elements in a
  * dictionary. Note that order is lost if you convert this object (and it's children)
  * to a QVariant and back again.
+ *
+ * Dictionary items also keep a hash of their children by key alongside the ordered
+ * list, so that key uniqueness checks and lookups don't have to walk every sibling.
+ *
+ * Every item can also give a 64-bit hash of its whole subtree (a Merkle hash), which
+ * is computed on demand and cached. Changing an item discards the cached hash of the
+ * item and its ancestors, so two subtrees can be compared cheaply at any time.
  */
 class PlistTreeItem
 {
@@ -64,11 +74,32 @@ public:
     // Object Lifecycle
     //
 
-    PlistTreeItem(const QVariant &value, const QString &key = QString());
-    PlistTreeItem(const PlistType &type, const QString &key = QString());
-    PlistTreeItem(const PlistTreeItem &item);
+    /** Create an item in the given arena, or on the heap if arena is nullptr. Items can only be created through these factories. */
+    static PlistTreeItem *Create(PlistTreeArena *arena, const QVariant &value, const QString &key = QString());
+    static PlistTreeItem *Create(PlistTreeArena *arena, PlistType type, const QString &key = QString());
+
+    /** Deep copy the given item and its children into the given arena, or onto the heap if arena is nullptr. */
+    static PlistTreeItem *Clone(PlistTreeArena *arena, const PlistTreeItem &item);
+
     ~PlistTreeItem();
 
+    static void operator delete(void *ptr);
+    static void operator delete(void *ptr, PlistTreeArena *arena);
+
+    /** The arena this item was allocated from, or nullptr if it lives on the heap. */
+    PlistTreeArena *arena() const;
+
+private:
+    // Private so that every item has the slot header in front of it which arena() reads
+    PlistTreeItem(const QVariant &value, const QString &key);
+    PlistTreeItem(const PlistType &type, const QString &key);
+    PlistTreeItem(const PlistTreeItem &item);
+    PlistTreeItem &operator=(const PlistTreeItem &item);
+
+    static void *operator new(size_t size, PlistTreeArena *arena);
+
+public:
+
     //
     // Children
     //
@@ -82,12 +113,21 @@ public:
     /** Insert node as a child at a given index. */
     bool insertChild(int index, PlistTreeItem *child);
 
+    /** Insert several nodes as children starting at a given index, renumbering the rows after them once. */
+    bool insertChildren(int index, const QList<PlistTreeItem*> &children);
+
     /** Clear all children. */
     void removeAllChildren();
 
     /** Remove a child at the given index. */
     bool removeChildAtIndex(int index);
 
+    /** Remove count children starting at the given index, renumbering the rows after them once. */
+    bool removeChildren(int index, int count);
+
+    /** Detach the child at the given index without deleting it, passing ownership to the caller. */
+    PlistTreeItem *takeChildAtIndex(int index);
+
     /** Get the child at the given row. */
     PlistTreeItem *child(int row) const;
 
@@ -97,6 +137,61 @@ public:
     /** For a dictionary, generaet the 'next' unique child key. */
     QString nextChildKey() const;
 
+    /** For a dictionary, get the child with the given key (or nullptr if there isn't one). */
+    PlistTreeItem *childForKey(const QString &key) const;
+
+    /** Mark this container as having children which a lazy reader hasn't materialized yet. */
+    void setUnfetchedChildren(qint64 fetchToken, int count);
+
+    /** Forget about unfetched children, once they have been read. */
+    void clearFetchToken();
+
+    /** Give up on reading our unfetched children. They stay unfetched, but fetching them won't be tried again. */
+    void markUnreadable();
+
+    /** Did reading our unfetched children fail? */
+    bool isUnreadable() const;
+
+    /** The lazy reader's token for our unfetched children, or -1 if there are none. */
+    qint64 fetchToken() const;
+
+    /** Are there children which haven't been read, whether or not they still can be? */
+    bool hasUnfetchedChildren() const;
+
+    /** How many children are still waiting to be read? */
+    int unfetchedChildCount() const;
+
+    //
+    // Source Tracking
+    //
+
+    /** Remember where this (unmodified) item came from in its PlistTreeSource, marking it as clean. */
+    void setSourceSpan(int span);
+
+    /** Index of this item's span in its PlistTreeSource, or -1 if it has none. */
+    int sourceSpan() const;
+
+    /** Has this item, or anything inside it, changed since it was read? New items are always dirty. */
+    bool isDirty() const;
+
+    /** Mark this item and all of its ancestors as changed. */
+    void markDirty();
+
+    //
+    // Content Hash
+    //
+
+    /**
+     * Hash of this item's type and value and, for containers, everything inside it. Keys
+     * are included for a dictionary's children, but not for the item itself, and the order
+     * of a dictionary's children doesn't matter. A container with unfetched (or unreadable)
+     * children can't be hashed by content, so it hashes as itself and only matches itself.
+     */
+    quint64 subtreeHash() const;
+
+    /** Discard the cached hash of this item and of all of its ancestors. */
+    void invalidateHash();
+
     //
     // Getters and Setters
     //
@@ -107,6 +202,9 @@ public:
     /** Set the value of this item and convert the provided value to the current item's type. */
     void setValueRetainType(const QVariant &value);
 
+    /** Set the type and value of this (non-container) item directly, for use by readers. */
+    void setValue(const PlistValue &value);
+
     /** Get the current value of this item as a QVariant, wraing children up in lists/maps as required. */
     QVariant getValue();
 
@@ -120,10 +218,10 @@ public:
     bool shouldChildrenHaveKey() const;
 
     /** Is the provided key valid for this item? */
-    bool isChildKeyValid(QString &aString, PlistTreeItem *ignoreItem = nullptr) const;
+    bool isChildKeyValid(const QString &aString, PlistTreeItem *ignoreItem = nullptr) const;
 
     /** Set Key. */
-    bool setKey(QString &aString);
+    bool setKey(const QString &aString);
 
     /** Return the parent item. */
     PlistTreeItem *parent() const;
@@ -150,6 +248,9 @@ public:
     /** Get the Plist Type for this item. */
     PlistType plistType() const;
 
+    /** Direct access to the typed value of this item, without going through a QVariant. */
+    const PlistValue &value() const;
+
     /** Get the 'Key' display value, which might not be the actual key if this item exists in an array say. */
     QString keyDescription() const;
 
@@ -163,6 +264,22 @@ public:
     bool setData(int column, QVariant data);
 
 
+protected:
+    /** Give a newly attached child a unique key (for dictionaries) and add it to the key index, marking us dirty if it had to be renamed. */
+    void adoptChildKey(PlistTreeItem *child);
+
+    /** Remove the given child from the key index, if it is the item registered under its key. */
+    void unindexChildKey(PlistTreeItem *child);
+
+    /** Rebuild the key index from scratch, for use when the type of this item changes. */
+    void rebuildChildKeyIndex();
+
+    /** Refresh the cached row of every child from the given index onwards. */
+    void renumberChildren(int fromIndex);
+
+    /** The value to display in the value column. */
+    QVariant valueData() const;
+
 
     //
     // Private Variables
@@ -171,10 +288,15 @@ public:
 private:
     PlistTreeItem *_parentItem;            // Link to parent, or nullptr
     QList<PlistTreeItem*> _childItems;     // List of child nodes
+    QHash<QString, PlistTreeItem*> _childKeyIndex;  // Children by key, if a dictionary
 
     QString _key;                       // Key, if in dictionary
-    PlistType _type;                    // Plist Type of value
-    QVariant _value;                    // Value, if not a container
+    PlistValue _value;                  // Plist Type, and value if not a container
+
+    int _row;                           // Position within the parent's child list
+    int _sourceSpan;                    // Span in the PlistTreeSource, or -1 if changed since read
+
+    // subtreeHash() is cached in the spare word of the item's arena header rather than here.
 
 
     //
@@ -188,9 +310,15 @@ public:
     /** Convert a String value into a Plist type enum value. */
     static PlistType StringToPlistType(QString aValue);
 
+    /** Describe a data blob for display, as grouped hex digits in angle brackets. */
+    static QString DataDescription(const QByteArray &data);
+
     /** Is the given plist type a 'container' type? */
     static bool IsContainerType(PlistType plistType);
 
+    /** Hash the given item's subtree, splitting it into enough disjoint subtrees to hash in parallel on the global thread pool. */
+    static quint64 ComputeHashesInParallel(const PlistTreeItem *root);
+
     /** Get a full list of strings for Plist Types to display in the type dropdown. */
     static QStringList ComboBoxTypeStrings();
 };
@@ -0,0 +1,270 @@
+#include "PlistTreeLoader.h"
+#include "PlistTreeReader.h"
+#include "PlistBinaryTreeReader.h"
+
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrentRun>
+
+
+PlistTreeLoader::PlistTreeLoader(QObject *parent) : QObject(parent)
+{
+    connect(&_watcher, SIGNAL(finished()), this, SLOT(loadFinished()));
+    connect(&_fetchWatcher, SIGNAL(finished()), this, SLOT(fetchFinished()));
+}
+
+
+PlistTreeLoader::~PlistTreeLoader()
+{
+    // Don't leave a worker writing into an arena nobody will free.
+    if ( _watcher.isRunning() )
+    {
+        disconnect(&_watcher, SIGNAL(finished()), this, SLOT(loadFinished()));
+        cancel();
+        _watcher.waitForFinished();
+
+        Result result = _watcher.result();
+        delete result.lazyReader;
+        delete result.source;
+        delete result.arena;
+    }
+
+    if ( _fetchWatcher.isRunning() )
+    {
+        disconnect(&_fetchWatcher, SIGNAL(finished()), this, SLOT(fetchFinished()));
+        cancel();
+        _fetchWatcher.waitForFinished();
+
+        FetchResult result = _fetchWatcher.result();
+        DeleteSubtrees(result);
+    }
+}
+
+
+bool PlistTreeLoader::load(const QString &fileName)
+{
+    if ( isRunning() || fileName.isEmpty() ) {
+        return false;
+    }
+
+    _fileName = fileName;
+    _cancelRequested.store(0);
+    _lastPercent.store(-1);
+
+    _watcher.setFuture(QtConcurrent::run(this, &PlistTreeLoader::run, fileName));
+    return true;
+}
+
+
+bool PlistTreeLoader::fetchAll(PlistTreeModel *model)
+{
+    if ( isRunning() || model == nullptr ) {
+        return false;
+    }
+
+    QVector<PlistLazyTreeReader::Subtree> subtrees;
+    PlistLazyTreeReader *reader = model->beginFetchAll(subtrees);
+
+    if ( reader == nullptr ) {
+        return false;
+    }
+
+    _fetchModel = model;
+    _cancelRequested.store(0);
+    _lastPercent.store(-1);
+
+    _fetchWatcher.setFuture(QtConcurrent::run(this, &PlistTreeLoader::runFetch, reader, subtrees));
+    return true;
+}
+
+
+void PlistTreeLoader::cancel()
+{
+    _cancelRequested.store(1);
+}
+
+
+bool PlistTreeLoader::isRunning() const
+{
+    return _watcher.isRunning() || _fetchWatcher.isRunning();
+}
+
+
+PlistTreeItem * PlistTreeLoader::ReadTreeFromFile(const QString &fileName, PlistTreeArena *arena, bool *isBinary)
+{
+    QString name = fileName;
+    const bool binary = PlistBinaryTreeReader::IsBinaryPlistFile(name);
+
+    if ( isBinary != nullptr ) {
+        *isBinary = binary;
+    }
+
+    if ( binary ) {
+        PlistBinaryTreeReader itemReader = PlistBinaryTreeReader();
+        itemReader.setArena(arena);
+        return itemReader.readTreeFromFile(name);
+    }
+
+    PlistTreeReader itemReader = PlistTreeReader();
+    itemReader.setArena(arena);
+    return itemReader.readTreeFromFile(name);
+}
+
+
+void PlistTreeLoader::loadFinished()
+{
+    Result result = _watcher.result();
+
+    if ( result.cancelled ) {
+        delete result.lazyReader;
+        delete result.source;
+        delete result.arena;
+        emit canceled(_fileName);
+    } else if ( result.root == nullptr ) {
+        delete result.lazyReader;
+        delete result.source;
+        delete result.arena;
+        emit failed(_fileName);
+    } else {
+        emit loaded(_fileName, result.root, result.arena, result.lazyReader, result.source, result.isBinary);
+    }
+}
+
+
+void PlistTreeLoader::fetchFinished()
+{
+    FetchResult result = _fetchWatcher.result();
+    PlistTreeModel *model = _fetchModel;
+    _fetchModel = nullptr;
+
+    if ( model == nullptr ) {
+        DeleteSubtrees(result);
+        return;
+    }
+
+    // The model always hears that the read is over, even if there's nothing to show for it.
+    if ( result.cancelled ) {
+        DeleteSubtrees(result);
+        model->endFetchAll(result.subtrees, nullptr);
+        emit fetchCanceled();
+    } else {
+        model->endFetchAll(result.subtrees, result.arena);
+        delete result.arena;
+        emit fetched();
+    }
+}
+
+
+void PlistTreeLoader::DeleteSubtrees(FetchResult &result)
+{
+    // Releasing the arena takes every item read into it along.
+    result.subtrees.clear();
+    delete result.arena;
+    result.arena = nullptr;
+}
+
+
+//
+// Worker Thread
+//
+
+
+PlistTreeLoader::Result PlistTreeLoader::run(const QString &fileName)
+{
+    QString name = fileName;
+    std::function<bool(qint64, qint64)> callback = [this](qint64 bytesRead, qint64 totalBytes) {
+        return reportProgress(bytesRead, totalBytes);
+    };
+
+    Result result;
+    result.arena = new PlistTreeArena();
+    result.lazyReader = nullptr;
+    result.source = nullptr;
+    result.root = nullptr;
+    result.isBinary = PlistBinaryTreeReader::IsBinaryPlistFile(name);
+
+    // Big XML files only get their top level read now; the rest is read as it's expanded.
+    if ( !result.isBinary && QFileInfo(name).size() >= LAZY_READ_THRESHOLD )
+    {
+        result.source = new PlistTreeSource();
+        result.lazyReader = new PlistLazyTreeReader();
+        result.lazyReader->setArena(result.arena);
+        result.lazyReader->setSource(result.source);
+        result.lazyReader->setProgressCallback(callback);
+        result.root = result.lazyReader->readTreeFromFile(name);
+
+        if ( result.root == nullptr ) {
+            delete result.lazyReader;
+            result.lazyReader = nullptr;
+            delete result.source;
+            result.source = nullptr;
+        }
+    }
+
+    // Otherwise (or if the lazy reader couldn't cope, rather than being cancelled) read the whole file now.
+    const bool needsFullRead = (result.root == nullptr && _cancelRequested.load() == 0);
+
+    if ( needsFullRead && result.isBinary ) {
+        PlistBinaryTreeReader itemReader = PlistBinaryTreeReader();
+        itemReader.setArena(result.arena);
+        itemReader.setProgressCallback(callback);
+        result.root = itemReader.readTreeFromFile(name);
+    } else if ( needsFullRead ) {
+        result.source = new PlistTreeSource();
+        PlistTreeReader itemReader = PlistTreeReader();
+        itemReader.setArena(result.arena);
+        itemReader.setSource(result.source);
+        itemReader.setProgressCallback(callback);
+        result.root = itemReader.readTreeFromFile(name);
+    }
+
+    result.cancelled = (_cancelRequested.load() != 0);
+
+    // Hash everything while we're still off the GUI thread, so comparisons later on are cheap.
+    if ( result.root != nullptr && !result.cancelled ) {
+        PlistTreeItem::ComputeHashesInParallel(result.root);
+    }
+
+    return result;
+}
+
+
+PlistTreeLoader::FetchResult PlistTreeLoader::runFetch(PlistLazyTreeReader *reader, QVector<PlistLazyTreeReader::Subtree> subtrees)
+{
+    std::function<bool(qint64, qint64)> callback = [this](qint64 bytesRead, qint64 totalBytes) {
+        return reportProgress(bytesRead, totalBytes);
+    };
+
+    // The items go in an arena of their own, as the model's belongs to the GUI thread.
+    FetchResult result;
+    result.arena = new PlistTreeArena();
+    result.subtrees = subtrees;
+    result.cancelled = !reader->readSubtrees(result.subtrees, result.arena, callback) || _cancelRequested.load() != 0;
+
+    // Hash everything while we're still off the GUI thread, as for a load.
+    for( int i = 0; i < result.subtrees.count() && !result.cancelled; ++i )
+    {
+        const QList<PlistTreeItem*> &children = result.subtrees.at(i).children;
+
+        for( int j = 0; j < children.count(); ++j ) {
+            children.at(j)->subtreeHash();
+        }
+    }
+
+    return result;
+}
+
+
+bool PlistTreeLoader::reportProgress(qint64 bytesRead, qint64 totalBytes)
+{
+    if ( totalBytes > 0 )
+    {
+        int percent = static_cast<int>(qBound<qint64>(0, bytesRead * 100 / totalBytes, 100));
+
+        // Only bother the GUI thread when the number actually changes.
+        if ( _lastPercent.fetchAndStoreRelaxed(percent) != percent ) {
+            emit progressChanged(percent);
+        }
+    }
+
+    return _cancelRequested.load() == 0;
+}
@@ -0,0 +1,131 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTTREELOADER_H
+#define PLISTTREELOADER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QPointer>
+
+#include "PlistTreeItem.h"
+#include "PlistTreeArena.h"
+#include "PlistLazyTreeReader.h"
+#include "PlistTreeSource.h"
+#include "PlistTreeModel.h"
+
+
+/**
+ * @brief Reads a Plist file on a worker thread, reporting progress and allowing cancellation.
+ *
+ * The format (XML or binary) is detected from the file contents. All items are allocated
+ * in a fresh arena which is handed over, along with the root item, in the loaded() signal.
+ * Large XML files are only read one level deep, in which case a lazy reader for the rest
+ * of the file is handed over too. XML files are kept open in a PlistTreeSource, so that
+ * unmodified parts can be copied straight back out when saving.
+ *
+ * The rest of a lazily read document can be read in the same way with fetchAll(), which
+ * hands the items over to the model once they have all been read.
+ * Signals are always delivered on the thread which owns the loader.
+ */
+class PlistTreeLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PlistTreeLoader(QObject *parent = 0);
+    ~PlistTreeLoader();
+
+    /** Start loading the given file. Does nothing if a load is already in progress. */
+    bool load(const QString &fileName);
+
+    /**
+     * Start reading everything the given model hasn't read from its file yet. Returns false if there's nothing
+     * to read, or the loader is busy. The model must outlive the read; fetched() or fetchCanceled() follows.
+     */
+    bool fetchAll(PlistTreeModel *model);
+
+    /** Is a load, or a fetch, in progress? */
+    bool isRunning() const;
+
+    /** Read the whole of the given XML or binary file on the calling thread. Returns nullptr on failure. */
+    static PlistTreeItem *ReadTreeFromFile(const QString &fileName, PlistTreeArena *arena, bool *isBinary = nullptr);
+
+public slots:
+    /** Ask the current load or fetch to stop. The canceled() or fetchCanceled() signal follows once the worker has stopped. */
+    void cancel();
+
+signals:
+    /** Percentage of the file which has been read so far. */
+    void progressChanged(int percent);
+
+    /** Loading finished; ownership of the root item, arena, lazy reader and source (if any) passes to the receiver. */
+    void loaded(const QString &fileName, PlistTreeItem *root, PlistTreeArena *arena, PlistLazyTreeReader *lazyReader, PlistTreeSource *source, bool isBinary);
+
+    /** The file couldn't be read. */
+    void failed(const QString &fileName);
+
+    /** The load was cancelled before it finished. */
+    void canceled(const QString &fileName);
+
+    /** Everything has been read, and handed over to the model. */
+    void fetched();
+
+    /** The fetch was cancelled before it finished, and the model left as it was. */
+    void fetchCanceled();
+
+private slots:
+    void loadFinished();
+    void fetchFinished();
+
+private:
+    // XML files at least this big are read lazily.
+    static const qint64 LAZY_READ_THRESHOLD = 64 * 1024 * 1024;
+
+    struct Result {
+        PlistTreeItem *root;
+        PlistTreeArena *arena;
+        PlistLazyTreeReader *lazyReader;
+        PlistTreeSource *source;
+        bool isBinary;
+        bool cancelled;
+    };
+
+    struct FetchResult {
+        QVector<PlistLazyTreeReader::Subtree> subtrees;
+        PlistTreeArena *arena;
+        bool cancelled;
+    };
+
+    Result run(const QString &fileName);
+    FetchResult runFetch(PlistLazyTreeReader *reader, QVector<PlistLazyTreeReader::Subtree> subtrees);
+    bool reportProgress(qint64 bytesRead, qint64 totalBytes);
+    static void DeleteSubtrees(FetchResult &result);
+
+    QFutureWatcher<Result> _watcher;
+    QFutureWatcher<FetchResult> _fetchWatcher;
+    QPointer<PlistTreeModel> _fetchModel;
+    QString _fileName;
+    QAtomicInt _cancelRequested;
+    QAtomicInt _lastPercent;
+};
+
+#endif // PLISTTREELOADER_H
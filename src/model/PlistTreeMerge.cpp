@@ -0,0 +1,284 @@
+#include "PlistTreeMerge.h"
+#include "PlistTreeDiff.h"
+
+#include <QVector>
+
+
+const char PlistTreeMerge::CONFLICT_KEY[] = "PlistPadConflict";
+
+
+PlistTreeMerge::PlistTreeMerge()
+{
+    _arena = nullptr;
+    _conflictCount = 0;
+}
+
+
+void PlistTreeMerge::setArena(PlistTreeArena *arena)
+{
+    _arena = arena;
+}
+
+
+PlistTreeItem * PlistTreeMerge::merge(const PlistTreeItem *base, const PlistTreeItem *ours, const PlistTreeItem *theirs)
+{
+    _conflictCount = 0;
+
+    if ( ours == nullptr || theirs == nullptr ) {
+        return nullptr;
+    }
+
+    // Unchanged subtrees are recognised by hash, so hash everything up front.
+    PlistTreeItem::ComputeHashesInParallel(ours);
+    PlistTreeItem::ComputeHashesInParallel(theirs);
+    PlistTreeItem::ComputeHashesInParallel(base);
+
+    return mergeItems(base, ours, theirs);
+}
+
+
+int PlistTreeMerge::conflictCount() const
+{
+    return _conflictCount;
+}
+
+
+bool PlistTreeMerge::IsConflict(const PlistTreeItem *item)
+{
+    if ( item == nullptr || item->plistType() != PlistTreeItem::PlistDictionary ) {
+        return false;
+    }
+
+    const PlistTreeItem *marker = item->childForKey(QLatin1String(CONFLICT_KEY));
+    return marker != nullptr && marker->plistType() == PlistTreeItem::PlistBoolean;
+}
+
+
+//
+// Protected Methods
+//
+
+
+PlistTreeItem * PlistTreeMerge::mergeItems(const PlistTreeItem *base, const PlistTreeItem *ours, const PlistTreeItem *theirs)
+{
+    // Both sides agree, or only one of them changed anything.
+    if ( ours->subtreeHash() == theirs->subtreeHash() ) {
+        return copyItem(ours);
+    } else if ( base != nullptr && base->subtreeHash() == ours->subtreeHash() ) {
+        return copyItem(theirs);
+    } else if ( base != nullptr && base->subtreeHash() == theirs->subtreeHash() ) {
+        return copyItem(ours);
+    }
+
+    // Both changed it. Two containers of the same kind can still be merged inside, if their
+    // children have all been read; a base of some other type, or one not read yet, is no help
+    // with that, so it's treated as missing.
+    if ( ours->plistType() == theirs->plistType() && PlistTreeItem::IsContainerType(ours->plistType()) &&
+         !ours->hasUnfetchedChildren() && !theirs->hasUnfetchedChildren() )
+    {
+        const bool baseUsable = (base != nullptr && base->plistType() == ours->plistType() && !base->hasUnfetchedChildren());
+        const PlistTreeItem *containerBase = baseUsable ? base : nullptr;
+
+        if ( ours->plistType() == PlistTreeItem::PlistDictionary ) {
+            return mergeDictionaries(containerBase, ours, theirs);
+        } else {
+            return mergeArrays(containerBase, ours, theirs);
+        }
+    }
+
+    return conflict(ours->key(), base, ours, theirs);
+}
+
+
+PlistTreeItem * PlistTreeMerge::mergeDictionaries(const PlistTreeItem *base, const PlistTreeItem *ours, const PlistTreeItem *theirs)
+{
+    PlistTreeItem *merged = PlistTreeItem::Create(_arena, PlistTreeItem::PlistDictionary, ours->key());
+
+    // Keys in our order, followed by the keys only they have, in their order.
+    for( int i = 0; i < ours->childCount(); ++i )
+    {
+        const PlistTreeItem *oursChild = ours->child(i);
+        const PlistTreeItem *theirsChild = theirs->childForKey(oursChild->key());
+        const PlistTreeItem *baseChild = (base != nullptr) ? base->childForKey(oursChild->key()) : nullptr;
+
+        if ( theirsChild != nullptr ) {
+            merged->aendChild(mergeItems(baseChild, oursChild, theirsChild));
+        } else if ( baseChild == nullptr ) {
+            merged->aendChild(copyItem(oursChild));             // We added it
+        } else if ( baseChild->subtreeHash() != oursChild->subtreeHash() ) {
+            merged->aendChild(conflict(oursChild->key(), baseChild, oursChild, nullptr));
+        }                                                       // Otherwise they removed it
+    }
+
+    for( int i = 0; i < theirs->childCount(); ++i )
+    {
+        const PlistTreeItem *theirsChild = theirs->child(i);
+
+        if ( ours->childForKey(theirsChild->key()) != nullptr ) {
+            continue;
+        }
+
+        const PlistTreeItem *baseChild = (base != nullptr) ? base->childForKey(theirsChild->key()) : nullptr;
+
+        if ( baseChild == nullptr ) {
+            merged->aendChild(copyItem(theirsChild));           // They added it
+        } else if ( baseChild->subtreeHash() != theirsChild->subtreeHash() ) {
+            merged->aendChild(conflict(theirsChild->key(), baseChild, nullptr, theirsChild));
+        }                                                       // Otherwise we removed it
+    }
+
+    return merged;
+}
+
+
+PlistTreeItem * PlistTreeMerge::mergeArrays(const PlistTreeItem *base, const PlistTreeItem *ours, const PlistTreeItem *theirs)
+{
+    PlistTreeItem *merged = PlistTreeItem::Create(_arena, PlistTreeItem::PlistArray, ours->key());
+    const int baseCount = (base != nullptr) ? base->childCount() : 0;
+    QVector<int> toOurs = (base != nullptr) ? PlistTreeDiff::MatchChildren(base, ours) : QVector<int>();
+    QVector<int> toTheirs = (base != nullptr) ? PlistTreeDiff::MatchChildren(base, theirs) : QVector<int>();
+
+    int baseNext = 0;
+    int oursNext = 0;
+    int theirsNext = 0;
+
+    // Base elements which both sides kept split the arrays into runs which can be merged
+    // independently. The end of the arrays acts as one last split.
+    for( int i = 0; i <= baseCount; ++i )
+    {
+        if ( i < baseCount && (toOurs.at(i) < 0 || toTheirs.at(i) < 0) ) {
+            continue;
+        }
+
+        const int oursEnd = (i < baseCount) ? toOurs.at(i) : ours->childCount();
+        const int theirsEnd = (i < baseCount) ? toTheirs.at(i) : theirs->childCount();
+
+        mergeRuns(merged, base, baseNext, i, ours, oursNext, oursEnd, theirs, theirsNext, theirsEnd);
+
+        if ( i < baseCount ) {
+            merged->aendChild(copyItem(ours->child(oursEnd)));
+        }
+
+        baseNext = i + 1;
+        oursNext = oursEnd + 1;
+        theirsNext = theirsEnd + 1;
+    }
+
+    return merged;
+}
+
+
+void PlistTreeMerge::mergeRuns(PlistTreeItem *merged, const PlistTreeItem *base, int baseBegin, int baseEnd,
+                               const PlistTreeItem *ours, int oursBegin, int oursEnd, const PlistTreeItem *theirs, int theirsBegin, int theirsEnd)
+{
+    const int baseLength = baseEnd - baseBegin;
+
+    if ( IsSameRun(base, baseBegin, baseEnd, ours, oursBegin, oursEnd) ) {
+        appendRun(merged, theirs, theirsBegin, theirsEnd);
+    } else if ( IsSameRun(base, baseBegin, baseEnd, theirs, theirsBegin, theirsEnd) ) {
+        appendRun(merged, ours, oursBegin, oursEnd);
+    } else if ( IsSameRun(ours, oursBegin, oursEnd, theirs, theirsBegin, theirsEnd) ) {
+        appendRun(merged, ours, oursBegin, oursEnd);
+    } else if ( baseLength > 0 && oursEnd - oursBegin == baseLength && theirsEnd - theirsBegin == baseLength ) {
+        // Both edited elements in place, so line them up and merge each one.
+        for( int k = 0; k < baseLength; ++k ) {
+            merged->aendChild(mergeItems(base->child(baseBegin + k), ours->child(oursBegin + k), theirs->child(theirsBegin + k)));
+        }
+    } else {
+        merged->aendChild(runConflict(base, baseBegin, baseEnd, ours, oursBegin, oursEnd, theirs, theirsBegin, theirsEnd));
+    }
+}
+
+
+PlistTreeItem * PlistTreeMerge::conflict(const QString &key, const PlistTreeItem *base, const PlistTreeItem *ours, const PlistTreeItem *theirs)
+{
+    PlistTreeItem *item = PlistTreeItem::Create(_arena, PlistTreeItem::PlistDictionary, key);
+    PlistTreeItem *marker = PlistTreeItem::Create(_arena, PlistTreeItem::PlistBoolean);
+    marker->setValueRetainType(true);
+    appendAs(item, marker, QLatin1String(CONFLICT_KEY));
+
+    if ( base != nullptr ) {
+        appendAs(item, copyItem(base), QLatin1String("Base"));
+    }
+
+    if ( ours != nullptr ) {
+        appendAs(item, copyItem(ours), QLatin1String("Ours"));
+    }
+
+    if ( theirs != nullptr ) {
+        appendAs(item, copyItem(theirs), QLatin1String("Theirs"));
+    }
+
+    _conflictCount++;
+    return item;
+}
+
+
+PlistTreeItem * PlistTreeMerge::runConflict(const PlistTreeItem *base, int baseBegin, int baseEnd,
+                                            const PlistTreeItem *ours, int oursBegin, int oursEnd, const PlistTreeItem *theirs, int theirsBegin, int theirsEnd)
+{
+    PlistTreeItem *item = PlistTreeItem::Create(_arena, PlistTreeItem::PlistDictionary);
+    PlistTreeItem *marker = PlistTreeItem::Create(_arena, PlistTreeItem::PlistBoolean);
+    marker->setValueRetainType(true);
+    appendAs(item, marker, QLatin1String(CONFLICT_KEY));
+
+    if ( base != nullptr ) {
+        appendAs(item, copyRun(base, baseBegin, baseEnd), QLatin1String("Base"));
+    }
+
+    appendAs(item, copyRun(ours, oursBegin, oursEnd), QLatin1String("Ours"));
+    appendAs(item, copyRun(theirs, theirsBegin, theirsEnd), QLatin1String("Theirs"));
+
+    _conflictCount++;
+    return item;
+}
+
+
+PlistTreeItem * PlistTreeMerge::copyItem(const PlistTreeItem *item)
+{
+    return PlistTreeItem::Clone(_arena, *item);
+}
+
+
+PlistTreeItem * PlistTreeMerge::copyRun(const PlistTreeItem *item, int begin, int end)
+{
+    PlistTreeItem *run = PlistTreeItem::Create(_arena, PlistTreeItem::PlistArray);
+    appendRun(run, item, begin, end);
+    return run;
+}
+
+
+void PlistTreeMerge::appendRun(PlistTreeItem *merged, const PlistTreeItem *item, int begin, int end)
+{
+    for( int i = begin; i < end; ++i ) {
+        merged->aendChild(copyItem(item->child(i)));
+    }
+}
+
+
+void PlistTreeMerge::appendAs(PlistTreeItem *parent, PlistTreeItem *child, const QString &key)
+{
+    parent->aendChild(child);
+
+    // A copy keeps its original key, which may have been taken by the time it gets here.
+    if ( child->key() != key ) {
+        child->setKey(key);
+    }
+}
+
+
+bool PlistTreeMerge::IsSameRun(const PlistTreeItem *first, int firstBegin, int firstEnd, const PlistTreeItem *second, int secondBegin, int secondEnd)
+{
+    if ( firstEnd - firstBegin != secondEnd - secondBegin ) {
+        return false;
+    }
+
+    for( int k = 0; k < firstEnd - firstBegin; ++k )
+    {
+        if ( first->child(firstBegin + k)->subtreeHash() != second->child(secondBegin + k)->subtreeHash() ) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,89 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTTREEMERGE_H
+#define PLISTTREEMERGE_H
+
+#include "PlistTreeItem.h"
+
+#include <QString>
+
+
+/**
+ * @brief Three-way structural merge of Plist trees (base, ours and theirs).
+ *
+ * Subtrees which only one side changed are taken from that side without looking inside,
+ * using subtreeHash(). Dictionaries are reconciled key by key, so changes to different
+ * keys never conflict, whatever order the keys are in. Arrays are aligned against the
+ * base with PlistTreeDiff::MatchChildren and merged diff3 style: runs between elements
+ * that neither side touched are taken from whichever side changed them, or merged item
+ * by item when both sides kept the length the same.
+ *
+ * A true conflict becomes a dictionary in the merged tree, with a CONFLICT_KEY boolean
+ * and a 'Base', 'Ours' and 'Theirs' entry for each side that has a value (holding an
+ * array of the items when the conflict is over a run of array elements), so it can be
+ * inspected and resolved in the editor like any other item.
+ *
+ * The merged tree is always a new tree; none of the inputs are modified.
+ */
+class PlistTreeMerge
+{
+public:
+    static const char CONFLICT_KEY[];
+
+    PlistTreeMerge();
+
+    /** Allocate the merged tree in the given arena (or on the heap, if nullptr). */
+    void setArena(PlistTreeArena *arena);
+
+    /** Merge the three trees and return the merged one, or nullptr if ours or theirs is missing. */
+    PlistTreeItem *merge(const PlistTreeItem *base, const PlistTreeItem *ours, const PlistTreeItem *theirs);
+
+    /** How many conflicts did the last merge() leave in the tree? */
+    int conflictCount() const;
+
+    /** Is the given item a conflict left by a merge? */
+    static bool IsConflict(const PlistTreeItem *item);
+
+
+protected:
+    PlistTreeItem *mergeItems(const PlistTreeItem *base, const PlistTreeItem *ours, const PlistTreeItem *theirs);
+    PlistTreeItem *mergeDictionaries(const PlistTreeItem *base, const PlistTreeItem *ours, const PlistTreeItem *theirs);
+    PlistTreeItem *mergeArrays(const PlistTreeItem *base, const PlistTreeItem *ours, const PlistTreeItem *theirs);
+    void mergeRuns(PlistTreeItem *merged, const PlistTreeItem *base, int baseBegin, int baseEnd,
+                   const PlistTreeItem *ours, int oursBegin, int oursEnd, const PlistTreeItem *theirs, int theirsBegin, int theirsEnd);
+
+    PlistTreeItem *conflict(const QString &key, const PlistTreeItem *base, const PlistTreeItem *ours, const PlistTreeItem *theirs);
+    PlistTreeItem *runConflict(const PlistTreeItem *base, int baseBegin, int baseEnd,
+                               const PlistTreeItem *ours, int oursBegin, int oursEnd, const PlistTreeItem *theirs, int theirsBegin, int theirsEnd);
+    PlistTreeItem *copyItem(const PlistTreeItem *item);
+    PlistTreeItem *copyRun(const PlistTreeItem *item, int begin, int end);
+    void appendRun(PlistTreeItem *merged, const PlistTreeItem *item, int begin, int end);
+    void appendAs(PlistTreeItem *parent, PlistTreeItem *child, const QString &key);
+
+    static bool IsSameRun(const PlistTreeItem *first, int firstBegin, int firstEnd, const PlistTreeItem *second, int secondBegin, int secondEnd);
+
+
+private:
+    PlistTreeArena *_arena;
+    int _conflictCount;
+};
+
+#endif // PLISTTREEMERGE_H
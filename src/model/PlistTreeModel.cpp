@@ -1,20 +1,88 @@
 #include "PlistTreeModel.h"
+#include "PlistTreeArena.h"
+#include "PlistLazyTreeReader.h"
+#include "PlistTreeSource.h"
+#include "PlistTreeQuery.h"
+#include "PlistSearchIndex.h"
+#include "PlistTextMatcher.h"
+#include "PlistTreeReplacer.h"
+#include "PlistTreeSearchCursor.h"
+
+
+namespace {
+    int CountUnreadableItems(const PlistTreeItem *item)
+    {
+        if ( item->isUnreadable() ) {
+            return 1;
+        }
+
+        int count = 0;
+
+        for( int i = 0; i < item->childCount(); ++i ) {
+            count += CountUnreadableItems(item->child(i));
+        }
+
+        return count;
+    }
+
+    /**
+     * Would renaming item to key succeed, after the renames already made in renamedKeys? If so, the rename is
+     * recorded there. renamedKeys holds, for each parent, the new owner of each key renames have touched, or
+     * nullptr for a key given up. It's the same check setKey makes, without changing anything.
+     */
+    bool SimulateRename(PlistTreeItem *item, const QString &key, QHash<PlistTreeItem*, QHash<QString, PlistTreeItem*> > &renamedKeys)
+    {
+        PlistTreeItem *parent = item->parent();
+
+        if ( parent == nullptr || !parent->shouldChildrenHaveKey() ) {
+            return key.isEmpty();
+        }
+
+        if ( key.isEmpty() ) {
+            return false;
+        }
+
+        QHash<QString, PlistTreeItem*> &keys = renamedKeys[parent];
+        QHash<QString, PlistTreeItem*>::const_iterator it = keys.constFind(key);
+        PlistTreeItem *owner = (it != keys.constEnd()) ? it.value() : parent->childForKey(key);
+
+        if ( owner != nullptr && owner != item ) {
+            return false;
+        }
+
+        keys.insert(item->key(), nullptr);
+        keys.insert(key, item);
+        return true;
+    }
+}
 
 
 PlistTreeModel::PlistTreeModel(const QVariant &data, QObject *parent) : QAbstractItemModel(parent)
 {
-    _invisibleRootItem = new PlistTreeItem(PlistTreeItem::PlistInvisibleRoot);
+    _arena = new PlistTreeArena();
+    _lazyReader = nullptr;
+    _source = nullptr;
+    _searchIndex = nullptr;
+    _unreadableItemCount = 0;
+    _isFetchingInBackground = false;
+    _invisibleRootItem = PlistTreeItem::Create(_arena, PlistTreeItem::PlistInvisibleRoot);
 
     if ( data.isValid() && !data.isNull() )
     {
-        _invisibleRootItem->aendChild(new PlistTreeItem(data));
+        _invisibleRootItem->aendChild(PlistTreeItem::Create(_arena, data));
     }
 }
 
 
-PlistTreeModel::PlistTreeModel(PlistTreeItem *root, QObject *parent) : QAbstractItemModel(parent)
+PlistTreeModel::PlistTreeModel(PlistTreeItem *root, PlistTreeArena *arena, PlistLazyTreeReader *lazyReader, PlistTreeSource *source, QObject *parent) : QAbstractItemModel(parent)
 {
-    _invisibleRootItem = new PlistTreeItem(PlistTreeItem::PlistInvisibleRoot);
+    _arena = (arena != nullptr) ? arena : new PlistTreeArena();
+    _lazyReader = lazyReader;
+    _source = source;
+    _searchIndex = nullptr;
+    _unreadableItemCount = 0;
+    _isFetchingInBackground = false;
+    _invisibleRootItem = PlistTreeItem::Create(_arena, PlistTreeItem::PlistInvisibleRoot);
 
     if ( root != nullptr ) {
         _invisibleRootItem->aendChild(root);
@@ -24,14 +92,33 @@ PlistTreeModel::PlistTreeModel(PlistTreeItem *root, QObject *parent) : QAbstract
 
 PlistTreeModel::PlistTreeModel(QObject *parent) : QAbstractItemModel(parent)
 {
-    _invisibleRootItem = new PlistTreeItem(PlistTreeItem::PlistInvisibleRoot);
-    _invisibleRootItem->aendChild(new PlistTreeItem(PlistTreeItem::PlistDictionary));
+    _arena = new PlistTreeArena();
+    _lazyReader = nullptr;
+    _source = nullptr;
+    _searchIndex = nullptr;
+    _unreadableItemCount = 0;
+    _isFetchingInBackground = false;
+    _invisibleRootItem = PlistTreeItem::Create(_arena, PlistTreeItem::PlistInvisibleRoot);
+    _invisibleRootItem->aendChild(PlistTreeItem::Create(_arena, PlistTreeItem::PlistDictionary));
 }
 
 
 PlistTreeModel::~PlistTreeModel()
 {
-    delete _invisibleRootItem;
+    // Goes before the items it points at.
+    delete _searchIndex;
+    _searchIndex = nullptr;
+
+    // The reader only maps the file; the items it created belong to the arena.
+    delete _lazyReader;
+    _lazyReader = nullptr;
+
+    delete _source;
+    _source = nullptr;
+
+    // Releasing the arena destroys the whole tree in one sweep, including the invisible root.
+    delete _arena;
+    _arena = nullptr;
     _invisibleRootItem = nullptr;
 }
 
@@ -47,6 +134,28 @@ PlistTreeItem * PlistTreeModel::itemAtIndex(const QModelIndex &index) const
 }
 
 
+QModelIndex PlistTreeModel::indexForItem(PlistTreeItem *item, int column) const
+{
+    if ( item == nullptr || item == _invisibleRootItem ) {
+        return QModelIndex();
+    }
+
+    return createIndex(item->row(), column, item);
+}
+
+
+PlistTreeArena * PlistTreeModel::arena() const
+{
+    return _arena;
+}
+
+
+const PlistTreeSource * PlistTreeModel::source() const
+{
+    return _source;
+}
+
+
 // http://qt-project.org/doc/qt-4.8/itemviews-simpletreemodel.html
 QModelIndex PlistTreeModel::index(int row, int column, const QModelIndex &parent) const
 {
@@ -133,7 +242,7 @@ QVariant PlistTreeModel::data(const QModelIndex &index, int role) const
     if ( role == Qt::CheckStateRole )
     {
         if ( index.column() == PlistTreeItem::COLUMN_VALUE && item->plistType() == PlistTreeItem::PlistBoolean ) {
-            return (item->data(index.column()).toBool()) ? Qt::Checked : Qt::Unchecked;
+            return item->value().boolean() ? Qt::Checked : Qt::Unchecked;
         } else {
             return QVariant();
         }
@@ -177,9 +286,54 @@ bool PlistTreeModel::setData(const QModelIndex &index, const QVariant &value, in
     }
 
     PlistTreeItem *item = static_cast<PlistTreeItem*>(index.internalPointer());
+
+    // Changing the type converts the children, so they need to be here first.
+    if ( index.column() == PlistTreeItem::COLUMN_TYPE && item->hasUnfetchedChildren() )
+    {
+        fetchMore(index.sibling(index.row(), 0));
+
+        if ( item->hasUnfetchedChildren() ) {
+            return false;
+        }
+    }
+
+    // Changing the type can throw the children away, so they leave the search index first.
+    const bool isTypeChange = (index.column() == PlistTreeItem::COLUMN_TYPE);
+
+    if ( isTypeChange && _searchIndex != nullptr ) {
+        _searchIndex->removeSubtree(item);
+    }
+
+    // So can the unreadable containers among them.
+    const bool recountUnreadable = isTypeChange && _unreadableItemCount > 0;
+
+    if ( recountUnreadable ) {
+        _unreadableItemCount -= CountUnreadableItems(item);
+    }
+
     bool didChange = item->setData(index.column(), value);
 
-    if ( didChange ) {
+    if ( recountUnreadable ) {
+        _unreadableItemCount += CountUnreadableItems(item);
+    }
+
+    if ( _searchIndex != nullptr ) {
+        if ( isTypeChange ) {
+            _searchIndex->addSubtree(item);
+        } else if ( didChange ) {
+            _searchIndex->updateItem(item);
+        }
+    }
+
+    if ( didChange )
+    {
+        // A key is written out by its parent, so an unread container keeps its own span when it's renamed.
+        if ( index.column() == PlistTreeItem::COLUMN_KEY && item->parent() != nullptr ) {
+            item->parent()->markDirty();
+        } else {
+            item->markDirty();
+        }
+
         emit dataChanged(index.sibling(index.row(), 0), index.sibling(index.row(), 2));
     }
 
@@ -191,21 +345,35 @@ bool PlistTreeModel::insertRows(int row, int count, const QModelIndex &parent)
 {
     PlistTreeItem *item = itemAtIndex(parent);
 
-    if ( item == nullptr ) {
+    if ( item == nullptr || !item->canAddChild() || count <= 0 ) {
+        return false;
+    }
+
+    if ( canFetchMore(parent) ) {
+        fetchMore(parent);
+    }
+
+    // New rows can't go among children which couldn't be read.
+    if ( item->hasUnfetchedChildren() ) {
         return false;
     }
 
-    emit beginInsertRows(parent, row, row + count);
-    int insertIndex = row;
+    emit beginInsertRows(parent, row, row + count - 1);
+    QList<PlistTreeItem*> children;
 
     for( int i = 0; i < count; ++i ) {
-        bool didInsert = item->insertChild(insertIndex, new PlistTreeItem(PlistTreeItem::PlistString));
+        children.append(PlistTreeItem::Create(_arena, PlistTreeItem::PlistString));
+    }
 
-        if ( didInsert ) {
-            insertIndex++;
+    item->insertChildren(row, children);
+
+    if ( _searchIndex != nullptr ) {
+        for( int i = 0; i < children.count(); ++i ) {
+            _searchIndex->addSubtree(children.at(i));
         }
     }
 
+    item->markDirty();
     emit endInsertRows();
     emit dataChanged(parent.sibling(parent.row(), 0), parent.sibling(parent.row(), 2));
     return true;
@@ -216,22 +384,82 @@ bool PlistTreeModel::removeRows(int row, int count, const QModelIndex &parent)
 {
     PlistTreeItem *item = itemAtIndex(parent);
 
-    if ( item == nullptr ) {
+    if ( item == nullptr || count <= 0 || row < 0 || row + count > item->childCount() ) {
         return false;
     }
 
-    emit beginRemoveRows(parent, row, row + count);
-    int removeIndex = row;
+    emit beginRemoveRows(parent, row, row + count - 1);
 
-    for( int i = 0; i < count; ++i ) {
-        item->removeChildAtIndex(removeIndex);
+    for( int i = row; i < row + count; ++i )
+    {
+        if ( _searchIndex != nullptr ) {
+            _searchIndex->removeSubtree(item->child(i));
+        }
+
+        if ( _unreadableItemCount > 0 ) {
+            _unreadableItemCount -= CountUnreadableItems(item->child(i));
+        }
     }
 
+    item->removeChildren(row, count);
+    item->markDirty();
     emit endRemoveRows();
     return true;
 }
 
 
+bool PlistTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    if ( parent.column() > 0 ) {
+        return false;
+    }
+
+    PlistTreeItem *item = parent.isValid() ? itemAtIndex(parent) : _invisibleRootItem;
+    return item->childCount() > 0 || item->hasUnfetchedChildren();
+}
+
+
+bool PlistTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    PlistTreeItem *item = itemAtIndex(parent);
+    return _lazyReader != nullptr && item != nullptr && item->hasUnfetchedChildren() && !item->isUnreadable();
+}
+
+
+void PlistTreeModel::fetchMore(const QModelIndex &parent)
+{
+    if ( !canFetchMore(parent) ) {
+        return;
+    }
+
+    PlistTreeItem *item = itemAtIndex(parent);
+    QList<PlistTreeItem*> children;
+
+    // The container keeps its token (and so its place in the file) rather than pretending to be empty,
+    // but it won't be read again, so views asking for more don't rescan the file and fail over and over.
+    if ( !_lazyReader->readChildren(item, children) ) {
+        item->markUnreadable();
+        _unreadableItemCount++;
+        emit fetchFailed(parent);
+        return;
+    }
+
+    item->clearFetchToken();
+
+    emit beginInsertRows(parent, 0, children.count() - 1);
+
+    for( int i = 0; i < children.count(); ++i ) {
+        item->aendChild(children.at(i));
+
+        if ( _searchIndex != nullptr ) {
+            _searchIndex->addSubtree(children.at(i));
+        }
+    }
+
+    emit endInsertRows();
+}
+
+
 PlistTreeItem * PlistTreeModel::visibleRoot()
 {
     if ( _invisibleRootItem == nullptr || _invisibleRootItem->child(0) == nullptr ) {
@@ -242,6 +470,81 @@ PlistTreeItem * PlistTreeModel::visibleRoot()
 }
 
 
+void PlistTreeModel::fetchAll(const QModelIndex &parent)
+{
+    PlistTreeItem *item = parent.isValid() ? itemAtIndex(parent) : _invisibleRootItem;
+
+    if ( _lazyReader == nullptr || item == nullptr ) {
+        return;
+    }
+
+    // Each unfetched container is read with everything below it, so every byte is only read once.
+    QVector<PlistLazyTreeReader::Subtree> subtrees;
+    QHash<qint64, PlistTreeItem*> items;
+    collectUnfetched(item, subtrees, items);
+
+    _lazyReader->readSubtrees(subtrees, _arena);
+    attachSubtrees(subtrees, items);
+
+    // Once everything has been read (or given up on), the file isn't needed any more.
+    if ( !parent.isValid() && !_isFetchingInBackground ) {
+        delete _lazyReader;
+        _lazyReader = nullptr;
+    }
+}
+
+
+bool PlistTreeModel::hasUnfetchedItems() const
+{
+    return _lazyReader != nullptr;
+}
+
+
+PlistLazyTreeReader * PlistTreeModel::beginFetchAll(QVector<PlistLazyTreeReader::Subtree> &subtrees)
+{
+    subtrees.clear();
+
+    if ( _lazyReader == nullptr || _isFetchingInBackground ) {
+        return nullptr;
+    }
+
+    QHash<qint64, PlistTreeItem*> items;
+    collectUnfetched(_invisibleRootItem, subtrees, items);
+
+    if ( subtrees.isEmpty() ) {
+        delete _lazyReader;
+        _lazyReader = nullptr;
+        return nullptr;
+    }
+
+    _isFetchingInBackground = true;
+    return _lazyReader;
+}
+
+
+void PlistTreeModel::endFetchAll(QVector<PlistLazyTreeReader::Subtree> &subtrees, PlistTreeArena *arena)
+{
+    _isFetchingInBackground = false;
+    _arena->adopt(arena);
+
+    // Look the containers up again, as the tree may have changed while they were being read.
+    QVector<PlistLazyTreeReader::Subtree> unfetched;
+    QHash<qint64, PlistTreeItem*> items;
+    collectUnfetched(_invisibleRootItem, unfetched, items);
+
+    if ( attachSubtrees(subtrees, items) == items.count() && _lazyReader != nullptr ) {
+        delete _lazyReader;
+        _lazyReader = nullptr;
+    }
+}
+
+
+bool PlistTreeModel::hasUnreadableItems() const
+{
+    return _unreadableItemCount > 0;
+}
+
+
 bool PlistTreeModel::insertItem(PlistTreeItem *item, int row, const QModelIndex &parent)
 {
     PlistTreeItem *parentItem = itemAtIndex(parent);
@@ -250,8 +553,22 @@ bool PlistTreeModel::insertItem(PlistTreeItem *item, int row, const QModelIndex
         return false;
     }
 
-    emit beginInsertRows(parent, row, row + 1);
+    if ( canFetchMore(parent) ) {
+        fetchMore(parent);
+    }
+
+    if ( parentItem->hasUnfetchedChildren() ) {
+        return false;
+    }
+
+    emit beginInsertRows(parent, row, row);
     parentItem->insertChild(row, item);
+    parentItem->markDirty();
+
+    if ( _searchIndex != nullptr ) {
+        _searchIndex->addSubtree(item);
+    }
+
     emit endInsertRows();
 
     emit dataChanged(parent.sibling(parent.row(), 0), parent.sibling(parent.row(), 2));
@@ -259,66 +576,271 @@ bool PlistTreeModel::insertItem(PlistTreeItem *item, int row, const QModelIndex
 }
 
 
-int PlistTreeModel::findReplace(QString &find, QString &replace, ReplaceTarget target, ReplaceMode mode)
+QModelIndexList PlistTreeModel::query(const PlistTreeQuery &query, int limit, bool fetch)
 {
-    if ( find.isEmpty() ) {
-        return 0;
+    QModelIndexList indexes;
+    PlistTreeItem *root = visibleRoot();
+
+    if ( root == nullptr ) {
+        return indexes;
     }
 
-    QModelIndex startIndex = index(0,0);
-    int count = doFindReplace(startIndex, find, replace, target, mode);
-    return count;
+    // Only the containers the path actually goes through are read, not the whole document.
+    PlistTreeQuery::FetchFunction fetchFunction;
+
+    if ( fetch ) {
+        fetchFunction = [this](PlistTreeItem *item) {
+            fetchMore(indexForItem(item));
+        };
+    }
+
+    QList<PlistTreeItem*> items = query.evaluate(root, limit, fetchFunction);
+
+    for( int i = 0; i < items.count(); ++i ) {
+        indexes.append(indexForItem(items.at(i)));
+    }
+
+    return indexes;
 }
 
 
-int PlistTreeModel::doFindReplace(QModelIndex &idx, QString &find, QString &replace, ReplaceTarget target, ReplaceMode mode)
+void PlistTreeModel::buildSearchIndex()
 {
+    if ( _searchIndex != nullptr || visibleRoot() == nullptr ) {
+        return;
+    }
+
+    // Nothing is read for it; fetchMore and fetchAll add whatever they read.
+    _searchIndex = new PlistSearchIndex(this);
+    connect(_searchIndex, SIGNAL(ready()), this, SIGNAL(searchIndexReady()));
+    _searchIndex->build(visibleRoot());
+}
+
+
+int PlistTreeModel::countMatches(const QString &find, ReplaceTarget target, ReplaceMode mode, Qt::CaseSensitivity cs)
+{
+    PlistTextMatcher matcher(find, mode, cs);
+
+    if ( !matcher.isValid() ) {
+        return find.isEmpty() ? 0 : -1;
+    }
+
+    // A regular expression can match text with none of its trigrams, so it has to look at everything read so far.
+    if ( mode == ReplaceModeRegularExpression ) {
+        PlistTreeReplacer replacer = PlistTreeReplacer(matcher, QString(), target);
+        return replacer.countMatches(visibleRoot());
+    }
+
+    if ( _searchIndex == nullptr || !_searchIndex->isReady() ) {
+        return -1;
+    }
+
+    QList<PlistTreeItem*> candidates = _searchIndex->find(find, target, cs);
+
+    if ( mode == ReplaceModeNormal ) {
+        return candidates.count();
+    }
+
+    // A whole word is also a plain substring, so the index's results just need narrowing down.
     int count = 0;
-    PlistTreeItem *item = itemAtIndex(idx);
-    PlistTreeItem *parent = item->parent();
 
-    if ( item == nullptr ) {
+    for( int i = 0; i < candidates.count(); ++i )
+    {
+        if ( PlistTreeReplacer::ItemMatches(candidates.at(i), matcher, target) ) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+
+QModelIndex PlistTreeModel::findNext(const QModelIndex &from, const QString &find, ReplaceTarget target, ReplaceMode mode, Qt::CaseSensitivity cs, bool backwards)
+{
+    PlistTextMatcher matcher(find, mode, cs);
+    PlistTreeItem *root = visibleRoot();
+
+    if ( !matcher.isValid() || root == nullptr ) {
+        return QModelIndex();
+    }
+
+    PlistTreeSearchCursor cursor = PlistTreeSearchCursor(root, [this](PlistTreeItem *item) {
+        fetchMore(indexForItem(item));
+    });
+
+    cursor.setPosition(from.isValid() ? itemAtIndex(from) : nullptr);
+
+    PlistTreeItem *item = backwards ? cursor.findPrevious(matcher, target) : cursor.findNext(matcher, target);
+    return indexForItem(item);
+}
+
+
+int PlistTreeModel::findReplace(const QString &find, const QString &replace, ReplaceTarget target, ReplaceMode mode, Qt::CaseSensitivity cs, bool dryRun)
+{
+    if ( find.isEmpty() ) {
+        return 0;
+    }
+
+    PlistTextMatcher matcher(find, mode, cs);
+
+    if ( !matcher.isValid() ) {
+        return -1;
+    }
+
+    fetchAll();
+
+    PlistTreeItem *root = visibleRoot();
+
+    if ( root == nullptr ) {
         return 0;
     }
 
-    if ( target == ReplaceKey || target == ReplaceAll )
+    PlistTreeReplacer replacer = PlistTreeReplacer(matcher, replace, target);
+    QVector<PlistTreeReplacer::Replacement> replacements = replacer.collect(root);
+    int count = 0;
+
+    // Items are counted, as countMatches does, leaving out those whose only change is a key that would clash.
+    if ( dryRun )
     {
-        if ( parent != nullptr && parent->shouldChildrenHaveKey() )
+        QHash<PlistTreeItem*, QHash<QString, PlistTreeItem*> > renamedKeys;
+
+        for( int i = 0; i < replacements.count(); ++i )
         {
-            QModelIndex editIndex = idx.sibling(idx.row(), PlistTreeItem::COLUMN_KEY);
-            QString origKey = data(editIndex, Qt::EditRole).toString();
-            QString key = origKey;
-            key.replace(find, replace);
+            const PlistTreeReplacer::Replacement &replacement = replacements.at(i);
+            const bool renames = replacement.hasKey && SimulateRename(replacement.item, replacement.key, renamedKeys);
 
-            if ( origKey.compare(key) != 0 ) {
-                setData(editIndex, key, Qt::EditRole);
+            if ( renames || replacement.hasValue ) {
                 count++;
             }
         }
+
+        return count;
     }
 
-    if ( target == ReplaceValue || target == ReplaceAll )
+    // The first and last changed row under each parent, so the view hears about each parent once.
+    QHash<PlistTreeItem*, QPair<int, int> > changedRows;
+
+    for( int i = 0; i < replacements.count(); ++i )
     {
-        if ( item->plistType() == PlistTreeItem::PlistString )
+        const PlistTreeReplacer::Replacement &replacement = replacements.at(i);
+        PlistTreeItem *item = replacement.item;
+        int changes = 0;
+
+        // A key that would clash with a sibling is left alone, as it would be when edited by hand.
+        if ( replacement.hasKey && item->setKey(replacement.key) ) {
+            changes++;
+        }
+
+        if ( replacement.hasValue )
         {
-            QModelIndex editIndex = idx.sibling(idx.row(), PlistTreeItem::COLUMN_VALUE);
-            QString origValue = data(editIndex, Qt::EditRole).toString();
-            QString value = origValue;
-            value.replace(find, replace);
+            PlistValue value = item->value();
+            value.setString(replacement.value);
+            item->setValue(value);
+            changes++;
+        }
 
-            if ( origValue.compare(value) != 0 ) {
-                setData(editIndex, value, Qt::EditRole);
-                count++;
-            }
+        if ( changes == 0 ) {
+            continue;
+        }
+
+        count++;
+
+        // As in setData, a new key only changes the parent's content.
+        if ( replacement.hasValue || item->parent() == nullptr ) {
+            item->markDirty();
+        } else {
+            item->parent()->markDirty();
+        }
+
+        if ( _searchIndex != nullptr ) {
+            _searchIndex->updateItem(item);
+        }
+
+        const int row = item->row();
+        QHash<PlistTreeItem*, QPair<int, int> >::iterator it = changedRows.find(item->parent());
+
+        if ( it == changedRows.end() ) {
+            changedRows.insert(item->parent(), qMakePair(row, row));
+        } else {
+            it.value().first = qMin(it.value().first, row);
+            it.value().second = qMax(it.value().second, row);
         }
     }
 
-    for ( int i = 0; i < item->childCount(); ++i )
+    for( QHash<PlistTreeItem*, QPair<int, int> >::const_iterator it = changedRows.constBegin(); it != changedRows.constEnd(); ++it )
     {
-        QModelIndex childIndex = idx.child(i, 0);
-        count += doFindReplace(childIndex, find, replace, target, mode);
+        QModelIndex parentIndex = indexForItem(it.key());
+        emit dataChanged(index(it.value().first, PlistTreeItem::COLUMN_KEY, parentIndex), index(it.value().second, PlistTreeItem::COLUMN_VALUE, parentIndex));
     }
 
     return count;
 }
 
+
+//
+// Protected Methods
+//
+
+
+void PlistTreeModel::collectUnfetched(PlistTreeItem *item, QVector<PlistLazyTreeReader::Subtree> &subtrees, QHash<qint64, PlistTreeItem*> &items) const
+{
+    if ( item->hasUnfetchedChildren() )
+    {
+        if ( !item->isUnreadable() ) {
+            subtrees.append(PlistLazyTreeReader::SubtreeForItem(item));
+            items.insert(item->fetchToken(), item);
+        }
+
+        return;
+    }
+
+    for( int i = 0; i < item->childCount(); ++i ) {
+        collectUnfetched(item->child(i), subtrees, items);
+    }
+}
+
+
+int PlistTreeModel::attachSubtrees(QVector<PlistLazyTreeReader::Subtree> &subtrees, const QHash<qint64, PlistTreeItem*> &items)
+{
+    int attached = 0;
+
+    for( int i = 0; i < subtrees.count(); ++i )
+    {
+        PlistLazyTreeReader::Subtree &subtree = subtrees[i];
+        PlistTreeItem *item = items.value(subtree.token);
+
+        // Read or removed since, so these children have nowhere to go.
+        if ( item == nullptr ) {
+            qDeleteAll(subtree.children);
+            subtree.children.clear();
+            continue;
+        }
+
+        QModelIndex parent = indexForItem(item);
+        attached++;
+
+        if ( !subtree.isRead ) {
+            item->markUnreadable();
+            _unreadableItemCount++;
+            emit fetchFailed(parent);
+            continue;
+        }
+
+        item->clearFetchToken();
+
+        emit beginInsertRows(parent, 0, subtree.children.count() - 1);
+
+        for( int j = 0; j < subtree.children.count(); ++j ) {
+            item->aendChild(subtree.children.at(j));
+
+            if ( _searchIndex != nullptr ) {
+                _searchIndex->addSubtree(subtree.children.at(j));
+            }
+        }
+
+        emit endInsertRows();
+        subtree.children.clear();
+    }
+
+    return attached;
+}
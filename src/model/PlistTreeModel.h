@@ -25,10 +25,17 @@
 #include <QUndoStack>
 #include <QtGui>
 #include "PlistTreeItem.h"
+#include "PlistLazyTreeReader.h"
+
+class PlistTreeSource;
+class PlistTreeQuery;
+class PlistSearchIndex;
 
 
 enum ReplaceMode {
-    ReplaceModeNormal
+    ReplaceModeNormal,
+    ReplaceModeWholeWord,
+    ReplaceModeRegularExpression
 };
 
 enum ReplaceTarget {
@@ -55,8 +62,8 @@ public:
     /** Constructor which accepts some data as a QVariant an converts that to the internal format. */
     PlistTreeModel(const QVariant &data, QObject *parent = 0);
 
-    /** Constructor which accepts a root node (without the invisible parent). */
-    PlistTreeModel(PlistTreeItem *root, QObject *parent = 0);
+    /** Constructor which accepts a root node (without the invisible parent), and optionally the arena it was allocated from, the lazy reader for its unfetched children and the source it was read from, which the model takes ownership of. */
+    PlistTreeModel(PlistTreeItem *root, PlistTreeArena *arena = nullptr, PlistLazyTreeReader *lazyReader = nullptr, PlistTreeSource *source = nullptr, QObject *parent = 0);
 
     /** Constructor without any data, will create an 'empty' model with a single Dictionary root node. */
     PlistTreeModel(QObject *parent = 0);
@@ -72,6 +79,15 @@ public:
     /** Get the PlistTreeItem at a given index. */
     PlistTreeItem *itemAtIndex(const QModelIndex &index) const;
 
+    /** Get the index of the given item (which must belong to this model), or an invalid index for the root's parent. */
+    QModelIndex indexForItem(PlistTreeItem *item, int column = 0) const;
+
+    /** The arena which owns the items of this document. New items should be allocated from here. */
+    PlistTreeArena *arena() const;
+
+    /** The file this document was read from, for copying unmodified parts when saving, or nullptr. */
+    const PlistTreeSource *source() const;
+
 
     //
     // Model Methods
@@ -99,7 +115,7 @@ public:
     int columnCount(const QModelIndex &parent = QModelIndex()) const;
 
     /** For editable cells. */
-    bool setData(const QModelIndex &index, const QVariant &value, int role);
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole);
 
     /** Ability to insert rows. */
     bool insertRows(int row, int count, const QModelIndex &parent);
@@ -107,6 +123,15 @@ public:
     /** Ability to remove rows. */
     bool removeRows(int row, int count, const QModelIndex &parent);
 
+    /** Does the item at the given index have children, fetched or not? */
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const;
+
+    /** Are there children at the given index which haven't been read from the file yet? */
+    bool canFetchMore(const QModelIndex &parent) const;
+
+    /** Read the children at the given index from the file. Emits fetchFailed, once, if they can't be read. */
+    void fetchMore(const QModelIndex &parent);
+
 
     //
     // Public Methods for Alication Use
@@ -118,19 +143,87 @@ public:
     /** Insert a full PlistTreeItem into the tree and reset the data model afterwards. */
     bool insertItem(PlistTreeItem *item, int row, const QModelIndex &parent);
 
-    /** Do a find/replace across the whole tree. */
-    int findReplace(QString &find, QString &replace, ReplaceTarget target, ReplaceMode mode);
+    /** Read every unfetched item below the given index from the file, in one pass, for operations that need the whole tree. */
+    void fetchAll(const QModelIndex &parent = QModelIndex());
+
+    /** Might there be items which haven't been read from the file yet? */
+    bool hasUnfetchedItems() const;
+
+    /**
+     * Start reading every unfetched item on another thread. Returns the reader to call readSubtrees() on for the
+     * given containers, or nullptr if there's nothing to read (or a read is already under way). The reader is
+     * kept until endFetchAll() is called, which must always follow, and the model must outlive the read.
+     */
+    PlistLazyTreeReader *beginFetchAll(QVector<PlistLazyTreeReader::Subtree> &subtrees);
+
+    /**
+     * Attach the children read by readSubtrees(), taking over the arena they were allocated from (if any).
+     * Containers read or removed in the meantime are skipped, and those that couldn't be read become unreadable.
+     */
+    void endFetchAll(QVector<PlistLazyTreeReader::Subtree> &subtrees, PlistTreeArena *arena);
+
+    /** Are there containers in the tree whose children couldn't be read from the file, so the tree is incomplete? */
+    bool hasUnreadableItems() const;
+
+    /**
+     * Indexes of the items matching a compiled key path, in document order, reading unfetched children along
+     * the way as needed. Without fetch, only what has been read already is looked at.
+     */
+    QModelIndexList query(const PlistTreeQuery &query, int limit = -1, bool fetch = true);
+
+    /**
+     * Start indexing the text of the document in the background, if that hasn't been done already. Only what
+     * has been read from the file is indexed; items read later on are added to the index as they arrive.
+     */
+    void buildSearchIndex();
+
+    /**
+     * How many items read from the file so far have a key or string value that matches, or -1 while the search
+     * index is still being built or if the find text isn't a valid regular expression. Normal and whole word
+     * searches use the index.
+     */
+    int countMatches(const QString &find, ReplaceTarget target, ReplaceMode mode = ReplaceModeNormal, Qt::CaseSensitivity cs = Qt::CaseSensitive);
+
+    /**
+     * The first item after (or before) from, in document order and wrapping around the ends, whose key or value
+     * matches. Only the items the search passes are read in from the file. Returns an invalid index if nothing
+     * matches, or the find text isn't a valid regular expression.
+     */
+    QModelIndex findNext(const QModelIndex &from, const QString &find, ReplaceTarget target, ReplaceMode mode, Qt::CaseSensitivity cs = Qt::CaseSensitive, bool backwards = false);
+
+    /**
+     * Do a find/replace across the whole tree, returning how many items were changed, or -1 if the
+     * find text isn't a valid regular expression. The search runs on every core without touching the tree,
+     * and then the changes are made in one pass, with a single dataChanged for the changed rows of each parent.
+     * A dry run only counts what would change.
+     */
+    int findReplace(const QString &find, const QString &replace, ReplaceTarget target, ReplaceMode mode, Qt::CaseSensitivity cs = Qt::CaseSensitive, bool dryRun = false);
 
     
 signals:
-    
+    /** The search index has finished building, so countMatches() can answer. */
+    void searchIndexReady();
+
+    /** The children at the given index couldn't be read from the file, so they're left unread for good. */
+    void fetchFailed(const QModelIndex &parent);
+
 public slots:
 
 protected:
-    int doFindReplace(QModelIndex &idx, QString &find, QString &replace, ReplaceTarget target, ReplaceMode mode);
+    /** Find the containers below item which are waiting to be read, by their fetch token. */
+    void collectUnfetched(PlistTreeItem *item, QVector<PlistLazyTreeReader::Subtree> &subtrees, QHash<qint64, PlistTreeItem*> &items) const;
+
+    /** Attach read subtrees to the containers they were read for, returning how many of those were dealt with. */
+    int attachSubtrees(QVector<PlistLazyTreeReader::Subtree> &subtrees, const QHash<qint64, PlistTreeItem*> &items);
 
 
 private:
+    PlistTreeArena *_arena;
+    PlistLazyTreeReader *_lazyReader;   // Reads unfetched children on demand, or nullptr
+    PlistTreeSource *_source;           // Original bytes of the file, or nullptr
+    PlistSearchIndex *_searchIndex;     // Built on demand by buildSearchIndex, or nullptr
+    int _unreadableItemCount;           // Containers in the tree whose children couldn't be read
+    bool _isFetchingInBackground;       // Between beginFetchAll and endFetchAll
     PlistTreeItem *_invisibleRootItem;
     
 };
@@ -0,0 +1,788 @@
+#include "PlistTreeQuery.h"
+
+#include <QDateTime>
+#include <QStringList>
+
+
+namespace {
+    // Keys which can be written as .Key when building a path; anything else is quoted.
+    bool IsPlainKey(const QString &key)
+    {
+        if ( key.isEmpty() || key == "*" || key.at(0).isSpace() || key.at(key.size() - 1).isSpace() ) {
+            return false;
+        }
+
+        if ( key.at(0) == '"' || key.at(0) == '\'' ) {
+            return false;
+        }
+
+        for( int i = 0; i < key.size(); ++i )
+        {
+            const QChar c = key.at(i);
+
+            if ( c == '.' || c == '[' || c == ']' ) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    QString QuoteKey(const QString &key)
+    {
+        QString quoted = key;
+        quoted.replace("\\", "\\\\");
+        quoted.replace("\"", "\\\"");
+        return QString("[\"%1\"]").arg(quoted);
+    }
+
+
+    // Dates compare as ISO 8601 text, which sorts the same way they do.
+    QString DateText(qint64 msecsSinceEpoch)
+    {
+        return QDateTime::fromMSecsSinceEpoch(msecsSinceEpoch, Qt::UTC).toString(Qt::ISODate);
+    }
+
+
+    template<typename T>
+    int Order(T a, T b)
+    {
+        return (a < b) ? -1 : ((b < a) ? 1 : 0);
+    }
+}
+
+
+PlistTreeQuery::PlistTreeQuery()
+{
+    _pos = 0;
+    _valid = false;
+    _errorPosition = -1;
+}
+
+
+bool PlistTreeQuery::compile(const QString &path)
+{
+    _path = path;
+    _pos = 0;
+    _steps.clear();
+    _filters.clear();
+    _valid = false;
+    _errorString = QString();
+    _errorPosition = -1;
+
+    skipWhitespace();
+
+    // The root can be named, but doesn't have to be.
+    const int start = _pos;
+    const int end = _pos + 4;
+
+    if ( _pos < _path.size() && _path.at(_pos) == '$' ) {
+        ++_pos;
+    } else if ( _path.midRef(_pos, 4) == QLatin1String("Root") && (end == _path.size() || _path.at(end) == '.' || _path.at(end) == '[' || _path.at(end).isSpace()) ) {
+        _pos = end;
+    }
+
+    if ( !parseSteps(_steps, false, _pos == start) ) {
+        return false;
+    }
+
+    _valid = true;
+    return true;
+}
+
+
+bool PlistTreeQuery::isValid() const
+{
+    return _valid;
+}
+
+
+QString PlistTreeQuery::path() const
+{
+    return _path;
+}
+
+
+QString PlistTreeQuery::errorString() const
+{
+    return _errorString;
+}
+
+
+int PlistTreeQuery::errorPosition() const
+{
+    return _errorPosition;
+}
+
+
+QList<PlistTreeItem*> PlistTreeQuery::evaluate(PlistTreeItem *root, int limit, const FetchFunction &fetch) const
+{
+    QList<PlistTreeItem*> results;
+
+    if ( !_valid || root == nullptr || limit == 0 ) {
+        return results;
+    }
+
+    evaluateSteps(_steps, 0, root, results, limit, fetch);
+    return results;
+}
+
+
+QString PlistTreeQuery::PathForItem(const PlistTreeItem *item)
+{
+    QStringList steps;
+
+    // Walk up as far as the visible root, which is the item without a real parent.
+    while( item != nullptr && item->parent() != nullptr && item->parent()->plistType() != PlistTreeItem::PlistInvisibleRoot )
+    {
+        const PlistTreeItem *parent = item->parent();
+
+        if ( parent->plistType() == PlistTreeItem::PlistDictionary ) {
+            steps.prepend(IsPlainKey(item->key()) ? QString(".%1").arg(item->key()) : QuoteKey(item->key()));
+        } else {
+            steps.prepend(QString("[%1]").arg(item->row()));
+        }
+
+        item = parent;
+    }
+
+    return QString("Root") + steps.join(QString());
+}
+
+
+//
+// Parsing
+//
+
+
+bool PlistTreeQuery::parseSteps(QVector<Step> &steps, bool isFilterPath, bool allowBareName)
+{
+    while( true )
+    {
+        // Whitespace ends a predicate's path, but can sit between the steps of a whole path.
+        if ( !isFilterPath ) {
+            skipWhitespace();
+        }
+
+        if ( _pos >= _path.size() ) {
+            return true;
+        }
+
+        const QChar c = _path.at(_pos);
+
+        if ( c == '.' )
+        {
+            Step step = MakeStep(StepKey);
+            ++_pos;
+
+            if ( _pos < _path.size() && _path.at(_pos) == '.' ) {
+                step.type = StepDescendants;
+                ++_pos;
+            }
+
+            if ( _pos < _path.size() && _path.at(_pos) == '*' ) {
+                // '..*' is every descendant, which is a descendants step with no key.
+                step.type = (step.type == StepKey) ? StepChildren : StepDescendants;
+                ++_pos;
+            } else if ( _pos < _path.size() && (_path.at(_pos) == '"' || _path.at(_pos) == '\'') ) {
+                if ( !parseQuoted(step.key) ) {
+                    return false;
+                }
+            } else if ( !parseName(step.key, isFilterPath) ) {
+                return false;
+            }
+
+            steps.append(step);
+        }
+        else if ( c == '[' )
+        {
+            if ( !parseBracket(steps) ) {
+                return false;
+            }
+        }
+        else if ( allowBareName && !isNameEnd(c, isFilterPath) )
+        {
+            // The first key doesn't need a dot in front of it.
+            Step step = MakeStep(StepKey);
+
+            if ( c == '*' ) {
+                step.type = StepChildren;
+                ++_pos;
+            } else if ( !parseName(step.key, isFilterPath) ) {
+                return false;
+            }
+
+            steps.append(step);
+        }
+        else if ( isFilterPath )
+        {
+            // Whatever comes next (an operator or the end of the predicate) is for parseFilter.
+            return true;
+        }
+        else
+        {
+            return fail("Expected '.' or '['");
+        }
+
+        allowBareName = false;
+    }
+}
+
+
+bool PlistTreeQuery::parseBracket(QVector<Step> &steps)
+{
+    Step step = MakeStep(StepIndex);
+    ++_pos;
+    skipWhitespace();
+
+    if ( _pos >= _path.size() ) {
+        return fail("Expected ']'");
+    }
+
+    const QChar c = _path.at(_pos);
+
+    if ( c == '*' )
+    {
+        step.type = StepChildren;
+        ++_pos;
+    }
+    else if ( c == '"' || c == '\'' )
+    {
+        step.type = StepKey;
+
+        if ( !parseQuoted(step.key) ) {
+            return false;
+        }
+    }
+    else if ( c == '?' )
+    {
+        step.type = StepFilter;
+        ++_pos;
+
+        if ( !parseFilter(step) ) {
+            return false;
+        }
+    }
+    else
+    {
+        if ( c != ':' )
+        {
+            if ( !parseInteger(step.first) ) {
+                return false;
+            }
+
+            step.hasFirst = true;
+            skipWhitespace();
+        }
+
+        if ( _pos < _path.size() && _path.at(_pos) == ':' )
+        {
+            step.type = StepSlice;
+            ++_pos;
+            skipWhitespace();
+
+            if ( _pos < _path.size() && _path.at(_pos) != ']' )
+            {
+                if ( !parseInteger(step.last) ) {
+                    return false;
+                }
+
+                step.hasLast = true;
+            }
+        }
+    }
+
+    skipWhitespace();
+
+    if ( _pos >= _path.size() || _path.at(_pos) != ']' ) {
+        return fail("Expected ']'");
+    }
+
+    ++_pos;
+    steps.append(step);
+    return true;
+}
+
+
+bool PlistTreeQuery::parseFilter(Step &step)
+{
+    Filter filter;
+    filter.op = OperatorExists;
+    skipWhitespace();
+
+    // JSONPath style parentheses are allowed, but not needed.
+    const bool hasParentheses = (_pos < _path.size() && _path.at(_pos) == '(');
+
+    if ( hasParentheses ) {
+        ++_pos;
+        skipWhitespace();
+    }
+
+    const bool isSelf = (_pos < _path.size() && _path.at(_pos) == '@');
+
+    if ( isSelf ) {
+        ++_pos;
+    }
+
+    if ( !parseSteps(filter.path, true, !isSelf) ) {
+        return false;
+    }
+
+    if ( !isSelf && filter.path.isEmpty() ) {
+        return fail("Expected a path");
+    }
+
+    skipWhitespace();
+
+    if ( _pos < _path.size() && _path.at(_pos) != ']' && _path.at(_pos) != ')' )
+    {
+        if ( !parseOperator(filter.op) ) {
+            return false;
+        }
+
+        skipWhitespace();
+        const int literalPos = _pos;
+
+        if ( !parseLiteral(filter.literal) ) {
+            return false;
+        }
+
+        if ( filter.op == OperatorMatches )
+        {
+            if ( filter.literal.type() != QVariant::String ) {
+                _pos = literalPos;
+                return fail("Expected a regular expression in quotes");
+            }
+
+            // Compiled (and JIT compiled) once here, rather than for every item.
+            filter.regex.setPattern(filter.literal.toString());
+
+            if ( !filter.regex.isValid() ) {
+                _pos = literalPos;
+                return fail(filter.regex.errorString());
+            }
+
+            filter.regex.optimize();
+        }
+        else if ( filter.literal.type() == QVariant::Bool && filter.op != OperatorEqual && filter.op != OperatorNotEqual )
+        {
+            _pos = literalPos;
+            return fail("true and false can only be compared with == or !=");
+        }
+
+        skipWhitespace();
+    }
+
+    if ( hasParentheses )
+    {
+        if ( _pos >= _path.size() || _path.at(_pos) != ')' ) {
+            return fail("Expected ')'");
+        }
+
+        ++_pos;
+        skipWhitespace();
+    }
+
+    step.filter = _filters.count();
+    _filters.append(filter);
+    return true;
+}
+
+
+bool PlistTreeQuery::parseName(QString &name, bool isFilterPath)
+{
+    const int start = _pos;
+
+    while( _pos < _path.size() && !isNameEnd(_path.at(_pos), isFilterPath) ) {
+        ++_pos;
+    }
+
+    name = _path.mid(start, _pos - start).trimmed();
+
+    if ( name.isEmpty() ) {
+        _pos = start;
+        return fail("Expected a key");
+    }
+
+    return true;
+}
+
+
+bool PlistTreeQuery::parseQuoted(QString &text)
+{
+    const QChar quote = _path.at(_pos++);
+    text = QString();
+
+    while( _pos < _path.size() )
+    {
+        QChar c = _path.at(_pos++);
+
+        if ( c == quote ) {
+            return true;
+        }
+
+        if ( c == '\\' && _pos < _path.size() ) {
+            c = _path.at(_pos++);
+        }
+
+        text.append(c);
+    }
+
+    return fail("Missing closing quote");
+}
+
+
+bool PlistTreeQuery::parseInteger(int &value)
+{
+    const int start = _pos;
+
+    if ( _pos < _path.size() && _path.at(_pos) == '-' ) {
+        ++_pos;
+    }
+
+    while( _pos < _path.size() && _path.at(_pos).isDigit() ) {
+        ++_pos;
+    }
+
+    bool isNumber = false;
+    value = _path.midRef(start, _pos - start).toInt(&isNumber);
+
+    if ( !isNumber ) {
+        _pos = start;
+        return fail("Expected an index, a slice, '*', a quoted key or a predicate");
+    }
+
+    return true;
+}
+
+
+bool PlistTreeQuery::parseOperator(Operator &op)
+{
+    const QStringRef text = _path.midRef(_pos, 2);
+
+    if ( text == QLatin1String("==") ) { op = OperatorEqual; }
+    else if ( text == QLatin1String("!=") ) { op = OperatorNotEqual; }
+    else if ( text == QLatin1String("<=") ) { op = OperatorLessOrEqual; }
+    else if ( text == QLatin1String(">=") ) { op = OperatorGreaterOrEqual; }
+    else if ( text == QLatin1String("=~") ) { op = OperatorMatches; }
+    else if ( text.startsWith('<') ) { op = OperatorLess; }
+    else if ( text.startsWith('>') ) { op = OperatorGreater; }
+    else if ( text.startsWith('=') ) { op = OperatorEqual; }
+    else { return fail("Expected ==, !=, <, <=, >, >= or =~"); }
+
+    _pos += (op == OperatorLess || op == OperatorGreater || (op == OperatorEqual && text != QLatin1String("=="))) ? 1 : 2;
+    return true;
+}
+
+
+bool PlistTreeQuery::parseLiteral(QVariant &literal)
+{
+    if ( _pos < _path.size() && (_path.at(_pos) == '"' || _path.at(_pos) == '\'') )
+    {
+        QString text;
+
+        if ( !parseQuoted(text) ) {
+            return false;
+        }
+
+        literal = text;
+        return true;
+    }
+
+    const int start = _pos;
+
+    while( _pos < _path.size() && !_path.at(_pos).isSpace() && _path.at(_pos) != ']' && _path.at(_pos) != ')' ) {
+        ++_pos;
+    }
+
+    const QString word = _path.mid(start, _pos - start);
+    bool isNumber = false;
+
+    if ( word == "true" || word == "false" ) {
+        literal = (word == "true");
+        return true;
+    }
+
+    // Whole numbers are kept as integers, so big ones still compare exactly.
+    qlonglong integer = word.toLongLong(&isNumber);
+
+    if ( isNumber ) {
+        literal = integer;
+        return true;
+    }
+
+    double real = word.toDouble(&isNumber);
+
+    if ( isNumber ) {
+        literal = real;
+        return true;
+    }
+
+    _pos = start;
+    return fail("Expected a number, a string in quotes, true or false");
+}
+
+
+bool PlistTreeQuery::isNameEnd(QChar c, bool isFilterPath) const
+{
+    if ( c == '.' || c == '[' || c == ']' ) {
+        return true;
+    }
+
+    return isFilterPath && (c.isSpace() || c == ')' || c == '=' || c == '!' || c == '<' || c == '>');
+}
+
+
+void PlistTreeQuery::skipWhitespace()
+{
+    while( _pos < _path.size() && _path.at(_pos).isSpace() ) {
+        ++_pos;
+    }
+}
+
+
+bool PlistTreeQuery::fail(const QString &message)
+{
+    _errorString = message;
+    _errorPosition = _pos;
+    _valid = false;
+    return false;
+}
+
+
+PlistTreeQuery::Step PlistTreeQuery::MakeStep(StepType type)
+{
+    Step step;
+    step.type = type;
+    step.first = 0;
+    step.last = 0;
+    step.hasFirst = false;
+    step.hasLast = false;
+    step.filter = -1;
+    return step;
+}
+
+
+//
+// Evaluation
+//
+
+
+bool PlistTreeQuery::evaluateSteps(const QVector<Step> &steps, int stepIndex, PlistTreeItem *item, QList<PlistTreeItem*> &results, int limit, const FetchFunction &fetch) const
+{
+    if ( stepIndex == steps.count() ) {
+        results.append(item);
+        return limit < 0 || results.count() < limit;
+    }
+
+    if ( !PlistTreeItem::IsContainerType(item->plistType()) ) {
+        return true;
+    }
+
+    if ( item->hasUnfetchedChildren() && fetch ) {
+        fetch(item);
+    }
+
+    const Step &step = steps.at(stepIndex);
+    const int count = item->childCount();
+
+    switch( step.type )
+    {
+    case StepKey:
+        {
+            PlistTreeItem *child = nullptr;
+
+            if ( item->plistType() == PlistTreeItem::PlistDictionary ) {
+                child = item->childForKey(step.key);
+            } else {
+                // Arrays can be stepped into with .0 as well as [0].
+                bool isIndex = false;
+                int index = step.key.toInt(&isIndex);
+
+                if ( isIndex && index >= 0 && index < count ) {
+                    child = item->child(index);
+                }
+            }
+
+            return child == nullptr || evaluateSteps(steps, stepIndex + 1, child, results, limit, fetch);
+        }
+
+    case StepChildren:
+        for( int i = 0; i < count; ++i )
+        {
+            if ( !evaluateSteps(steps, stepIndex + 1, item->child(i), results, limit, fetch) ) {
+                return false;
+            }
+        }
+        return true;
+
+    case StepIndex:
+        {
+            const int index = (step.first < 0) ? count + step.first : step.first;
+            return index < 0 || index >= count || evaluateSteps(steps, stepIndex + 1, item->child(index), results, limit, fetch);
+        }
+
+    case StepSlice:
+        {
+            int first = step.hasFirst ? step.first : 0;
+            int last = step.hasLast ? step.last : count;
+
+            first = qBound(0, (first < 0) ? count + first : first, count);
+            last = qBound(0, (last < 0) ? count + last : last, count);
+
+            for( int i = first; i < last; ++i )
+            {
+                if ( !evaluateSteps(steps, stepIndex + 1, item->child(i), results, limit, fetch) ) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    case StepDescendants:
+        return evaluateDescendants(steps, stepIndex, item, results, limit, fetch);
+
+    case StepFilter:
+        {
+            const Filter &filter = _filters.at(step.filter);
+
+            for( int i = 0; i < count; ++i )
+            {
+                PlistTreeItem *child = item->child(i);
+
+                if ( matchesFilter(filter, child, fetch) && !evaluateSteps(steps, stepIndex + 1, child, results, limit, fetch) ) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    return true;
+}
+
+
+bool PlistTreeQuery::evaluateDescendants(const QVector<Step> &steps, int stepIndex, PlistTreeItem *item, QList<PlistTreeItem*> &results, int limit, const FetchFunction &fetch) const
+{
+    if ( item->hasUnfetchedChildren() && fetch ) {
+        fetch(item);
+    }
+
+    const QString &key = steps.at(stepIndex).key;
+    const bool isDict = (item->plistType() == PlistTreeItem::PlistDictionary);
+
+    // Pre-order, so that results stay in document order.
+    for( int i = 0; i < item->childCount(); ++i )
+    {
+        PlistTreeItem *child = item->child(i);
+
+        if ( key.isEmpty() || (isDict && child->key() == key) )
+        {
+            if ( !evaluateSteps(steps, stepIndex + 1, child, results, limit, fetch) ) {
+                return false;
+            }
+        }
+
+        if ( PlistTreeItem::IsContainerType(child->plistType()) && !evaluateDescendants(steps, stepIndex, child, results, limit, fetch) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+bool PlistTreeQuery::matchesFilter(const Filter &filter, PlistTreeItem *item, const FetchFunction &fetch) const
+{
+    QList<PlistTreeItem*> values;
+
+    // Whether the path exists only needs the first value; a comparison passes if any value does.
+    evaluateSteps(filter.path, 0, item, values, (filter.op == OperatorExists) ? 1 : -1, fetch);
+
+    if ( filter.op == OperatorExists ) {
+        return !values.isEmpty();
+    }
+
+    for( int i = 0; i < values.count(); ++i )
+    {
+        if ( CompareValue(filter, values.at(i)) ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+bool PlistTreeQuery::CompareValue(const Filter &filter, const PlistTreeItem *item)
+{
+    const PlistValue &value = item->value();
+    const PlistTreeItem::PlistType type = item->plistType();
+
+    if ( filter.op == OperatorMatches )
+    {
+        QString text;
+
+        switch( type )
+        {
+        case PlistTreeItem::PlistString: text = value.string(); break;
+        case PlistTreeItem::PlistInteger: text = QString::number(value.integer()); break;
+        case PlistTreeItem::PlistReal: text = QString::number(value.real(), 'g', 17); break;
+        case PlistTreeItem::PlistDate: text = DateText(value.date()); break;
+        default: return false;
+        }
+
+        return filter.regex.match(text).hasMatch();
+    }
+
+    int order = 0;
+
+    switch( filter.literal.type() )
+    {
+    case QVariant::Bool:
+        if ( type != PlistTreeItem::PlistBoolean ) {
+            return false;
+        }
+
+        order = Order(value.boolean(), filter.literal.toBool());
+        break;
+
+    case QVariant::LongLong:
+    case QVariant::Double:
+        if ( type == PlistTreeItem::PlistInteger && filter.literal.type() == QVariant::LongLong ) {
+            order = Order<qint64>(value.integer(), filter.literal.toLongLong());
+        } else if ( type == PlistTreeItem::PlistInteger ) {
+            order = Order<double>(value.integer(), filter.literal.toDouble());
+        } else if ( type == PlistTreeItem::PlistReal ) {
+            order = Order<double>(value.real(), filter.literal.toDouble());
+        } else {
+            return false;
+        }
+        break;
+
+    case QVariant::String:
+        if ( type == PlistTreeItem::PlistString ) {
+            order = Order(value.string().compare(filter.literal.toString()), 0);
+        } else if ( type == PlistTreeItem::PlistDate ) {
+            order = Order(DateText(value.date()).compare(filter.literal.toString()), 0);
+        } else {
+            return false;
+        }
+        break;
+
+    default:
+        return false;
+    }
+
+    switch( filter.op )
+    {
+    case OperatorEqual: return order == 0;
+    case OperatorNotEqual: return order != 0;
+    case OperatorLess: return order < 0;
+    case OperatorLessOrEqual: return order <= 0;
+    case OperatorGreater: return order > 0;
+    case OperatorGreaterOrEqual: return order >= 0;
+    default: return false;
+    }
+}
@@ -0,0 +1,159 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTTREEQUERY_H
+#define PLISTTREEQUERY_H
+
+#include "PlistTreeItem.h"
+
+#include <QList>
+#include <QRegularExpression>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+#include <functional>
+
+
+/**
+ * @brief A key path into a Plist tree, such as 'Root.Items[*].Name', compiled once and then evaluated.
+ *
+ * Paths start at the root, which can be written as 'Root' or '$' or left out altogether,
+ * and are made up of these steps:
+ *
+ *     .Key  or  ["Key"]       The dictionary child with the given key (a hashed lookup)
+ *     .*    or  [*]           Every child
+ *     [3]   or  [-1]          A child by position, from the end if negative
+ *     [1:5] or  [-3:]         A range of children, as a Python slice
+ *     ..Key or  ..*           Any descendant with the given key, or every descendant
+ *     [?Price > 10]           Children for which a relative path has a value that compares as given
+ *
+ * A predicate is a relative path (optionally starting with '@', for the child itself)
+ * followed by one of == != < <= > >= and a number, string, true or false, or by =~ and a
+ * regular expression in quotes. A path on its own just checks that it exists. Numbers
+ * compare with integers and reals, strings with strings and with dates (as ISO 8601 text),
+ * and values of any other type never match.
+ *
+ * Evaluation is depth first, so results come out in document order and can stop early
+ * once enough have been found.
+ */
+class PlistTreeQuery
+{
+public:
+    /** Called before the children of an item with unfetched children are looked at, to read them. */
+    typedef std::function<void(PlistTreeItem*)> FetchFunction;
+
+    PlistTreeQuery();
+
+    /** Parse the given path. Returns false, with an error string and position, if it isn't valid. */
+    bool compile(const QString &path);
+
+    /** Did the last compile succeed? */
+    bool isValid() const;
+
+    QString path() const;
+    QString errorString() const;
+    int errorPosition() const;
+
+    /** Items below the given (visible) root which match the path, stopping after limit of them if limit isn't negative. */
+    QList<PlistTreeItem*> evaluate(PlistTreeItem *root, int limit = -1, const FetchFunction &fetch = FetchFunction()) const;
+
+    /** The path which leads to the given item from the root of its tree. */
+    static QString PathForItem(const PlistTreeItem *item);
+
+
+protected:
+    enum StepType {
+        StepKey,
+        StepChildren,
+        StepIndex,
+        StepSlice,
+        StepDescendants,
+        StepFilter
+    };
+
+    enum Operator {
+        OperatorExists,
+        OperatorEqual,
+        OperatorNotEqual,
+        OperatorLess,
+        OperatorLessOrEqual,
+        OperatorGreater,
+        OperatorGreaterOrEqual,
+        OperatorMatches
+    };
+
+    struct Step {
+        StepType type;
+        QString key;            // StepKey, or StepDescendants (empty for any key)
+        int first;              // StepIndex, or start of a StepSlice
+        int last;               // End of a StepSlice (exclusive)
+        bool hasFirst;
+        bool hasLast;
+        int filter;             // StepFilter, index into _filters
+    };
+
+    struct Filter {
+        QVector<Step> path;     // Relative to the child being tested
+        Operator op;
+        QVariant literal;       // QString, qlonglong, double or bool
+        QRegularExpression regex;
+    };
+
+    //
+    // Parsing
+    //
+
+    bool parseSteps(QVector<Step> &steps, bool isFilterPath, bool allowBareName);
+    bool parseBracket(QVector<Step> &steps);
+    bool parseFilter(Step &step);
+    bool parseName(QString &name, bool isFilterPath);
+    bool parseQuoted(QString &text);
+    bool parseInteger(int &value);
+    bool parseOperator(Operator &op);
+    bool parseLiteral(QVariant &literal);
+    bool isNameEnd(QChar c, bool isFilterPath) const;
+    void skipWhitespace();
+    bool fail(const QString &message);
+
+    static Step MakeStep(StepType type);
+
+    //
+    // Evaluation
+    //
+
+    /** Apply steps [stepIndex, end) to the given item, adding matches to results. Returns false once the limit is reached. */
+    bool evaluateSteps(const QVector<Step> &steps, int stepIndex, PlistTreeItem *item, QList<PlistTreeItem*> &results, int limit, const FetchFunction &fetch) const;
+    bool evaluateDescendants(const QVector<Step> &steps, int stepIndex, PlistTreeItem *item, QList<PlistTreeItem*> &results, int limit, const FetchFunction &fetch) const;
+    bool matchesFilter(const Filter &filter, PlistTreeItem *item, const FetchFunction &fetch) const;
+
+    static bool CompareValue(const Filter &filter, const PlistTreeItem *item);
+
+
+private:
+    QString _path;
+    int _pos;                           // Parse position in _path
+    QVector<Step> _steps;
+    QVector<Filter> _filters;
+    bool _valid;
+    QString _errorString;
+    int _errorPosition;
+};
+
+#endif // PLISTTREEQUERY_H
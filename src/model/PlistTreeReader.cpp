@@ -1,9 +1,38 @@
 #include "PlistTreeReader.h"
+#include "PlistTreeArena.h"
 
 #include <iostream>
 
+
+namespace {
+    // How many tokens to read between progress reports.
+    const int PROGRESS_INTERVAL = 4096;
+}
+
+
 PlistTreeReader::PlistTreeReader()
 {
+    _arena = nullptr;
+    _source = nullptr;
+    _cancelled = false;
+}
+
+
+void PlistTreeReader::setArena(PlistTreeArena *arena)
+{
+    _arena = arena;
+}
+
+
+void PlistTreeReader::setSource(PlistTreeSource *source)
+{
+    _source = source;
+}
+
+
+void PlistTreeReader::setProgressCallback(const std::function<bool(qint64, qint64)> &callback)
+{
+    _progressCallback = callback;
 }
 
 
@@ -14,7 +43,42 @@ PlistTreeItem * PlistTreeReader::readTreeFromFile(QString &fileName)
     }
 
     QFile file(fileName);
-    file.open(QIODevice::ReadOnly | QIODevice::Text);
+
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        return nullptr;
+    }
+
+    // Tokenize straight from the source (or just the mapped file) if we can.
+    if ( _source != nullptr && _source->open(fileName) )
+    {
+        PlistXmlTokenizer tokenizer(_source->data(), _source->size());
+        PlistTreeItem *result = itemFromTokenizer(tokenizer, _source->size(), _source);
+
+        if ( result != nullptr || _cancelled ) {
+            file.close();
+            return result;
+        }
+    }
+    else
+    {
+        qint64 size = file.size();
+        uchar *data = (size > 0) ? file.map(0, size) : nullptr;
+
+        if ( data != nullptr )
+        {
+            PlistXmlTokenizer tokenizer(reinterpret_cast<const char*>(data), size);
+            PlistTreeItem *result = itemFromTokenizer(tokenizer, size, nullptr);
+            file.unmap(data);
+
+            if ( result != nullptr || _cancelled ) {
+                file.close();
+                return result;
+            }
+        }
+    }
+
+    file.seek(0);
+
     QXmlStreamReader xmlReader(&file);
     PlistTreeItem *result = itemFromXmlReader(xmlReader);
     file.close();
@@ -29,16 +93,159 @@ PlistTreeItem * PlistTreeReader::readTreeFromString(QString &data)
         return nullptr;
     }
 
+    QByteArray utf8 = data.toUtf8();
+    PlistXmlTokenizer tokenizer(utf8.constData(), utf8.size());
+    PlistTreeItem *result = itemFromTokenizer(tokenizer, utf8.size(), nullptr);
+
+    if ( result != nullptr || _cancelled ) {
+        return result;
+    }
+
     QXmlStreamReader xmlReader(data);
     return itemFromXmlReader(xmlReader);
 }
 
 
+PlistTreeItem * PlistTreeReader::itemFromTokenizer(PlistXmlTokenizer &tokenizer, qint64 size, PlistTreeSource *source)
+{
+    // Same state machine as itemFromXmlReader, but any problem at all gives up and
+    // returns nullptr, leaving the caller to fall back to QXmlStreamReader.
+    PlistTreeItem * invisibleRootNode = PlistTreeItem::Create(_arena, PlistTreeItem::PlistInvisibleRoot);
+    PlistTreeItem * currentContainer = invisibleRootNode;
+    ReaderState state = ReaderExpectingPlistStart;
+    bool isInDict = false;
+    bool isComplete = false;
+
+    QString key;
+    QVector<qint64> containerStarts;     // Offset of the start tag of each open container
+    int tokensUntilProgress = PROGRESS_INTERVAL;
+
+    while( !isComplete )
+    {
+        PlistXmlTokenizer::Token token = tokenizer.readNext();
+
+        if ( _progressCallback && --tokensUntilProgress == 0 )
+        {
+            tokensUntilProgress = PROGRESS_INTERVAL;
+
+            if ( !_progressCallback(tokenizer.tokenBegin(), size) ) {
+                _cancelled = true;
+                break;
+            }
+        }
+
+        if ( token == PlistXmlTokenizer::TokenText || token == PlistXmlTokenizer::TokenCData )
+        {
+            continue;
+        }
+        else if ( token == PlistXmlTokenizer::TokenStartElement || token == PlistXmlTokenizer::TokenEmptyElement )
+        {
+            PlistXmlTokenizer::ElementName elementName = tokenizer.elementName();
+            const bool isEmptyElement = (token == PlistXmlTokenizer::TokenEmptyElement);
+
+            if ( state == ReaderExpectingPlistStart )
+            {
+                if ( elementName != PlistXmlTokenizer::ElementPlist || isEmptyElement ) {
+                    break;
+                }
+
+                state = ReaderExpectingValue;
+            }
+            else if ( state == ReaderExpectingKey )
+            {
+                if ( elementName != PlistXmlTokenizer::ElementKey ) {
+                    break;
+                }
+
+                key = isEmptyElement ? QString() : tokenizer.readElementText();
+                state = ReaderExpectingValue;
+            }
+            else if ( state == ReaderExpectingValue )
+            {
+                PlistTreeItem::PlistType plistType = PlistTypeForElementName(elementName);
+
+                if ( plistType == PlistTreeItem::PlistError ) {
+                    break;
+                }
+
+                PlistTreeItem *item = PlistTreeItem::Create(_arena, plistType, isInDict ? key : QString());
+                currentContainer->aendChild(item);
+
+                // A duplicate or missing key was renamed, so none of the open containers match their bytes any more.
+                if ( isInDict && item->key() != key ) {
+                    containerStarts.fill(-1);
+                }
+
+                if ( PlistTreeItem::IsContainerType(plistType) )
+                {
+                    if ( !isEmptyElement ) {
+                        currentContainer = item;
+                        isInDict = (plistType == PlistTreeItem::PlistDictionary);
+                        containerStarts.append(tokenizer.tokenBegin());
+                    }
+                }
+                else if ( elementName == PlistXmlTokenizer::ElementTrue || elementName == PlistXmlTokenizer::ElementFalse )
+                {
+                    item->setValueRetainType(elementName == PlistXmlTokenizer::ElementTrue);
+
+                    if ( !isEmptyElement ) {
+                        tokenizer.skipCurrentElement();
+                    }
+                }
+                else
+                {
+                    item->setValueRetainType(isEmptyElement ? QString() : tokenizer.readElementText());
+                }
+
+                state = isInDict ? ReaderExpectingKey : ReaderExpectingValue;
+            }
+        }
+        else if ( token == PlistXmlTokenizer::TokenEndElement )
+        {
+            // The container is complete and (unless a key was renamed) untouched, so its source bytes can stand in for it.
+            if ( currentContainer != invisibleRootNode && !containerStarts.isEmpty() )
+            {
+                qint64 begin = containerStarts.takeLast();
+
+                if ( source != nullptr && begin >= 0 ) {
+                    currentContainer->setSourceSpan(source->addSpan(begin, tokenizer.tokenEnd()));
+                }
+            }
+
+            currentContainer = currentContainer->parent();
+
+            // Should occur when we read the last plist tag.
+            if ( currentContainer == nullptr ) {
+                isComplete = true;
+                break;
+            }
+
+            isInDict = (currentContainer->plistType() == PlistTreeItem::PlistDictionary);
+            state = isInDict ? ReaderExpectingKey : ReaderExpectingValue;
+        }
+        else
+        {
+            // End of document too early, malformed or unsupported input.
+            break;
+        }
+
+        if ( tokenizer.token() == PlistXmlTokenizer::TokenError || tokenizer.token() == PlistXmlTokenizer::TokenUnsupported ) {
+            break;
+        }
+    }
+
+    PlistTreeItem *result = isComplete ? invisibleRootNode->takeChildAtIndex(0) : nullptr;
+    delete invisibleRootNode;
+
+    return result;
+}
+
+
 PlistTreeItem * PlistTreeReader::itemFromXmlReader(QXmlStreamReader &xmlReader)
 {
     // Fake root node which we will discard in the result, so we can start
     // the internal loop without worrying about boundary conditions.
-    PlistTreeItem * invisibleRootNode = new PlistTreeItem(PlistTreeItem::PlistInvisibleRoot);
+    PlistTreeItem * invisibleRootNode = PlistTreeItem::Create(_arena, PlistTreeItem::PlistInvisibleRoot);
     PlistTreeItem * currentContainer = invisibleRootNode;
     ReaderState state = ReaderExpectingPlistStart;
     bool isInDict = false;
@@ -46,10 +253,23 @@ PlistTreeItem * PlistTreeReader::itemFromXmlReader(QXmlStreamReader &xmlReader)
     QString key;
     QVariant value;
 
+    QIODevice *device = xmlReader.device();
+    int tokensUntilProgress = PROGRESS_INTERVAL;
+
     while(!xmlReader.atEnd() && !xmlReader.hasError())
     {
         xmlReader.readNext();
 
+        if ( _progressCallback && device != nullptr && --tokensUntilProgress == 0 )
+        {
+            tokensUntilProgress = PROGRESS_INTERVAL;
+
+            if ( !_progressCallback(device->pos(), device->size()) ) {
+                delete invisibleRootNode;
+                return nullptr;
+            }
+        }
+
         if (xmlReader.isStartElement())
         {
             QString elementName(xmlReader.name().toString());
@@ -69,16 +289,14 @@ PlistTreeItem * PlistTreeReader::itemFromXmlReader(QXmlStreamReader &xmlReader)
                 PlistTreeItem::PlistType plistType = plistTypeForElementName(elementName);
 
                 if ( plistType == PlistTreeItem::PlistError ) {
+                    delete invisibleRootNode;
                     return nullptr;
                 }
 
-                PlistTreeItem *item = new PlistTreeItem(plistType);
+                // Give the item its key up front, so the container only has to check it once.
+                PlistTreeItem *item = PlistTreeItem::Create(_arena, plistType, isInDict ? key : QString());
                 currentContainer->aendChild(item);
 
-                if ( isInDict ) {
-                    item->setKey(key);
-                }
-
                 if ( PlistTreeItem::IsContainerType(plistType) )
                 {
                     currentContainer = item;
@@ -90,6 +308,15 @@ PlistTreeItem * PlistTreeReader::itemFromXmlReader(QXmlStreamReader &xmlReader)
                         state = ReaderExpectingValue;
                     }
                 }
+                else if ( elementName.compare("true", Qt::CaseInsensitive) == 0 || elementName.compare("false", Qt::CaseInsensitive) == 0 )
+                {
+                    item->setValueRetainType(elementName.compare("true", Qt::CaseInsensitive) == 0);
+                    xmlReader.skipCurrentElement();
+
+                    if ( isInDict ) {
+                        state = ReaderExpectingKey;
+                    }
+                }
                 else
                 {
                     item->setValueRetainType(xmlReader.readElementText());
@@ -120,7 +347,16 @@ PlistTreeItem * PlistTreeReader::itemFromXmlReader(QXmlStreamReader &xmlReader)
         }
     }
 
-    return invisibleRootNode->child(0);
+    // A truncated or malformed document stops with whatever had been read so far, which is no use to anyone.
+    if ( xmlReader.hasError() ) {
+        delete invisibleRootNode;
+        return nullptr;
+    }
+
+    PlistTreeItem *result = invisibleRootNode->takeChildAtIndex(0);
+    delete invisibleRootNode;
+
+    return result;
 }
 
 
@@ -130,6 +366,8 @@ PlistTreeItem::PlistType PlistTreeReader::plistTypeForElementName(QString &eleme
     if ( elementName.compare("real", Qt::CaseInsensitive) == 0 ) { return PlistTreeItem::PlistReal; }
     if ( elementName.compare("integer", Qt::CaseInsensitive) == 0 ) { return PlistTreeItem::PlistInteger; }
     if ( elementName.compare("boolean", Qt::CaseInsensitive) == 0 ) { return PlistTreeItem::PlistBoolean; }
+    if ( elementName.compare("true", Qt::CaseInsensitive) == 0 ) { return PlistTreeItem::PlistBoolean; }
+    if ( elementName.compare("false", Qt::CaseInsensitive) == 0 ) { return PlistTreeItem::PlistBoolean; }
     if ( elementName.compare("date", Qt::CaseInsensitive) == 0 ) { return PlistTreeItem::PlistDate; }
     if ( elementName.compare("data", Qt::CaseInsensitive) == 0 ) { return PlistTreeItem::PlistData; }
     if ( elementName.compare("array", Qt::CaseInsensitive) == 0 ) { return PlistTreeItem::PlistArray; }
@@ -137,3 +375,24 @@ PlistTreeItem::PlistType PlistTreeReader::plistTypeForElementName(QString &eleme
 
     return PlistTreeItem::PlistError;
 }
+
+
+PlistTreeItem::PlistType PlistTreeReader::PlistTypeForElementName(PlistXmlTokenizer::ElementName elementName)
+{
+    switch( elementName )
+    {
+    case PlistXmlTokenizer::ElementString: return PlistTreeItem::PlistString;
+    case PlistXmlTokenizer::ElementReal: return PlistTreeItem::PlistReal;
+    case PlistXmlTokenizer::ElementInteger: return PlistTreeItem::PlistInteger;
+    case PlistXmlTokenizer::ElementTrue: return PlistTreeItem::PlistBoolean;
+    case PlistXmlTokenizer::ElementFalse: return PlistTreeItem::PlistBoolean;
+    case PlistXmlTokenizer::ElementBoolean: return PlistTreeItem::PlistBoolean;
+    case PlistXmlTokenizer::ElementDate: return PlistTreeItem::PlistDate;
+    case PlistXmlTokenizer::ElementData: return PlistTreeItem::PlistData;
+    case PlistXmlTokenizer::ElementArray: return PlistTreeItem::PlistArray;
+    case PlistXmlTokenizer::ElementDict: return PlistTreeItem::PlistDictionary;
+
+    default:
+        return PlistTreeItem::PlistError;
+    }
+}
@@ -22,13 +22,21 @@
 #define PLISTTREEREADER_H
 
 #include "PlistTreeItem.h"
+#include "PlistXmlTokenizer.h"
+#include "PlistTreeSource.h"
 
 #include <QXmlStreamReader>
 #include <QFile>
 
+#include <functional>
+
 
 /**
  * @brief Class for reading a Plist tree from a string/file.
+ *
+ * Input is read with PlistXmlTokenizer where possible, falling back to QXmlStreamReader
+ * for anything the tokenizer doesn't handle (other encodings, DTD internal subsets and
+ * so on) or can't make sense of.
  */
 class PlistTreeReader
 {   
@@ -41,14 +49,32 @@ public:
 
     PlistTreeReader();
 
+    /** Allocate all items read from now on in the given arena (or on the heap, if nullptr). */
+    void setArena(PlistTreeArena *arena);
+
+    /** Keep the file read by readTreeFromFile in the given source, recording the span of every container. */
+    void setSource(PlistTreeSource *source);
+
+    /** Called periodically with the bytes read so far and the total; return false to cancel the read. */
+    void setProgressCallback(const std::function<bool(qint64, qint64)> &callback);
+
     PlistTreeItem * readTreeFromFile(QString &fileName);
     PlistTreeItem * readTreeFromString(QString &data);
 
+    /** The item type for a tokenized element name, or PlistError if it isn't a value element. */
+    static PlistTreeItem::PlistType PlistTypeForElementName(PlistXmlTokenizer::ElementName elementName);
 
 
 protected:
+    PlistTreeItem * itemFromTokenizer(PlistXmlTokenizer &tokenizer, qint64 size, PlistTreeSource *source);
     PlistTreeItem * itemFromXmlReader(QXmlStreamReader &xmlReader);
     PlistTreeItem::PlistType plistTypeForElementName(QString &elementName);
+
+private:
+    PlistTreeArena *_arena;
+    PlistTreeSource *_source;
+    std::function<bool(qint64, qint64)> _progressCallback;
+    bool _cancelled;
 };
 
 #endif // PLISTTREEREADER_H
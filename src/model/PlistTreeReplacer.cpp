@@ -0,0 +1,223 @@
+#include "PlistTreeReplacer.h"
+
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+
+
+namespace {
+    // Stop splitting this many levels down, even if there still aren't many tasks.
+    const int MAX_SPLIT_DEPTH = 8;
+}
+
+
+PlistTreeReplacer::PlistTreeReplacer(const PlistTextMatcher &matcher, const QString &replace, ReplaceTarget target) : _matcher(matcher)
+{
+    _replace = replace;
+    _target = target;
+}
+
+
+QVector<PlistTreeReplacer::Replacement> PlistTreeReplacer::collect(PlistTreeItem *root) const
+{
+    QVector<Replacement> replacements;
+
+    if ( root == nullptr || !_matcher.isValid() ) {
+        return replacements;
+    }
+
+    // QtConcurrent (in Qt 5) wants functors to say what they return.
+    struct CollectTask {
+        typedef QVector<Replacement> result_type;
+        const PlistTreeReplacer *replacer;
+
+        QVector<Replacement> operator()(const Task &task) const
+        {
+            QVector<Replacement> found;
+            auto visit = [this, &found](PlistTreeItem *item) {
+                Replacement replacement;
+
+                if ( replacer->replacementForItem(item, replacement) ) {
+                    found.append(replacement);
+                }
+            };
+
+            VisitTask(task, visit);
+            return found;
+        }
+    };
+
+    CollectTask collectTask = { this };
+    QVector<QVector<Replacement> > results = QtConcurrent::blockingMapped<QVector<QVector<Replacement> > >(SplitTree(root), collectTask);
+
+    // blockingMapped keeps the tasks' order, which keeps the replacements in document order.
+    for( int i = 0; i < results.count(); ++i ) {
+        replacements += results.at(i);
+    }
+
+    return replacements;
+}
+
+
+int PlistTreeReplacer::countMatches(PlistTreeItem *root) const
+{
+    if ( root == nullptr || !_matcher.isValid() ) {
+        return 0;
+    }
+
+    struct CountTask {
+        typedef int result_type;
+        const PlistTreeReplacer *replacer;
+
+        int operator()(const Task &task) const
+        {
+            int count = 0;
+            auto visit = [this, &count](PlistTreeItem *item) {
+                if ( ItemMatches(item, replacer->_matcher, replacer->_target) ) {
+                    count++;
+                }
+            };
+
+            VisitTask(task, visit);
+            return count;
+        }
+    };
+
+    CountTask countTask = { this };
+    QVector<int> counts = QtConcurrent::blockingMapped<QVector<int> >(SplitTree(root), countTask);
+    int count = 0;
+
+    for( int i = 0; i < counts.count(); ++i ) {
+        count += counts.at(i);
+    }
+
+    return count;
+}
+
+
+bool PlistTreeReplacer::ItemMatches(const PlistTreeItem *item, const PlistTextMatcher &matcher, ReplaceTarget target)
+{
+    if ( target == ReplaceKey || target == ReplaceAll )
+    {
+        const PlistTreeItem *parent = item->parent();
+
+        if ( parent != nullptr && parent->shouldChildrenHaveKey() && matcher.matches(item->key()) ) {
+            return true;
+        }
+    }
+
+    if ( target == ReplaceValue || target == ReplaceAll )
+    {
+        if ( item->plistType() == PlistTreeItem::PlistString && matcher.matches(item->value().string()) ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+//
+// Protected Methods
+//
+
+
+QVector<PlistTreeReplacer::Task> PlistTreeReplacer::SplitTree(PlistTreeItem *root)
+{
+    const int wantedTasks = qMax(QThread::idealThreadCount(), 1) * 4;
+
+    QVector<Task> tasks;
+    Task rootTask = { root, true };
+    tasks.append(rootTask);
+
+    // Replace each whole subtree with its item and its children's subtrees, a level at a
+    // time, which keeps the tasks in document order.
+    for( int depth = 0; depth < MAX_SPLIT_DEPTH && tasks.count() < wantedTasks; ++depth )
+    {
+        QVector<Task> split;
+        bool didSplit = false;
+
+        for( int i = 0; i < tasks.count(); ++i )
+        {
+            const Task &task = tasks.at(i);
+
+            if ( !task.withDescendants || task.item->childCount() == 0 ) {
+                split.append(task);
+                continue;
+            }
+
+            Task itemTask = { task.item, false };
+            split.append(itemTask);
+
+            for( int row = 0; row < task.item->childCount(); ++row ) {
+                Task childTask = { task.item->child(row), true };
+                split.append(childTask);
+            }
+
+            didSplit = true;
+        }
+
+        tasks.swap(split);
+
+        if ( !didSplit ) {
+            break;
+        }
+    }
+
+    return tasks;
+}
+
+
+template <typename Visitor>
+void PlistTreeReplacer::VisitTask(const Task &task, Visitor &visit)
+{
+    if ( !task.withDescendants ) {
+        visit(task.item);
+        return;
+    }
+
+    // An explicit stack, as worker threads have less stack to spare for deep documents.
+    QVector<PlistTreeItem*> stack;
+    stack.append(task.item);
+
+    while( !stack.isEmpty() )
+    {
+        PlistTreeItem *item = stack.takeLast();
+        visit(item);
+
+        for( int row = item->childCount() - 1; row >= 0; --row ) {
+            stack.append(item->child(row));
+        }
+    }
+}
+
+
+bool PlistTreeReplacer::replacementForItem(PlistTreeItem *item, Replacement &replacement) const
+{
+    const PlistTreeItem *parent = item->parent();
+
+    replacement.item = item;
+    replacement.hasKey = false;
+    replacement.hasValue = false;
+
+    if ( (_target == ReplaceKey || _target == ReplaceAll) && parent != nullptr && parent->shouldChildrenHaveKey() )
+    {
+        QString key = item->key();
+
+        if ( _matcher.replace(key, _replace) ) {
+            replacement.key = key;
+            replacement.hasKey = true;
+        }
+    }
+
+    if ( (_target == ReplaceValue || _target == ReplaceAll) && item->plistType() == PlistTreeItem::PlistString )
+    {
+        QString value = item->value().string();
+
+        if ( _matcher.replace(value, _replace) ) {
+            replacement.value = value;
+            replacement.hasValue = true;
+        }
+    }
+
+    return replacement.hasKey || replacement.hasValue;
+}
@@ -0,0 +1,87 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTTREEREPLACER_H
+#define PLISTTREEREPLACER_H
+
+#include "PlistTreeItem.h"
+#include "PlistTextMatcher.h"
+
+#include <QString>
+#include <QVector>
+
+
+/**
+ * @brief The read-only half of a find/replace: works out what would change, on every core, without changing anything.
+ *
+ * The tree is split into independent subtrees which are searched on the global thread pool.
+ * Each one produces the replacements for its items in document order, and the results are
+ * joined back up in the same order, so the caller can apply them (or just count them) in a
+ * single pass on the GUI thread. Nothing may change the tree while collect() or countMatches()
+ * is running; both block until the search has finished.
+ */
+class PlistTreeReplacer
+{
+public:
+    /** The new key and/or value for one item. */
+    struct Replacement {
+        PlistTreeItem *item;
+        bool hasKey;
+        bool hasValue;
+        QString key;
+        QString value;
+    };
+
+    PlistTreeReplacer(const PlistTextMatcher &matcher, const QString &replace, ReplaceTarget target);
+
+    /** Every replacement in root and below it, in document order. */
+    QVector<Replacement> collect(PlistTreeItem *root) const;
+
+    /** How many items in root and below it have a key or value that matches. */
+    int countMatches(PlistTreeItem *root) const;
+
+    /** Does the key or value (as the target says) of the given item match? */
+    static bool ItemMatches(const PlistTreeItem *item, const PlistTextMatcher &matcher, ReplaceTarget target);
+
+
+protected:
+    /** An item on its own, or an item and everything below it. */
+    struct Task {
+        PlistTreeItem *item;
+        bool withDescendants;
+    };
+
+    /** Split the tree into roughly enough tasks to keep every thread busy. */
+    static QVector<Task> SplitTree(PlistTreeItem *root);
+
+    /** Calls visit for each item in a task, in document order. */
+    template <typename Visitor>
+    static void VisitTask(const Task &task, Visitor &visit);
+
+    bool replacementForItem(PlistTreeItem *item, Replacement &replacement) const;
+
+
+private:
+    PlistTextMatcher _matcher;
+    QString _replace;
+    ReplaceTarget _target;
+};
+
+#endif // PLISTTREEREPLACER_H
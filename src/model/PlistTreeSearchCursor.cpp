@@ -0,0 +1,151 @@
+#include "PlistTreeSearchCursor.h"
+#include "PlistTreeReplacer.h"
+
+
+PlistTreeSearchCursor::PlistTreeSearchCursor(PlistTreeItem *root, const FetchFunction &fetch)
+{
+    _root = root;
+    _position = nullptr;
+    _fetch = fetch;
+}
+
+
+void PlistTreeSearchCursor::setPosition(PlistTreeItem *item)
+{
+    _position = item;
+}
+
+
+PlistTreeItem *PlistTreeSearchCursor::position() const
+{
+    return _position;
+}
+
+
+PlistTreeItem *PlistTreeSearchCursor::next()
+{
+    if ( _root == nullptr ) {
+        return nullptr;
+    }
+
+    // Before the start, or at the very end, the next item is the root.
+    if ( _position == nullptr ) {
+        _position = _root;
+        return _position;
+    }
+
+    if ( childCount(_position) > 0 ) {
+        _position = _position->child(0);
+        return _position;
+    }
+
+    // Climb until there's a next sibling to go to.
+    for( PlistTreeItem *item = _position; item != _root; item = item->parent() )
+    {
+        PlistTreeItem *parent = item->parent();
+
+        if ( item->row() + 1 < parent->childCount() ) {
+            _position = parent->child(item->row() + 1);
+            return _position;
+        }
+    }
+
+    _position = _root;
+    return _position;
+}
+
+
+PlistTreeItem *PlistTreeSearchCursor::previous()
+{
+    if ( _root == nullptr ) {
+        return nullptr;
+    }
+
+    if ( _position == nullptr || _position == _root ) {
+        _position = lastDescendant(_root);
+        return _position;
+    }
+
+    PlistTreeItem *parent = _position->parent();
+    const int row = _position->row();
+
+    _position = (row > 0) ? lastDescendant(parent->child(row - 1)) : parent;
+    return _position;
+}
+
+
+PlistTreeItem *PlistTreeSearchCursor::findNext(const PlistTextMatcher &matcher, ReplaceTarget target)
+{
+    return find(matcher, target, false);
+}
+
+
+PlistTreeItem *PlistTreeSearchCursor::findPrevious(const PlistTextMatcher &matcher, ReplaceTarget target)
+{
+    return find(matcher, target, true);
+}
+
+
+//
+// Protected Methods
+//
+
+
+PlistTreeItem *PlistTreeSearchCursor::find(const PlistTextMatcher &matcher, ReplaceTarget target, bool backwards)
+{
+    if ( _root == nullptr || !matcher.isValid() ) {
+        return nullptr;
+    }
+
+    // With no position, a forward search starts at the root and a backward one at the end.
+    PlistTreeItem *original = _position;
+    PlistTreeItem *start = _position;
+    PlistTreeItem *item = backwards ? previous() : next();
+
+    if ( start == nullptr ) {
+        start = item;
+
+        if ( PlistTreeReplacer::ItemMatches(item, matcher, target) ) {
+            return item;
+        }
+
+        item = backwards ? previous() : next();
+    }
+
+    // Once we're back where we started, every item has been looked at, the start last of all.
+    while( true )
+    {
+        if ( PlistTreeReplacer::ItemMatches(item, matcher, target) ) {
+            return item;
+        }
+
+        if ( item == start ) {
+            break;
+        }
+
+        item = backwards ? previous() : next();
+    }
+
+    _position = original;
+    return nullptr;
+}
+
+
+int PlistTreeSearchCursor::childCount(PlistTreeItem *item) const
+{
+    if ( item->hasUnfetchedChildren() && _fetch ) {
+        _fetch(item);
+    }
+
+    return item->childCount();
+}
+
+
+PlistTreeItem *PlistTreeSearchCursor::lastDescendant(PlistTreeItem *item) const
+{
+    while( childCount(item) > 0 ) {
+        item = item->child(item->childCount() - 1);
+    }
+
+    return item;
+}
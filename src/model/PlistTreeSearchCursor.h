@@ -0,0 +1,77 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTTREESEARCHCURSOR_H
+#define PLISTTREESEARCHCURSOR_H
+
+#include "PlistTreeItem.h"
+#include "PlistTextMatcher.h"
+
+#include <functional>
+
+
+/**
+ * @brief A position in a pre-order walk of a tree, which can step or search forwards and backwards from where it left off.
+ *
+ * Each step only looks at the neighbours of the current item (children, siblings via their
+ * row and the parent chain), so walking the whole tree costs about as much as a recursive
+ * traversal, and finding the next match costs nothing for the items that come after it.
+ * Searches wrap around the ends of the tree and stop once they get back to where they started.
+ *
+ * The tree mustn't have items removed between steps unless the position is set again.
+ */
+class PlistTreeSearchCursor
+{
+public:
+    /** Called before the children of an item with unfetched children are looked at, to read them. */
+    typedef std::function<void(PlistTreeItem*)> FetchFunction;
+
+    PlistTreeSearchCursor(PlistTreeItem *root, const FetchFunction &fetch = FetchFunction());
+
+    /** Move to the given item, which should be root or below it. A null item means before the start. */
+    void setPosition(PlistTreeItem *item);
+    PlistTreeItem *position() const;
+
+    /** Step to the next or previous item in document order, wrapping at the ends. Returns the new position. */
+    PlistTreeItem *next();
+    PlistTreeItem *previous();
+
+    /** Step forwards (or backwards) to the next item whose key or value matches, or return nullptr, leaving the position alone, if nothing does. */
+    PlistTreeItem *findNext(const PlistTextMatcher &matcher, ReplaceTarget target);
+    PlistTreeItem *findPrevious(const PlistTextMatcher &matcher, ReplaceTarget target);
+
+
+protected:
+    PlistTreeItem *find(const PlistTextMatcher &matcher, ReplaceTarget target, bool backwards);
+
+    /** The item's children, reading them first if they haven't been. */
+    int childCount(PlistTreeItem *item) const;
+
+    /** The last item in document order below (or at) item. */
+    PlistTreeItem *lastDescendant(PlistTreeItem *item) const;
+
+
+private:
+    PlistTreeItem *_root;
+    PlistTreeItem *_position;
+    FetchFunction _fetch;
+};
+
+#endif // PLISTTREESEARCHCURSOR_H
@@ -0,0 +1,635 @@
+#include "PlistTreeSortModel.h"
+
+#include <algorithm>
+
+
+namespace {
+    // Inserting more rows than this at once appends them and sorts afterwards, rather than placing each one.
+    const int MAX_PLACED_ROWS = 64;
+
+    inline PlistTreeItem *ItemAt(const QModelIndex &index)
+    {
+        return static_cast<PlistTreeItem*>(index.internalPointer());
+    }
+}
+
+
+PlistTreeSortModel::PlistTreeSortModel(QAbstractItemModel *source, QObject *parent) : QAbstractProxyModel(parent)
+{
+    _sortByKey = false;
+    _isPassingThrough = false;
+    _isBulkInserting = false;
+
+    // Natural order, so that 'Item 2' comes before 'Item 10'.
+    _collator.setNumericMode(true);
+    _collator.setCaseSensitivity(Qt::CaseInsensitive);
+
+    setSourceModel(source);
+
+    connect(source, SIGNAL(rowsAboutToBeInserted(QModelIndex,int,int)), this, SLOT(sourceRowsAboutToBeInserted(QModelIndex,int,int)));
+    connect(source, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(sourceRowsInserted(QModelIndex,int,int)));
+    connect(source, SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)), this, SLOT(sourceRowsAboutToBeRemoved(QModelIndex,int,int)));
+    connect(source, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(sourceRowsRemoved(QModelIndex,int,int)));
+    connect(source, SIGNAL(dataChanged(QModelIndex,QModelIndex)), this, SLOT(sourceDataChanged(QModelIndex,QModelIndex)));
+    connect(source, SIGNAL(modelAboutToBeReset()), this, SLOT(sourceAboutToBeReset()));
+    connect(source, SIGNAL(modelReset()), this, SLOT(sourceReset()));
+}
+
+
+PlistTreeSortModel::~PlistTreeSortModel()
+{
+    qDeleteAll(_mappings);
+}
+
+
+void PlistTreeSortModel::setSortByKey(bool sortByKey)
+{
+    if ( sortByKey == _sortByKey ) {
+        return;
+    }
+
+    // Only the dictionaries the view has already asked for are sorted now; the rest wait until it does.
+    relayout([this, sortByKey]() {
+        _sortByKey = sortByKey;
+
+        for( QHash<const void*, Mapping*>::iterator it = _mappings.begin(); it != _mappings.end(); ++it )
+        {
+            Mapping *mapping = it.value();
+            mapping->isSorted = shouldSort(mapping->sourceParent);
+
+            if ( mapping->isSorted ) {
+                sortMapping(mapping);
+            } else {
+                mapping->sourceRows.clear();
+                mapping->proxyRows.clear();
+            }
+        }
+    });
+}
+
+
+bool PlistTreeSortModel::sortByKey() const
+{
+    return _sortByKey;
+}
+
+
+//
+// Proxy Methods
+//
+
+
+QModelIndex PlistTreeSortModel::mapToSource(const QModelIndex &proxyIndex) const
+{
+    if ( !proxyIndex.isValid() ) {
+        return QModelIndex();
+    }
+
+    const Mapping *mapping = static_cast<const Mapping*>(proxyIndex.internalPointer());
+    const int sourceRow = mapping->isSorted ? mapping->sourceRows.value(proxyIndex.row(), -1) : proxyIndex.row();
+
+    return sourceModel()->index(sourceRow, proxyIndex.column(), mapping->sourceParent);
+}
+
+
+QModelIndex PlistTreeSortModel::mapFromSource(const QModelIndex &sourceIndex) const
+{
+    if ( !sourceIndex.isValid() ) {
+        return QModelIndex();
+    }
+
+    Mapping *mapping = mappingFor(sourceIndex.parent());
+    const int proxyRow = mapping->isSorted ? mapping->proxyRows.value(sourceIndex.row(), -1) : sourceIndex.row();
+
+    return (proxyRow >= 0) ? createIndex(proxyRow, sourceIndex.column(), mapping) : QModelIndex();
+}
+
+
+QModelIndex PlistTreeSortModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if ( row < 0 || column < 0 || row >= rowCount(parent) || column >= columnCount(parent) ) {
+        return QModelIndex();
+    }
+
+    return createIndex(row, column, mappingFor(mapToSource(parent)));
+}
+
+
+QModelIndex PlistTreeSortModel::parent(const QModelIndex &child) const
+{
+    if ( !child.isValid() ) {
+        return QModelIndex();
+    }
+
+    const Mapping *mapping = static_cast<const Mapping*>(child.internalPointer());
+    return mapFromSource(mapping->sourceParent);
+}
+
+
+int PlistTreeSortModel::rowCount(const QModelIndex &parent) const
+{
+    if ( parent.column() > 0 ) {
+        return 0;
+    }
+
+    QModelIndex sourceParent = mapToSource(parent);
+    const Mapping *mapping = findMapping(sourceParent);
+
+    // A sorted dictionary only has the rows it has been told about, which matters while they're being placed one by one.
+    if ( mapping != nullptr && mapping->isSorted ) {
+        return mapping->sourceRows.count();
+    }
+
+    return sourceModel()->rowCount(sourceParent);
+}
+
+
+int PlistTreeSortModel::columnCount(const QModelIndex &parent) const
+{
+    return sourceModel()->columnCount(mapToSource(parent));
+}
+
+
+bool PlistTreeSortModel::hasChildren(const QModelIndex &parent) const
+{
+    return sourceModel()->hasChildren(mapToSource(parent));
+}
+
+
+bool PlistTreeSortModel::canFetchMore(const QModelIndex &parent) const
+{
+    return sourceModel()->canFetchMore(mapToSource(parent));
+}
+
+
+void PlistTreeSortModel::fetchMore(const QModelIndex &parent)
+{
+    sourceModel()->fetchMore(mapToSource(parent));
+}
+
+
+QVariant PlistTreeSortModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    return sourceModel()->headerData(section, orientation, role);
+}
+
+
+bool PlistTreeSortModel::insertRows(int row, int count, const QModelIndex &parent)
+{
+    QModelIndex sourceParent = mapToSource(parent);
+    const Mapping *mapping = findMapping(sourceParent);
+    int sourceRow = row;
+
+    if ( mapping != nullptr && mapping->isSorted ) {
+        sourceRow = (row < mapping->sourceRows.count()) ? mapping->sourceRows.at(row) : sourceModel()->rowCount(sourceParent);
+    }
+
+    return sourceModel()->insertRows(sourceRow, count, sourceParent);
+}
+
+
+bool PlistTreeSortModel::removeRows(int row, int count, const QModelIndex &parent)
+{
+    QModelIndex sourceParent = mapToSource(parent);
+    const Mapping *mapping = findMapping(sourceParent);
+
+    if ( mapping == nullptr || !mapping->isSorted ) {
+        return sourceModel()->removeRows(row, count, sourceParent);
+    }
+
+    if ( row < 0 || count < 0 || row + count > mapping->sourceRows.count() ) {
+        return false;
+    }
+
+    // Neighbours here needn't be neighbours in the source, so they go one at a time, from the bottom up.
+    QVector<int> sourceRows = mapping->sourceRows.mid(row, count);
+    std::sort(sourceRows.begin(), sourceRows.end());
+    bool didRemove = true;
+
+    for( int i = sourceRows.count() - 1; i >= 0; --i ) {
+        didRemove = sourceModel()->removeRows(sourceRows.at(i), 1, sourceParent) && didRemove;
+    }
+
+    return didRemove;
+}
+
+
+//
+// Protected Slots
+//
+
+
+void PlistTreeSortModel::sourceRowsAboutToBeInserted(const QModelIndex &parent, int first, int last)
+{
+    Mapping *mapping = findMapping(parent);
+
+    // Rows which aren't sorted yet pass straight through, as the view may still have counted them.
+    if ( mapping == nullptr || !mapping->isSorted )
+    {
+        if ( mapping != nullptr || isIndexed(parent) ) {
+            beginInsertRows(mapFromSource(parent), first, last);
+            _isPassingThrough = true;
+        }
+
+        return;
+    }
+
+    // Lots of rows (such as a dictionary being read in) go on the end for now, and are sorted once they're all there.
+    if ( last - first + 1 > MAX_PLACED_ROWS ) {
+        const int count = mapping->sourceRows.count();
+        beginInsertRows(mapFromSource(parent), count, count + last - first);
+        _isBulkInserting = true;
+    }
+}
+
+
+void PlistTreeSortModel::sourceRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    Mapping *mapping = findMapping(parent);
+
+    if ( _isPassingThrough ) {
+        _isPassingThrough = false;
+
+        if ( mapping != nullptr ) {
+            mapping->keys.clear();
+        }
+
+        endInsertRows();
+        return;
+    }
+
+    if ( mapping == nullptr || !mapping->isSorted ) {
+        return;
+    }
+
+    const int count = last - first + 1;
+
+    // Rows after the new ones have moved down in the source.
+    for( int i = 0; i < mapping->sourceRows.count(); ++i )
+    {
+        if ( mapping->sourceRows.at(i) >= first ) {
+            mapping->sourceRows[i] += count;
+        }
+    }
+
+    for( int row = first; row <= last; ++row ) {
+        mapping->keys.insert(mapping->keys.begin() + row, sortKeyForRow(mapping, row));
+    }
+
+    // The new rows aren't anywhere yet.
+    mapping->proxyRows.fill(-1, mapping->proxyRows.count() + count);
+    renumberMapping(mapping);
+
+    if ( _isBulkInserting )
+    {
+        _isBulkInserting = false;
+
+        const int from = mapping->sourceRows.count();
+
+        for( int row = first; row <= last; ++row ) {
+            mapping->sourceRows.append(row);
+        }
+
+        renumberMapping(mapping, from);
+        endInsertRows();
+
+        relayout([this, mapping]() {
+            sortMapping(mapping);
+        });
+
+        return;
+    }
+
+    QModelIndex proxyParent = mapFromSource(parent);
+
+    for( int row = first; row <= last; ++row )
+    {
+        const int position = sortedPosition(mapping, row);
+
+        beginInsertRows(proxyParent, position, position);
+        mapping->sourceRows.insert(position, row);
+        renumberMapping(mapping, position);
+        endInsertRows();
+    }
+}
+
+
+void PlistTreeSortModel::sourceRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+    Mapping *mapping = findMapping(parent);
+
+    if ( mapping == nullptr || !mapping->isSorted )
+    {
+        if ( mapping != nullptr || isIndexed(parent) ) {
+            beginRemoveRows(mapFromSource(parent), first, last);
+            _isPassingThrough = true;
+        }
+
+        return;
+    }
+
+    // The rows going are scattered through the sorted order, so each run of them goes separately, from the bottom up.
+    QVector<int> proxyRows;
+
+    for( int row = first; row <= last; ++row ) {
+        proxyRows.append(mapping->proxyRows.at(row));
+    }
+
+    std::sort(proxyRows.begin(), proxyRows.end());
+
+    QModelIndex proxyParent = mapFromSource(parent);
+    int end = proxyRows.count() - 1;
+
+    while( end >= 0 )
+    {
+        int start = end;
+
+        while( start > 0 && proxyRows.at(start - 1) == proxyRows.at(start) - 1 ) {
+            start--;
+        }
+
+        beginRemoveRows(proxyParent, proxyRows.at(start), proxyRows.at(end));
+        mapping->sourceRows.remove(proxyRows.at(start), end - start + 1);
+        renumberMapping(mapping, proxyRows.at(start));
+        endRemoveRows();
+
+        end = start - 1;
+    }
+}
+
+
+void PlistTreeSortModel::sourceRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if ( _isPassingThrough ) {
+        _isPassingThrough = false;
+        endRemoveRows();
+    }
+
+    Mapping *mapping = findMapping(parent);
+
+    if ( mapping != nullptr )
+    {
+        if ( mapping->isSorted )
+        {
+            const int count = last - first + 1;
+
+            for( int i = 0; i < mapping->sourceRows.count(); ++i )
+            {
+                if ( mapping->sourceRows.at(i) > last ) {
+                    mapping->sourceRows[i] -= count;
+                }
+            }
+
+            mapping->keys.erase(mapping->keys.begin() + first, mapping->keys.begin() + last + 1);
+            mapping->proxyRows.resize(mapping->proxyRows.count() - count);
+            renumberMapping(mapping);
+        }
+        else
+        {
+            mapping->keys.clear();
+        }
+    }
+
+    // Mappings for anything below the rows that went are no use now, and their items may be reused.
+    for( QHash<const void*, Mapping*>::iterator it = _mappings.begin(); it != _mappings.end(); )
+    {
+        if ( it.key() != nullptr && !it.value()->sourceParent.isValid() ) {
+            delete it.value();
+            it = _mappings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+
+void PlistTreeSortModel::sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if ( !topLeft.isValid() || !bottomRight.isValid() ) {
+        return;
+    }
+
+    QModelIndex sourceParent = topLeft.parent();
+    Mapping *mapping = findMapping(sourceParent);
+
+    if ( mapping == nullptr ) {
+        return;
+    }
+
+    const bool keyChanged = (topLeft.column() <= PlistTreeItem::COLUMN_KEY);
+    const bool typeChanged = (topLeft.column() <= PlistTreeItem::COLUMN_TYPE && bottomRight.column() >= PlistTreeItem::COLUMN_TYPE);
+    QModelIndex proxyParent = mapFromSource(sourceParent);
+
+    for( int row = topLeft.row(); row <= bottomRight.row(); ++row )
+    {
+        // A dictionary that became an array (or the other way round) needs its children put in order again.
+        if ( typeChanged )
+        {
+            Mapping *childMapping = findMapping(sourceModel()->index(row, 0, sourceParent));
+
+            // Converting can also throw the children away without saying so, and then nothing here can be trusted.
+            if ( childMapping != nullptr && childMapping->isSorted && childMapping->sourceRows.count() != sourceModel()->rowCount(childMapping->sourceParent) )
+            {
+                beginResetModel();
+                qDeleteAll(_mappings);
+                _mappings.clear();
+                endResetModel();
+                return;
+            }
+
+            if ( childMapping != nullptr && childMapping->isSorted != shouldSort(childMapping->sourceParent) )
+            {
+                relayout([this, childMapping]() {
+                    childMapping->isSorted = shouldSort(childMapping->sourceParent);
+                    childMapping->sourceRows.clear();
+                    childMapping->proxyRows.clear();
+                    childMapping->keys.clear();
+
+                    if ( childMapping->isSorted ) {
+                        sortMapping(childMapping);
+                    }
+                });
+            }
+        }
+
+        // A new key moves just this row to where it now belongs.
+        if ( mapping->isSorted && keyChanged )
+        {
+            mapping->keys[row] = sortKeyForRow(mapping, row);
+
+            const int from = mapping->proxyRows.at(row);
+            mapping->sourceRows.remove(from);
+            const int to = sortedPosition(mapping, row);
+            mapping->sourceRows.insert(from, row);
+
+            if ( to != from && beginMoveRows(proxyParent, from, from, proxyParent, (to > from) ? to + 1 : to) )
+            {
+                mapping->sourceRows.remove(from);
+                mapping->sourceRows.insert(to, row);
+                renumberMapping(mapping, qMin(from, to), qMax(from, to));
+                endMoveRows();
+            }
+        }
+
+        // Keys kept from when sorting was on need to stay right for when it's on again.
+        if ( !mapping->isSorted && keyChanged && row < static_cast<int>(mapping->keys.size()) ) {
+            mapping->keys[row] = sortKeyForRow(mapping, row);
+        }
+
+        const int proxyRow = mapping->isSorted ? mapping->proxyRows.at(row) : row;
+        emit dataChanged(index(proxyRow, topLeft.column(), proxyParent), index(proxyRow, bottomRight.column(), proxyParent));
+    }
+}
+
+
+void PlistTreeSortModel::sourceAboutToBeReset()
+{
+    beginResetModel();
+}
+
+
+void PlistTreeSortModel::sourceReset()
+{
+    qDeleteAll(_mappings);
+    _mappings.clear();
+    endResetModel();
+}
+
+
+//
+// Protected Methods
+//
+
+
+PlistTreeSortModel::Mapping *PlistTreeSortModel::mappingFor(const QModelIndex &sourceParent) const
+{
+    Mapping *mapping = findMapping(sourceParent);
+
+    if ( mapping != nullptr ) {
+        return mapping;
+    }
+
+    mapping = new Mapping();
+    mapping->sourceParent = sourceParent;
+    mapping->isSorted = shouldSort(sourceParent);
+
+    if ( mapping->isSorted ) {
+        sortMapping(mapping);
+    }
+
+    _mappings.insert(sourceParent.internalPointer(), mapping);
+    return mapping;
+}
+
+
+PlistTreeSortModel::Mapping *PlistTreeSortModel::findMapping(const QModelIndex &sourceParent) const
+{
+    return _mappings.value(sourceParent.isValid() ? sourceParent.internalPointer() : nullptr, nullptr);
+}
+
+
+bool PlistTreeSortModel::isIndexed(const QModelIndex &sourceParent) const
+{
+    // Making an index for a row makes the mapping for its siblings, so without one the view can't have asked about it.
+    return !sourceParent.isValid() || findMapping(sourceParent.parent()) != nullptr;
+}
+
+
+void PlistTreeSortModel::sortMapping(Mapping *mapping) const
+{
+    const int count = sourceModel()->rowCount(mapping->sourceParent);
+
+    // Collation keys are the expensive part, so they're only worked out once.
+    if ( static_cast<int>(mapping->keys.size()) != count )
+    {
+        mapping->keys.clear();
+        mapping->keys.reserve(count);
+
+        for( int row = 0; row < count; ++row ) {
+            mapping->keys.push_back(sortKeyForRow(mapping, row));
+        }
+    }
+
+    mapping->sourceRows.resize(count);
+
+    for( int row = 0; row < count; ++row ) {
+        mapping->sourceRows[row] = row;
+    }
+
+    std::sort(mapping->sourceRows.begin(), mapping->sourceRows.end(), [this, mapping](int a, int b) {
+        return isBefore(mapping, a, b);
+    });
+
+    mapping->proxyRows.resize(count);
+    renumberMapping(mapping);
+}
+
+
+void PlistTreeSortModel::renumberMapping(Mapping *mapping, int from, int to) const
+{
+    if ( to < 0 || to >= mapping->sourceRows.count() ) {
+        to = mapping->sourceRows.count() - 1;
+    }
+
+    for( int row = from; row <= to; ++row ) {
+        mapping->proxyRows[mapping->sourceRows.at(row)] = row;
+    }
+}
+
+
+bool PlistTreeSortModel::isBefore(const Mapping *mapping, int sourceRow, int otherSourceRow) const
+{
+    const int order = mapping->keys.at(sourceRow).compare(mapping->keys.at(otherSourceRow));
+
+    // Keys that collate the same (differing only in case, say) stay in file order.
+    return (order != 0) ? (order < 0) : (sourceRow < otherSourceRow);
+}
+
+
+int PlistTreeSortModel::sortedPosition(const Mapping *mapping, int sourceRow) const
+{
+    QVector<int>::const_iterator it = std::lower_bound(mapping->sourceRows.constBegin(), mapping->sourceRows.constEnd(), sourceRow, [this, mapping](int a, int b) {
+        return isBefore(mapping, a, b);
+    });
+
+    return static_cast<int>(it - mapping->sourceRows.constBegin());
+}
+
+
+QCollatorSortKey PlistTreeSortModel::sortKeyForRow(const Mapping *mapping, int sourceRow) const
+{
+    const PlistTreeItem *item = ItemAt(sourceModel()->index(sourceRow, 0, mapping->sourceParent));
+    return _collator.sortKey(item != nullptr ? item->key() : QString());
+}
+
+
+bool PlistTreeSortModel::shouldSort(const QModelIndex &sourceParent) const
+{
+    const PlistTreeItem *item = ItemAt(sourceParent);
+    return _sortByKey && item != nullptr && item->shouldChildrenHaveKey();
+}
+
+
+void PlistTreeSortModel::relayout(const std::function<void()> &change)
+{
+    emit layoutAboutToBeChanged();
+
+    // Remember which source rows the persistent indexes (expanded and selected rows) are on.
+    QModelIndexList proxyIndexes = persistentIndexList();
+    QList<QPersistentModelIndex> sourceIndexes;
+
+    for( int i = 0; i < proxyIndexes.count(); ++i ) {
+        sourceIndexes.append(mapToSource(proxyIndexes.at(i)));
+    }
+
+    change();
+
+    QModelIndexList newIndexes;
+
+    for( int i = 0; i < sourceIndexes.count(); ++i ) {
+        newIndexes.append(mapFromSource(sourceIndexes.at(i)));
+    }
+
+    changePersistentIndexList(proxyIndexes, newIndexes);
+    emit layoutChanged();
+}
@@ -0,0 +1,134 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTTREESORTMODEL_H
+#define PLISTTREESORTMODEL_H
+
+#include <QAbstractProxyModel>
+#include <QCollator>
+#include <QCollatorSortKey>
+#include <QHash>
+#include <QPersistentModelIndex>
+#include <QVector>
+#include <functional>
+#include <vector>
+
+#include "PlistTreeItem.h"
+
+
+/**
+ * @brief A proxy which can show the children of every dictionary sorted by key, leaving arrays in order.
+ *
+ * The source can be a PlistTreeModel or a proxy on top of one (such as PlistTreeFilterModel), as
+ * long as its indexes point at PlistTreeItems. Each dictionary is only sorted once the view asks
+ * for its rows, using collation keys which are worked out once per key and kept for as long as
+ * the dictionary is around, so turning sorting off and on again doesn't recompute them. Adding,
+ * removing or renaming a key moves just that row to its place, rather than sorting again.
+ */
+class PlistTreeSortModel : public QAbstractProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit PlistTreeSortModel(QAbstractItemModel *source, QObject *parent = 0);
+    ~PlistTreeSortModel();
+
+    /** Sort dictionary children by key (in natural order and ignoring case), or show them in file order. */
+    void setSortByKey(bool sortByKey);
+    bool sortByKey() const;
+
+    //
+    // Proxy Methods
+    //
+
+    QModelIndex mapToSource(const QModelIndex &proxyIndex) const;
+    QModelIndex mapFromSource(const QModelIndex &sourceIndex) const;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
+    QModelIndex parent(const QModelIndex &child) const;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const;
+    bool canFetchMore(const QModelIndex &parent) const;
+    void fetchMore(const QModelIndex &parent);
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+    /** New rows go wherever their keys sort to, so in a sorted dictionary the row only says which source row to insert before. */
+    bool insertRows(int row, int count, const QModelIndex &parent = QModelIndex());
+    bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex());
+
+
+protected slots:
+    void sourceRowsAboutToBeInserted(const QModelIndex &parent, int first, int last);
+    void sourceRowsInserted(const QModelIndex &parent, int first, int last);
+    void sourceRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+    void sourceRowsRemoved(const QModelIndex &parent, int first, int last);
+    void sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void sourceAboutToBeReset();
+    void sourceReset();
+
+
+protected:
+    /** How the children of one source parent are ordered. */
+    struct Mapping {
+        QPersistentModelIndex sourceParent;
+        bool isSorted;
+        QVector<int> sourceRows;                // Proxy row -> source row, when sorted
+        QVector<int> proxyRows;                 // Source row -> proxy row, when sorted
+        std::vector<QCollatorSortKey> keys;     // By source row, or empty if not worked out
+    };
+
+    /** The mapping for the children of a source parent, made (and sorted, if need be) the first time it's asked for. */
+    Mapping *mappingFor(const QModelIndex &sourceParent) const;
+
+    /** The existing mapping for the children of a source parent, or nullptr. */
+    Mapping *findMapping(const QModelIndex &sourceParent) const;
+
+    /** Could the view have an index for this source parent, and so have asked how many rows it has? */
+    bool isIndexed(const QModelIndex &sourceParent) const;
+
+    /** Put the rows in key order, working out any keys that are missing. */
+    void sortMapping(Mapping *mapping) const;
+
+    /** Rebuild proxyRows for proxy rows [from, to]. */
+    void renumberMapping(Mapping *mapping, int from = 0, int to = -1) const;
+
+    /** Does the given source row sort before the other? */
+    bool isBefore(const Mapping *mapping, int sourceRow, int otherSourceRow) const;
+
+    /** The proxy row at which the given source row belongs, among the rows there now. */
+    int sortedPosition(const Mapping *mapping, int sourceRow) const;
+
+    QCollatorSortKey sortKeyForRow(const Mapping *mapping, int sourceRow) const;
+    bool shouldSort(const QModelIndex &sourceParent) const;
+
+    /** Make a change to the order of rows (but not how many there are), keeping persistent indexes on the same items. */
+    void relayout(const std::function<void()> &change);
+
+
+private:
+    bool _sortByKey;
+    QCollator _collator;
+    mutable QHash<const void*, Mapping*> _mappings;     // By the source parent's item (nullptr for the top level)
+    bool _isPassingThrough;                             // Rows being inserted or removed in an unsorted parent
+    bool _isBulkInserting;                              // Rows being appended, to be sorted once they're in
+};
+
+#endif // PLISTTREESORTMODEL_H
@@ -0,0 +1,83 @@
+#include "PlistTreeSource.h"
+
+
+PlistTreeSource::PlistTreeSource()
+{
+    _data = nullptr;
+    _size = 0;
+    _isMapped = false;
+}
+
+
+PlistTreeSource::~PlistTreeSource()
+{
+    if ( _isMapped ) {
+        _file.unmap(reinterpret_cast<uchar*>(const_cast<char*>(_data)));
+    }
+
+    _file.close();
+}
+
+
+bool PlistTreeSource::open(const QString &fileName)
+{
+    if ( _data != nullptr || fileName.isEmpty() ) {
+        return false;
+    }
+
+    _file.setFileName(fileName);
+
+    if ( !_file.open(QIODevice::ReadOnly) || _file.size() == 0 ) {
+        return false;
+    }
+
+#if defined(Q_OS_WIN)
+    _contents = _file.readAll();
+    _file.close();
+
+    if ( _contents.isEmpty() ) {
+        return false;
+    }
+
+    _data = _contents.constData();
+    _size = _contents.size();
+#else
+    _size = _file.size();
+    _data = reinterpret_cast<const char*>(_file.map(0, _size));
+    _isMapped = (_data != nullptr);
+
+    if ( _data == nullptr ) {
+        _size = 0;
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+
+int PlistTreeSource::addSpan(qint64 begin, qint64 end)
+{
+    Span span = { begin, end };
+    QMutexLocker locker(&_spansMutex);
+    _spans.append(span);
+    return _spans.count() - 1;
+}
+
+
+QByteArray PlistTreeSource::span(int index) const
+{
+    QMutexLocker locker(&_spansMutex);
+
+    if ( _data == nullptr || index < 0 || index >= _spans.count() ) {
+        return QByteArray();
+    }
+
+    const Span span = _spans.at(index);
+
+    if ( span.begin < 0 || span.end > _size || span.end <= span.begin ) {
+        return QByteArray();
+    }
+
+    return QByteArray::fromRawData(_data + span.begin, static_cast<int>(span.end - span.begin));
+}
@@ -0,0 +1,78 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTTREESOURCE_H
+#define PLISTTREESOURCE_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QVector>
+#include <QMutex>
+
+
+/**
+ * @brief The original bytes of an XML Plist file, kept around after it has been read.
+ *
+ * Readers record the byte span of each container element here, and the item remembers
+ * the span's index. When saving, PlistTreeWriter copies the spans of containers which
+ * haven't been edited straight from the source instead of serializing them again.
+ *
+ * The file is memory mapped, except on Windows where a mapped file can't be replaced,
+ * which would stop QSaveFile from saving over it; there it is read into memory instead.
+ *
+ * Spans can be added and looked up from more than one thread, so that the rest of a
+ * lazily read file can be read on a worker while the GUI thread goes on using it.
+ */
+class PlistTreeSource
+{
+public:
+    PlistTreeSource();
+    ~PlistTreeSource();
+
+    /** Load the given file. Only call this once. */
+    bool open(const QString &fileName);
+
+    /** The file's contents, or nullptr if it isn't open. */
+    const char *data() const { return _data; }
+    qint64 size() const { return _size; }
+
+    /** Record the span [begin, end) of an element and return its index. */
+    int addSpan(qint64 begin, qint64 end);
+
+    /** The bytes of a recorded span, without copying them. Empty if the index is invalid. */
+    QByteArray span(int index) const;
+
+
+private:
+    struct Span {
+        qint64 begin;
+        qint64 end;
+    };
+
+    QFile _file;
+    QByteArray _contents;               // Used instead of a mapping on Windows
+    const char *_data;
+    qint64 _size;
+    bool _isMapped;
+    QVector<Span> _spans;
+    mutable QMutex _spansMutex;         // Guards _spans
+};
+
+#endif // PLISTTREESOURCE_H
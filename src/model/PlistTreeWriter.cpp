@@ -1,9 +1,49 @@
 #include "PlistTreeWriter.h"
 
+#include <QThread>
+#include <QFuture>
+#include <QQueue>
+#include <QtConcurrent/QtConcurrentRun>
+
+
+namespace {
+    // Output is handed to the device in blocks of roughly this size.
+    const int FLUSH_THRESHOLD = 4 << 20;
+
+    // Documents with fewer items than this aren't worth splitting across threads.
+    const qint64 PARALLEL_THRESHOLD = 50000;
+
+    qint64 CountItems(const PlistTreeItem *node)
+    {
+        qint64 count = 1;
+
+        for( int i = 0; i < node->childCount(); ++i ) {
+            count += CountItems(node->child(i));
+        }
+
+        return count;
+    }
+}
+
 
 PlistTreeWriter::PlistTreeWriter()
 {
+    _device = nullptr;
+    _source = nullptr;
+    _compact = false;
+    _writeFailed = false;
+}
+
+
+void PlistTreeWriter::setSource(const PlistTreeSource *source)
+{
+    _source = source;
+}
+
 
+void PlistTreeWriter::setCompact(bool compact)
+{
+    _compact = compact;
 }
 
 
@@ -13,12 +53,19 @@ bool PlistTreeWriter::writeTreeToFile(PlistTreeItem *rootNode, QString &fileName
         return false;
     }
 
-    QFile *file = new QFile(fileName);
-    bool result = writeTreeToIODevice(rootNode, file);
-    file->close();
-    delete file;
+    // The original file is only replaced once everything has been written.
+    QSaveFile file(fileName);
 
-    return result;
+    if ( !file.open(QIODevice::WriteOnly) ) {
+        return false;
+    }
+
+    if ( !writeTree(rootNode, &file) ) {
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
 }
 
 
@@ -28,10 +75,11 @@ bool PlistTreeWriter::writeTreeToIODevice(PlistTreeItem *rootNode, QIODevice *de
         return false;
     }
 
-    device->open(QIODevice::WriteOnly | QIODevice::Text);
+    if ( !device->isOpen() && !device->open(QIODevice::WriteOnly | QIODevice::Text) ) {
+        return false;
+    }
 
-    QXmlStreamWriter xmlWriter(device);
-    bool result = writeToXmlStreamWriter(rootNode, xmlWriter);
+    bool result = writeTree(rootNode, device);
 
     device->close();
     return result;
@@ -44,10 +92,31 @@ bool PlistTreeWriter::writeTreeToString(PlistTreeItem *rootNode, QString *string
         return false;
     }
 
-    QXmlStreamWriter xmlWriter(string);
-    bool result = writeToXmlStreamWriter(rootNode, xmlWriter);
+    QByteArray buffer;
 
-    return result;
+    if ( !writeTreeToBuffer(rootNode, &buffer) ) {
+        return false;
+    }
+
+    *string = QString::fromUtf8(buffer);
+    return true;
+}
+
+
+bool PlistTreeWriter::writeTreeToBuffer(PlistTreeItem *rootNode, QByteArray *buffer)
+{
+    if ( rootNode == nullptr || buffer == nullptr ) {
+        return false;
+    }
+
+    _device = nullptr;
+    _writeFailed = false;
+
+    PlistXmlEmitter emitter(buffer);
+    emitter.setCompact(_compact);
+    writeDocument(rootNode, emitter);
+
+    return !_writeFailed;
 }
 
 
@@ -56,71 +125,246 @@ bool PlistTreeWriter::writeTreeToString(PlistTreeItem *rootNode, QString *string
 //
 
 
-bool PlistTreeWriter::writeToXmlStreamWriter(PlistTreeItem *rootNode, QXmlStreamWriter &xmlWriter)
+bool PlistTreeWriter::writeTree(PlistTreeItem *rootNode, QIODevice *device)
 {
-    xmlWriter.setAutoFormatting(true);
-    xmlWriter.writeStartDocument("1.0");
+    _device = device;
+    _writeFailed = false;
 
-    xmlWriter.writeDTD("<!DOCTYPE plist PUBLIC \"-//Ale//DTD PLIST 1.0//EN\" \"http://www.ale.com/DTDs/PropertyList-1.0.dtd\">");
-    xmlWriter.writeStartElement("plist");
-    xmlWriter.writeAttribute("version", "1.0");
+    // Reserve once; flush() empties the buffer without giving the memory back.
+    _buffer.reserve(FLUSH_THRESHOLD + FLUSH_THRESHOLD / 4);
+    _buffer.resize(0);
 
-    writeNode(rootNode, xmlWriter, true);
+    PlistXmlEmitter emitter(&_buffer);
+    emitter.setCompact(_compact);
+    writeDocument(rootNode, emitter);
+    flush();
 
-    xmlWriter.writeEndElement();    // Plist
-    xmlWriter.writeEndDocument();
+    _device = nullptr;
+    return !_writeFailed;
+}
 
-    return true;
+
+void PlistTreeWriter::writeDocument(PlistTreeItem *rootNode, PlistXmlEmitter &emitter)
+{
+    emitter.writeStartDocument();
+
+    if ( !writeRootInParallel(rootNode, emitter) ) {
+        writeNode(rootNode, emitter, 1, true);
+    }
+
+    emitter.writeEndDocument();
 }
 
 
-bool PlistTreeWriter::writeNode(PlistTreeItem *node, QXmlStreamWriter &xmlWriter, bool isRootNode = false)
+bool PlistTreeWriter::writeRootInParallel(PlistTreeItem *rootNode, PlistXmlEmitter &emitter)
 {
-    if ( node == nullptr || xmlWriter.hasError() ) {
+    const int threadCount = QThread::idealThreadCount();
+
+    if ( threadCount < 2 || rootNode->childCount() < 2 || !PlistTreeItem::IsContainerType(rootNode->plistType()) ) {
+        return false;
+    }
+
+    // An unmodified root is a single copy, which threads won't speed up.
+    if ( _source != nullptr && !rootNode->isDirty() && rootNode->sourceSpan() >= 0 ) {
         return false;
     }
 
+    QVector<qint64> childItems(rootNode->childCount());
+    qint64 totalItems = 0;
+
+    for( int i = 0; i < rootNode->childCount(); ++i ) {
+        childItems[i] = CountItems(rootNode->child(i));
+        totalItems += childItems[i];
+    }
+
+    if ( totalItems < PARALLEL_THRESHOLD ) {
+        return false;
+    }
+
+    // A few chunks per thread evens out uneven subtrees; a bounded number in flight
+    // keeps memory use to a handful of chunk buffers rather than the whole document.
+    const qint64 chunkItems = qMax<qint64>(totalItems / (threadCount * 4), 1);
+    const int maxInFlight = threadCount * 2;
+    const char *elementName = elementNameForItem(rootNode);
+
+    QQueue<QFuture<QByteArray> > inFlight;
+    int first = 0;
+
+    emitter.writeStartElement(elementName, 1);
+
+    while( first < rootNode->childCount() )
+    {
+        int last = first;
+        qint64 items = 0;
+
+        while( last < rootNode->childCount() && (items < chunkItems || last == first) ) {
+            items += childItems.at(last++);
+        }
+
+        inFlight.enqueue(QtConcurrent::run(&PlistTreeWriter::SerializeChildren, rootNode, first, last, 2, _source, _compact));
+        first = last;
+
+        if ( inFlight.count() >= maxInFlight ) {
+            writeChunk(inFlight.dequeue().result(), emitter);
+        }
+    }
+
+    while( !inFlight.isEmpty() ) {
+        writeChunk(inFlight.dequeue().result(), emitter);
+    }
+
+    emitter.writeEndElement(elementName, 1);
+    return true;
+}
+
+
+void PlistTreeWriter::writeNode(PlistTreeItem *node, PlistXmlEmitter &emitter, int depth, bool isRootNode)
+{
+    if ( node == nullptr || _writeFailed ) {
+        return;
+    }
+
     // If this node has a valid parent, and the parent is a dictionary, we need to put out a <key>NAME</key> element.
     if ( !isRootNode && node->parent() != nullptr && node->parent()->plistType() == PlistTreeItem::PlistDictionary ) {
-        xmlWriter.writeTextElement("key", node->key());
+        emitter.writeStringElement("key", node->key(), depth);
     }
 
     // Now output the content of this node
-    QString elementName = elementNameForItem(node);
+    const PlistValue &value = node->value();
 
-    if ( PlistTreeItem::IsContainerType(node->plistType()) )
+    switch( node->plistType() )
     {
-        xmlWriter.writeStartElement(elementName);
-
-        for( int i = 0; i < node->childCount(); i++ ) {
-            writeNode(node->child(i), xmlWriter);
+    case PlistTreeItem::PlistArray:
+    case PlistTreeItem::PlistDictionary:
+        if ( writeSourceSpan(node, emitter, depth) ) {
+            // Unchanged, so copied straight from the source.
+        } else if ( node->hasUnfetchedChildren() ) {
+            // Its children were never read and there's nothing to copy them from.
+            _writeFailed = true;
+        } else if ( node->childCount() == 0 ) {
+            emitter.writeEmptyElement(elementNameForItem(node), depth);
+        } else {
+            emitter.writeStartElement(elementNameForItem(node), depth);
+
+            for( int i = 0; i < node->childCount(); i++ ) {
+                writeNode(node->child(i), emitter, depth + 1, false);
+            }
+
+            emitter.writeEndElement(elementNameForItem(node), depth);
         }
+        break;
+
+    case PlistTreeItem::PlistString: emitter.writeStringElement("string", value.string(), depth); break;
+    case PlistTreeItem::PlistInteger: emitter.writeIntegerElement(value.integer(), depth); break;
+    case PlistTreeItem::PlistReal: emitter.writeRealElement(value.real(), depth); break;
+    case PlistTreeItem::PlistBoolean: emitter.writeBooleanElement(value.boolean(), depth); break;
+    case PlistTreeItem::PlistDate: emitter.writeDateElement(value.date(), depth); break;
+    case PlistTreeItem::PlistData: emitter.writeDataElement(value.data(), depth); break;
 
-        xmlWriter.writeEndElement();
+    default:
+        break;
     }
-    else
-    {
-        xmlWriter.writeTextElement(elementName, node->getValue().toString());
+
+    if ( _device != nullptr && emitter.buffer()->size() >= FLUSH_THRESHOLD ) {
+        flush();
     }
+}
+
+
+bool PlistTreeWriter::writeSourceSpan(PlistTreeItem *node, PlistXmlEmitter &emitter, int depth)
+{
+    if ( _source == nullptr || _compact || node->isDirty() || node->sourceSpan() < 0 ) {
+        return false;
+    }
+
+    QByteArray span = _source->span(node->sourceSpan());
 
+    if ( span.isEmpty() ) {
+        return false;
+    }
+
+    // The span runs from the start tag to the end of the end tag; the indentation inside it is kept as it was.
+    emitter.writeIndent(depth);
+    writeChunk(span, emitter);
+    emitter.writeLineEnd();
     return true;
 }
 
 
-QString PlistTreeWriter::elementNameForItem(PlistTreeItem *node)
+void PlistTreeWriter::writeChunk(const QByteArray &chunk, PlistXmlEmitter &emitter)
+{
+    // Chunks are never legitimately empty; SerializeChildren returns nothing when it fails.
+    if ( chunk.isEmpty() ) {
+        _writeFailed = true;
+        return;
+    }
+
+    if ( _device == nullptr ) {
+        emitter.buffer()->append(chunk);
+        return;
+    }
+
+    // Keep the output in order, then hand the chunk over as it is rather than copying it.
+    flush();
+
+    if ( !_writeFailed && _device->write(chunk) != chunk.size() ) {
+        _writeFailed = true;
+    }
+}
+
+
+void PlistTreeWriter::flush()
+{
+    if ( _device == nullptr || _buffer.isEmpty() ) {
+        return;
+    }
+
+    if ( !_writeFailed && _device->write(_buffer) != _buffer.size() ) {
+        _writeFailed = true;
+    }
+
+    _buffer.resize(0);
+}
+
+
+QByteArray PlistTreeWriter::SerializeChildren(PlistTreeItem *node, int first, int last, int depth, const PlistTreeSource *source, bool compact)
+{
+    // A writer of our own, with no device, so nothing is shared with the calling thread.
+    // The source is only ever read, so sharing that is fine.
+    PlistTreeWriter writer;
+    writer.setSource(source);
+    writer.setCompact(compact);
+    QByteArray chunk;
+    PlistXmlEmitter emitter(&chunk);
+    emitter.setCompact(compact);
+
+    for( int i = first; i < last; ++i ) {
+        writer.writeNode(node->child(i), emitter, depth, false);
+    }
+
+    if ( writer._writeFailed ) {
+        chunk.clear();
+    }
+
+    return chunk;
+}
+
+
+const char * PlistTreeWriter::elementNameForItem(PlistTreeItem *node)
 {
     switch(node->plistType())
     {
-    case PlistTreeItem::PlistString: return QString("string");
-    case PlistTreeItem::PlistReal: return QString("real");
-    case PlistTreeItem::PlistInteger: return QString("integer");
-    case PlistTreeItem::PlistBoolean: return QString("boolean");
-    case PlistTreeItem::PlistDate: return QString("date");
-    case PlistTreeItem::PlistData: return QString("data");
-    case PlistTreeItem::PlistArray: return QString("array");
-    case PlistTreeItem::PlistDictionary: return QString("dict");
+    case PlistTreeItem::PlistString: return "string";
+    case PlistTreeItem::PlistReal: return "real";
+    case PlistTreeItem::PlistInteger: return "integer";
+    case PlistTreeItem::PlistBoolean: return node->value().boolean() ? "true" : "false";
+    case PlistTreeItem::PlistDate: return "date";
+    case PlistTreeItem::PlistData: return "data";
+    case PlistTreeItem::PlistArray: return "array";
+    case PlistTreeItem::PlistDictionary: return "dict";
+    default: break;
     }
 
-    return QString();
+    return "";
 }
 
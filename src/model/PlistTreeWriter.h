@@ -22,29 +22,73 @@
 #define PLISTTREEWRITER_H
 
 #include "PlistTreeItem.h"
+#include "PlistXmlEmitter.h"
+#include "PlistTreeSource.h"
 
-#include <QXmlStreamWriter>
 #include <QFile>
+#include <QSaveFile>
 
 
 /**
  * @brief Class for writing a Plist Tree to a File / IODevice or String.
+ *
+ * The document is built as UTF-8 by a PlistXmlEmitter, which formats each value straight
+ * from the item's typed storage. When writing to a device the output goes through one
+ * large buffer which is flushed in big blocks and reused, so memory use doesn't grow with
+ * the document. Files are written through QSaveFile, so a failed save never leaves a
+ * truncated file behind.
+ *
+ * Big documents are written in parallel: the root's children are split into runs of
+ * similar size, each run is serialized into its own buffer on the global thread pool,
+ * and the buffers are written out in order as they complete.
+ *
+ * Given the PlistTreeSource a document was read from, containers which haven't changed
+ * since are copied from it byte for byte rather than serialized again. That includes
+ * containers whose children were never read, so a lazily read document can be saved
+ * without reading the rest of it.
+ *
+ * A compact writer leaves out all indentation and line breaks. Copied containers keep the
+ * layout they had in the source, so a compact writer always serializes everything.
  */
 class PlistTreeWriter
 {
 public:
     PlistTreeWriter();
 
+    /** Copy unmodified containers from the given source (or serialize everything, if nullptr). */
+    void setSource(const PlistTreeSource *source);
+
+    /** Write without indentation or line breaks. */
+    void setCompact(bool compact);
+
     bool writeTreeToFile(PlistTreeItem *rootNode, QString &fileName);
     bool writeTreeToIODevice(PlistTreeItem *rootNode, QIODevice *device);
     bool writeTreeToString(PlistTreeItem *rootNode, QString *string);
 
+    /** Write the whole document as UTF-8 onto the end of the given buffer. */
+    bool writeTreeToBuffer(PlistTreeItem *rootNode, QByteArray *buffer);
+
 
 protected:
-    bool writeToXmlStreamWriter(PlistTreeItem *rootNode, QXmlStreamWriter &xmlWriter);
-    bool writeNode(PlistTreeItem *node, QXmlStreamWriter &xmlWriter, bool isRootNode);
+    bool writeTree(PlistTreeItem *rootNode, QIODevice *device);
+    void writeDocument(PlistTreeItem *rootNode, PlistXmlEmitter &emitter);
+    bool writeRootInParallel(PlistTreeItem *rootNode, PlistXmlEmitter &emitter);
+    void writeNode(PlistTreeItem *node, PlistXmlEmitter &emitter, int depth, bool isRootNode);
+    bool writeSourceSpan(PlistTreeItem *node, PlistXmlEmitter &emitter, int depth);
+    void writeChunk(const QByteArray &chunk, PlistXmlEmitter &emitter);
+    void flush();
+
+    /** Serialize the children [first, last) of the given node at the given depth. Safe to run on any thread. */
+    static QByteArray SerializeChildren(PlistTreeItem *node, int first, int last, int depth, const PlistTreeSource *source, bool compact);
+
+    const char *elementNameForItem(PlistTreeItem *node);
 
-    QString elementNameForItem(PlistTreeItem *node);
+private:
+    QByteArray _buffer;                 // Output waiting to be written to _device
+    QIODevice *_device;                 // Device being streamed to, or nullptr when building a buffer
+    const PlistTreeSource *_source;     // Where unmodified containers are copied from, or nullptr
+    bool _compact;
+    bool _writeFailed;
 };
 
 #endif // PLISTTREEWRITER_H
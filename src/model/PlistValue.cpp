@@ -0,0 +1,155 @@
+#include "PlistValue.h"
+
+#include <new>
+
+
+// QString and QByteArray are a single d-pointer each, which is what lets them share the
+// inline payload with the scalar types.
+Q_STATIC_ASSERT(sizeof(QString) <= sizeof(void*));
+Q_STATIC_ASSERT(sizeof(QByteArray) <= sizeof(void*));
+Q_STATIC_ASSERT(sizeof(PlistValue) <= 16);
+
+
+PlistValue::PlistValue(quint8 type)
+{
+    _payload.integer = 0;
+    _storage = StorageNone;
+    _type = type;
+}
+
+
+PlistValue::PlistValue(const PlistValue &other)
+{
+    _payload.integer = 0;
+    _storage = StorageNone;
+    _type = other._type;
+    *this = other;
+}
+
+
+PlistValue::~PlistValue()
+{
+    clear();
+}
+
+
+PlistValue & PlistValue::operator=(const PlistValue &other)
+{
+    if ( this == &other ) {
+        return *this;
+    }
+
+    switch( other._storage )
+    {
+    case StorageString: setString(*other.stringStorage()); break;
+    case StorageData: setData(*other.dataStorage()); break;
+
+    default:
+        clear();
+        _payload = other._payload;
+        _storage = other._storage;
+        break;
+    }
+
+    _type = other._type;
+    return *this;
+}
+
+
+void PlistValue::clear()
+{
+    if ( _storage == StorageString ) {
+        stringStorage()->~QString();
+    } else if ( _storage == StorageData ) {
+        dataStorage()->~QByteArray();
+    }
+
+    _payload.integer = 0;
+    _storage = StorageNone;
+}
+
+
+void PlistValue::setInteger(qint64 value)
+{
+    clear();
+    _payload.integer = value;
+    _storage = StorageInteger;
+}
+
+
+void PlistValue::setReal(double value)
+{
+    clear();
+    _payload.real = value;
+    _storage = StorageReal;
+}
+
+
+void PlistValue::setBoolean(bool value)
+{
+    clear();
+    _payload.boolean = value;
+    _storage = StorageBoolean;
+}
+
+
+void PlistValue::setDate(qint64 msecsSinceEpoch)
+{
+    clear();
+    _payload.integer = msecsSinceEpoch;
+    _storage = StorageDate;
+}
+
+
+void PlistValue::setString(const QString &value)
+{
+    if ( _storage == StorageString ) {
+        *stringStorage() = value;
+        return;
+    }
+
+    clear();
+    new (_payload.shared) QString(value);
+    _storage = StorageString;
+}
+
+
+void PlistValue::setData(const QByteArray &value)
+{
+    if ( _storage == StorageData ) {
+        *dataStorage() = value;
+        return;
+    }
+
+    clear();
+    new (_payload.shared) QByteArray(value);
+    _storage = StorageData;
+}
+
+
+void PlistValue::setPending(quint32 token, quint32 count)
+{
+    clear();
+    _payload.integer = static_cast<qint64>((quint64(count) << 32) | token);
+    _storage = StoragePending;
+}
+
+
+void PlistValue::setUnreadable()
+{
+    if ( _storage == StoragePending ) {
+        _storage = StorageUnreadable;
+    }
+}
+
+
+QString PlistValue::string() const
+{
+    return _storage == StorageString ? *stringStorage() : QString();
+}
+
+
+QByteArray PlistValue::data() const
+{
+    return _storage == StorageData ? *dataStorage() : QByteArray();
+}
@@ -0,0 +1,112 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTVALUE_H
+#define PLISTVALUE_H
+
+#include <QString>
+#include <QByteArray>
+
+
+/**
+ * @brief Compact tagged storage for the value of a single Plist item.
+ *
+ * Integers, reals, booleans and dates (as milliseconds since the epoch, UTC) are stored
+ * inline, while strings and data blobs are held as implicitly shared QString/QByteArray
+ * handles. Alongside the storage kind, the value carries an 8-bit type tag owned by the
+ * item (a PlistTreeItem::PlistType), so the whole thing fits in 16 bytes.
+ *
+ * Getters don't convert between kinds; asking for the wrong kind returns a default value.
+ */
+class PlistValue
+{
+public:
+    enum StorageKind {
+        StorageNone,
+        StorageInteger,
+        StorageReal,
+        StorageBoolean,
+        StorageDate,
+        StorageString,
+        StorageData,
+        StoragePending,                 // Container whose children haven't been read yet
+        StorageUnreadable,              // Container whose children couldn't be read, and won't be tried again
+    };
+
+    explicit PlistValue(quint8 type = 0);
+    PlistValue(const PlistValue &other);
+    ~PlistValue();
+
+    PlistValue &operator=(const PlistValue &other);
+
+    /** The item type tag stored alongside the value. */
+    quint8 type() const { return _type; }
+    void setType(quint8 type) { _type = type; }
+
+    /** Which kind of value is currently stored? */
+    StorageKind storageKind() const { return static_cast<StorageKind>(_storage); }
+
+    /** Drop any stored value, keeping the type tag. */
+    void clear();
+
+    void setInteger(qint64 value);
+    void setReal(double value);
+    void setBoolean(bool value);
+    void setDate(qint64 msecsSinceEpoch);
+    void setString(const QString &value);
+    void setData(const QByteArray &value);
+
+    /** Mark a container as having unread children, remembering a reader token and how many there are. */
+    void setPending(quint32 token, quint32 count);
+
+    /** Turn a pending value into an unreadable one, keeping its token and count. */
+    void setUnreadable();
+
+    qint64 integer() const { return _storage == StorageInteger ? _payload.integer : 0; }
+    double real() const { return _storage == StorageReal ? _payload.real : 0.0; }
+    bool boolean() const { return _storage == StorageBoolean ? _payload.boolean : false; }
+    qint64 date() const { return _storage == StorageDate ? _payload.integer : 0; }
+    QString string() const;
+    QByteArray data() const;
+    qint64 pendingToken() const { return isPending() ? static_cast<qint64>(_payload.integer & 0xFFFFFFFF) : -1; }
+    int pendingCount() const { return isPending() ? static_cast<int>(quint64(_payload.integer) >> 32) : 0; }
+
+    /** Is this a container whose children aren't here, whether or not they can still be read? */
+    bool isPending() const { return _storage == StoragePending || _storage == StorageUnreadable; }
+
+
+private:
+    QString *stringStorage() { return reinterpret_cast<QString*>(_payload.shared); }
+    const QString *stringStorage() const { return reinterpret_cast<const QString*>(_payload.shared); }
+    QByteArray *dataStorage() { return reinterpret_cast<QByteArray*>(_payload.shared); }
+    const QByteArray *dataStorage() const { return reinterpret_cast<const QByteArray*>(_payload.shared); }
+
+    union {
+        qint64 integer;                 // Integers and dates
+        double real;
+        bool boolean;
+        char shared[sizeof(void*)];     // Placement storage for a QString or QByteArray handle
+    } _payload;
+
+    quint8 _storage;                    // StorageKind of the payload
+    quint8 _type;                       // Owner's type tag
+};
+
+#endif // PLISTVALUE_H
@@ -0,0 +1,391 @@
+#include "PlistXmlEmitter.h"
+
+#include <cmath>
+#include <cstring>
+
+
+namespace {
+    const int INDENT_SIZE = 4;
+
+    const char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    inline char *appendTwoDigits(char *out, int value) {
+        out[0] = static_cast<char>('0' + value / 10);
+        out[1] = static_cast<char>('0' + value % 10);
+        return out + 2;
+    }
+
+    // Floor division, so dates before 1970 come out right.
+    inline qint64 floorDivide(qint64 value, qint64 divisor) {
+        return (value >= 0) ? (value / divisor) : -((-value + divisor - 1) / divisor);
+    }
+}
+
+
+PlistXmlEmitter::PlistXmlEmitter(QByteArray *buffer)
+{
+    _buffer = buffer;
+    _compact = false;
+}
+
+
+void PlistXmlEmitter::setCompact(bool compact)
+{
+    _compact = compact;
+}
+
+
+void PlistXmlEmitter::writeStartDocument()
+{
+    append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>");
+    appendLineEnd();
+    append("<!DOCTYPE plist PUBLIC \"-//Ale//DTD PLIST 1.0//EN\" \"http://www.ale.com/DTDs/PropertyList-1.0.dtd\">");
+    appendLineEnd();
+    append("<plist version=\"1.0\">");
+    appendLineEnd();
+}
+
+
+void PlistXmlEmitter::writeEndDocument()
+{
+    append("</plist>");
+
+    // Even a compact document ends with a newline, like any other text file.
+    _buffer->append('\n');
+}
+
+
+void PlistXmlEmitter::writeStartElement(const char *name, int depth)
+{
+    appendIndent(depth);
+    appendOpenTag(name);
+    appendLineEnd();
+}
+
+
+void PlistXmlEmitter::writeEndElement(const char *name, int depth)
+{
+    appendIndent(depth);
+    appendCloseTag(name);
+    appendLineEnd();
+}
+
+
+void PlistXmlEmitter::writeEmptyElement(const char *name, int depth)
+{
+    appendIndent(depth);
+    append("<");
+    append(name);
+    append("/>");
+    appendLineEnd();
+}
+
+
+void PlistXmlEmitter::writeStringElement(const char *name, const QString &text, int depth)
+{
+    appendIndent(depth);
+    appendOpenTag(name);
+    appendEscaped(text);
+    appendCloseTag(name);
+    appendLineEnd();
+}
+
+
+void PlistXmlEmitter::writeIntegerElement(qint64 value, int depth)
+{
+    appendIndent(depth);
+    appendOpenTag("integer");
+
+    char *out = beginWrite(24);
+    endWrite(FormatInteger(out, value));
+
+    appendCloseTag("integer");
+    appendLineEnd();
+}
+
+
+void PlistXmlEmitter::writeRealElement(double value, int depth)
+{
+    appendIndent(depth);
+    appendOpenTag("real");
+
+    if ( std::isnan(value) ) {
+        append("nan");
+    } else if ( std::isinf(value) ) {
+        append(value > 0 ? "+infinity" : "-infinity");
+    } else {
+        // The shortest of 15, 16 or 17 significant digits that reads back as the same double.
+        for( int precision = 15; precision <= 17; ++precision )
+        {
+            _realText.setNum(value, 'g', precision);
+
+            if ( precision == 17 || _realText.toDouble() == value ) {
+                break;
+            }
+        }
+
+        _buffer->append(_realText);
+    }
+
+    appendCloseTag("real");
+    appendLineEnd();
+}
+
+
+void PlistXmlEmitter::writeBooleanElement(bool value, int depth)
+{
+    writeEmptyElement(value ? "true" : "false", depth);
+}
+
+
+void PlistXmlEmitter::writeDateElement(qint64 msecsSinceEpoch, int depth)
+{
+    appendIndent(depth);
+    appendOpenTag("date");
+
+    char *out = beginWrite(32);
+    endWrite(FormatDate(out, msecsSinceEpoch));
+
+    appendCloseTag("date");
+    appendLineEnd();
+}
+
+
+void PlistXmlEmitter::writeDataElement(const QByteArray &data, int depth)
+{
+    appendIndent(depth);
+    appendOpenTag("data");
+
+    char *out = beginWrite(((data.size() + 2) / 3) * 4);
+    endWrite(FormatBase64(out, data));
+
+    appendCloseTag("data");
+    appendLineEnd();
+}
+
+
+void PlistXmlEmitter::writeIndent(int depth)
+{
+    appendIndent(depth);
+}
+
+
+void PlistXmlEmitter::writeLineEnd()
+{
+    appendLineEnd();
+}
+
+
+//
+// Protected Methods
+//
+
+
+char * PlistXmlEmitter::beginWrite(int maxSize)
+{
+    // Growing a QByteArray is amortised, and shrinking it back in endWrite keeps the capacity.
+    int size = _buffer->size();
+    _buffer->resize(size + maxSize);
+    return _buffer->data() + size;
+}
+
+
+void PlistXmlEmitter::endWrite(char *end)
+{
+    _buffer->resize(static_cast<int>(end - _buffer->constData()));
+}
+
+
+void PlistXmlEmitter::append(const char *text)
+{
+    _buffer->append(text, static_cast<int>(strlen(text)));
+}
+
+
+void PlistXmlEmitter::appendIndent(int depth)
+{
+    if ( _compact ) {
+        return;
+    }
+
+    const int size = depth * INDENT_SIZE;
+    char *out = beginWrite(size);
+    memset(out, ' ', size);
+    endWrite(out + size);
+}
+
+
+void PlistXmlEmitter::appendLineEnd()
+{
+    if ( !_compact ) {
+        _buffer->append('\n');
+    }
+}
+
+
+void PlistXmlEmitter::appendOpenTag(const char *name)
+{
+    append("<");
+    append(name);
+    append(">");
+}
+
+
+void PlistXmlEmitter::appendCloseTag(const char *name)
+{
+    append("</");
+    append(name);
+    append(">");
+}
+
+
+void PlistXmlEmitter::appendEscaped(const QString &text)
+{
+    const ushort *in = text.utf16();
+    const ushort *end = in + text.size();
+
+    // Worst case is an escape (5 bytes) for every UTF-16 unit.
+    char *out = beginWrite(text.size() * 5);
+
+    while( in < end )
+    {
+        uint c = *in++;
+
+        if ( c < 0x80 )
+        {
+            switch( c )
+            {
+            case '&': memcpy(out, "&amp;", 5); out += 5; break;
+            case '<': memcpy(out, "&lt;", 4); out += 4; break;
+            case '>': memcpy(out, "&gt;", 4); out += 4; break;
+            case '\r': memcpy(out, "&#13;", 5); out += 5; break;
+            default: *out++ = static_cast<char>(c); break;
+            }
+
+            continue;
+        }
+
+        if ( QChar::isHighSurrogate(c) && in < end && QChar::isLowSurrogate(*in) ) {
+            c = QChar::surrogateToUcs4(static_cast<ushort>(c), *in++);
+        } else if ( QChar::isSurrogate(c) ) {
+            c = 0xFFFD;         // Unpaired surrogate
+        }
+
+        if ( c < 0x800 ) {
+            *out++ = static_cast<char>(0xC0 | (c >> 6));
+            *out++ = static_cast<char>(0x80 | (c & 0x3F));
+        } else if ( c < 0x10000 ) {
+            *out++ = static_cast<char>(0xE0 | (c >> 12));
+            *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (c & 0x3F));
+        } else {
+            *out++ = static_cast<char>(0xF0 | (c >> 18));
+            *out++ = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+
+    endWrite(out);
+}
+
+
+char * PlistXmlEmitter::FormatInteger(char *out, qint64 value)
+{
+    // Work in unsigned so that the most negative value doesn't overflow.
+    quint64 magnitude = (value < 0) ? (0 - static_cast<quint64>(value)) : static_cast<quint64>(value);
+    char digits[20];
+    int count = 0;
+
+    do {
+        digits[count++] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while( magnitude != 0 );
+
+    if ( value < 0 ) {
+        *out++ = '-';
+    }
+
+    while( count > 0 ) {
+        *out++ = digits[--count];
+    }
+
+    return out;
+}
+
+
+char * PlistXmlEmitter::FormatDate(char *out, qint64 msecsSinceEpoch)
+{
+    // Plist dates are whole seconds in UTC: YYYY-MM-DDTHH:MM:SSZ
+    qint64 seconds = floorDivide(msecsSinceEpoch, 1000);
+    qint64 days = floorDivide(seconds, 86400);
+    int secondOfDay = static_cast<int>(seconds - days * 86400);
+
+    // Civil date from a day count, after Howard Hinnant's days_from_civil inverse.
+    qint64 z = days + 719468;
+    qint64 era = floorDivide(z, 146097);
+    qint64 dayOfEra = z - era * 146097;
+    qint64 yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    qint64 dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    qint64 shiftedMonth = (5 * dayOfYear + 2) / 153;
+    int day = static_cast<int>(dayOfYear - (153 * shiftedMonth + 2) / 5 + 1);
+    int month = static_cast<int>(shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9);
+    qint64 year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+    if ( year >= 0 && year <= 9999 ) {
+        out = appendTwoDigits(out, static_cast<int>(year / 100));
+        out = appendTwoDigits(out, static_cast<int>(year % 100));
+    } else {
+        out = FormatInteger(out, year);
+    }
+
+    *out++ = '-';
+    out = appendTwoDigits(out, month);
+    *out++ = '-';
+    out = appendTwoDigits(out, day);
+    *out++ = 'T';
+    out = appendTwoDigits(out, secondOfDay / 3600);
+    *out++ = ':';
+    out = appendTwoDigits(out, (secondOfDay / 60) % 60);
+    *out++ = ':';
+    out = appendTwoDigits(out, secondOfDay % 60);
+    *out++ = 'Z';
+
+    return out;
+}
+
+
+char * PlistXmlEmitter::FormatBase64(char *out, const QByteArray &data)
+{
+    const uchar *in = reinterpret_cast<const uchar*>(data.constData());
+    const uchar *end = in + data.size();
+
+    while( end - in >= 3 )
+    {
+        uint triple = (uint(in[0]) << 16) | (uint(in[1]) << 8) | uint(in[2]);
+        *out++ = BASE64_ALPHABET[(triple >> 18) & 0x3F];
+        *out++ = BASE64_ALPHABET[(triple >> 12) & 0x3F];
+        *out++ = BASE64_ALPHABET[(triple >> 6) & 0x3F];
+        *out++ = BASE64_ALPHABET[triple & 0x3F];
+        in += 3;
+    }
+
+    if ( end - in == 1 )
+    {
+        uint triple = uint(in[0]) << 16;
+        *out++ = BASE64_ALPHABET[(triple >> 18) & 0x3F];
+        *out++ = BASE64_ALPHABET[(triple >> 12) & 0x3F];
+        *out++ = '=';
+        *out++ = '=';
+    }
+    else if ( end - in == 2 )
+    {
+        uint triple = (uint(in[0]) << 16) | (uint(in[1]) << 8);
+        *out++ = BASE64_ALPHABET[(triple >> 18) & 0x3F];
+        *out++ = BASE64_ALPHABET[(triple >> 12) & 0x3F];
+        *out++ = BASE64_ALPHABET[(triple >> 6) & 0x3F];
+        *out++ = '=';
+    }
+
+    return out;
+}
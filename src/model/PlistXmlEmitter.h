@@ -0,0 +1,94 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTXMLEMITTER_H
+#define PLISTXMLEMITTER_H
+
+#include <QByteArray>
+#include <QString>
+
+
+/**
+ * @brief Writes the elements of an XML Plist straight into a UTF-8 byte buffer.
+ *
+ * Values are formatted directly into the buffer: integers and dates digit by digit,
+ * reals in their shortest representation that reads back exactly, data as base64 and
+ * strings encoded and escaped in a single pass. Nothing is converted through QVariant
+ * or a temporary QString. Layout matches what QXmlStreamWriter's auto formatting used
+ * to produce, with four spaces per level, unless the emitter is set to be compact, in
+ * which case there is no indentation or line breaks at all.
+ */
+class PlistXmlEmitter
+{
+public:
+    explicit PlistXmlEmitter(QByteArray *buffer);
+
+    /** Leave out indentation and line breaks, for the smallest possible document. */
+    void setCompact(bool compact);
+    bool isCompact() const { return _compact; }
+
+    /** The buffer being written to. */
+    QByteArray *buffer() const { return _buffer; }
+
+    /** XML declaration, DOCTYPE and the opening plist tag. */
+    void writeStartDocument();
+
+    /** The closing plist tag. */
+    void writeEndDocument();
+
+    void writeStartElement(const char *name, int depth);
+    void writeEndElement(const char *name, int depth);
+    void writeEmptyElement(const char *name, int depth);
+
+    void writeStringElement(const char *name, const QString &text, int depth);
+    void writeIntegerElement(qint64 value, int depth);
+    void writeRealElement(double value, int depth);
+    void writeBooleanElement(bool value, int depth);
+    void writeDateElement(qint64 msecsSinceEpoch, int depth);
+    void writeDataElement(const QByteArray &data, int depth);
+
+    /** Start and end a line around content the caller writes itself, such as an element copied from the source file. */
+    void writeIndent(int depth);
+    void writeLineEnd();
+
+
+protected:
+    char *beginWrite(int maxSize);
+    void endWrite(char *end);
+
+    void append(const char *text);
+    void appendIndent(int depth);
+    void appendLineEnd();
+    void appendOpenTag(const char *name);
+    void appendCloseTag(const char *name);
+    void appendEscaped(const QString &text);
+
+    static char *FormatInteger(char *out, qint64 value);
+    static char *FormatDate(char *out, qint64 msecsSinceEpoch);
+    static char *FormatBase64(char *out, const QByteArray &data);
+
+
+private:
+    QByteArray *_buffer;
+    QByteArray _realText;               // Scratch space for formatting reals
+    bool _compact;
+};
+
+#endif // PLISTXMLEMITTER_H
@@ -0,0 +1,576 @@
+#include "PlistXmlTokenizer.h"
+
+#include <QtAlgorithms>
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PLISTPAD_HAVE_SSE2
+#endif
+
+
+namespace {
+    // Tokens between calls to the progress callback.
+    const int PROGRESS_INTERVAL = 4096;
+
+    inline bool isXmlSpace(char c) {
+        return ( c == ' ' || c == '\t' || c == '\r' || c == '\n' );
+    }
+
+    inline bool startsWith(const char *data, qint64 pos, qint64 end, const char *prefix) {
+        qint64 length = static_cast<qint64>(strlen(prefix));
+        return ( end - pos >= length && memcmp(data + pos, prefix, length) == 0 );
+    }
+
+    // Find the first '<' or '&' in [from, end), or end if there is neither.
+    inline const char *findMarkupOrEntity(const char *from, const char *end) {
+#ifdef PLISTPAD_HAVE_SSE2
+        const __m128i lessThan = _mm_set1_epi8('<');
+        const __m128i ampersand = _mm_set1_epi8('&');
+
+        while( end - from >= 16 )
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from));
+            int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, lessThan), _mm_cmpeq_epi8(chunk, ampersand)));
+
+            if ( mask != 0 ) {
+                return from + qCountTrailingZeroBits(static_cast<quint32>(mask));
+            }
+
+            from += 16;
+        }
+#endif
+
+        while( from < end && *from != '<' && *from != '&' ) {
+            from++;
+        }
+
+        return from;
+    }
+
+    // Perfect hash of the element names we know about. It is evaluated at compile time
+    // for the case labels in elementName(), so a collision is a duplicate case error.
+    constexpr quint32 ElementNameHash(const char *name, int size) {
+        return size < 1 ? 0 : ((quint32(uchar(name[0])) + quint32(uchar(name[size - 1])) + quint32(size) * 7) & 0x3F);
+    }
+
+    template<int N>
+    constexpr quint32 ElementNameHash(const char (&name)[N]) {
+        return ElementNameHash(name, N - 1);
+    }
+
+    // XML normalises all line endings in text to a single line feed.
+    void normaliseLineEndings(QString &text) {
+        text.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+        text.replace(QLatin1Char('\r'), QLatin1Char('\n'));
+    }
+}
+
+
+PlistXmlTokenizer::PlistXmlTokenizer(const char *data, qint64 size, qint64 begin, qint64 end)
+{
+    _data = data;
+    _pos = begin;
+    _end = (end < 0 || end > size) ? size : end;
+
+    _token = TokenNone;
+    _tokenBegin = begin;
+    _tokenEnd = begin;
+    _nameBegin = begin;
+    _nameSize = 0;
+    _textBegin = begin;
+    _textEnd = begin;
+    _textHasEntity = false;
+    _unsupported = false;
+    _tokensUntilProgress = PROGRESS_INTERVAL;
+
+    // Skip a UTF-8 byte order mark. UTF-16 files need a real XML parser.
+    if ( begin == 0 && _end >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0 ) {
+        _pos = 3;
+    } else if ( begin == 0 && _end >= 2 && ((uchar(data[0]) == 0xFE && uchar(data[1]) == 0xFF) || (uchar(data[0]) == 0xFF && uchar(data[1]) == 0xFE)) ) {
+        _unsupported = true;
+    }
+}
+
+
+PlistXmlTokenizer::Token PlistXmlTokenizer::readNext()
+{
+    if ( _token == TokenError || _token == TokenUnsupported ) {
+        return _token;
+    }
+
+    if ( _unsupported ) {
+        return fail(TokenUnsupported);
+    }
+
+    if ( --_tokensUntilProgress == 0 )
+    {
+        _tokensUntilProgress = PROGRESS_INTERVAL;
+
+        if ( _progressCallback && !_progressCallback(_pos, _end) ) {
+            return fail(TokenError);
+        }
+    }
+
+    while( true )
+    {
+        if ( _pos >= _end ) {
+            _tokenBegin = _tokenEnd = _end;
+            return (_token = TokenEndOfDocument);
+        }
+
+        _tokenBegin = _pos;
+
+        if ( _data[_pos] != '<' ) {
+            readText();
+            return (_token = TokenText);
+        }
+
+        // Comments, processing instructions and the DOCTYPE don't produce tokens.
+        if ( readMarkup() ) {
+            return _token;
+        }
+    }
+}
+
+
+void PlistXmlTokenizer::setProgressCallback(const std::function<bool(qint64, qint64)> &callback)
+{
+    _progressCallback = callback;
+}
+
+
+bool PlistXmlTokenizer::nameIs(const char *name) const
+{
+    if ( _token != TokenStartElement && _token != TokenEndElement && _token != TokenEmptyElement ) {
+        return false;
+    }
+
+    return ( static_cast<int>(strlen(name)) == _nameSize && memcmp(_data + _nameBegin, name, _nameSize) == 0 );
+}
+
+
+QString PlistXmlTokenizer::name() const
+{
+    return QString::fromUtf8(_data + _nameBegin, _nameSize);
+}
+
+
+PlistXmlTokenizer::ElementName PlistXmlTokenizer::elementName() const
+{
+    if ( _token != TokenStartElement && _token != TokenEndElement && _token != TokenEmptyElement ) {
+        return ElementUnknown;
+    }
+
+    // The hash picks the only possible candidate; one comparison confirms it.
+    ElementName candidate;
+    const char *expected;
+
+    switch( ElementNameHash(_data + _nameBegin, _nameSize) )
+    {
+    case ElementNameHash("plist"): candidate = ElementPlist; expected = "plist"; break;
+    case ElementNameHash("dict"): candidate = ElementDict; expected = "dict"; break;
+    case ElementNameHash("key"): candidate = ElementKey; expected = "key"; break;
+    case ElementNameHash("array"): candidate = ElementArray; expected = "array"; break;
+    case ElementNameHash("string"): candidate = ElementString; expected = "string"; break;
+    case ElementNameHash("integer"): candidate = ElementInteger; expected = "integer"; break;
+    case ElementNameHash("real"): candidate = ElementReal; expected = "real"; break;
+    case ElementNameHash("true"): candidate = ElementTrue; expected = "true"; break;
+    case ElementNameHash("false"): candidate = ElementFalse; expected = "false"; break;
+    case ElementNameHash("boolean"): candidate = ElementBoolean; expected = "boolean"; break;
+    case ElementNameHash("date"): candidate = ElementDate; expected = "date"; break;
+    case ElementNameHash("data"): candidate = ElementData; expected = "data"; break;
+
+    default:
+        return ElementUnknown;
+    }
+
+    return nameIs(expected) ? candidate : ElementUnknown;
+}
+
+
+bool PlistXmlTokenizer::isWhitespace() const
+{
+    if ( _token != TokenText ) {
+        return false;
+    }
+
+    for( qint64 i = _textBegin; i < _textEnd; ++i ) {
+        if ( !isXmlSpace(_data[i]) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+QString PlistXmlTokenizer::text()
+{
+    if ( _token != TokenText && _token != TokenCData ) {
+        return QString();
+    }
+
+    const qint64 size = _textEnd - _textBegin;
+    const bool hasCarriageReturn = ( memchr(_data + _textBegin, '\r', size) != nullptr );
+    QString result;
+
+    if ( _token == TokenCData || !_textHasEntity )
+    {
+        result = QString::fromUtf8(_data + _textBegin, static_cast<int>(size));
+    }
+    else
+    {
+        qint64 pos = _textBegin;
+
+        while( pos < _textEnd )
+        {
+            const char *amp = static_cast<const char*>(memchr(_data + pos, '&', _textEnd - pos));
+            const qint64 segmentEnd = amp ? (amp - _data) : _textEnd;
+
+            if ( segmentEnd > pos ) {
+                result.append(QString::fromUtf8(_data + pos, static_cast<int>(segmentEnd - pos)));
+            }
+
+            pos = segmentEnd;
+
+            if ( amp != nullptr && !appendEntity(result, pos, _textEnd) ) {
+                fail(TokenUnsupported);
+                return QString();
+            }
+        }
+    }
+
+    if ( hasCarriageReturn ) {
+        normaliseLineEndings(result);
+    }
+
+    return result;
+}
+
+
+QString PlistXmlTokenizer::readElementText()
+{
+    QString result;
+
+    while( true )
+    {
+        switch( readNext() )
+        {
+        case TokenText:
+        case TokenCData:
+            if ( result.isEmpty() ) {
+                result = text();
+            } else {
+                result.append(text());
+            }
+            break;
+
+        case TokenEndElement:
+            return result;
+
+        case TokenUnsupported:
+            return QString();
+
+        default:
+            // Plist values never contain child elements.
+            fail(TokenError);
+            return QString();
+        }
+    }
+}
+
+
+bool PlistXmlTokenizer::skipCurrentElement(int *childCount)
+{
+    int depth = 1;
+    int count = 0;
+
+    while( true )
+    {
+        switch( readNext() )
+        {
+        case TokenStartElement:
+            if ( depth == 1 && elementName() != ElementKey ) {
+                count++;
+            }
+
+            depth++;
+            break;
+
+        case TokenEmptyElement:
+            if ( depth == 1 && elementName() != ElementKey ) {
+                count++;
+            }
+            break;
+
+        case TokenEndElement:
+            if ( --depth == 0 )
+            {
+                if ( childCount != nullptr ) {
+                    *childCount = count;
+                }
+
+                return true;
+            }
+            break;
+
+        case TokenText:
+        case TokenCData:
+            break;
+
+        default:
+            return false;
+        }
+    }
+}
+
+
+//
+// Protected Methods
+//
+
+
+PlistXmlTokenizer::Token PlistXmlTokenizer::fail(Token token)
+{
+    if ( token == TokenUnsupported ) {
+        _unsupported = true;
+    }
+
+    _token = token;
+    return token;
+}
+
+
+void PlistXmlTokenizer::readText()
+{
+    const char *end = _data + _end;
+    const char *found = findMarkupOrEntity(_data + _pos, end);
+
+    _textHasEntity = false;
+
+    // Once we've seen one entity, only the '<' matters.
+    if ( found < end && *found == '&' ) {
+        _textHasEntity = true;
+        found = static_cast<const char*>(memchr(found, '<', end - found));
+        found = found ? found : end;
+    }
+
+    _textBegin = _pos;
+    _textEnd = found - _data;
+    _tokenEnd = _textEnd;
+    _pos = _textEnd;
+}
+
+
+bool PlistXmlTokenizer::readMarkup()
+{
+    qint64 pos = _pos + 1;
+
+    if ( pos >= _end ) {
+        fail(TokenError);
+        return true;
+    }
+
+    if ( _data[pos] == '?' )
+    {
+        const char *close = find("?>", pos);
+
+        if ( close == nullptr ) {
+            fail(TokenError);
+            return true;
+        }
+
+        // Only UTF-8 (and its ASCII subset) is handled here.
+        if ( startsWith(_data, pos, _end, "?xml") )
+        {
+            QByteArray declaration(_data + pos, static_cast<int>(close - (_data + pos)));
+            int encoding = declaration.indexOf("encoding");
+
+            if ( encoding >= 0 )
+            {
+                int quote = declaration.indexOf('"', encoding);
+                int singleQuote = declaration.indexOf('\'', encoding);
+                quote = (quote < 0 || (singleQuote >= 0 && singleQuote < quote)) ? singleQuote : quote;
+                int quoteEnd = (quote >= 0) ? declaration.indexOf(declaration.at(quote), quote + 1) : -1;
+                QByteArray name = declaration.mid(quote + 1, quoteEnd - quote - 1).toLower();
+
+                if ( quoteEnd < 0 || (name != "utf-8" && name != "utf8" && name != "us-ascii" && name != "ascii") ) {
+                    fail(TokenUnsupported);
+                    return true;
+                }
+            }
+        }
+
+        _pos = (close - _data) + 2;
+        return false;
+    }
+
+    if ( _data[pos] == '!' )
+    {
+        if ( startsWith(_data, pos, _end, "!--") )
+        {
+            const char *close = find("-->", pos + 3);
+
+            if ( close == nullptr ) {
+                fail(TokenError);
+                return true;
+            }
+
+            _pos = (close - _data) + 3;
+            return false;
+        }
+
+        if ( startsWith(_data, pos, _end, "![CDATA[") )
+        {
+            const char *close = find("]]>", pos + 8);
+
+            if ( close == nullptr ) {
+                fail(TokenError);
+                return true;
+            }
+
+            _textBegin = pos + 8;
+            _textEnd = close - _data;
+            _pos = _textEnd + 3;
+            _tokenEnd = _pos;
+            _token = TokenCData;
+            return true;
+        }
+
+        if ( startsWith(_data, pos, _end, "!DOCTYPE") )
+        {
+            // An internal subset could declare entities, which we don't handle.
+            char quote = 0;
+
+            for( qint64 i = pos; i < _end; ++i )
+            {
+                char c = _data[i];
+
+                if ( quote != 0 ) {
+                    if ( c == quote ) { quote = 0; }
+                } else if ( c == '"' || c == '\'' ) {
+                    quote = c;
+                } else if ( c == '[' ) {
+                    fail(TokenUnsupported);
+                    return true;
+                } else if ( c == '>' ) {
+                    _pos = i + 1;
+                    return false;
+                }
+            }
+
+            fail(TokenError);
+            return true;
+        }
+
+        fail(TokenUnsupported);
+        return true;
+    }
+
+    // Start, end or empty element. Attributes are skipped, minding '>' in quoted values.
+    const bool isEnd = (_data[pos] == '/');
+    _nameBegin = isEnd ? pos + 1 : pos;
+    qint64 i = _nameBegin;
+
+    while( i < _end && !isXmlSpace(_data[i]) && _data[i] != '>' && _data[i] != '/' ) {
+        i++;
+    }
+
+    _nameSize = static_cast<int>(i - _nameBegin);
+    char quote = 0;
+
+    while( i < _end )
+    {
+        char c = _data[i];
+
+        if ( quote != 0 ) {
+            if ( c == quote ) { quote = 0; }
+        } else if ( c == '"' || c == '\'' ) {
+            quote = c;
+        } else if ( c == '>' ) {
+            break;
+        }
+
+        i++;
+    }
+
+    if ( i >= _end || _nameSize == 0 ) {
+        fail(TokenError);
+        return true;
+    }
+
+    const bool isEmpty = ( !isEnd && _data[i - 1] == '/' );
+    _pos = i + 1;
+    _tokenEnd = _pos;
+    _token = isEnd ? TokenEndElement : (isEmpty ? TokenEmptyElement : TokenStartElement);
+    return true;
+}
+
+
+const char * PlistXmlTokenizer::find(const char *needle, qint64 from) const
+{
+    const size_t length = strlen(needle);
+
+    while( from < _end )
+    {
+        const char *candidate = static_cast<const char*>(memchr(_data + from, needle[0], _end - from));
+
+        if ( candidate == nullptr ) {
+            return nullptr;
+        }
+
+        from = candidate - _data;
+
+        if ( _end - from >= static_cast<qint64>(length) && memcmp(candidate, needle, length) == 0 ) {
+            return candidate;
+        }
+
+        from++;
+    }
+
+    return nullptr;
+}
+
+
+bool PlistXmlTokenizer::appendEntity(QString &result, qint64 &pos, qint64 end)
+{
+    // Longest entity we accept is a numeric one like &#x10FFFF;
+    const qint64 limit = qMin(end, pos + 12);
+    const char *semicolon = static_cast<const char*>(memchr(_data + pos, ';', limit - pos));
+
+    if ( semicolon == nullptr ) {
+        return false;
+    }
+
+    const char *name = _data + pos + 1;
+    const int length = static_cast<int>(semicolon - name);
+    pos = (semicolon - _data) + 1;
+
+    if ( length == 2 && memcmp(name, "lt", 2) == 0 ) { result.append(QLatin1Char('<')); return true; }
+    if ( length == 2 && memcmp(name, "gt", 2) == 0 ) { result.append(QLatin1Char('>')); return true; }
+    if ( length == 3 && memcmp(name, "amp", 3) == 0 ) { result.append(QLatin1Char('&')); return true; }
+    if ( length == 4 && memcmp(name, "quot", 4) == 0 ) { result.append(QLatin1Char('"')); return true; }
+    if ( length == 4 && memcmp(name, "apos", 4) == 0 ) { result.append(QLatin1Char('\'')); return true; }
+
+    if ( length < 2 || name[0] != '#' ) {
+        return false;
+    }
+
+    bool ok = false;
+    uint codePoint = (name[1] == 'x' || name[1] == 'X') ? QByteArray(name + 2, length - 2).toUInt(&ok, 16) : QByteArray(name + 1, length - 1).toUInt(&ok, 10);
+
+    if ( !ok || codePoint == 0 || codePoint > 0x10FFFF ) {
+        return false;
+    }
+
+    if ( QChar::requiresSurrogates(codePoint) ) {
+        result.append(QChar(QChar::highSurrogate(codePoint)));
+        result.append(QChar(QChar::lowSurrogate(codePoint)));
+    } else {
+        result.append(QChar(codePoint));
+    }
+
+    return true;
+}
@@ -0,0 +1,139 @@
+/****************************************************************************
+** Copyright (c) 2013 "John Wordsworth"
+** Contact: http://www.johnwordsworth.com/
+**
+** This file is part of Plist Pad.
+**
+** Plist Pad is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#ifndef PLISTXMLTOKENIZER_H
+#define PLISTXMLTOKENIZER_H
+
+#include <QString>
+#include <functional>
+
+
+/**
+ * @brief Minimal pull tokenizer for XML Plist files held in memory as UTF-8.
+ *
+ * Unlike QXmlStreamReader this works directly on byte offsets into the buffer, which
+ * lets callers remember where an element starts and ends and come back to it later.
+ * Text is scanned 16 bytes at a time where SSE2 is available, and element names are
+ * matched with a perfect hash rather than string comparisons.
+ * It only understands what Plist files actually use: elements, text, the predefined
+ * and numeric entities, CDATA, comments, processing instructions and a DOCTYPE without
+ * an internal subset. Anything else is reported as TokenUnsupported so that callers
+ * can fall back to a full XML parser.
+ */
+class PlistXmlTokenizer
+{
+public:
+    enum Token {
+        TokenNone,
+        TokenStartElement,
+        TokenEndElement,
+        TokenEmptyElement,              // <tag/>
+        TokenText,
+        TokenCData,
+        TokenEndOfDocument,
+        TokenError,
+        TokenUnsupported,
+    };
+
+    enum ElementName {
+        ElementUnknown,
+        ElementPlist,
+        ElementDict,
+        ElementKey,
+        ElementArray,
+        ElementString,
+        ElementInteger,
+        ElementReal,
+        ElementTrue,
+        ElementFalse,
+        ElementBoolean,                 // Not standard, but written by older versions of Plist Pad
+        ElementDate,
+        ElementData,
+    };
+
+    /** Tokenize data[begin, end). An end of -1 means the end of the buffer. */
+    PlistXmlTokenizer(const char *data, qint64 size, qint64 begin = 0, qint64 end = -1);
+
+    /** Move on to the next token. */
+    Token readNext();
+
+    /** The current token. */
+    Token token() const { return _token; }
+
+    /** Is the current token an element with the given name? */
+    bool nameIs(const char *name) const;
+
+    /** Name of the current element. */
+    QString name() const;
+
+    /** Which of the Plist element names the current element has, without building a string. */
+    ElementName elementName() const;
+
+    /** Byte offsets of the current token: the '<' and one past the '>' for elements. */
+    qint64 tokenBegin() const { return _tokenBegin; }
+    qint64 tokenEnd() const { return _tokenEnd; }
+
+    /** Is the current text token nothing but whitespace? */
+    bool isWhitespace() const;
+
+    /** Decoded content of the current text or CDATA token. */
+    QString text();
+
+    /** After a start element, read up to the matching end element and return the decoded text in between. */
+    QString readElementText();
+
+    /** After a start element, skip to the matching end element, counting the element children (other than keys) directly inside it. */
+    bool skipCurrentElement(int *childCount = nullptr);
+
+    /** Did we hit something we don't handle, so the caller should use a full XML parser instead? */
+    bool isUnsupported() const { return _unsupported; }
+
+    /** Call back every so many tokens with the position and end of the data. Returning false stops with TokenError. */
+    void setProgressCallback(const std::function<bool(qint64, qint64)> &callback);
+
+
+protected:
+    Token fail(Token token);
+    bool readMarkup();
+    void readText();
+    const char *find(const char *needle, qint64 from) const;
+    bool appendEntity(QString &result, qint64 &pos, qint64 end);
+
+
+private:
+    const char *_data;
+    qint64 _pos;                        // Where the next token starts
+    qint64 _end;
+
+    Token _token;
+    qint64 _tokenBegin;
+    qint64 _tokenEnd;
+    qint64 _nameBegin;                  // Element name, for element tokens
+    int _nameSize;
+    qint64 _textBegin;                  // Raw content, for text and CDATA tokens
+    qint64 _textEnd;
+    bool _textHasEntity;                // Did the scan for the end of the text pass an '&'?
+    bool _unsupported;
+
+    std::function<bool(qint64, qint64)> _progressCallback;
+    int _tokensUntilProgress;
+};
+
+#endif // PLISTXMLTOKENIZER_H
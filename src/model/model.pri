@@ -0,0 +1,56 @@
+#------------------------
+# Plist Model
+#
+# Shared by the application and the benchmarks, so both build exactly the
+# same reader/writer code.
+#------------------------
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/PlistTreeWriter.cpp \
+    $$PWD/PlistTreeArena.cpp \
+    $$PWD/PlistTreeItem.cpp \
+    $$PWD/PlistTreeModel.cpp \
+    $$PWD/PlistValue.cpp \
+    $$PWD/PlistTreeReader.cpp \
+    $$PWD/PlistBinaryTreeReader.cpp \
+    $$PWD/PlistBinaryTreeWriter.cpp \
+    $$PWD/PlistTreeLoader.cpp \
+    $$PWD/PlistXmlTokenizer.cpp \
+    $$PWD/PlistLazyTreeReader.cpp \
+    $$PWD/PlistXmlEmitter.cpp \
+    $$PWD/PlistTreeSource.cpp \
+    $$PWD/PlistTreeDiff.cpp \
+    $$PWD/PlistTreeMerge.cpp \
+    $$PWD/PlistTreeQuery.cpp \
+    $$PWD/PlistSearchIndex.cpp \
+    $$PWD/PlistTextMatcher.cpp \
+    $$PWD/PlistTreeReplacer.cpp \
+    $$PWD/PlistTreeSearchCursor.cpp \
+    $$PWD/PlistTreeFilterModel.cpp \
+    $$PWD/PlistTreeSortModel.cpp
+
+HEADERS += \
+    $$PWD/PlistTreeModel.h \
+    $$PWD/PlistTreeArena.h \
+    $$PWD/PlistTreeItem.h \
+    $$PWD/PlistTreeReader.h \
+    $$PWD/PlistBinaryTreeReader.h \
+    $$PWD/PlistValue.h \
+    $$PWD/PlistTreeWriter.h \
+    $$PWD/PlistBinaryTreeWriter.h \
+    $$PWD/PlistTreeLoader.h \
+    $$PWD/PlistXmlTokenizer.h \
+    $$PWD/PlistLazyTreeReader.h \
+    $$PWD/PlistXmlEmitter.h \
+    $$PWD/PlistTreeSource.h \
+    $$PWD/PlistTreeDiff.h \
+    $$PWD/PlistTreeMerge.h \
+    $$PWD/PlistTreeQuery.h \
+    $$PWD/PlistSearchIndex.h \
+    $$PWD/PlistTextMatcher.h \
+    $$PWD/PlistTreeReplacer.h \
+    $$PWD/PlistTreeSearchCursor.h \
+    $$PWD/PlistTreeFilterModel.h \
+    $$PWD/PlistTreeSortModel.h
@@ -0,0 +1,226 @@
+#include <QtTest>
+#include <QBuffer>
+
+#include <limits>
+
+#include "PlistTreeItem.h"
+#include "PlistBinaryTreeReader.h"
+#include "PlistBinaryTreeWriter.h"
+
+
+namespace {
+    void AppendBigEndian(QByteArray &bytes, quint64 value, int size)
+    {
+        for( int i = size - 1; i >= 0; --i ) {
+            bytes.append(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    // A bplist00 file made of already encoded objects, with 4 byte offsets. The first object is the top one.
+    QByteArray BinaryPlist(const QList<QByteArray> &objects, int objectRefSize)
+    {
+        QByteArray file("bplist00");
+        QList<int> offsets;
+
+        for( int i = 0; i < objects.count(); ++i ) {
+            offsets.append(file.size());
+            file.append(objects.at(i));
+        }
+
+        const int offsetTableOffset = file.size();
+
+        for( int i = 0; i < offsets.count(); ++i ) {
+            AppendBigEndian(file, offsets.at(i), 4);
+        }
+
+        file.append(QByteArray(6, '\0'));
+        file.append(static_cast<char>(4));
+        file.append(static_cast<char>(objectRefSize));
+        AppendBigEndian(file, objects.count(), 8);
+        AppendBigEndian(file, 0, 8);
+        AppendBigEndian(file, offsetTableOffset, 8);
+        return file;
+    }
+
+    PlistTreeItem *ReadTree(const QByteArray &bytes)
+    {
+        PlistBinaryTreeReader reader = PlistBinaryTreeReader();
+        return reader.readTreeFromData(reinterpret_cast<const uchar*>(bytes.constData()), bytes.size());
+    }
+
+    QByteArray WriteTree(PlistTreeItem *root)
+    {
+        QByteArray bytes;
+        QBuffer buffer(&bytes);
+        buffer.open(QIODevice::WriteOnly);
+
+        PlistBinaryTreeWriter writer = PlistBinaryTreeWriter();
+
+        if ( !writer.writeTreeToIODevice(root, &buffer) ) {
+            return QByteArray();
+        }
+
+        return bytes;
+    }
+
+    qint64 UtcMSecs(int year, int month, int day, int hour = 0, int minute = 0, int second = 0)
+    {
+        return QDateTime(QDate(year, month, day), QTime(hour, minute, second), Qt::UTC).toMSecsSinceEpoch();
+    }
+}
+
+
+/**
+ * @brief Checks that binary plists survive a write and read unchanged, and that crafted files can't blow up the reader.
+ */
+class PlistBinaryTreeTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip();
+    void sharedScalars();
+    void sharedContainers();
+    void exponentialContainers();
+    void referenceCycle();
+    void badTrailer();
+};
+
+
+void PlistBinaryTreeTests::roundTrip()
+{
+    QVariantList integers = QVariantList{0, 1, -1, 255, 256, 65535, 65536, qint64(1) << 40,
+                                         std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max()};
+    QVariantList reals = QVariantList{0.0, 0.5, -1e300, 1.0 / 3.0, 0.1 + 0.2};
+    QVariantList dates = QVariantList{QDateTime::fromMSecsSinceEpoch(UtcMSecs(2013, 7, 13, 17, 32, 41), Qt::UTC),
+                                      QDateTime::fromMSecsSinceEpoch(UtcMSecs(1900, 1, 1), Qt::UTC)};
+    QVariantList data = QVariantList{QByteArray(), QByteArray("\x00\x01\xfe\xff", 4), QByteArray(1000, 'x')};
+    QVariantList strings = QVariantList{QString(), QString("ascii"), QString::fromUtf8("caf\xc3\xa9 \xf0\x9f\x98\x80"), QString(200, 'y')};
+
+    // The same keys in every element, as in most real files, so they're uniqued.
+    QVariantList records;
+
+    for( int i = 0; i < 20; ++i ) {
+        records.append(QVariantMap{{"Name", QString("Item %1").arg(i)}, {"Index", i}, {"Enabled", i % 2 == 0}});
+    }
+
+    QVariantMap root = QVariantMap{{"integers", integers}, {"reals", reals}, {"dates", dates}, {"data", data}, {"strings", strings},
+                                   {"records", records}, {"empty array", QVariantList()}, {"empty dict", QVariantMap()},
+                                   {QString::fromUtf8("\xc3\xbcnicode key"), true}};
+
+    QScopedPointer<PlistTreeItem> written(PlistTreeItem::Create(nullptr, root));
+    QByteArray bytes = WriteTree(written.data());
+    QVERIFY(PlistBinaryTreeReader::IsBinaryPlist(reinterpret_cast<const uchar*>(bytes.constData()), bytes.size()));
+
+    QScopedPointer<PlistTreeItem> read(ReadTree(bytes));
+    QVERIFY(!read.isNull());
+
+    for( int i = 0; i < written->childCount(); ++i )
+    {
+        const PlistTreeItem *writtenChild = written->child(i);
+        const PlistTreeItem *readChild = read->childForKey(writtenChild->key());
+        QVERIFY2(readChild != nullptr, qPrintable(writtenChild->key()));
+        QVERIFY2(readChild->subtreeHash() == writtenChild->subtreeHash(), qPrintable(writtenChild->key()));
+    }
+
+    QCOMPARE(read->subtreeHash(), written->subtreeHash());
+
+    // Writing what was read gives the same file again.
+    QCOMPARE(WriteTree(read.data()), bytes);
+}
+
+
+void PlistBinaryTreeTests::sharedScalars()
+{
+    // A hundred thousand references to one 'true' is legitimately far more items than objects.
+    const int count = 100000;
+    QByteArray array;
+    array.append(static_cast<char>(0xAF));
+    array.append(static_cast<char>(0x12));
+    AppendBigEndian(array, count, 4);
+    array.append(QByteArray(count, '\x01'));
+
+    QScopedPointer<PlistTreeItem> read(ReadTree(BinaryPlist(QList<QByteArray>() << array << QByteArray("\x09"), 1)));
+    QVERIFY(!read.isNull());
+    QCOMPARE(read->childCount(), count);
+    QCOMPARE(read->child(count - 1)->plistType(), PlistTreeItem::PlistBoolean);
+    QVERIFY(read->child(count - 1)->value().boolean());
+}
+
+
+void PlistBinaryTreeTests::sharedContainers()
+{
+    // Each array holds the next one twice, so three levels expand into 15 items, which is fine.
+    QList<QByteArray> objects;
+
+    for( int i = 0; i < 3; ++i ) {
+        objects.append(QByteArray() + static_cast<char>(0xA2) + static_cast<char>(i + 1) + static_cast<char>(i + 1));
+    }
+
+    objects.append(QByteArray("\x09"));
+
+    QScopedPointer<PlistTreeItem> read(ReadTree(BinaryPlist(objects, 1)));
+    QVERIFY(!read.isNull());
+    QCOMPARE(read->childCount(), 2);
+    QCOMPARE(read->child(1)->child(1)->childCount(), 2);
+    QVERIFY(read->child(1)->child(1)->child(1)->value().boolean());
+}
+
+
+void PlistBinaryTreeTests::exponentialContainers()
+{
+    // The same, 60 levels deep, would be 2^61 items from a file of a few hundred bytes.
+    QList<QByteArray> objects;
+
+    for( int i = 0; i < 60; ++i ) {
+        objects.append(QByteArray() + static_cast<char>(0xA2) + static_cast<char>(i + 1) + static_cast<char>(i + 1));
+    }
+
+    objects.append(QByteArray("\x09"));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QScopedPointer<PlistTreeItem> read(ReadTree(BinaryPlist(objects, 1)));
+    QVERIFY(read.isNull());
+    QVERIFY(timer.elapsed() < 5000);
+}
+
+
+void PlistBinaryTreeTests::referenceCycle()
+{
+    // An array which contains itself.
+    QByteArray array = QByteArray() + static_cast<char>(0xA1) + static_cast<char>(0);
+
+    QScopedPointer<PlistTreeItem> read(ReadTree(BinaryPlist(QList<QByteArray>() << array, 1)));
+    QVERIFY(read.isNull());
+}
+
+
+void PlistBinaryTreeTests::badTrailer()
+{
+    QByteArray valid = BinaryPlist(QList<QByteArray>() << QByteArray("\x09"), 1);
+    QScopedPointer<PlistTreeItem> read(ReadTree(valid));
+    QVERIFY(!read.isNull());
+
+    // An object count running past the offset table.
+    QByteArray tooManyObjects = valid;
+    tooManyObjects[tooManyObjects.size() - 24 + 7] = 100;
+    read.reset(ReadTree(tooManyObjects));
+    QVERIFY(read.isNull());
+
+    // A reference size of zero.
+    QByteArray noRefSize = valid;
+    noRefSize[noRefSize.size() - 25] = 0;
+    read.reset(ReadTree(noRefSize));
+    QVERIFY(read.isNull());
+
+    // Not enough file for a trailer.
+    read.reset(ReadTree(valid.left(20)));
+    QVERIFY(read.isNull());
+}
+
+
+QTEST_GUILESS_MAIN(PlistBinaryTreeTests)
+
+#include "PlistBinaryTreeTests.moc"
@@ -0,0 +1,12 @@
+#-------------------------------------------------
+#
+# Binary plist reader and writer tests.
+#
+#-------------------------------------------------
+
+TARGET = PlistBinaryTreeTests
+
+SOURCES += \
+    PlistBinaryTreeTests.cpp
+
+include(../tests.pri)
@@ -0,0 +1,631 @@
+#include <QtTest>
+#include <QAbstractItemModelTester>
+#include <QCollator>
+#include <QTemporaryFile>
+
+#include "PlistTreeModel.h"
+#include "PlistTreeArena.h"
+#include "PlistLazyTreeReader.h"
+#include "PlistTreeReader.h"
+#include "PlistTreeWriter.h"
+#include "PlistTreeFilterModel.h"
+#include "PlistTreeSortModel.h"
+
+
+namespace {
+    // Nested deeply enough that a lazy reader leaves most of it unread.
+    const char LAZY_PLIST[] =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<!DOCTYPE plist PUBLIC \"-//Apple//DTD PLIST 1.0//EN\" \"http://www.apple.com/DTDs/PropertyList-1.0.dtd\">\n"
+        "<plist version=\"1.0\">\n"
+        "<dict>\n"
+        "\t<key>alpha</key>\n"
+        "\t<dict>\n"
+        "\t\t<key>needle</key>\n"
+        "\t\t<string>one</string>\n"
+        "\t\t<key>other</key>\n"
+        "\t\t<string>two</string>\n"
+        "\t</dict>\n"
+        "\t<key>bravo</key>\n"
+        "\t<array>\n"
+        "\t\t<string>haystack</string>\n"
+        "\t\t<dict>\n"
+        "\t\t\t<key>deep</key>\n"
+        "\t\t\t<string>a needle in here</string>\n"
+        "\t\t</dict>\n"
+        "\t</array>\n"
+        "\t<key>charlie</key>\n"
+        "\t<string>three</string>\n"
+        "</dict>\n"
+        "</plist>\n";
+
+    // Keys which are duplicated at the top and further down.
+    const char DUPLICATE_PLIST[] =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<plist version=\"1.0\">\n"
+        "<dict>\n"
+        "\t<key>dup</key>\n"
+        "\t<string>one</string>\n"
+        "\t<key>dup</key>\n"
+        "\t<string>two</string>\n"
+        "\t<key>outer</key>\n"
+        "\t<dict>\n"
+        "\t\t<key>inner</key>\n"
+        "\t\t<dict>\n"
+        "\t\t\t<key>deep</key>\n"
+        "\t\t\t<string>a</string>\n"
+        "\t\t\t<key>deep</key>\n"
+        "\t\t\t<string>b</string>\n"
+        "\t\t</dict>\n"
+        "\t</dict>\n"
+        "</dict>\n"
+        "</plist>\n";
+
+    // The array passes the quick scan on load, but can't be read in full.
+    const char BROKEN_PLIST[] =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<plist version=\"1.0\">\n"
+        "<dict>\n"
+        "\t<key>broken</key>\n"
+        "\t<array>\n"
+        "\t\t<bogus/>\n"
+        "\t</array>\n"
+        "\t<key>fine</key>\n"
+        "\t<string>yes</string>\n"
+        "</dict>\n"
+        "</plist>\n";
+}
+
+
+/**
+ * @brief Checks that the tree model, and the filter and sort proxies stacked on it, keep to the item model rules.
+ *
+ * Each model has a QAbstractItemModelTester watching it, which fails the test as soon as a signal's
+ * range, a row count or a parent doesn't add up. The tests themselves then check what the view would show.
+ */
+class PlistModelTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void insertAndRemoveRows();
+    void renameKeys();
+    void findReplaceCountsItems();
+    void insertManyRows();
+    void insertAndRemoveManyRows();
+    void filterSortedRows();
+    void filterEditedHiddenRows();
+    void filterKeepsExpandedRows();
+    void filterLazyModel();
+    void fetchUnreadableChildren();
+    void fetchAllInBackground();
+    void searchIndexLazyModel();
+    void saveRenamedDuplicateKeys();
+    void addChildToEmptyDictionary();
+
+private:
+    QModelIndex root() const;
+    QStringList keys(const QModelIndex &parent) const;
+    bool isSorted(const QStringList &keys) const;
+    void insertKeys(const QStringList &keys);
+    PlistTreeModel *readLazyModel(const char *xml, QTemporaryFile &file) const;
+
+    PlistTreeModel *_model;
+    PlistTreeFilterModel *_filter;
+    PlistTreeSortModel *_sort;
+    QList<QAbstractItemModelTester*> _testers;
+};
+
+
+void PlistModelTests::init()
+{
+    _model = new PlistTreeModel();
+    _filter = new PlistTreeFilterModel(_model);
+    _sort = new PlistTreeSortModel(_filter);
+
+    _testers.append(new QAbstractItemModelTester(_model, QAbstractItemModelTester::FailureReportingMode::QtTest));
+    _testers.append(new QAbstractItemModelTester(_filter, QAbstractItemModelTester::FailureReportingMode::QtTest));
+    _testers.append(new QAbstractItemModelTester(_sort, QAbstractItemModelTester::FailureReportingMode::QtTest));
+
+    insertKeys(QStringList() << "delta" << "alpha" << "echo" << "charlie" << "bravo");
+    _sort->setSortByKey(true);
+}
+
+
+void PlistModelTests::cleanup()
+{
+    qDeleteAll(_testers);
+    _testers.clear();
+
+    delete _sort;
+    delete _filter;
+    delete _model;
+}
+
+
+void PlistModelTests::insertAndRemoveRows()
+{
+    QCOMPARE(keys(root()), QStringList() << "alpha" << "bravo" << "charlie" << "delta" << "echo");
+
+    // Removing the last source row, and the last sorted row.
+    QModelIndex sourceRoot = _model->index(0, 0);
+    QVERIFY(_model->removeRows(4, 1, sourceRoot));
+    QCOMPARE(keys(root()), QStringList() << "alpha" << "charlie" << "delta" << "echo");
+
+    QVERIFY(_sort->removeRows(3, 1, root()));
+    QCOMPARE(keys(root()), QStringList() << "alpha" << "charlie" << "delta");
+
+    // Rows can't be removed past the end.
+    QVERIFY(!_model->removeRows(2, 2, sourceRoot));
+
+    // A new row goes to wherever its key sorts to.
+    QVERIFY(_sort->insertRows(0, 1, root()));
+    QCOMPARE(_sort->rowCount(root()), 4);
+    QVERIFY(isSorted(keys(root())));
+
+    QVERIFY(_model->insertItem(PlistTreeItem::Create(nullptr, PlistTreeItem::PlistString), 0, sourceRoot));
+    QCOMPARE(_sort->rowCount(root()), 5);
+    QVERIFY(isSorted(keys(root())));
+
+    // Turning sorting off shows the file order again.
+    _sort->setSortByKey(false);
+    QCOMPARE(keys(root()).count(), 5);
+    QCOMPARE(keys(root()).at(1), _model->index(1, 0, sourceRoot).data().toString());
+}
+
+
+void PlistModelTests::renameKeys()
+{
+    QModelIndex alpha = _sort->index(0, PlistTreeItem::COLUMN_KEY, root());
+    QPersistentModelIndex persistent = alpha;
+
+    // Renaming moves just that row, and anything pointing at it follows.
+    QVERIFY(_sort->setData(alpha, "foxtrot"));
+    QCOMPARE(keys(root()), QStringList() << "bravo" << "charlie" << "delta" << "echo" << "foxtrot");
+    QCOMPARE(persistent.row(), 4);
+    QCOMPARE(persistent.data().toString(), QString("foxtrot"));
+
+    QVERIFY(_sort->setData(_sort->index(3, PlistTreeItem::COLUMN_KEY, root()), "able"));
+    QCOMPARE(keys(root()), QStringList() << "able" << "bravo" << "charlie" << "delta" << "foxtrot");
+
+    // Keys kept while sorting is off still have to be right when it comes back on.
+    _sort->setSortByKey(false);
+    QVERIFY(_model->setData(_model->index(0, PlistTreeItem::COLUMN_KEY, _model->index(0, 0)), "zulu"));
+    _sort->setSortByKey(true);
+    QCOMPARE(keys(root()).last(), QString("zulu"));
+    QVERIFY(isSorted(keys(root())));
+}
+
+
+void PlistModelTests::findReplaceCountsItems()
+{
+    QModelIndex sourceRoot = _model->index(0, 0);
+    QVERIFY(_model->setData(_model->index(0, PlistTreeItem::COLUMN_VALUE, sourceRoot), "lemon"));
+
+    // delta matches by key and value, but is still one item, as countMatches has it.
+    QCOMPARE(_model->countMatches("l", ReplaceAll, ReplaceModeRegularExpression), 3);
+    QCOMPARE(_model->findReplace("l", "L", ReplaceAll, ReplaceModeNormal, Qt::CaseSensitive, true), 3);
+    QCOMPARE(_model->findReplace("l", "L", ReplaceAll, ReplaceModeNormal), 3);
+    QCOMPARE(_model->index(0, PlistTreeItem::COLUMN_KEY, sourceRoot).data().toString(), QString("deLta"));
+
+    // A key which would clash with a sibling is left alone, and isn't counted by a dry run either.
+    QCOMPARE(_model->findReplace("echo", "bravo", ReplaceKey, ReplaceModeNormal, Qt::CaseSensitive, true), 0);
+    QCOMPARE(_model->findReplace("echo", "bravo", ReplaceKey, ReplaceModeNormal), 0);
+
+    // Nor may two renames take the same key.
+    QCOMPARE(_model->findReplace("^(echo|bravo)$", "foxtrot", ReplaceKey, ReplaceModeRegularExpression, Qt::CaseSensitive, true), 1);
+    QCOMPARE(_model->findReplace("^(echo|bravo)$", "foxtrot", ReplaceKey, ReplaceModeRegularExpression), 1);
+
+    // But a key given up by one rename is free for the next.
+    QVERIFY(_model->setData(_model->index(1, PlistTreeItem::COLUMN_KEY, sourceRoot), "ab"));
+    QVERIFY(_model->setData(_model->index(3, PlistTreeItem::COLUMN_KEY, sourceRoot), "abb"));
+    QCOMPARE(_model->findReplace("b$", "", ReplaceKey, ReplaceModeRegularExpression, Qt::CaseSensitive, true), 2);
+    QCOMPARE(_model->findReplace("b$", "", ReplaceKey, ReplaceModeRegularExpression), 2);
+    QCOMPARE(_model->index(3, PlistTreeItem::COLUMN_KEY, sourceRoot).data().toString(), QString("ab"));
+}
+
+
+void PlistModelTests::insertManyRows()
+{
+    // More rows than are placed one at a time, so they're appended and then sorted.
+    QVERIFY(_sort->insertRows(2, 200, root()));
+    QCOMPARE(_sort->rowCount(root()), 205);
+    QVERIFY(isSorted(keys(root())));
+
+    QVERIFY(_model->removeRows(0, 150, _model->index(0, 0)));
+    QCOMPARE(_sort->rowCount(root()), 55);
+    QVERIFY(isSorted(keys(root())));
+}
+
+
+void PlistModelTests::insertAndRemoveManyRows()
+{
+    QModelIndex sourceRoot = _model->index(0, 0);
+    PlistTreeItem *rootItem = _model->itemAtIndex(sourceRoot);
+    quint32 seed = 1;
+
+    // A fixed sequence of runs inserted and removed all over the place, checking every row after each.
+    for( int round = 0; round < 200; ++round )
+    {
+        seed = seed * 1103515245 + 12345;
+        const int childCount = rootItem->childCount();
+        const int count = 1 + static_cast<int>((seed >> 16) % 50);
+        int row = static_cast<int>((seed >> 8) % (childCount + 1));
+
+        if ( (seed & 0x10) != 0 || childCount < count ) {
+            QVERIFY(_model->insertRows(row, count, sourceRoot));
+        } else {
+            row = qMin(row, childCount - count);
+            QVERIFY(_model->removeRows(row, count, sourceRoot));
+        }
+
+        QCOMPARE(_model->rowCount(sourceRoot), rootItem->childCount());
+
+        for( int i = 0; i < rootItem->childCount(); ++i ) {
+            PlistTreeItem *child = rootItem->child(i);
+            QCOMPARE(child->row(), i);
+            QVERIFY(rootItem->childForKey(child->key()) == child);
+        }
+    }
+
+    QVERIFY(isSorted(keys(root())));
+}
+
+
+void PlistModelTests::filterSortedRows()
+{
+    _filter->setFilterText("ha");
+    QCOMPARE(keys(root()), QStringList() << "alpha" << "charlie");
+
+    QVERIFY(_sort->setData(_sort->index(1, PlistTreeItem::COLUMN_KEY, root()), "aha"));
+    QCOMPARE(keys(root()), QStringList() << "aha" << "alpha");
+
+    _filter->setFilterText(QString());
+    QCOMPARE(keys(root()), QStringList() << "aha" << "alpha" << "bravo" << "delta" << "echo");
+}
+
+
+void PlistModelTests::filterEditedHiddenRows()
+{
+    _filter->setFilterText("al");
+    QCOMPARE(keys(root()), QStringList() << "alpha");
+
+    // 'echo' is hidden, but changes to match what's typed next.
+    QModelIndex sourceRoot = _model->index(0, 0);
+    QVERIFY(_model->setData(_model->index(2, PlistTreeItem::COLUMN_KEY, sourceRoot), "algebra"));
+
+    _filter->setFilterText("alg");
+    QCOMPARE(keys(root()), QStringList() << "algebra");
+}
+
+
+void PlistModelTests::filterKeepsExpandedRows()
+{
+    QSignalSpy resets(_filter, SIGNAL(modelAboutToBeReset()));
+    QPersistentModelIndex charlie = _sort->index(2, PlistTreeItem::COLUMN_KEY, root());
+    QCOMPARE(charlie.data().toString(), QString("charlie"));
+
+    // Rows come and go one run at a time, so the ones that stay are still the same rows.
+    _filter->setFilterText("a");
+    _filter->setFilterText("ar");
+    QCOMPARE(keys(root()), QStringList() << "charlie");
+
+    _filter->setFilterText("a");
+    _filter->setFilterText(QString());
+    QCOMPARE(keys(root()), QStringList() << "alpha" << "bravo" << "charlie" << "delta" << "echo");
+
+    QCOMPARE(resets.count(), 0);
+    QVERIFY(charlie.isValid());
+    QCOMPARE(charlie.data().toString(), QString("charlie"));
+}
+
+
+void PlistModelTests::filterLazyModel()
+{
+    QTemporaryFile file;
+    QScopedPointer<PlistTreeModel> lazyModel(readLazyModel(LAZY_PLIST, file));
+    QVERIFY(lazyModel);
+    PlistTreeModel &model = *lazyModel;
+    PlistTreeFilterModel filter(&model);
+    PlistTreeSortModel sort(&filter);
+
+    // Testers would read everything as they look around, so until it has been read the
+    // signals are checked by hand: nothing may start before the last change has finished.
+    int depth = 0;
+    bool isNested = false;
+    auto begin = [&depth, &isNested]() { isNested = isNested || depth > 0; depth++; };
+    auto end = [&depth]() { depth--; };
+
+    connect(&filter, &QAbstractItemModel::modelAboutToBeReset, begin);
+    connect(&filter, &QAbstractItemModel::rowsAboutToBeInserted, begin);
+    connect(&filter, &QAbstractItemModel::rowsAboutToBeRemoved, begin);
+    connect(&filter, &QAbstractItemModel::modelReset, end);
+    connect(&filter, &QAbstractItemModel::rowsInserted, end);
+    connect(&filter, &QAbstractItemModel::rowsRemoved, end);
+
+    QModelIndex sourceRoot = model.index(0, 0);
+    QVERIFY(model.canFetchMore(model.index(0, 0, sourceRoot)));
+
+    filter.setFilterText("needle");
+    QVERIFY(!isNested);
+    QCOMPARE(depth, 0);
+    QVERIFY(!model.canFetchMore(model.index(0, 0, sourceRoot)));
+    QCOMPARE(filter.matchCount(), 2);
+
+    // Now that everything has been read, the testers can look at it all.
+    QAbstractItemModelTester modelTester(&model, QAbstractItemModelTester::FailureReportingMode::QtTest);
+    QAbstractItemModelTester filterTester(&filter, QAbstractItemModelTester::FailureReportingMode::QtTest);
+    QAbstractItemModelTester sortTester(&sort, QAbstractItemModelTester::FailureReportingMode::QtTest);
+
+    QModelIndex proxyRoot = sort.index(0, 0);
+    QCOMPARE(sort.rowCount(proxyRoot), 2);
+    QCOMPARE(sort.index(0, PlistTreeItem::COLUMN_KEY, proxyRoot).data().toString(), QString("alpha"));
+    QCOMPARE(sort.rowCount(sort.index(0, 0, proxyRoot)), 1);
+    QCOMPARE(sort.rowCount(sort.index(1, 0, proxyRoot)), 1);
+
+    filter.setFilterText("needle in");
+    QCOMPARE(filter.matchCount(), 1);
+    QCOMPARE(sort.rowCount(proxyRoot), 1);
+
+    filter.setFilterText(QString());
+    QVERIFY(!isNested);
+    QCOMPARE(sort.rowCount(proxyRoot), 3);
+}
+
+
+void PlistModelTests::fetchUnreadableChildren()
+{
+    QTemporaryFile file;
+    QScopedPointer<PlistTreeModel> lazyModel(readLazyModel(BROKEN_PLIST, file));
+    QVERIFY(lazyModel);
+    PlistTreeModel &model = *lazyModel;
+    QSignalSpy failures(&model, SIGNAL(fetchFailed(QModelIndex)));
+
+    QModelIndex sourceRoot = model.index(0, 0);
+    QModelIndex broken = model.index(0, 0, sourceRoot);
+    QVERIFY(model.canFetchMore(broken));
+
+    // It fails once, and then stays unread without the file being scanned again.
+    model.fetchMore(broken);
+    QCOMPARE(failures.count(), 1);
+    QVERIFY(!model.canFetchMore(broken));
+    QVERIFY(model.hasChildren(broken));
+    QCOMPARE(model.rowCount(broken), 0);
+    QVERIFY(model.hasUnreadableItems());
+
+    model.fetchMore(broken);
+    model.fetchAll();
+    QCOMPARE(failures.count(), 1);
+
+    // Nothing can be added among the children that couldn't be read...
+    QVERIFY(!model.insertRows(0, 1, broken));
+
+    // ...but once it's gone, the rest of the tree is complete.
+    QVERIFY(model.removeRows(0, 1, sourceRoot));
+    QVERIFY(!model.hasUnreadableItems());
+}
+
+
+void PlistModelTests::fetchAllInBackground()
+{
+    QTemporaryFile file;
+    QScopedPointer<PlistTreeModel> lazyModel(readLazyModel(LAZY_PLIST, file));
+    QVERIFY(lazyModel);
+    PlistTreeModel &model = *lazyModel;
+    QModelIndex sourceRoot = model.index(0, 0);
+
+    QVector<PlistLazyTreeReader::Subtree> subtrees;
+    PlistLazyTreeReader *fetchReader = model.beginFetchAll(subtrees);
+    QVERIFY(fetchReader != nullptr);
+    QCOMPARE(subtrees.count(), 2);
+
+    // Only one read at a time.
+    QVector<PlistLazyTreeReader::Subtree> others;
+    QVERIFY(model.beginFetchAll(others) == nullptr);
+
+    // This is what the loader's worker does, into an arena of its own.
+    PlistTreeArena *fetchArena = new PlistTreeArena();
+    QVERIFY(fetchReader->readSubtrees(subtrees, fetchArena));
+
+    // Meanwhile the view reads one of them itself.
+    model.fetchMore(model.index(0, 0, sourceRoot));
+    QCOMPARE(model.rowCount(model.index(0, 0, sourceRoot)), 2);
+
+    model.endFetchAll(subtrees, fetchArena);
+    delete fetchArena;
+
+    QVERIFY(!model.hasUnfetchedItems());
+    QCOMPARE(model.rowCount(model.index(0, 0, sourceRoot)), 2);
+
+    // Everything below the other one came in the same pass.
+    QModelIndex bravo = model.index(1, 0, sourceRoot);
+    QCOMPARE(model.rowCount(bravo), 2);
+    QVERIFY(!model.canFetchMore(model.index(1, 0, bravo)));
+    QCOMPARE(model.rowCount(model.index(1, 0, bravo)), 1);
+    QCOMPARE(model.index(0, PlistTreeItem::COLUMN_VALUE, model.index(1, 0, bravo)).data().toString(), QString("a needle in here"));
+
+    // The fetched items now belong to the document.
+    QVERIFY(model.itemAtIndex(model.index(1, 0, bravo))->arena() == model.arena());
+
+    QAbstractItemModelTester modelTester(&model, QAbstractItemModelTester::FailureReportingMode::QtTest);
+}
+
+
+void PlistModelTests::searchIndexLazyModel()
+{
+    QTemporaryFile file;
+    QScopedPointer<PlistTreeModel> lazyModel(readLazyModel(LAZY_PLIST, file));
+    QVERIFY(lazyModel);
+    PlistTreeModel &model = *lazyModel;
+
+    // The index only covers what has been read, and doesn't read any more for itself.
+    QSignalSpy ready(&model, SIGNAL(searchIndexReady()));
+    model.buildSearchIndex();
+    QVERIFY(ready.count() > 0 || ready.wait());
+    QVERIFY(model.hasUnfetchedItems());
+    QVERIFY(model.canFetchMore(model.index(0, 0, model.index(0, 0))));
+
+    QCOMPARE(model.countMatches("needle", ReplaceAll), 0);
+    QCOMPARE(model.countMatches("needle", ReplaceAll, ReplaceModeRegularExpression), 0);
+
+    // Whatever is read later on is added as it arrives.
+    model.fetchMore(model.index(0, 0, model.index(0, 0)));
+    QCOMPARE(model.countMatches("needle", ReplaceAll), 1);
+
+    model.fetchAll();
+    QCOMPARE(model.countMatches("needle", ReplaceAll), 2);
+    QCOMPARE(model.countMatches("needle", ReplaceAll, ReplaceModeRegularExpression), 2);
+}
+
+
+void PlistModelTests::saveRenamedDuplicateKeys()
+{
+    QTemporaryFile file;
+    QScopedPointer<PlistTreeModel> lazyModel(readLazyModel(DUPLICATE_PLIST, file));
+    QVERIFY(lazyModel);
+
+    // Renamed keys mean the file's bytes can't be copied back out, whichever reader read them...
+    PlistTreeArena arena;
+    PlistTreeSource source;
+    PlistTreeReader reader;
+    reader.setArena(&arena);
+    reader.setSource(&source);
+
+    QString fileName = file.fileName();
+    PlistTreeItem *root = reader.readTreeFromFile(fileName);
+    QVERIFY(root != nullptr);
+
+    QString xml;
+    PlistTreeWriter writer;
+    writer.setSource(&source);
+    QVERIFY(writer.writeTreeToString(root, &xml));
+    QCOMPARE(xml.count("<key>dup</key>"), 1);
+    QCOMPARE(xml.count("<key>deep</key>"), 1);
+
+    // ...and however far down they are when read lazily.
+    lazyModel->fetchAll();
+    xml.clear();
+    writer.setSource(lazyModel->source());
+    QVERIFY(writer.writeTreeToString(lazyModel->visibleRoot(), &xml));
+    QCOMPARE(xml.count("<key>dup</key>"), 1);
+    QCOMPARE(xml.count("<key>deep</key>"), 1);
+
+    // Reading one level at a time catches them as well.
+    QTemporaryFile otherFile;
+    QScopedPointer<PlistTreeModel> otherModel(readLazyModel(DUPLICATE_PLIST, otherFile));
+    QVERIFY(otherModel);
+
+    QModelIndex outer = otherModel->index(2, 0, otherModel->index(0, 0));
+    otherModel->fetchMore(outer);
+    otherModel->fetchMore(otherModel->index(0, 0, outer));
+    xml.clear();
+    writer.setSource(otherModel->source());
+    QVERIFY(writer.writeTreeToString(otherModel->visibleRoot(), &xml));
+    QCOMPARE(xml.count("<key>deep</key>"), 1);
+}
+
+
+void PlistModelTests::addChildToEmptyDictionary()
+{
+    QModelIndex sourceRoot = _model->index(0, 0);
+    QVERIFY(_model->setData(_model->index(0, PlistTreeItem::COLUMN_TYPE, sourceRoot), "Dictionary"));
+
+    // The view has counted the (no) rows of the new dictionary, but never asked for one.
+    QModelIndex dictionary = _sort->mapFromSource(_filter->mapFromSource(_model->index(0, 0, sourceRoot)));
+    QCOMPARE(_sort->rowCount(dictionary), 0);
+
+    QVERIFY(_model->insertRows(0, 2, _model->index(0, 0, sourceRoot)));
+    QCOMPARE(_sort->rowCount(dictionary), 2);
+    QVERIFY(isSorted(keys(dictionary)));
+
+    QVERIFY(_model->removeRows(1, 1, _model->index(0, 0, sourceRoot)));
+    QCOMPARE(_sort->rowCount(dictionary), 1);
+}
+
+
+//
+// Private
+//
+
+
+PlistTreeModel * PlistModelTests::readLazyModel(const char *xml, QTemporaryFile &file) const
+{
+    if ( !file.open() ) {
+        return nullptr;
+    }
+
+    file.write(xml);
+    file.close();
+
+    PlistTreeArena *arena = new PlistTreeArena();
+    PlistTreeSource *source = new PlistTreeSource();
+    PlistLazyTreeReader *reader = new PlistLazyTreeReader();
+    reader->setArena(arena);
+    reader->setSource(source);
+
+    QString fileName = file.fileName();
+    PlistTreeItem *lazyRoot = reader->readTreeFromFile(fileName);
+
+    if ( lazyRoot == nullptr ) {
+        delete reader;
+        delete source;
+        delete arena;
+        return nullptr;
+    }
+
+    return new PlistTreeModel(lazyRoot, arena, reader, source);
+}
+
+
+QModelIndex PlistModelTests::root() const
+{
+    return _sort->index(0, 0);
+}
+
+
+QStringList PlistModelTests::keys(const QModelIndex &parent) const
+{
+    QStringList keys;
+
+    for( int row = 0; row < _sort->rowCount(parent); ++row ) {
+        keys.append(_sort->index(row, PlistTreeItem::COLUMN_KEY, parent).data().toString());
+    }
+
+    return keys;
+}
+
+
+bool PlistModelTests::isSorted(const QStringList &keys) const
+{
+    QCollator collator;
+    collator.setNumericMode(true);
+    collator.setCaseSensitivity(Qt::CaseInsensitive);
+
+    for( int i = 1; i < keys.count(); ++i )
+    {
+        if ( collator.compare(keys.at(i - 1), keys.at(i)) > 0 ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+void PlistModelTests::insertKeys(const QStringList &keys)
+{
+    QModelIndex sourceRoot = _model->index(0, 0);
+    QVERIFY(_model->insertRows(0, keys.count(), sourceRoot));
+
+    for( int row = 0; row < keys.count(); ++row ) {
+        QVERIFY(_model->setData(_model->index(row, PlistTreeItem::COLUMN_KEY, sourceRoot), keys.at(row)));
+    }
+}
+
+
+QTEST_GUILESS_MAIN(PlistModelTests)
+
+#include "PlistModelTests.moc"
@@ -0,0 +1,14 @@
+#-------------------------------------------------
+#
+# Tree model, filter and sort proxy tests.
+#
+# QAbstractItemModelTester needs Qt 5.11 or later.
+#
+#-------------------------------------------------
+
+TARGET = PlistModelTests
+
+SOURCES += \
+    PlistModelTests.cpp
+
+include(../tests.pri)
@@ -0,0 +1,224 @@
+#include <QtTest>
+
+#include <algorithm>
+
+#include "PlistTreeItem.h"
+#include "PlistSearchIndex.h"
+
+
+namespace {
+    const char *WORDS[] = { "Apple", "apple pie", "Banana", "CHERRY", "com.example.App", "Bundle Identifier",
+                            "Version", "caf\xc3\xa9", "ab", "a" };
+    const int WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+
+    QString Word(int i)
+    {
+        return QString::fromUtf8(WORDS[i % WORD_COUNT]);
+    }
+
+    // Entries sharing a small vocabulary, so most trigrams turn up in many places.
+    QVariantMap Entry(int i)
+    {
+        QVariantList tags = QVariantList{Word(i + 1), Word(i * 3), Word(i * 7) + " " + Word(i + 5)};
+        return QVariantMap{{"Name", Word(i)}, {"Tags", tags}, {"Count", i}, {"Nested", QVariantMap{{Word(i + 2), Word(i + 4)}}}};
+    }
+
+    // The same rule the index applies to its candidates, over every item in the tree.
+    void FullWalk(PlistTreeItem *item, const QString &text, ReplaceTarget target, Qt::CaseSensitivity cs, QList<PlistTreeItem*> &results)
+    {
+        const PlistTreeItem *parent = item->parent();
+        bool keyMatches = parent != nullptr && parent->shouldChildrenHaveKey() && item->key().contains(text, cs);
+        bool valueMatches = item->plistType() == PlistTreeItem::PlistString && item->value().string().contains(text, cs);
+
+        if ( (target != ReplaceValue && keyMatches) || (target != ReplaceKey && valueMatches) ) {
+            results.append(item);
+        }
+
+        for( int i = 0; i < item->childCount(); ++i ) {
+            FullWalk(item->child(i), text, target, cs, results);
+        }
+    }
+
+    QList<PlistTreeItem*> Sorted(QList<PlistTreeItem*> items)
+    {
+        std::sort(items.begin(), items.end());
+        return items;
+    }
+}
+
+
+/**
+ * @brief Checks that PlistSearchIndex finds exactly what a full walk of the tree finds, before and after edits.
+ */
+class PlistSearchIndexTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void matchesFullWalk_data();
+    void matchesFullWalk();
+    void limitResults();
+    void notBuilt();
+    void edits();
+    void editsDuringBuild();
+
+private:
+    PlistTreeItem *_root;
+};
+
+
+void PlistSearchIndexTests::init()
+{
+    QVariantMap entries;
+
+    for( int i = 0; i < 200; ++i ) {
+        entries.insert(QString("Entry %1 %2").arg(i, 3, 10, QChar('0')).arg(Word(i)), Entry(i));
+    }
+
+    _root = PlistTreeItem::Create(nullptr, entries);
+}
+
+
+void PlistSearchIndexTests::cleanup()
+{
+    delete _root;
+    _root = nullptr;
+}
+
+
+void PlistSearchIndexTests::matchesFullWalk_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<int>("cs");
+
+    // Shorter than a trigram, exactly one, several, across a space, and in nothing at all.
+    QTest::newRow("one character") << "a" << int(Qt::CaseSensitive);
+    QTest::newRow("two characters") << "Ap" << int(Qt::CaseSensitive);
+    QTest::newRow("trigram") << "App" << int(Qt::CaseSensitive);
+    QTest::newRow("trigram insensitive") << "App" << int(Qt::CaseInsensitive);
+    QTest::newRow("word") << "apple" << int(Qt::CaseSensitive);
+    QTest::newRow("word insensitive") << "APPLE" << int(Qt::CaseInsensitive);
+    QTest::newRow("across words") << "ple pi" << int(Qt::CaseSensitive);
+    QTest::newRow("key only") << "Entry 01" << int(Qt::CaseSensitive);
+    QTest::newRow("accent") << QString::fromUtf8("CAF\xc3\x89") << int(Qt::CaseInsensitive);
+    QTest::newRow("nowhere") << "zzz" << int(Qt::CaseSensitive);
+    QTest::newRow("trigrams apart") << "Appna" << int(Qt::CaseInsensitive);
+}
+
+
+void PlistSearchIndexTests::matchesFullWalk()
+{
+    QFETCH(QString, text);
+    QFETCH(int, cs);
+
+    PlistSearchIndex index;
+    index.build(_root);
+    QTRY_VERIFY(index.isReady());
+
+    const ReplaceTarget targets[] = { ReplaceKey, ReplaceValue, ReplaceAll };
+
+    for( int i = 0; i < 3; ++i )
+    {
+        QList<PlistTreeItem*> expected;
+        FullWalk(_root, text, targets[i], Qt::CaseSensitivity(cs), expected);
+
+        // A fresh index numbers items in tree order, so even the order matches.
+        QCOMPARE(index.find(text, targets[i], Qt::CaseSensitivity(cs)), expected);
+    }
+}
+
+
+void PlistSearchIndexTests::limitResults()
+{
+    PlistSearchIndex index;
+    index.build(_root);
+    QTRY_VERIFY(index.isReady());
+
+    QList<PlistTreeItem*> all = index.find("Apple", ReplaceAll);
+    QVERIFY(all.count() > 5);
+    QCOMPARE(index.find("Apple", ReplaceAll, Qt::CaseSensitive, 5), all.mid(0, 5));
+    QVERIFY(index.find("Apple", ReplaceAll, Qt::CaseSensitive, 0).isEmpty());
+}
+
+
+void PlistSearchIndexTests::notBuilt()
+{
+    PlistSearchIndex index;
+    QVERIFY(!index.isReady());
+    QVERIFY(index.find("Apple", ReplaceAll).isEmpty());
+
+    // Edits before any build are ignored rather than half indexed.
+    index.updateItem(_root->child(0));
+    QVERIFY(index.find("Apple", ReplaceAll).isEmpty());
+}
+
+
+void PlistSearchIndexTests::edits()
+{
+    PlistSearchIndex index;
+    index.build(_root);
+    QTRY_VERIFY(index.isReady());
+
+    // A changed value and a renamed key.
+    PlistTreeItem *entry = _root->child(10);
+    PlistTreeItem *name = entry->childForKey("Name");
+    name->setValueAndType(QVariant(QString("Quince")));
+    index.updateItem(name);
+    QVERIFY(entry->setKey("Quince entry"));
+    index.updateItem(entry);
+
+    // A new entry, and a removed one.
+    PlistTreeItem *added = PlistTreeItem::Create(nullptr, Entry(3), "Quince added");
+    QVERIFY(_root->aendChild(added));
+    index.addSubtree(added);
+
+    index.removeSubtree(_root->child(20));
+    QVERIFY(_root->removeChildAtIndex(20));
+
+    const QString texts[] = { "Quince", "quince entry", "Apple", "Banana", "a" };
+
+    for( int i = 0; i < 5; ++i )
+    {
+        QList<PlistTreeItem*> expected;
+        FullWalk(_root, texts[i], ReplaceAll, Qt::CaseInsensitive, expected);
+        QCOMPARE(Sorted(index.find(texts[i], ReplaceAll, Qt::CaseInsensitive)), Sorted(expected));
+    }
+}
+
+
+void PlistSearchIndexTests::editsDuringBuild()
+{
+    PlistSearchIndex index;
+    index.build(_root);
+
+    // Made before the worker's index is in place, so they have to be applied once it is.
+    PlistTreeItem *name = _root->child(30)->childForKey("Name");
+    name->setValueAndType(QVariant(QString("Quince")));
+    index.updateItem(name);
+
+    index.removeSubtree(_root->child(40));
+    QVERIFY(_root->removeChildAtIndex(40));
+
+    PlistTreeItem *added = PlistTreeItem::Create(nullptr, QVariantMap{{"Name", "Quince too"}}, "Added");
+    QVERIFY(_root->aendChild(added));
+    index.addSubtree(added);
+
+    QTRY_VERIFY(index.isReady());
+
+    const QString texts[] = { "Quince", "Entry 040", "Apple" };
+
+    for( int i = 0; i < 3; ++i )
+    {
+        QList<PlistTreeItem*> expected;
+        FullWalk(_root, texts[i], ReplaceAll, Qt::CaseSensitive, expected);
+        QCOMPARE(Sorted(index.find(texts[i], ReplaceAll)), Sorted(expected));
+    }
+}
+
+
+QTEST_GUILESS_MAIN(PlistSearchIndexTests)
+
+#include "PlistSearchIndexTests.moc"
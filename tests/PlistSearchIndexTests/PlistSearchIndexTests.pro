@@ -0,0 +1,12 @@
+#-------------------------------------------------
+#
+# Trigram search index tests.
+#
+#-------------------------------------------------
+
+TARGET = PlistSearchIndexTests
+
+SOURCES += \
+    PlistSearchIndexTests.cpp
+
+include(../tests.pri)
@@ -0,0 +1,226 @@
+#include <QtTest>
+
+#include "PlistTreeItem.h"
+#include "PlistTreeDiff.h"
+
+
+namespace {
+    PlistTreeItem *Tree(const QVariant &value)
+    {
+        return PlistTreeItem::Create(nullptr, value);
+    }
+
+    // Each level holds the next one twice, once in an array and once in a dictionary.
+    QVariant Nested(int depth, const QString &leaf)
+    {
+        if ( depth == 0 ) {
+            return leaf;
+        }
+
+        return QVariantList{Nested(depth - 1, leaf), QVariantMap{{"k", Nested(depth - 1, leaf)}}};
+    }
+}
+
+
+/**
+ * @brief Checks the edit scripts PlistTreeDiff produces, and how it pairs up array elements.
+ */
+class PlistTreeDiffTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void identicalTrees();
+    void dictionaryEdits();
+    void typeChanges();
+    void arrayInsertion();
+    void pairUnmatchedElements();
+    void matchChildren();
+    void missingRoots();
+    void unfetchedContainers();
+    void parallelHashes();
+
+private:
+    PlistTreeDiff _diff;
+};
+
+
+void PlistTreeDiffTests::identicalTrees()
+{
+    // Dictionary order doesn't count as a difference.
+    QScopedPointer<PlistTreeItem> oldTree(Tree(QVariantMap{{"a", 1}, {"b", 2}}));
+    QScopedPointer<PlistTreeItem> newTree(PlistTreeItem::Create(nullptr, PlistTreeItem::PlistDictionary));
+    newTree->aendChild(PlistTreeItem::Create(nullptr, QVariant(2), "b"));
+    newTree->aendChild(PlistTreeItem::Create(nullptr, QVariant(1), "a"));
+
+    QVERIFY(!_diff.compare(oldTree.data(), newTree.data()));
+    QVERIFY(_diff.edits().isEmpty());
+}
+
+
+void PlistTreeDiffTests::dictionaryEdits()
+{
+    QScopedPointer<PlistTreeItem> oldTree(Tree(QVariantMap{{"a", 1}, {"b", 2}, {"c", 3}}));
+    QScopedPointer<PlistTreeItem> newTree(Tree(QVariantMap{{"a", 1}, {"b", 5}, {"d", 4}}));
+
+    QVERIFY(_diff.compare(oldTree.data(), newTree.data()));
+    QCOMPARE(_diff.edits().count(), 3);
+
+    // Old keys in order, then the new ones.
+    const PlistTreeDiff::Edit &changed = _diff.edits().at(0);
+    QCOMPARE(changed.type, PlistTreeDiff::EditChanged);
+    QCOMPARE(changed.oldItem->key(), QString("b"));
+    QCOMPARE(changed.oldItem->value().integer(), qint64(2));
+    QCOMPARE(changed.newItem->value().integer(), qint64(5));
+
+    const PlistTreeDiff::Edit &removed = _diff.edits().at(1);
+    QCOMPARE(removed.type, PlistTreeDiff::EditRemoved);
+    QCOMPARE(removed.oldItem->key(), QString("c"));
+    QVERIFY(removed.newItem == nullptr);
+
+    const PlistTreeDiff::Edit &added = _diff.edits().at(2);
+    QCOMPARE(added.type, PlistTreeDiff::EditAdded);
+    QVERIFY(added.oldItem == nullptr);
+    QCOMPARE(added.newItem->key(), QString("d"));
+}
+
+
+void PlistTreeDiffTests::typeChanges()
+{
+    // A leaf changing type, and a container changing kind, are each one change.
+    QScopedPointer<PlistTreeItem> oldTree(Tree(QVariantMap{{"a", 1}, {"b", QVariantList{1, 2}}}));
+    QScopedPointer<PlistTreeItem> newTree(Tree(QVariantMap{{"a", "1"}, {"b", QVariantMap{{"x", 1}}}}));
+
+    QVERIFY(_diff.compare(oldTree.data(), newTree.data()));
+    QCOMPARE(_diff.edits().count(), 2);
+    QCOMPARE(_diff.countEdits(PlistTreeDiff::EditChanged), 2);
+    QCOMPARE(_diff.edits().at(0).newItem->plistType(), PlistTreeItem::PlistString);
+    QCOMPARE(_diff.edits().at(1).oldItem->plistType(), PlistTreeItem::PlistArray);
+    QCOMPARE(_diff.edits().at(1).newItem->plistType(), PlistTreeItem::PlistDictionary);
+}
+
+
+void PlistTreeDiffTests::arrayInsertion()
+{
+    QScopedPointer<PlistTreeItem> oldTree(Tree(QVariantList{1, 2, 3}));
+    QScopedPointer<PlistTreeItem> newTree(Tree(QVariantList{1, 9, 2, 3}));
+
+    // Aligned by content, so only the new element shows up rather than three changes.
+    QVERIFY(_diff.compare(oldTree.data(), newTree.data()));
+    QCOMPARE(_diff.edits().count(), 1);
+    QCOMPARE(_diff.edits().at(0).type, PlistTreeDiff::EditAdded);
+    QCOMPARE(_diff.edits().at(0).newItem->row(), 1);
+    QCOMPARE(_diff.edits().at(0).newItem->value().integer(), qint64(9));
+}
+
+
+void PlistTreeDiffTests::pairUnmatchedElements()
+{
+    QVariantMap first = QVariantMap{{"a", 1}, {"x", 0}};
+    QVariantMap edited = QVariantMap{{"a", 2}, {"x", 0}};
+    QVariantMap second = QVariantMap{{"b", 1}};
+
+    QScopedPointer<PlistTreeItem> oldTree(Tree(QVariantList{1, first, second, 4}));
+    QScopedPointer<PlistTreeItem> newTree(Tree(QVariantList{1, edited, 4}));
+
+    // The elements left between matches are paired by position, so the edit is found inside
+    // the first one, and only the second one is removed.
+    QVERIFY(_diff.compare(oldTree.data(), newTree.data()));
+    QCOMPARE(_diff.edits().count(), 2);
+
+    const PlistTreeDiff::Edit &changed = _diff.edits().at(0);
+    QCOMPARE(changed.type, PlistTreeDiff::EditChanged);
+    QCOMPARE(changed.oldItem->key(), QString("a"));
+    QCOMPARE(changed.oldItem->parent(), oldTree->child(1));
+    QCOMPARE(changed.newItem->parent(), newTree->child(1));
+
+    const PlistTreeDiff::Edit &removed = _diff.edits().at(1);
+    QCOMPARE(removed.type, PlistTreeDiff::EditRemoved);
+    QCOMPARE(removed.oldItem, static_cast<const PlistTreeItem*>(oldTree->child(2)));
+}
+
+
+void PlistTreeDiffTests::matchChildren()
+{
+    QScopedPointer<PlistTreeItem> oldTree(Tree(QVariantList{1, 2, 3, 4}));
+    QScopedPointer<PlistTreeItem> same(Tree(QVariantList{1, 2, 3, 4}));
+    QScopedPointer<PlistTreeItem> moved(Tree(QVariantList{4, 1, 3}));
+
+    QCOMPARE(PlistTreeDiff::MatchChildren(oldTree.data(), same.data()), QVector<int>() << 0 << 1 << 2 << 3);
+
+    // The longest common subsequence is 1, 3; matches only ever go forwards.
+    QCOMPARE(PlistTreeDiff::MatchChildren(oldTree.data(), moved.data()), QVector<int>() << 1 << -1 << 2 << -1);
+}
+
+
+void PlistTreeDiffTests::missingRoots()
+{
+    QScopedPointer<PlistTreeItem> tree(Tree(QVariantList{1}));
+
+    QVERIFY(!_diff.compare(nullptr, nullptr));
+
+    QVERIFY(_diff.compare(nullptr, tree.data()));
+    QCOMPARE(_diff.edits().count(), 1);
+    QCOMPARE(_diff.edits().at(0).type, PlistTreeDiff::EditAdded);
+
+    QVERIFY(_diff.compare(tree.data(), nullptr));
+    QCOMPARE(_diff.edits().count(), 1);
+    QCOMPARE(_diff.edits().at(0).type, PlistTreeDiff::EditRemoved);
+}
+
+
+void PlistTreeDiffTests::unfetchedContainers()
+{
+    QScopedPointer<PlistTreeItem> oldTree(Tree(QVariantMap{{"a", 1}}));
+    QScopedPointer<PlistTreeItem> newTree(Tree(QVariantMap{{"a", 1}}));
+    QScopedPointer<PlistTreeItem> empty(PlistTreeItem::Create(nullptr, PlistTreeItem::PlistDictionary));
+
+    PlistTreeItem *oldPending = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistDictionary, "p");
+    PlistTreeItem *newPending = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistDictionary, "p");
+    oldPending->setUnfetchedChildren(0, 3);
+    newPending->setUnfetchedChildren(0, 3);
+    oldTree->aendChild(oldPending);
+    newTree->aendChild(newPending);
+
+    // Nothing is known about what they hold, so they match neither each other nor an empty dictionary.
+    QVERIFY(oldPending->subtreeHash() != newPending->subtreeHash());
+    QVERIFY(oldPending->subtreeHash() != empty->subtreeHash());
+
+    // Nor are they looked inside, which would find nothing to report.
+    QVERIFY(_diff.compare(oldTree.data(), newTree.data()));
+    QCOMPARE(_diff.edits().count(), 1);
+    QCOMPARE(_diff.edits().at(0).type, PlistTreeDiff::EditChanged);
+    QCOMPARE(_diff.edits().at(0).oldItem, static_cast<const PlistTreeItem*>(oldPending));
+
+    // Once read, they're compared like anything else.
+    oldPending->clearFetchToken();
+    newPending->clearFetchToken();
+    QVERIFY(!_diff.compare(oldTree.data(), newTree.data()));
+}
+
+
+void PlistTreeDiffTests::parallelHashes()
+{
+    QScopedPointer<PlistTreeItem> serial(Tree(Nested(10, "leaf")));
+    QScopedPointer<PlistTreeItem> parallel(Tree(Nested(10, "leaf")));
+    QScopedPointer<PlistTreeItem> different(Tree(Nested(10, "leaf")));
+
+    // Only two children at the root, so the work has to be split further down to go round.
+    PlistTreeItem *leaf = different.data();
+
+    while( leaf->childCount() > 0 ) {
+        leaf = leaf->child(leaf->childCount() - 1);
+    }
+
+    leaf->setValueAndType(QVariant(QString("changed")));
+
+    QCOMPARE(PlistTreeItem::ComputeHashesInParallel(parallel.data()), serial->subtreeHash());
+    QCOMPARE(parallel->child(1)->child(0)->subtreeHash(), serial->child(1)->child(0)->subtreeHash());
+    QVERIFY(PlistTreeItem::ComputeHashesInParallel(different.data()) != serial->subtreeHash());
+    QVERIFY(PlistTreeItem::ComputeHashesInParallel(nullptr) == 0);
+}
+
+
+QTEST_GUILESS_MAIN(PlistTreeDiffTests)
+
+#include "PlistTreeDiffTests.moc"
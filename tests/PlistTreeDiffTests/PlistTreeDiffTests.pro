@@ -0,0 +1,12 @@
+#-------------------------------------------------
+#
+# Structural diff tests.
+#
+#-------------------------------------------------
+
+TARGET = PlistTreeDiffTests
+
+SOURCES += \
+    PlistTreeDiffTests.cpp
+
+include(../tests.pri)
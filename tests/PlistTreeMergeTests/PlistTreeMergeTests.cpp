@@ -0,0 +1,233 @@
+#include <QtTest>
+
+#include "PlistTreeItem.h"
+#include "PlistTreeMerge.h"
+
+
+namespace {
+    // Variants are plenty for these trees; dictionary order never matters to the merge.
+    PlistTreeItem *Tree(const QVariant &value)
+    {
+        return value.isValid() ? PlistTreeItem::Create(nullptr, value) : nullptr;
+    }
+
+    qint64 IntegerForKey(const PlistTreeItem *item, const QString &key)
+    {
+        const PlistTreeItem *child = item->childForKey(key);
+        return (child != nullptr) ? child->value().integer() : -1;
+    }
+
+    QList<qint64> Integers(const PlistTreeItem *array)
+    {
+        QList<qint64> integers;
+
+        for( int i = 0; i < array->childCount(); ++i ) {
+            integers.append(array->child(i)->value().integer());
+        }
+
+        return integers;
+    }
+}
+
+
+/**
+ * @brief Checks what PlistTreeMerge makes of the three versions of a tree.
+ *
+ * Every test builds a base, ours and theirs from variants, merges them and looks at the result,
+ * including the conflict dictionaries left where both sides changed the same thing.
+ */
+class PlistTreeMergeTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void identicalSides();
+    void oneSidedEdits();
+    void deleteAgainstModify();
+    void addedWithoutBase();
+    void arrayInsertions();
+    void arrayInsertionConflict();
+    void conflictMarker();
+
+private:
+    PlistTreeItem *merge(const QVariant &base, const QVariant &ours, const QVariant &theirs);
+
+    PlistTreeMerge _merger;
+};
+
+
+void PlistTreeMergeTests::identicalSides()
+{
+    QVariantMap base = QVariantMap{{"a", 1}, {"b", 2}};
+    QVariantMap changed = QVariantMap{{"a", 5}, {"b", 2}};
+
+    // Both sides made the same change.
+    QScopedPointer<PlistTreeItem> merged(merge(base, changed, changed));
+    QCOMPARE(_merger.conflictCount(), 0);
+    QCOMPARE(merged->childCount(), 2);
+    QCOMPARE(IntegerForKey(merged.data(), "a"), qint64(5));
+    QCOMPARE(IntegerForKey(merged.data(), "b"), qint64(2));
+
+    // Nobody changed anything.
+    QScopedPointer<PlistTreeItem> unchanged(merge(base, base, base));
+    QScopedPointer<PlistTreeItem> expected(Tree(base));
+    QCOMPARE(_merger.conflictCount(), 0);
+    QCOMPARE(unchanged->subtreeHash(), expected->subtreeHash());
+}
+
+
+void PlistTreeMergeTests::oneSidedEdits()
+{
+    QVariantMap base = QVariantMap{{"a", 1}, {"b", 1}, {"c", 1}, {"n", QVariantMap{{"x", 1}, {"y", 1}}}};
+    QVariantMap ours = QVariantMap{{"a", 2}, {"b", 1}, {"c", 1}, {"d", 4}, {"n", QVariantMap{{"x", 2}, {"y", 1}}}};
+    QVariantMap theirs = QVariantMap{{"a", 1}, {"b", 3}, {"n", QVariantMap{{"x", 1}, {"y", 3}}}};
+
+    QScopedPointer<PlistTreeItem> merged(merge(base, ours, theirs));
+    QCOMPARE(_merger.conflictCount(), 0);
+
+    QCOMPARE(IntegerForKey(merged.data(), "a"), qint64(2));     // Ours
+    QCOMPARE(IntegerForKey(merged.data(), "b"), qint64(3));     // Theirs
+    QVERIFY(merged->childForKey("c") == nullptr);               // Removed by them
+    QCOMPARE(IntegerForKey(merged.data(), "d"), qint64(4));     // Added by us
+
+    // Edits to different keys of the same dictionary are merged inside it.
+    const PlistTreeItem *nested = merged->childForKey("n");
+    QVERIFY(nested != nullptr);
+    QCOMPARE(IntegerForKey(nested, "x"), qint64(2));
+    QCOMPARE(IntegerForKey(nested, "y"), qint64(3));
+}
+
+
+void PlistTreeMergeTests::deleteAgainstModify()
+{
+    QVariantMap base = QVariantMap{{"a", 1}, {"b", 1}};
+    QVariantMap removed = QVariantMap{{"b", 1}};
+    QVariantMap modified = QVariantMap{{"a", 5}, {"b", 1}};
+
+    // We removed it, they changed it.
+    QScopedPointer<PlistTreeItem> merged(merge(base, removed, modified));
+    QCOMPARE(_merger.conflictCount(), 1);
+    QCOMPARE(IntegerForKey(merged.data(), "b"), qint64(1));
+
+    const PlistTreeItem *conflict = merged->childForKey("a");
+    QVERIFY(PlistTreeMerge::IsConflict(conflict));
+    QCOMPARE(IntegerForKey(conflict, "Base"), qint64(1));
+    QVERIFY(conflict->childForKey("Ours") == nullptr);
+    QCOMPARE(IntegerForKey(conflict, "Theirs"), qint64(5));
+
+    // The other way around.
+    merged.reset(merge(base, modified, removed));
+    QCOMPARE(_merger.conflictCount(), 1);
+
+    conflict = merged->childForKey("a");
+    QVERIFY(PlistTreeMerge::IsConflict(conflict));
+    QCOMPARE(IntegerForKey(conflict, "Base"), qint64(1));
+    QCOMPARE(IntegerForKey(conflict, "Ours"), qint64(5));
+    QVERIFY(conflict->childForKey("Theirs") == nullptr);
+
+    // Removing something the other side left alone is just a removal.
+    merged.reset(merge(base, removed, base));
+    QCOMPARE(_merger.conflictCount(), 0);
+    QVERIFY(merged->childForKey("a") == nullptr);
+}
+
+
+void PlistTreeMergeTests::addedWithoutBase()
+{
+    // Without a common ancestor, only what both sides agree on is free of conflicts.
+    QScopedPointer<PlistTreeItem> merged(merge(QVariant(), QVariantMap{{"a", 1}, {"b", 2}}, QVariantMap{{"a", 1}, {"b", 3}, {"c", 4}}));
+    QCOMPARE(_merger.conflictCount(), 1);
+    QCOMPARE(IntegerForKey(merged.data(), "a"), qint64(1));
+    QCOMPARE(IntegerForKey(merged.data(), "c"), qint64(4));
+
+    const PlistTreeItem *conflict = merged->childForKey("b");
+    QVERIFY(PlistTreeMerge::IsConflict(conflict));
+    QVERIFY(conflict->childForKey("Base") == nullptr);
+    QCOMPARE(IntegerForKey(conflict, "Ours"), qint64(2));
+    QCOMPARE(IntegerForKey(conflict, "Theirs"), qint64(3));
+}
+
+
+void PlistTreeMergeTests::arrayInsertions()
+{
+    QVariantList base = QVariantList{1, 2, 3};
+
+    // Insertions at different places both make it in.
+    QScopedPointer<PlistTreeItem> merged(merge(base, QVariantList{0, 1, 2, 3}, QVariantList{1, 2, 3, 4}));
+    QCOMPARE(_merger.conflictCount(), 0);
+    QCOMPARE(Integers(merged.data()), QList<qint64>() << 0 << 1 << 2 << 3 << 4);
+
+    // As do an insertion and a removal elsewhere.
+    merged.reset(merge(base, QVariantList{1, 7, 2, 3}, QVariantList{1, 2}));
+    QCOMPARE(_merger.conflictCount(), 0);
+    QCOMPARE(Integers(merged.data()), QList<qint64>() << 1 << 7 << 2);
+
+    // The same insertion on both sides is taken once.
+    merged.reset(merge(base, QVariantList{1, 8, 2, 3}, QVariantList{1, 8, 2, 3}));
+    QCOMPARE(_merger.conflictCount(), 0);
+    QCOMPARE(Integers(merged.data()), QList<qint64>() << 1 << 8 << 2 << 3);
+}
+
+
+void PlistTreeMergeTests::arrayInsertionConflict()
+{
+    // Different insertions at the same place conflict, but only over that run.
+    QScopedPointer<PlistTreeItem> merged(merge(QVariantList{1, 2, 3}, QVariantList{1, 8, 2, 3}, QVariantList{1, 9, 9, 2, 3}));
+    QCOMPARE(_merger.conflictCount(), 1);
+    QCOMPARE(merged->childCount(), 4);
+    QCOMPARE(merged->child(0)->value().integer(), qint64(1));
+    QCOMPARE(merged->child(2)->value().integer(), qint64(2));
+    QCOMPARE(merged->child(3)->value().integer(), qint64(3));
+
+    const PlistTreeItem *conflict = merged->child(1);
+    QVERIFY(PlistTreeMerge::IsConflict(conflict));
+    QCOMPARE(conflict->childForKey("Base")->childCount(), 0);
+    QCOMPARE(Integers(conflict->childForKey("Ours")), QList<qint64>() << 8);
+    QCOMPARE(Integers(conflict->childForKey("Theirs")), QList<qint64>() << 9 << 9);
+}
+
+
+void PlistTreeMergeTests::conflictMarker()
+{
+    QScopedPointer<PlistTreeItem> merged(merge(QVariantMap{{"a", 1}}, QVariantMap{{"a", 2}}, QVariantMap{{"a", "two"}}));
+    QCOMPARE(_merger.conflictCount(), 1);
+
+    // The conflict keeps the key it replaces, and leads with a true marker.
+    const PlistTreeItem *conflict = merged->childForKey("a");
+    QVERIFY(conflict != nullptr);
+    QCOMPARE(conflict->plistType(), PlistTreeItem::PlistDictionary);
+    QCOMPARE(conflict->child(0)->key(), QString(PlistTreeMerge::CONFLICT_KEY));
+    QCOMPARE(conflict->child(0)->plistType(), PlistTreeItem::PlistBoolean);
+    QVERIFY(conflict->child(0)->value().boolean());
+    QCOMPARE(conflict->childForKey("Theirs")->value().string(), QString("two"));
+
+    // Only a dictionary with a boolean marker counts.
+    QScopedPointer<PlistTreeItem> plain(Tree(QVariantMap{{"a", 1}}));
+    QScopedPointer<PlistTreeItem> stringMarker(Tree(QVariantMap{{PlistTreeMerge::CONFLICT_KEY, "yes"}}));
+    QScopedPointer<PlistTreeItem> array(Tree(QVariantList{true}));
+
+    QVERIFY(!PlistTreeMerge::IsConflict(nullptr));
+    QVERIFY(!PlistTreeMerge::IsConflict(plain.data()));
+    QVERIFY(!PlistTreeMerge::IsConflict(stringMarker.data()));
+    QVERIFY(!PlistTreeMerge::IsConflict(array.data()));
+}
+
+
+//
+// Private
+//
+
+
+PlistTreeItem * PlistTreeMergeTests::merge(const QVariant &base, const QVariant &ours, const QVariant &theirs)
+{
+    QScopedPointer<PlistTreeItem> baseTree(Tree(base));
+    QScopedPointer<PlistTreeItem> oursTree(Tree(ours));
+    QScopedPointer<PlistTreeItem> theirsTree(Tree(theirs));
+
+    return _merger.merge(baseTree.data(), oursTree.data(), theirsTree.data());
+}
+
+
+QTEST_GUILESS_MAIN(PlistTreeMergeTests)
+
+#include "PlistTreeMergeTests.moc"
@@ -0,0 +1,12 @@
+#-------------------------------------------------
+#
+# Three-way merge tests.
+#
+#-------------------------------------------------
+
+TARGET = PlistTreeMergeTests
+
+SOURCES += \
+    PlistTreeMergeTests.cpp
+
+include(../tests.pri)
@@ -0,0 +1,221 @@
+#include <QtTest>
+
+#include "PlistTreeItem.h"
+#include "PlistTreeQuery.h"
+
+
+namespace {
+    // What a match is called in the expected results: its name, or its value for integers.
+    QString Describe(const PlistTreeItem *item)
+    {
+        if ( item->plistType() == PlistTreeItem::PlistInteger ) {
+            return QString::number(item->value().integer());
+        }
+
+        const PlistTreeItem *name = item->childForKey("Name");
+        return (name != nullptr) ? name->value().string() : item->value().string();
+    }
+
+    QStringList Describe(const QList<PlistTreeItem*> &items)
+    {
+        QStringList descriptions;
+
+        for( int i = 0; i < items.count(); ++i ) {
+            descriptions.append(Describe(items.at(i)));
+        }
+
+        return descriptions;
+    }
+}
+
+
+/**
+ * @brief Checks that PlistTreeQuery rejects bad paths where they go wrong, and finds the right items for good ones.
+ */
+class PlistTreeQueryTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void parseErrors_data();
+    void parseErrors();
+    void slices_data();
+    void slices();
+    void predicates_data();
+    void predicates();
+    void limitResults();
+    void pathForItem();
+
+private:
+    PlistTreeItem *_numbers;            // [0, 1, ... 9]
+    PlistTreeItem *_shop;               // { Items: [ { Name, Price, Enabled }, ... ] }
+};
+
+
+void PlistTreeQueryTests::initTestCase()
+{
+    QVariantList numbers;
+
+    for( int i = 0; i < 10; ++i ) {
+        numbers.append(i);
+    }
+
+    _numbers = PlistTreeItem::Create(nullptr, numbers);
+
+    QVariantList items;
+    items.append(QVariantMap{{"Name", "Apple"}, {"Price", 5}, {"Enabled", true}});
+    items.append(QVariantMap{{"Name", "Banana"}, {"Price", 12.5}, {"Enabled", false}});
+    items.append(QVariantMap{{"Name", "Cherry"}, {"Price", 20}, {"Enabled", true}});
+    items.append(QVariantMap{{"Name", "Date"}});
+
+    _shop = PlistTreeItem::Create(nullptr, QVariantMap{{"Items", items}});
+}
+
+
+void PlistTreeQueryTests::cleanupTestCase()
+{
+    delete _numbers;
+    delete _shop;
+}
+
+
+void PlistTreeQueryTests::parseErrors_data()
+{
+    QTest::addColumn<QString>("path");
+    QTest::addColumn<int>("position");
+    QTest::addColumn<QString>("error");         // Empty if the message comes from elsewhere
+
+    QTest::newRow("no separator") << "Root x" << 5 << "Expected '.' or '['";
+    QTest::newRow("no key") << "Root." << 5 << "Expected a key";
+    QTest::newRow("unclosed bracket") << "Root.Items[" << 11 << "Expected ']'";
+    QTest::newRow("bad index") << "Root.Items[abc]" << 11 << "Expected an index, a slice, '*', a quoted key or a predicate";
+    QTest::newRow("unclosed quote") << "Root.Items[\"abc]" << 16 << "Missing closing quote";
+    QTest::newRow("no operator") << "Root.Items[?Price ! 3]" << 18 << "Expected ==, !=, <, <=, >, >= or =~";
+    QTest::newRow("no literal") << "Root.Items[?Price > ]" << 20 << "Expected a number, a string in quotes, true or false";
+    QTest::newRow("ordered boolean") << "Root.Items[?Enabled < true]" << 22 << "true and false can only be compared with == or !=";
+    QTest::newRow("unquoted regex") << "Root.Items[?Name =~ 5]" << 20 << "Expected a regular expression in quotes";
+    QTest::newRow("bad regex") << "Root.Items[?Name =~ \"(\"]" << 20 << QString();
+    QTest::newRow("unclosed parenthesis") << "Root.Items[?(Name == 'A']" << 24 << "Expected ')'";
+}
+
+
+void PlistTreeQueryTests::parseErrors()
+{
+    QFETCH(QString, path);
+    QFETCH(int, position);
+    QFETCH(QString, error);
+
+    PlistTreeQuery query;
+    QVERIFY(!query.compile(path));
+    QVERIFY(!query.isValid());
+    QCOMPARE(query.errorPosition(), position);
+
+    if ( !error.isEmpty() ) {
+        QCOMPARE(query.errorString(), error);
+    } else {
+        QVERIFY(!query.errorString().isEmpty());
+    }
+
+    // A failed path finds nothing.
+    QVERIFY(query.evaluate(_numbers).isEmpty());
+}
+
+
+void PlistTreeQueryTests::slices_data()
+{
+    QTest::addColumn<QString>("path");
+    QTest::addColumn<QStringList>("expected");
+
+    QTest::newRow("index") << "Root[3]" << (QStringList() << "3");
+    QTest::newRow("index from end") << "[-1]" << (QStringList() << "9");
+    QTest::newRow("index past end") << "[10]" << QStringList();
+    QTest::newRow("slice") << "Root[1:4]" << (QStringList() << "1" << "2" << "3");
+    QTest::newRow("slice from end") << "[-3:]" << (QStringList() << "7" << "8" << "9");
+    QTest::newRow("slice to") << "[:2]" << (QStringList() << "0" << "1");
+    QTest::newRow("slice to end") << "[ 8 : ]" << (QStringList() << "8" << "9");
+    QTest::newRow("slice backwards") << "[5:2]" << QStringList();
+    QTest::newRow("slice clamped") << "[-100:-8]" << (QStringList() << "0" << "1");
+    QTest::newRow("dotted index") << "Root.4" << (QStringList() << "4");
+}
+
+
+void PlistTreeQueryTests::slices()
+{
+    QFETCH(QString, path);
+    QFETCH(QStringList, expected);
+
+    PlistTreeQuery query;
+    QVERIFY2(query.compile(path), qPrintable(query.errorString()));
+    QCOMPARE(Describe(query.evaluate(_numbers)), expected);
+}
+
+
+void PlistTreeQueryTests::predicates_data()
+{
+    QTest::addColumn<QString>("path");
+    QTest::addColumn<QStringList>("expected");
+
+    QTest::newRow("greater") << "Root.Items[?Price > 10]" << (QStringList() << "Banana" << "Cherry");
+    QTest::newRow("less or equal") << "Root.Items[?Price <= 5]" << (QStringList() << "Apple");
+    QTest::newRow("real") << "Root.Items[?Price == 12.5]" << (QStringList() << "Banana");
+    QTest::newRow("boolean") << "Root.Items[?Enabled == true]" << (QStringList() << "Apple" << "Cherry");
+    QTest::newRow("not equal") << "Root.Items[?Enabled != true]" << (QStringList() << "Banana");
+    QTest::newRow("exists") << "Root.Items[?Price]" << (QStringList() << "Apple" << "Banana" << "Cherry");
+    QTest::newRow("string") << "Root.Items[?Name > 'B']" << (QStringList() << "Banana" << "Cherry" << "Date");
+    QTest::newRow("regex") << "Root.Items[?Name =~ \"^[AB]\"]" << (QStringList() << "Apple" << "Banana");
+    QTest::newRow("parentheses") << "Root.Items[?(Name == 'Date')]" << (QStringList() << "Date");
+    QTest::newRow("self") << "Root.Items[?@.Price >= 20]" << (QStringList() << "Cherry");
+    QTest::newRow("wrong type") << "Root.Items[?Price == '5']" << QStringList();
+    QTest::newRow("then a key") << "Root.Items[?Price > 10].Name" << (QStringList() << "Banana" << "Cherry");
+    QTest::newRow("descendants") << "Root..Name" << (QStringList() << "Apple" << "Banana" << "Cherry" << "Date");
+}
+
+
+void PlistTreeQueryTests::predicates()
+{
+    QFETCH(QString, path);
+    QFETCH(QStringList, expected);
+
+    PlistTreeQuery query;
+    QVERIFY2(query.compile(path), qPrintable(query.errorString()));
+    QCOMPARE(Describe(query.evaluate(_shop)), expected);
+}
+
+
+void PlistTreeQueryTests::limitResults()
+{
+    PlistTreeQuery query;
+    QVERIFY(query.compile("Root..Name"));
+
+    QCOMPARE(Describe(query.evaluate(_shop, 2)), QStringList() << "Apple" << "Banana");
+    QVERIFY(query.evaluate(_shop, 0).isEmpty());
+}
+
+
+void PlistTreeQueryTests::pathForItem()
+{
+    // The path of every item leads straight back to it.
+    PlistTreeQuery everything;
+    QVERIFY(everything.compile("Root..*"));
+
+    QList<PlistTreeItem*> items = everything.evaluate(_shop);
+    QVERIFY(!items.isEmpty());
+
+    for( int i = 0; i < items.count(); ++i )
+    {
+        PlistTreeQuery path;
+        QVERIFY(path.compile(PlistTreeQuery::PathForItem(items.at(i))));
+
+        QList<PlistTreeItem*> found = path.evaluate(_shop);
+        QCOMPARE(found.count(), 1);
+        QVERIFY(found.first() == items.at(i));
+    }
+}
+
+
+QTEST_GUILESS_MAIN(PlistTreeQueryTests)
+
+#include "PlistTreeQueryTests.moc"
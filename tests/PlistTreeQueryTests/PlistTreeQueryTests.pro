@@ -0,0 +1,12 @@
+#-------------------------------------------------
+#
+# Key path query tests.
+#
+#-------------------------------------------------
+
+TARGET = PlistTreeQueryTests
+
+SOURCES += \
+    PlistTreeQueryTests.cpp
+
+include(../tests.pri)
@@ -0,0 +1,188 @@
+#include <QtTest>
+
+#include "PlistTreeItem.h"
+#include "PlistTreeSearchCursor.h"
+
+
+namespace {
+    void PreOrder(PlistTreeItem *item, QList<PlistTreeItem*> &items)
+    {
+        items.append(item);
+
+        for( int i = 0; i < item->childCount(); ++i ) {
+            PreOrder(item->child(i), items);
+        }
+    }
+
+    PlistTreeItem *PendingDictionary(qint64 token)
+    {
+        PlistTreeItem *item = PlistTreeItem::Create(nullptr, PlistTreeItem::PlistDictionary);
+        item->setUnfetchedChildren(token, 1);
+        return item;
+    }
+}
+
+
+/**
+ * @brief Checks that PlistTreeSearchCursor walks and searches in document order, wraps at the ends, and only reads what it reaches.
+ */
+class PlistTreeSearchCursorTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void walkForwards();
+    void walkBackwards();
+    void findWraps();
+    void findOnlyStart();
+    void findNothing();
+    void fetchOnlyWhatIsReached();
+
+private:
+    // Root { a: [ "x", "target", { b: "y" } ], c: "target", d: {}, e: "z" }
+    PlistTreeItem *_root;
+};
+
+
+void PlistTreeSearchCursorTests::init()
+{
+    QVariantList a = QVariantList{"x", "target", QVariantMap{{"b", "y"}}};
+    _root = PlistTreeItem::Create(nullptr, QVariantMap{{"a", a}, {"c", "target"}, {"d", QVariantMap()}, {"e", "z"}});
+}
+
+
+void PlistTreeSearchCursorTests::cleanup()
+{
+    delete _root;
+    _root = nullptr;
+}
+
+
+void PlistTreeSearchCursorTests::walkForwards()
+{
+    QList<PlistTreeItem*> expected;
+    PreOrder(_root, expected);
+    QCOMPARE(expected.count(), 9);
+
+    PlistTreeSearchCursor cursor(_root);
+    QVERIFY(cursor.position() == nullptr);
+
+    for( int i = 0; i < expected.count(); ++i ) {
+        QVERIFY2(cursor.next() == expected.at(i), qPrintable(QString("Step %1").arg(i)));
+    }
+
+    // Past the end comes the root again.
+    QVERIFY(cursor.next() == _root);
+    QVERIFY(cursor.position() == _root);
+}
+
+
+void PlistTreeSearchCursorTests::walkBackwards()
+{
+    QList<PlistTreeItem*> expected;
+    PreOrder(_root, expected);
+
+    PlistTreeSearchCursor cursor(_root);
+
+    for( int i = expected.count() - 1; i >= 0; --i ) {
+        QVERIFY2(cursor.previous() == expected.at(i), qPrintable(QString("Step %1").arg(i)));
+    }
+
+    // Before the root comes the last item again.
+    QVERIFY(cursor.previous() == expected.last());
+}
+
+
+void PlistTreeSearchCursorTests::findWraps()
+{
+    PlistTreeItem *inArray = _root->childForKey("a")->child(1);
+    PlistTreeItem *inRoot = _root->childForKey("c");
+    PlistTextMatcher matcher("target");
+
+    PlistTreeSearchCursor cursor(_root);
+    QVERIFY(cursor.findNext(matcher, ReplaceValue) == inArray);
+    QVERIFY(cursor.findNext(matcher, ReplaceValue) == inRoot);
+
+    // From the last match, forwards goes round to the first, and backwards the other way.
+    QVERIFY(cursor.findNext(matcher, ReplaceValue) == inArray);
+    QVERIFY(cursor.findPrevious(matcher, ReplaceValue) == inRoot);
+    QVERIFY(cursor.findPrevious(matcher, ReplaceValue) == inArray);
+
+    // With no position, a backward search starts from the end.
+    cursor.setPosition(nullptr);
+    QVERIFY(cursor.findPrevious(matcher, ReplaceValue) == inRoot);
+}
+
+
+void PlistTreeSearchCursorTests::findOnlyStart()
+{
+    // The only match is where the search starts, so it's found after going all the way round.
+    PlistTreeItem *x = _root->childForKey("a")->child(0);
+    PlistTextMatcher matcher("x");
+
+    PlistTreeSearchCursor cursor(_root);
+    cursor.setPosition(x);
+    QVERIFY(cursor.findNext(matcher, ReplaceValue) == x);
+    QVERIFY(cursor.findPrevious(matcher, ReplaceValue) == x);
+
+    // Keys are only searched where they're asked for.
+    PlistTreeItem *b = _root->childForKey("a")->child(2)->childForKey("b");
+    QVERIFY(cursor.findNext(PlistTextMatcher("b"), ReplaceValue) == nullptr);
+    QVERIFY(cursor.findNext(PlistTextMatcher("b"), ReplaceKey) == b);
+}
+
+
+void PlistTreeSearchCursorTests::findNothing()
+{
+    PlistTreeItem *start = _root->childForKey("d");
+
+    PlistTreeSearchCursor cursor(_root);
+    cursor.setPosition(start);
+    QVERIFY(cursor.findNext(PlistTextMatcher("nowhere"), ReplaceAll) == nullptr);
+    QVERIFY(cursor.position() == start);
+    QVERIFY(cursor.findPrevious(PlistTextMatcher("nowhere"), ReplaceAll) == nullptr);
+    QVERIFY(cursor.position() == start);
+
+    // An invalid matcher doesn't move it either.
+    QVERIFY(cursor.findNext(PlistTextMatcher("(", ReplaceModeRegularExpression), ReplaceAll) == nullptr);
+    QVERIFY(cursor.position() == start);
+}
+
+
+void PlistTreeSearchCursorTests::fetchOnlyWhatIsReached()
+{
+    // [ {unfetched}, "target", {unfetched} ]
+    QScopedPointer<PlistTreeItem> root(PlistTreeItem::Create(nullptr, PlistTreeItem::PlistArray));
+    root->aendChild(PendingDictionary(1));
+    root->aendChild(PlistTreeItem::Create(nullptr, QVariant("target")));
+    root->aendChild(PendingDictionary(2));
+
+    QList<qint64> fetched;
+
+    PlistTreeSearchCursor::FetchFunction fetch = [&fetched](PlistTreeItem *item) {
+        fetched.append(item->fetchToken());
+        item->clearFetchToken();
+        item->aendChild(PlistTreeItem::Create(nullptr, QVariant("inner"), "key"));
+    };
+
+    PlistTreeSearchCursor cursor(root.data(), fetch);
+    QVERIFY(cursor.findNext(PlistTextMatcher("target"), ReplaceValue) == root->child(1));
+
+    // The first dictionary was walked through, the second one hasn't been reached.
+    QCOMPARE(fetched, QList<qint64>() << 1);
+    QCOMPARE(root->child(0)->childCount(), 1);
+    QVERIFY(root->child(2)->hasUnfetchedChildren());
+
+    // Going on past it reads it, finds what it held, and wraps back round.
+    QVERIFY(cursor.findNext(PlistTextMatcher("inner"), ReplaceValue) == root->child(2)->child(0));
+    QCOMPARE(fetched, QList<qint64>() << 1 << 2);
+    QVERIFY(cursor.findNext(PlistTextMatcher("inner"), ReplaceValue) == root->child(0)->child(0));
+}
+
+
+QTEST_GUILESS_MAIN(PlistTreeSearchCursorTests)
+
+#include "PlistTreeSearchCursorTests.moc"
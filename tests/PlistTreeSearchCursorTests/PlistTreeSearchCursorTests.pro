@@ -0,0 +1,12 @@
+#-------------------------------------------------
+#
+# Search cursor tests.
+#
+#-------------------------------------------------
+
+TARGET = PlistTreeSearchCursorTests
+
+SOURCES += \
+    PlistTreeSearchCursorTests.cpp
+
+include(../tests.pri)
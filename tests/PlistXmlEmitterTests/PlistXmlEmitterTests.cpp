@@ -0,0 +1,287 @@
+#include <QtTest>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "PlistXmlEmitter.h"
+#include "PlistTreeItem.h"
+#include "PlistTreeReader.h"
+#include "PlistTreeWriter.h"
+
+
+namespace {
+    qint64 UtcMSecs(int year, int month, int day, int hour = 0, int minute = 0, int second = 0)
+    {
+        return QDateTime(QDate(year, month, day), QTime(hour, minute, second), Qt::UTC).toMSecsSinceEpoch();
+    }
+}
+
+
+/**
+ * @brief Checks the text PlistXmlEmitter writes for each kind of value, and that the writer's output reads back the same.
+ *
+ * Elements are written compact at depth 0, so each one comes out as just its tags and value.
+ */
+class PlistXmlEmitterTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void reals_data();
+    void reals();
+    void realsRoundTrip();
+    void integers_data();
+    void integers();
+    void dates_data();
+    void dates();
+    void base64_data();
+    void base64();
+    void escaping_data();
+    void escaping();
+    void layout();
+    void writeAndReadBack();
+};
+
+
+void PlistXmlEmitterTests::reals_data()
+{
+    QTest::addColumn<double>("value");
+    QTest::addColumn<QByteArray>("expected");
+
+    QTest::newRow("zero") << 0.0 << QByteArray("0");
+    QTest::newRow("negative") << -2.5 << QByteArray("-2.5");
+    QTest::newRow("tenth") << 0.1 << QByteArray("0.1");
+    QTest::newRow("third") << 1.0 / 3.0 << QByteArray("0.3333333333333333");
+    QTest::newRow("17 digits") << 0.1 + 0.2 << QByteArray("0.30000000000000004");
+    QTest::newRow("large") << 1e300 << QByteArray("1e+300");
+    QTest::newRow("nan") << std::numeric_limits<double>::quiet_NaN() << QByteArray("nan");
+    QTest::newRow("infinity") << std::numeric_limits<double>::infinity() << QByteArray("+infinity");
+    QTest::newRow("negative infinity") << -std::numeric_limits<double>::infinity() << QByteArray("-infinity");
+}
+
+
+void PlistXmlEmitterTests::reals()
+{
+    QFETCH(double, value);
+    QFETCH(QByteArray, expected);
+
+    QByteArray buffer;
+    PlistXmlEmitter emitter(&buffer);
+    emitter.setCompact(true);
+    emitter.writeRealElement(value, 0);
+
+    QCOMPARE(buffer, "<real>" + expected + "</real>");
+
+    if ( std::isfinite(value) ) {
+        QCOMPARE(expected.toDouble(), value);
+    }
+}
+
+
+void PlistXmlEmitterTests::realsRoundTrip()
+{
+    // Arbitrary finite doubles, from random bit patterns, all read back exactly.
+    quint64 state = 12345;
+    int checked = 0;
+
+    while( checked < 10000 )
+    {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        double value = 0.0;
+        memcpy(&value, &state, sizeof(value));
+
+        if ( !std::isfinite(value) ) {
+            continue;
+        }
+
+        QByteArray buffer;
+        PlistXmlEmitter emitter(&buffer);
+        emitter.setCompact(true);
+        emitter.writeRealElement(value, 0);
+
+        QByteArray text = buffer.mid(6, buffer.size() - 13);
+        QVERIFY2(text.toDouble() == value, text.constData());
+        checked++;
+    }
+}
+
+
+void PlistXmlEmitterTests::integers_data()
+{
+    QTest::addColumn<qint64>("value");
+    QTest::addColumn<QByteArray>("expected");
+
+    QTest::newRow("zero") << qint64(0) << QByteArray("0");
+    QTest::newRow("negative") << qint64(-1) << QByteArray("-1");
+    QTest::newRow("maximum") << std::numeric_limits<qint64>::max() << QByteArray("9223372036854775807");
+    QTest::newRow("minimum") << std::numeric_limits<qint64>::min() << QByteArray("-9223372036854775808");
+}
+
+
+void PlistXmlEmitterTests::integers()
+{
+    QFETCH(qint64, value);
+    QFETCH(QByteArray, expected);
+
+    QByteArray buffer;
+    PlistXmlEmitter emitter(&buffer);
+    emitter.setCompact(true);
+    emitter.writeIntegerElement(value, 0);
+
+    QCOMPARE(buffer, "<integer>" + expected + "</integer>");
+}
+
+
+void PlistXmlEmitterTests::dates_data()
+{
+    QTest::addColumn<qint64>("msecs");
+    QTest::addColumn<QByteArray>("expected");
+
+    QTest::newRow("epoch") << qint64(0) << QByteArray("1970-01-01T00:00:00Z");
+    QTest::newRow("recent") << UtcMSecs(2013, 7, 13, 17, 32, 41) << QByteArray("2013-07-13T17:32:41Z");
+    QTest::newRow("leap day") << UtcMSecs(2000, 2, 29, 12) << QByteArray("2000-02-29T12:00:00Z");
+    QTest::newRow("milliseconds dropped") << UtcMSecs(2013, 7, 13) + 999 << QByteArray("2013-07-13T00:00:00Z");
+
+    // Before 1970, seconds and days have to round down rather than towards zero.
+    QTest::newRow("millisecond before epoch") << qint64(-1) << QByteArray("1969-12-31T23:59:59Z");
+    QTest::newRow("day before epoch") << qint64(-86400000) << QByteArray("1969-12-31T00:00:00Z");
+    QTest::newRow("1900") << UtcMSecs(1900, 1, 1) << QByteArray("1900-01-01T00:00:00Z");
+    QTest::newRow("1900 march") << UtcMSecs(1900, 3, 1, 23, 59, 59) << QByteArray("1900-03-01T23:59:59Z");
+    QTest::newRow("1600 leap day") << UtcMSecs(1600, 2, 29, 12, 34, 56) << QByteArray("1600-02-29T12:34:56Z");
+    QTest::newRow("year one") << UtcMSecs(1, 1, 1) << QByteArray("0001-01-01T00:00:00Z");
+}
+
+
+void PlistXmlEmitterTests::dates()
+{
+    QFETCH(qint64, msecs);
+    QFETCH(QByteArray, expected);
+
+    QByteArray buffer;
+    PlistXmlEmitter emitter(&buffer);
+    emitter.setCompact(true);
+    emitter.writeDateElement(msecs, 0);
+
+    QCOMPARE(buffer, "<date>" + expected + "</date>");
+}
+
+
+void PlistXmlEmitterTests::base64_data()
+{
+    QTest::addColumn<QByteArray>("bytes");
+
+    QByteArray everyByte;
+
+    for( int i = 0; i < 256; ++i ) {
+        everyByte.append(static_cast<char>(i));
+    }
+
+    // Every length modulo 3, so every kind of padding.
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("one") << QByteArray("f");
+    QTest::newRow("two") << QByteArray("fo");
+    QTest::newRow("three") << QByteArray("foo");
+    QTest::newRow("six") << QByteArray("foobar");
+    QTest::newRow("every byte") << everyByte;
+    QTest::newRow("every byte less one") << everyByte.left(255);
+}
+
+
+void PlistXmlEmitterTests::base64()
+{
+    QFETCH(QByteArray, bytes);
+
+    QByteArray buffer;
+    PlistXmlEmitter emitter(&buffer);
+    emitter.setCompact(true);
+    emitter.writeDataElement(bytes, 0);
+
+    QCOMPARE(buffer, "<data>" + bytes.toBase64() + "</data>");
+}
+
+
+void PlistXmlEmitterTests::escaping_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QByteArray>("expected");
+
+    QTest::newRow("plain") << QString("plain text") << QByteArray("plain text");
+    QTest::newRow("markup") << QString("a & b < c > d") << QByteArray("a &amp; b &lt; c &gt; d");
+    QTest::newRow("quotes") << QString("\"quoted\" 'text'") << QByteArray("\"quoted\" 'text'");
+    QTest::newRow("carriage return") << QString("one\r\ntwo") << QByteArray("one&#13;\ntwo");
+    QTest::newRow("two bytes") << QString::fromUtf8("caf\xc3\xa9") << QByteArray("caf\xc3\xa9");
+    QTest::newRow("three bytes") << QString::fromUtf8("\xe2\x82\xac") << QByteArray("\xe2\x82\xac");
+    QTest::newRow("surrogate pair") << QString::fromUtf8("\xf0\x9f\x98\x80") << QByteArray("\xf0\x9f\x98\x80");
+    QTest::newRow("unpaired surrogate") << QString(QChar(0xD800)) + "x" << QByteArray("\xef\xbf\xbdx");
+}
+
+
+void PlistXmlEmitterTests::escaping()
+{
+    QFETCH(QString, text);
+    QFETCH(QByteArray, expected);
+
+    QByteArray buffer;
+    PlistXmlEmitter emitter(&buffer);
+    emitter.setCompact(true);
+    emitter.writeStringElement("string", text, 0);
+
+    QCOMPARE(buffer, "<string>" + expected + "</string>");
+}
+
+
+void PlistXmlEmitterTests::layout()
+{
+    QByteArray buffer;
+    PlistXmlEmitter emitter(&buffer);
+    emitter.writeStartElement("dict", 1);
+    emitter.writeStringElement("key", "a", 2);
+    emitter.writeBooleanElement(true, 2);
+    emitter.writeEndElement("dict", 1);
+
+    QCOMPARE(buffer, QByteArray("    <dict>\n        <key>a</key>\n        <true/>\n    </dict>\n"));
+
+    buffer.clear();
+    emitter.setCompact(true);
+    emitter.writeStartElement("dict", 1);
+    emitter.writeStringElement("key", "a", 2);
+    emitter.writeBooleanElement(false, 2);
+    emitter.writeEndElement("dict", 1);
+
+    QCOMPARE(buffer, QByteArray("<dict><key>a</key><false/></dict>"));
+}
+
+
+void PlistXmlEmitterTests::writeAndReadBack()
+{
+    QVariantList values;
+    values.append(0.1 + 0.2);
+    values.append(-1e-300);
+    values.append(1.0 / 3.0);
+    values.append(QDateTime::fromMSecsSinceEpoch(UtcMSecs(1900, 3, 1, 23, 59, 59), Qt::UTC));
+    values.append(QDateTime::fromMSecsSinceEpoch(UtcMSecs(1969, 12, 31, 23, 59, 59), Qt::UTC));
+    values.append(QByteArray("\x00\x01\xfe\xff", 4));
+    values.append(QString::fromUtf8("a & b < c\r\n\xf0\x9f\x98\x80"));
+    values.append(std::numeric_limits<qint64>::min());
+
+    QScopedPointer<PlistTreeItem> written(PlistTreeItem::Create(nullptr, values));
+
+    QString xml;
+    PlistTreeWriter writer = PlistTreeWriter();
+    QVERIFY(writer.writeTreeToString(written.data(), &xml));
+
+    PlistTreeReader reader = PlistTreeReader();
+    QScopedPointer<PlistTreeItem> read(reader.readTreeFromString(xml));
+    QVERIFY(!read.isNull());
+    QCOMPARE(read->childCount(), written->childCount());
+
+    for( int i = 0; i < written->childCount(); ++i ) {
+        QVERIFY2(read->child(i)->subtreeHash() == written->child(i)->subtreeHash(), qPrintable(QString("Child %1").arg(i)));
+    }
+}
+
+
+QTEST_GUILESS_MAIN(PlistXmlEmitterTests)
+
+#include "PlistXmlEmitterTests.moc"
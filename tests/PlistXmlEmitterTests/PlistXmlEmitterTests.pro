@@ -0,0 +1,12 @@
+#-------------------------------------------------
+#
+# XML value formatting tests.
+#
+#-------------------------------------------------
+
+TARGET = PlistXmlEmitterTests
+
+SOURCES += \
+    PlistXmlEmitterTests.cpp
+
+include(../tests.pri)
@@ -0,0 +1,15 @@
+#------------------------
+# Shared by every test, so they all build against the same model code as
+# the application.
+#------------------------
+
+QT       += core gui testlib
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
+
+TEMPLATE = app
+
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+include($$PWD/../src/model/model.pri)
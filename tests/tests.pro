@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# Plist Pad tests. Each one is a headless QTest executable of its own,
+# and all of them run with:
+#
+#   qmake tests.pro && make && make check
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    PlistModelTests \
+    PlistTreeMergeTests \
+    PlistTreeDiffTests \
+    PlistTreeQueryTests \
+    PlistXmlEmitterTests \
+    PlistBinaryTreeTests \
+    PlistSearchIndexTests \
+    PlistTreeSearchCursorTests